@@ -0,0 +1,324 @@
+// bench_suite.cpp - Fixed LoRaCore benchmark scenarios, metrics and baseline comparison
+#include <Arduino.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "bench_suite.hpp"
+#include "lora_helpers.hpp"
+#include "lora_packets.hpp"
+
+// Допуски подобраны так, чтобы смена seed не давала ложных срабатываний,
+// а ухудшение протокола на 10-20% - давало
+const BenchMetricInfo benchMetrics[BENCH_METRIC_COUNT] = {
+    {"goodput_bps",         true,  0.05, 0.5},
+    {"delivery",            true,  0.00, 0.02},
+    {"latency_p50_ms",      false, 0.15, 20.0},
+    {"latency_p99_ms",      false, 0.20, 200.0},
+    {"ack_bytes",           false, 0.10, 64.0},
+    {"retransmissions",     false, 0.15, 5.0},
+    {"airtime_us_per_byte", false, 0.05, 5.0},
+};
+
+void collectMetrics(const SimResult &r, BenchSample &sample)
+{
+    sample.values[METRIC_GOODPUT] = r.goodputBps();
+    sample.values[METRIC_DELIVERY] = r.deliveryRatio();
+    sample.values[METRIC_LATENCY_P50] = r.latencyPercentile(50);
+    sample.values[METRIC_LATENCY_P99] = r.latencyPercentile(99);
+    sample.values[METRIC_ACK_BYTES] = r.ackBytes;
+    sample.values[METRIC_RETRANSMISSIONS] = r.retransmissions;
+    sample.values[METRIC_AIRTIME_PER_BYTE] = r.deliveredBytes ? (double)r.airtimeUs / r.deliveredBytes : 0.0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCENARIOS
+// ═══════════════════════════════════════════════════════════════════════════
+static SimScenario baseScenario(const char *name, uint64_t seed, uint32_t durationS)
+{
+    SimScenario s;
+    s.name = name;
+    s.seed = seed;
+    s.durationS = durationS;
+    return s;
+}
+
+// Master -> 1 slave с ACK, предложенная нагрузка ~130% ёмкости канала на профиле
+static SimScenario saturatingUnicast(uint8_t profile, uint64_t seed, uint32_t durationS)
+{
+    static constexpr uint8_t PAYLOAD = 40;  // > 30: не агрегируется
+    SimScenario s = baseScenario(("saturate_p" + std::to_string(profile)).c_str(), seed, durationS);
+    s.profile = profile;
+    s.commandPayload = PAYLOAD;
+    s.telemetryIntervalMs = 0;
+    uint32_t frameMs = profileTimeOnAirUs(profile, offsetof(LoRaPacket, payload) + PAYLOAD) / 1000;
+    s.commandIntervalMs = std::max<uint32_t>(5, frameMs * 3 / 4);
+    return s;
+}
+
+std::vector<SimScenario> benchScenarios(uint64_t seed)
+{
+    std::vector<SimScenario> list;
+
+    // Насыщающий unicast по профилям: от SF12 до GFSK 100 kbps
+    list.push_back(saturatingUnicast(0, seed, 600));
+    list.push_back(saturatingUnicast(2, seed, 300));
+    list.push_back(saturatingUnicast(4, seed, 120));
+    list.push_back(saturatingUnicast(6, seed, 120));
+    list.push_back(saturatingUnicast(8, seed, 120));
+    list.push_back(saturatingUnicast(9, seed, 120));
+    list.push_back(saturatingUnicast(12, seed, 60));
+
+    // Та же перегрузка SF8, производитель ограничен кредитом отправки
+    SimScenario credit = saturatingUnicast(4, seed, 120);
+    credit.name = "saturate_p4_credit";
+    credit.credit = true;
+    list.push_back(credit);
+
+    // Та же перегрузка SF8, команды со сроком жизни 3 с: истёкшие не передаются и не повторяются
+    SimScenario ttl = saturatingUnicast(4, seed, 120);
+    ttl.name = "saturate_p4_ttl";
+    ttl.ttlMs = 3000;
+    list.push_back(ttl);
+
+    // Состояние на SF12: телеметрия 40 B с ACK каждые 3 с, быстрее канала. Очередью / latest-value
+    for (bool latest : {false, true}) {
+        SimScenario s = baseScenario(latest ? "state_p0_latest" : "state_p0", seed, 300);
+        s.profile = 0;
+        s.commandIntervalMs = 0;
+        s.telemetryIntervalMs = 3000;
+        s.telemetryPayload = 40;
+        s.telemetryAck = true;
+        s.latestTelemetry = latest;
+        list.push_back(s);
+    }
+
+    // Смешанный трафик: команды с ACK + телеметрия без ACK
+    SimScenario mixed = baseScenario("mixed_cmd_tlm", seed, 600);
+    mixed.slaves = 4;
+    mixed.commandIntervalMs = 4000;
+    mixed.telemetryIntervalMs = 2000;
+    list.push_back(mixed);
+
+    // Агрегация: частая мелкая телеметрия, очередь не пустеет
+    for (bool aggregation : {true, false}) {
+        SimScenario s = baseScenario(aggregation ? "aggregation_on" : "aggregation_off", seed, 120);
+        s.commandIntervalMs = 0;
+        s.telemetryIntervalMs = 30;
+        s.aggregation = aggregation;
+        list.push_back(s);
+    }
+
+    // Интервал bulk ACK: телеметрия с ACK быстрее интервала накопления
+    for (uint32_t intervalMs : {0u, 300u, 1500u}) {
+        std::string name = intervalMs ? "bulk_ack_" + std::to_string(intervalMs) : std::string("bulk_ack_auto");
+        SimScenario s = baseScenario(name.c_str(), seed, 300);
+        s.commandIntervalMs = 0;
+        s.telemetryIntervalMs = 400;
+        s.telemetryAck = true;
+        s.bulkAckIntervalMs = intervalMs;
+        list.push_back(s);
+    }
+
+    // Линии с потерями и замираниями
+    for (float loss : {0.1f, 0.3f}) {
+        SimScenario s = baseScenario(loss < 0.2f ? "lossy_10" : "lossy_30", seed, 600);
+        s.slaves = 2;
+        s.channel.packetLossRate = loss;
+        s.channel.shadowingSigmaDb = 4.0f;
+        list.push_back(s);
+    }
+
+    // Звезда: 1 master + N slave
+    for (uint8_t slaves : {2, 8, 32}) {
+        SimScenario s = baseScenario(("star_" + std::to_string(slaves)).c_str(), seed, 600);
+        s.slaves = slaves;
+        s.commandIntervalMs = 10000;
+        s.telemetryIntervalMs = 10000;
+        list.push_back(s);
+    }
+
+    // Звезда с одной плохой линией: команды 40 B с ACK всем 4 slave, к первому 60% потерь
+    SimScenario badLink = baseScenario("star_4_badlink", seed, 300);
+    badLink.slaves = 4;
+    badLink.badLinkLoss = 0.6f;
+    badLink.commandPayload = 40;
+    badLink.commandIntervalMs = 1000;
+    badLink.telemetryIntervalMs = 0;
+    list.push_back(badLink);
+
+    // Дальняя связь: SF12 напрямую против SF8 через цепочку ретрансляторов
+    for (uint8_t relays : {0, 1, 2}) {
+        std::string name = relays ? "relay_" + std::to_string(relays) + "hop_p4" : std::string("relay_direct_p0");
+        SimScenario s = baseScenario(name.c_str(), seed, 900);
+        s.profile = relays ? 4 : 0;
+        s.relays = relays;
+        s.distanceM = relays == 2 ? 45000.0f : 30000.0f;
+        s.commandIntervalMs = 10000;
+        s.telemetryIntervalMs = 10000;
+        list.push_back(s);
+    }
+
+    // Звезда под TDMA: те же нагрузки, что star_8/star_32
+    for (uint8_t slaves : {8, 32}) {
+        SimScenario s = baseScenario(("star_" + std::to_string(slaves) + "_tdma").c_str(), seed, 600);
+        s.slaves = slaves;
+        s.tdma = true;
+        s.commandIntervalMs = 10000;
+        s.telemetryIntervalMs = 10000;
+        list.push_back(s);
+    }
+
+    // Звезда под polling: те же нагрузки
+    for (uint8_t slaves : {8, 32}) {
+        SimScenario s = baseScenario(("star_" + std::to_string(slaves) + "_poll").c_str(), seed, 600);
+        s.slaves = slaves;
+        s.polling = true;
+        s.commandIntervalMs = 10000;
+        s.telemetryIntervalMs = 10000;
+        list.push_back(s);
+    }
+
+    // Передача блоков 64 KB master -> slave поверх обычного трафика: goodput включает файл
+    SimScenario transfer = baseScenario("transfer_64k", seed, 600);
+    transfer.transferBytes = 64 * 1024;
+    transfer.commandIntervalMs = 10000;
+    transfer.telemetryIntervalMs = 10000;
+    list.push_back(transfer);
+    return list;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CSV / JSON
+// ═══════════════════════════════════════════════════════════════════════════
+bool writeCsv(const char *path, const std::vector<BenchRun> &runs)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "scenario,seed");
+    for (const BenchMetricInfo &m : benchMetrics)
+        fprintf(f, ",%s", m.name);
+    fprintf(f, "\n");
+    for (const BenchRun &run : runs) {
+        if (!run.ok)
+            continue;
+        fprintf(f, "%s,%llu", run.scenario.name.c_str(), (unsigned long long)run.scenario.seed);
+        for (double v : run.sample.values)
+            fprintf(f, ",%.4f", v);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return true;
+}
+
+bool writeJson(const char *path, const std::vector<BenchRun> &runs)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "{\n  \"scenarios\": [\n");
+    for (size_t i = 0; i < runs.size(); i++) {
+        const BenchRun &run = runs[i];
+        const SimScenario &s = run.scenario;
+        fprintf(f, "    {\"name\": \"%s\", \"seed\": %llu, \"profile\": %u, \"slaves\": %u, "
+                   "\"duration_s\": %u, \"ok\": %s, \"wall_s\": %.2f, \"metrics\": {",
+                s.name.c_str(), (unsigned long long)s.seed, s.profile, s.slaves, s.durationS,
+                run.ok ? "true" : "false", run.wallS);
+        for (int m = 0; m < BENCH_METRIC_COUNT; m++)
+            fprintf(f, "%s\"%s\": %.4f", m ? ", " : "", benchMetrics[m].name, run.sample.values[m]);
+        fprintf(f, "}}%s\n", i + 1 < runs.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static std::vector<std::string> splitCsvLine(const char *line)
+{
+    std::vector<std::string> fields;
+    std::string field;
+    for (const char *p = line; *p && *p != '\n' && *p != '\r'; p++) {
+        if (*p == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += *p;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+bool loadBaseline(const char *path, uint64_t seed, BenchBaseline &baseline)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    char line[512];
+    if (!fgets(line, sizeof(line), f)) {
+        fclose(f);
+        return false;
+    }
+    // Колонки ищутся по имени: baseline со старым набором метрик остаётся читаемым
+    std::vector<std::string> header = splitCsvLine(line);
+    std::vector<int> column(header.size(), -1);
+    for (size_t c = 0; c < header.size(); c++)
+        for (int m = 0; m < BENCH_METRIC_COUNT; m++)
+            if (header[c] == benchMetrics[m].name)
+                column[c] = m;
+
+    while (fgets(line, sizeof(line), f)) {
+        std::vector<std::string> fields = splitCsvLine(line);
+        if (fields.size() != header.size() || fields[0].empty())
+            continue;
+        if (strtoull(fields[1].c_str(), nullptr, 10) != seed)
+            continue;
+        BenchSample sample;
+        for (int m = 0; m < BENCH_METRIC_COUNT; m++)
+            sample.values[m] = NAN;
+        for (size_t c = 2; c < fields.size(); c++)
+            if (column[c] >= 0)
+                sample.values[column[c]] = strtod(fields[c].c_str(), nullptr);
+        baseline[fields[0]] = sample;
+    }
+    fclose(f);
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// COMPARISON
+// ═══════════════════════════════════════════════════════════════════════════
+unsigned compareWithBaseline(const std::vector<BenchRun> &runs, const BenchBaseline &baseline,
+                             double toleranceScale)
+{
+    unsigned regressions = 0;
+    for (const BenchRun &run : runs) {
+        const std::string &name = run.scenario.name;
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            printf("  %-18s not in baseline\n", name.c_str());
+            continue;
+        }
+        if (!run.ok) {
+            printf("  %-18s FAILED: scenario did not finish\n", name.c_str());
+            regressions++;
+            continue;
+        }
+        for (int m = 0; m < BENCH_METRIC_COUNT; m++) {
+            const BenchMetricInfo &info = benchMetrics[m];
+            double base = it->second.values[m];
+            double value = run.sample.values[m];
+            if (isnan(base))
+                continue;
+            double slack = (info.relTolerance * fabs(base) + info.absTolerance) * toleranceScale;
+            bool worse = info.higherIsBetter ? value < base - slack : value > base + slack;
+            if (worse) {
+                printf("  %-18s REGRESSION %s: %.2f -> %.2f (tolerance %.2f)\n", name.c_str(), info.name, base, value, slack);
+                regressions++;
+            }
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,66 @@
+// bench_suite.hpp - Fixed LoRaCore benchmark scenarios, metrics and baseline comparison
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "sim_scenario.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// METRICS
+// ═══════════════════════════════════════════════════════════════════════════
+enum BenchMetricId
+{
+    METRIC_GOODPUT = 0,             // Полезные байты приложения / с
+    METRIC_DELIVERY,                // Доля доставленных сообщений
+    METRIC_LATENCY_P50,             // End-to-end, мс
+    METRIC_LATENCY_P99,
+    METRIC_ACK_BYTES,               // Байт ACK + BULK ACK в эфире
+    METRIC_RETRANSMISSIONS,         // Повторных кадров
+    METRIC_AIRTIME_PER_BYTE,        // мкс эфира на доставленный байт приложения
+    BENCH_METRIC_COUNT
+};
+
+// Регрессия: значение хуже baseline больше чем на rel * |baseline| + abs
+struct BenchMetricInfo
+{
+    const char *name;               // Колонка CSV / ключ JSON
+    bool higherIsBetter;
+    double relTolerance;
+    double absTolerance;
+};
+
+extern const BenchMetricInfo benchMetrics[BENCH_METRIC_COUNT];
+
+struct BenchSample
+{
+    double values[BENCH_METRIC_COUNT] = {};
+};
+
+void collectMetrics(const SimResult &result, BenchSample &sample);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCENARIOS
+// ═══════════════════════════════════════════════════════════════════════════
+std::vector<SimScenario> benchScenarios(uint64_t seed);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// REPORTS
+// ═══════════════════════════════════════════════════════════════════════════
+struct BenchRun
+{
+    SimScenario scenario;
+    BenchSample sample;
+    bool ok = false;                // Процесс сценария завершился и вернул метрики
+    float wallS = 0.0f;
+};
+
+typedef std::map<std::string, BenchSample> BenchBaseline;
+
+bool writeCsv(const char *path, const std::vector<BenchRun> &runs);
+bool writeJson(const char *path, const std::vector<BenchRun> &runs);
+bool loadBaseline(const char *path, uint64_t seed, BenchBaseline &baseline);
+
+// Печатает сравнение, возвращает число регрессий. toleranceScale умножает допуски.
+unsigned compareWithBaseline(const std::vector<BenchRun> &runs, const BenchBaseline &baseline,
+                             double toleranceScale);
@@ -0,0 +1,188 @@
+// LoRa protocol benchmark: fixed scenario suite over SimChannel with regression check
+// Usage: lora_bench [options], see --help
+#include <Arduino.h>
+#include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bench_suite.hpp"
+
+// Каждый сценарий - отдельный процесс (задачи LoRaCore не останавливаются),
+// метрики возвращаются через pipe
+struct BenchChild
+{
+    pid_t pid = -1;
+    int fd = -1;
+    size_t index = 0;
+    std::chrono::steady_clock::time_point started;
+};
+
+static bool startScenario(const SimScenario &scenario, size_t index, BenchChild &child)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        SimResult result = runScenario(scenario);
+        BenchSample sample;
+        collectMetrics(result, sample);
+        bool ok = write(fds[1], &sample, sizeof(sample)) == (ssize_t)sizeof(sample);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    child.pid = pid;
+    child.fd = fds[0];
+    child.index = index;
+    child.started = std::chrono::steady_clock::now();
+    return true;
+}
+
+static void finishScenario(BenchChild &child, int status, BenchRun &run)
+{
+    ssize_t got = read(child.fd, &run.sample, sizeof(run.sample));
+    close(child.fd);
+    run.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && got == (ssize_t)sizeof(run.sample);
+    run.wallS = std::chrono::duration<float>(std::chrono::steady_clock::now() - child.started).count();
+}
+
+static void printRun(const BenchRun &run)
+{
+    const double *v = run.sample.values;
+    if (!run.ok) {
+        printf("%-18s FAILED\n", run.scenario.name.c_str());
+        return;
+    }
+    printf("%-18s %9.1f %6.1f%% %8.0f %8.0f %8.0f %6.0f %9.0f %6.1fs\n", run.scenario.name.c_str(),
+           v[METRIC_GOODPUT], 100.0 * v[METRIC_DELIVERY], v[METRIC_LATENCY_P50], v[METRIC_LATENCY_P99],
+           v[METRIC_ACK_BYTES], v[METRIC_RETRANSMISSIONS], v[METRIC_AIRTIME_PER_BYTE], run.wallS);
+}
+
+static void printUsage(const char *prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  --seed N             RNG seed of every scenario (default 1)\n");
+    printf("  --filter TEXT        Run only scenarios whose name contains TEXT\n");
+    printf("  --list               Print scenario names and exit\n");
+    printf("  --jobs N             Scenarios in parallel (default: CPU count)\n");
+    printf("  --csv FILE           Write metrics as CSV\n");
+    printf("  --json FILE          Write metrics as JSON\n");
+    printf("  --baseline FILE      Compare with baseline CSV, exit 2 on regression\n");
+    printf("  --tolerance X        Multiply regression tolerances (default 1.0)\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t seed = 1;
+    String filter;
+    bool listOnly = false;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *csvPath = nullptr;
+    const char *jsonPath = nullptr;
+    const char *baselinePath = nullptr;
+    double toleranceScale = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "--list") {
+            listOnly = true;
+        } else if (arg == "--jobs" && hasValue) {
+            jobs = String(argv[++i]).toInt();
+        } else if (arg == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        } else if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            toleranceScale = String(argv[++i]).toFloat();
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    jobs = std::max(1L, jobs);
+
+    std::vector<BenchRun> runs;
+    for (const SimScenario &scenario : benchScenarios(seed)) {
+        if (filter.length() && String(scenario.name.c_str()).indexOf(filter) < 0)
+            continue;
+        BenchRun run;
+        run.scenario = scenario;
+        runs.push_back(run);
+    }
+    if (listOnly) {
+        for (const BenchRun &run : runs)
+            printf("%-18s profile=%u slaves=%u duration=%us\n", run.scenario.name.c_str(),
+                   run.scenario.profile, run.scenario.slaves, run.scenario.durationS);
+        return 0;
+    }
+
+    BenchBaseline baseline;
+    if (baselinePath && !loadBaseline(baselinePath, seed, baseline)) {
+        printf("Cannot read baseline %s\n", baselinePath);
+        return 1;
+    }
+
+    printf("═══ lora_bench: %u scenarios, seed %llu, %ld jobs\n", (unsigned)runs.size(),
+           (unsigned long long)seed, jobs);
+    printf("%-18s %9s %7s %8s %8s %8s %6s %9s %7s\n", "scenario", "goodput", "deliv", "p50 ms", "p99 ms",
+           "ack B", "retx", "air us/B", "wall");
+
+    std::vector<BenchChild> active;
+    size_t next = 0;
+    while (next < runs.size() || !active.empty()) {
+        while (next < runs.size() && (long)active.size() < jobs) {
+            BenchChild child;
+            if (!startScenario(runs[next].scenario, next, child)) {
+                printf("fork() failed for %s\n", runs[next].scenario.name.c_str());
+                return 1;
+            }
+            active.push_back(child);
+            next++;
+        }
+
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+        for (size_t i = 0; i < active.size(); i++) {
+            if (active[i].pid != pid)
+                continue;
+            BenchRun &run = runs[active[i].index];
+            finishScenario(active[i], status, run);
+            printRun(run);
+            active.erase(active.begin() + i);
+            break;
+        }
+    }
+
+    if (csvPath && !writeCsv(csvPath, runs))
+        printf("Cannot write %s\n", csvPath);
+    if (jsonPath && !writeJson(jsonPath, runs))
+        printf("Cannot write %s\n", jsonPath);
+
+    bool failed = false;
+    for (const BenchRun &run : runs)
+        failed |= !run.ok;
+
+    if (baselinePath) {
+        printf("═══ baseline %s (tolerance x%.2f)\n", baselinePath, toleranceScale);
+        unsigned regressions = compareWithBaseline(runs, baseline, toleranceScale);
+        printf("  %u regressions\n", regressions);
+        if (regressions)
+            return 2;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// LoRa channel simulator: N LoRaCore nodes over a shared virtual channel
+// Usage: lora_sim [options], see --help
+#include <Arduino.h>
+#include <map>
+#include "sim_scenario.hpp"
+
+static void printUsage(const char *prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  --seed N             RNG seed (default 1)\n");
+    printf("  --duration S         Simulated seconds of traffic (default 600)\n");
+    printf("  --profile P          Profile index 0..%d (default 4)\n", LORA_PROFILE_COUNT - 1);
+    printf("  --slaves N           Slaves around the master (default 1)\n");
+    printf("  --distance M         Master-slave distance, m (default 500)\n");
+    printf("  --relays N           Relay nodes on the master-slave line (default 0)\n");
+    printf("  --tdma               Beacon-synchronised TDMA: master schedules slave slots\n");
+    printf("  --poll               Polling MAC: master polls slaves, replies carry AGR + ACKs\n");
+    printf("  --loss P             Random frame loss 0..1 (default 0)\n");
+    printf("  --bad-link P         Extra loss 0..1 on the master - first slave link (default 0)\n");
+    printf("  --shadowing DB       Per-frame fading sigma, dB (default 0)\n");
+    printf("  --ple N              Path loss exponent (default 2.7)\n");
+    printf("  --cmd-interval MS    Master -> each slave, 0 = off (default 5000)\n");
+    printf("  --tlm-interval MS    Each slave -> master, 0 = off (default 5000)\n");
+    printf("  --payload B          Application payload bytes (default 12)\n");
+    printf("  --tlm-ack            Telemetry requires ACK (no aggregation)\n");
+    printf("  --transfer KB        Block transfer of KB kilobytes master -> first slave\n");
+    printf("  --credit             Producers skip messages while getSendCredit() is 0\n");
+    printf("  --ttl MS             Message lifetime: expired frames are not sent or retried, 0 = off\n");
+    printf("  --heartbeat MS       Master broadcast heartbeat with network time stamp, 0 = off (default 0)\n");
+    printf("  --latest             Telemetry via sendPacketLatest(): newer sample replaces queued one\n");
+    printf("  --duty               Enforce EU868 sub-band duty cycle on all nodes\n");
+    printf("  --tpc                Per-peer TX power control from link reports on all nodes\n");
+    printf("  --no-aggregation     Disable AGR aggregation on all nodes\n");
+    printf("  --bulk-ack MS        Bulk ACK interval, 0 = per profile (default 0)\n");
+    printf("  --auto-asa           Enable auto-ASA on all nodes\n");
+    printf("  --legacy-asa N       First N slaves run ASA without MTU, as firmware before profile MTU\n");
+    printf("  --verbose            Print LoRaCore logs of all nodes\n");
+    printf("  --metrics            Print LoRaCore metrics of the master\n");
+    printf("  --stack              Print peak stack use of LoRaCore tasks (maximum over nodes)\n");
+    printf("  --trace N            Per-packet stage tracing, print every Nth frame (0 = metrics only)\n");
+}
+
+int main(int argc, char **argv)
+{
+    SimScenario scenario;
+    scenario.name = "lora_sim";
+    bool printMetrics = false;
+    bool printStack = false;
+
+    for (int i = 1; i < argc; i++) {
+        String arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) {
+            scenario.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--duration" && hasValue) {
+            scenario.durationS = String(argv[++i]).toInt();
+        } else if (arg == "--profile" && hasValue) {
+            scenario.profile = String(argv[++i]).toInt();
+        } else if (arg == "--slaves" && hasValue) {
+            scenario.slaves = String(argv[++i]).toInt();
+        } else if (arg == "--distance" && hasValue) {
+            scenario.distanceM = String(argv[++i]).toFloat();
+        } else if (arg == "--relays" && hasValue) {
+            scenario.relays = String(argv[++i]).toInt();
+        } else if (arg == "--tdma") {
+            scenario.tdma = true;
+        } else if (arg == "--poll") {
+            scenario.polling = true;
+        } else if (arg == "--loss" && hasValue) {
+            scenario.channel.packetLossRate = String(argv[++i]).toFloat();
+        } else if (arg == "--bad-link" && hasValue) {
+            scenario.badLinkLoss = String(argv[++i]).toFloat();
+        } else if (arg == "--shadowing" && hasValue) {
+            scenario.channel.shadowingSigmaDb = String(argv[++i]).toFloat();
+        } else if (arg == "--ple" && hasValue) {
+            scenario.channel.pathLossExponent = String(argv[++i]).toFloat();
+        } else if (arg == "--cmd-interval" && hasValue) {
+            scenario.commandIntervalMs = String(argv[++i]).toInt();
+        } else if (arg == "--tlm-interval" && hasValue) {
+            scenario.telemetryIntervalMs = String(argv[++i]).toInt();
+        } else if (arg == "--payload" && hasValue) {
+            scenario.commandPayload = scenario.telemetryPayload = String(argv[++i]).toInt();
+        } else if (arg == "--transfer" && hasValue) {
+            scenario.transferBytes = String(argv[++i]).toInt() * 1024;
+        } else if (arg == "--ttl" && hasValue) {
+            scenario.ttlMs = String(argv[++i]).toInt();
+        } else if (arg == "--heartbeat" && hasValue) {
+            scenario.heartbeatIntervalMs = String(argv[++i]).toInt();
+        } else if (arg == "--latest") {
+            scenario.latestTelemetry = true;
+        } else if (arg == "--duty") {
+            scenario.dutyCycle = true;
+        } else if (arg == "--tpc") {
+            scenario.txPowerControl = true;
+        } else if (arg == "--credit") {
+            scenario.credit = true;
+        } else if (arg == "--tlm-ack") {
+            scenario.telemetryAck = true;
+        } else if (arg == "--no-aggregation") {
+            scenario.aggregation = false;
+        } else if (arg == "--bulk-ack" && hasValue) {
+            scenario.bulkAckIntervalMs = String(argv[++i]).toInt();
+        } else if (arg == "--auto-asa") {
+            scenario.autoAsa = true;
+        } else if (arg == "--legacy-asa" && hasValue) {
+            scenario.legacyAsa = String(argv[++i]).toInt();
+        } else if (arg == "--verbose") {
+            scenario.verbose = true;
+        } else if (arg == "--metrics") {
+            printMetrics = true;
+        } else if (arg == "--stack") {
+            printStack = true;
+        } else if (arg == "--trace" && hasValue) {
+            scenario.trace = true;
+            scenario.traceSampleEvery = String(argv[++i]).toInt();
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (scenario.profile >= LORA_PROFILE_COUNT || scenario.slaves == 0 || scenario.slaves + scenario.relays > 200) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SimResult result = runScenario(scenario);
+    printResult(scenario, result);
+    if (printMetrics)
+        printf("═══ master metrics\n%s", result.masterMetrics.toString().c_str());
+    if (printStack) {
+        // Задачи с одним именем на всех узлах - одна строка с наибольшей глубиной
+        std::map<std::string, host::TaskStack> stacks;
+        for (const host::TaskStack &task : host::taskStacks()) {
+            auto it = stacks.find(task.name);
+            if (it == stacks.end() || task.used > it->second.used)
+                stacks[task.name] = task;
+        }
+        printf("═══ task stacks (host build, bytes)\n");
+        for (const auto &entry : stacks)
+            printf("  %-12s depth=%5u used=%5u%s\n", entry.first.c_str(), entry.second.depth, entry.second.used,
+                   entry.second.used > entry.second.depth ? "  OVERFLOW" : "");
+    }
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,459 @@
+// sim_scenario.cpp - Multi-node LoRaCore scenario over SimChannel
+#include <Arduino.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <math.h>
+#include <memory>
+#include <set>
+#include "sim_scenario.hpp"
+#include "LoRaCore.hpp"
+
+// Payload сообщения приложения (дополняется нулями до заданной длины)
+#pragma pack(push, 1)
+struct SimMessage
+{
+    uint8_t magic;
+    LoraAddress_t origin;
+    uint32_t seq;
+    uint32_t sentMs;
+};
+#pragma pack(pop)
+
+static constexpr uint8_t SIM_MESSAGE_MAGIC = 0x5A;
+static constexpr uint32_t SIM_TICK_MS = 5;              // Период опроса входящих очередей
+static constexpr uint32_t SIM_DRAIN_MS = 15000;         // Дожидаемся повторов после конца трафика
+static constexpr float SIM_CLUSTER_RADIUS_M = 100.0f;   // Slave вокруг конца цепочки ретрансляторов
+
+struct SimNode
+{
+    LoraAddress_t address = 0;
+    std::unique_ptr<SimRadio> radio;
+    std::unique_ptr<LoRaCore> core;
+    uint32_t nextSeq = 0;
+    uint8_t lastProfile = 0;
+    LoraAddress_t ackPeer = 0;                      // Последний отправитель пакета с ACK
+    std::vector<unsigned long> nextSendMs;          // Master: по slave, slave: одно значение
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RESULT
+// ═══════════════════════════════════════════════════════════════════════════
+float SimResult::goodputBps() const
+{
+    return durationS ? (float)deliveredBytes / durationS : 0.0f;
+}
+
+uint32_t SimResult::latencyPercentile(float p) const
+{
+    if (latencyMs.empty())
+        return 0;
+    std::vector<uint32_t> sorted = latencyMs;
+    std::sort(sorted.begin(), sorted.end());
+    size_t idx = (size_t)(p / 100.0f * (sorted.size() - 1) + 0.5f);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+float SimResult::latencyAvgMs() const
+{
+    if (latencyMs.empty())
+        return 0.0f;
+    uint64_t sum = 0;
+    for (uint32_t v : latencyMs)
+        sum += v;
+    return (float)sum / latencyMs.size();
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRAFFIC
+// ═══════════════════════════════════════════════════════════════════════════
+static unsigned long jitteredInterval(HostRandom &rng, uint32_t intervalMs)
+{
+    // ±10%, чтобы узлы не синхронизировались
+    return (unsigned long)(intervalMs * (0.9 + 0.2 * rng.uniform()));
+}
+
+static void sendMessage(SimNode &from, LoraAddress_t to, uint8_t packetType, uint8_t payloadLen,
+                        bool ackRequired, uint32_t ttlMs, bool credit, bool latest, SimResult &result)
+{
+    // Производитель с обратным давлением пропускает сообщение, а не копит очередь
+    if (credit && from.core->getSendCredit(to).frames == 0) {
+        result.throttled++;
+        return;
+    }
+    uint8_t payload[MAX_LORA_PAYLOAD] = {};
+    SimMessage msg = {SIM_MESSAGE_MAGIC, from.address, from.nextSeq++, (uint32_t)millis()};
+    memcpy(payload, &msg, sizeof(msg));
+
+    PacketBase base;
+    base.packetType = packetType;
+    // Больше базового MTU - только к узлу, с которым MTU согласован через ASA
+    base.payloadLen = std::max((uint8_t)sizeof(msg), std::min(payloadLen, from.core->getMtu(to)));
+    base.ackRequired = ackRequired;
+    base.ttlMs = ttlMs;
+    if (latest) {
+        from.core->sendPacketLatest(to, &base, payload, packetType);
+    } else {
+        from.core->sendPacketBase(to, &base, payload);
+    }
+    result.sent++;
+}
+
+static void handleMessage(const uint8_t *payload, uint8_t len, std::set<uint64_t> &seen, SimResult &result)
+{
+    if (len < sizeof(SimMessage) || payload[0] != SIM_MESSAGE_MAGIC)
+        return;
+    SimMessage msg;
+    memcpy(&msg, payload, sizeof(msg));
+
+    uint64_t key = ((uint64_t)msg.origin << 32) | msg.seq;
+    if (!seen.insert(key).second) {
+        result.duplicates++;
+        return;
+    }
+    result.delivered++;
+    result.deliveredBytes += len;
+    result.latencyMs.push_back((uint32_t)millis() - msg.sentMs);
+}
+
+static void drainIncoming(SimNode &node, std::set<uint64_t> &seen, SimResult &result)
+{
+    LoRaPacket pkt;
+    while (node.core->receive(pkt)) {
+        if (pkt.isAckRequired())
+            node.ackPeer = pkt.getSenderId();
+        // Маяки TDMA - heartbeat, не сообщения приложения
+        if (pkt.payloadLen > MAX_LORA_PAYLOAD || pkt.packetType == CMD_HEARTBEAT)
+            continue;
+        if (pkt.packetType == CMD_AGR) {
+            PacketAggregated agr;
+            agr.deserialize(pkt.payload, pkt.payloadLen, [&](uint8_t, const uint8_t *sub, uint8_t subLen) {
+                handleMessage(sub, subLen, seen, result);
+            });
+        } else {
+            handleMessage(pkt.payload, pkt.payloadLen, seen, result);
+        }
+    }
+}
+
+// Кадры в эфире: служебный трафик ACK и повторы (тот же sender/id и те же байты)
+static void observeFrame(const uint8_t *data, size_t len, std::map<uint16_t, uint32_t> &lastFrameHash,
+                         SimResult &result)
+{
+    if (len < offsetof(LoRaPacket, payload))
+        return;
+    const LoRaPacket *pkt = (const LoRaPacket *)data;
+
+    result.framesTx++;
+    // ACK через ретрансляторы - тот же служебный трафик
+    uint8_t type = pkt->packetType;
+    LoRaRelayHeader relay;
+    if (len >= offsetof(LoRaPacket, payload) + LORA_RELAY_HEADER_SIZE && readRelayHeader(*pkt, relay))
+        type = relay.innerType;
+    if (type == CMD_ACK || type == CMD_BULK_ACK) {
+        result.ackFrames++;
+        result.ackBytes += len;
+        return;
+    }
+    // Опросы не повторяются; одинаковые пустые опросы с тем же id после переполнения - не повтор
+    if (type == CMD_POLL)
+        return;
+
+    uint32_t hash = 2166136261u; // FNV-1a по типу и payload
+    hash = (hash ^ pkt->packetType) * 16777619u;
+    for (size_t i = offsetof(LoRaPacket, payload); i < len; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+
+    uint16_t key = ((uint16_t)pkt->senderId << 8) | pkt->packetId;
+    auto it = lastFrameHash.find(key);
+    if (it != lastFrameHash.end() && it->second == hash)
+        result.retransmissions++;
+    lastFrameHash[key] = hash;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RUN
+// ═══════════════════════════════════════════════════════════════════════════
+SimResult runScenario(const SimScenario &scenario)
+{
+    SimResult result;
+    result.durationS = scenario.durationS;
+
+    host::setClockMode(host::ClockMode::SIMULATED);
+    host::seedRandom(scenario.seed);
+    Serial.setEnabled(scenario.verbose);
+
+    SimChannelConfig channelConfig = scenario.channel;
+    channelConfig.seed = scenario.seed ^ 0xC4A77E1ULL;
+    // Канал, радио и LoRaCore не удаляются: их задачи и события ядра живут до выхода процесса
+    SimChannel &channel = *new SimChannel(channelConfig);
+    HostRandom trafficRng(scenario.seed ^ 0x7AFF1CULL);
+
+    std::map<uint16_t, uint32_t> lastFrameHash;
+    // Кадры каждого передатчика за окно duty cycle: (начало, эфир), сумма окна
+    std::map<const SimRadio *, std::deque<std::pair<unsigned long, uint32_t>>> dutyFrames;
+    std::map<const SimRadio *, uint32_t> dutyUsedUs;
+    // Узлы legacyAsa: кадр длиннее LORA_BASE_MTU прошивка без MTU профиля не примет
+    auto isLegacy = [&scenario](LoraAddress_t address) {
+        return address >= DEVICE_ID_SLAVE && address < DEVICE_ID_SLAVE + std::min(scenario.legacyAsa, scenario.slaves);
+    };
+    channel.setFrameObserver([&](const SimRadio &radio, const uint8_t *data, size_t len, uint32_t airtimeUs) {
+        result.airtimeUs += airtimeUs;
+        observeFrame(data, len, lastFrameHash, result);
+        if (len > offsetof(LoRaPacket, payload) + LORA_BASE_MTU && isLegacy(((const LoRaPacket *)data)->getReceiverId()))
+            result.legacyOversize++;
+        auto &frames = dutyFrames[&radio];
+        uint32_t &used = dutyUsedUs[&radio];
+        unsigned long now = millis();
+        while (!frames.empty() && now - frames.front().first >= LORA_DUTY_CYCLE_WINDOW_MS) {
+            used -= frames.front().second;
+            frames.pop_front();
+        }
+        frames.push_back({now, airtimeUs});
+        used += airtimeUs;
+        result.dutyMaxUsedUs = std::max(result.dutyMaxUsedUs, used);
+        int8_t power = radio.getTxPower();
+        result.txPowerDbmUs += (double)power * airtimeUs;
+        result.txEnergyMwUs += pow(10.0, power / 10.0) * airtimeUs;
+        result.txFullEnergyMwUs += pow(10.0, LORA_TX_POWER / 10.0) * airtimeUs;
+        if (power < LORA_TX_POWER)
+            result.reducedFrames++;
+    });
+
+    // Узел 0 - master в центре, slave на окружности, за ними ретрансляторы.
+    // В цепочке slave на окружности SIM_CLUSTER_RADIUS_M вокруг дальнего конца.
+    std::vector<SimNode> nodes(1 + scenario.slaves + scenario.relays);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        SimNode &node = nodes[i];
+        float x = 0.0f;
+        float y = 0.0f;
+        if (i > scenario.slaves) {
+            x = scenario.distanceM * (i - scenario.slaves) / (scenario.relays + 1);
+        } else if (i > 0 && scenario.relays) {
+            float angle = 6.2831853f * (i - 1) / scenario.slaves;
+            x = scenario.distanceM + (scenario.slaves > 1 ? SIM_CLUSTER_RADIUS_M * cosf(angle) : 0.0f);
+            y = scenario.slaves > 1 ? SIM_CLUSTER_RADIUS_M * sinf(angle) : 0.0f;
+        } else if (i > 0) {
+            float angle = 6.2831853f * (i - 1) / scenario.slaves;
+            x = scenario.distanceM * cosf(angle);
+            y = scenario.distanceM * sinf(angle);
+        }
+        node.address = (i == 0) ? DEVICE_ID_MASTER : (LoraAddress_t)(DEVICE_ID_SLAVE + i - 1);
+        node.radio.reset(new SimRadio(channel, x, y));
+        node.core.reset(new LoRaCore(*node.radio, node.address, i == 0 ? DEVICE_ID_SLAVE : DEVICE_ID_MASTER));
+    }
+
+    if (scenario.badLinkLoss > 0.0f && scenario.slaves)
+        channel.setLinkLossRate(*nodes[0].radio, *nodes[1].radio, scenario.badLinkLoss);
+
+    for (SimNode &node : nodes) {
+        if (!node.core->begin()) {
+            printf("LoRaCore init failed for node %u\n", node.address);
+            return result;
+        }
+        node.core->setAckCallback([&result](PacketId_t, LoraAddress_t, uint8_t) { result.acked++; });
+        node.core->applyProfileFromSettings(scenario.profile);
+        node.core->setAutoAsaEnabled(scenario.autoAsa);
+        node.core->setAsaMtuEnabled(!isLegacy(node.address));
+        node.core->setAggregationEnabled(scenario.aggregation);
+        node.core->setDutyCycleEnforced(scenario.dutyCycle);
+        node.core->setTxPowerControlEnabled(scenario.txPowerControl);
+        if (node.address >= DEVICE_ID_SLAVE + scenario.slaves)
+            node.core->setRelayEnabled(true);
+        else if (scenario.tdma)
+            node.core->setTdmaRole(node.address == DEVICE_ID_MASTER ? TdmaRole::MASTER : TdmaRole::SLAVE);
+        else if (scenario.polling)
+            node.core->setPollRole(node.address == DEVICE_ID_MASTER ? PollRole::MASTER : PollRole::SLAVE);
+        if (scenario.bulkAckIntervalMs)
+            node.core->setBulkAckInterval(scenario.bulkAckIntervalMs);
+        if (scenario.trace) {
+            node.core->setPacketTracing(true, scenario.traceSampleEvery);
+            LoraAddress_t address = node.address;
+            node.core->setTraceCallback([address](const LoRaPacketTrace &trace) {
+                printf("%8lu node %u %s\n", millis(), address, trace.toString().c_str());
+            });
+        }
+        node.lastProfile = node.core->getCurrentProfileIndex();
+    }
+
+    // Передача блоков: псевдослучайные данные со своим RNG, трафик сценария не меняется.
+    // Источник и приёмник живут до выхода, как LoRaCore
+    std::vector<uint8_t> *transferData = nullptr;
+    LoRaMemorySink *transferSink = nullptr;
+    if (scenario.transferBytes) {
+        HostRandom dataRng(scenario.seed ^ 0xB10C5ULL);
+        transferData = new std::vector<uint8_t>(scenario.transferBytes);
+        for (uint8_t &b : *transferData)
+            b = (uint8_t)dataRng.next32();
+        transferSink = new LoRaMemorySink(scenario.transferBytes);
+        nodes[1].core->setTransferHandler([transferSink](LoraAddress_t, const LoRaTransferOffer &) {
+            return (LoRaTransferSink *)transferSink;
+        });
+        unsigned long transferStartMs = millis();
+        nodes[0].core->setTransferCallback([&result, transferStartMs](LoraAddress_t, bool, uint8_t code) {
+            result.transferResult = code;
+            result.transferMs = millis() - transferStartMs;
+        });
+        nodes[0].core->startTransfer(nodes[1].address,
+                                     *new LoRaMemorySource(transferData->data(), scenario.transferBytes));
+    }
+
+    // Первые отправки разнесены случайно по первому интервалу
+    unsigned long startMs = millis();
+    nodes[0].nextSendMs.resize(scenario.slaves);
+    for (auto &t : nodes[0].nextSendMs)
+        t = startMs + (scenario.commandIntervalMs ? trafficRng.next32() % scenario.commandIntervalMs : 0);
+    for (size_t i = 1; i <= scenario.slaves; i++)
+        nodes[i].nextSendMs.push_back(startMs + (scenario.telemetryIntervalMs ? trafficRng.next32() % scenario.telemetryIntervalMs : 0));
+
+    unsigned long nextHeartbeatMs = startMs;
+    unsigned long nextTimeCheckMs = startMs + 1000;
+    uint32_t heartbeatCount = 0;
+
+    std::set<uint64_t> seen;
+    unsigned long trafficEndMs = startMs + scenario.durationS * 1000UL;
+    unsigned long endMs = trafficEndMs + SIM_DRAIN_MS;
+
+    while (millis() < endMs) {
+        unsigned long now = millis();
+        bool traffic = now < trafficEndMs;
+
+        for (size_t i = 0; i < nodes.size(); i++) {
+            SimNode &node = nodes[i];
+            drainIncoming(node, seen, result);
+            // Как главный цикл master_node/slave_node: накопленные ACK уходят по таймауту
+            if (node.ackPeer)
+                node.core->processBulkAckTimeout(node.ackPeer);
+
+            uint8_t profile = node.core->getCurrentProfileIndex();
+            if (profile != node.lastProfile) {
+                result.profileSwitches++;
+                node.lastProfile = profile;
+            }
+
+            if (!traffic)
+                continue;
+            if (i == 0 && scenario.heartbeatIntervalMs && (long)(now - nextHeartbeatMs) >= 0) {
+                PacketHeartbeat hb;
+                hb.count = heartbeatCount++;
+                node.core->trySendPacket(DEVICE_ID_BROADCAST, &hb, (uint8_t *)&hb.count);
+                nextHeartbeatMs = now + scenario.heartbeatIntervalMs;
+            }
+            if (i == 0 && scenario.commandIntervalMs) {
+                for (size_t s = 0; s < node.nextSendMs.size(); s++) {
+                    if ((long)(now - node.nextSendMs[s]) >= 0) {
+                        sendMessage(node, nodes[s + 1].address, CMD_COMMAND_STRING, scenario.commandPayload,
+                                    scenario.commandAck, scenario.ttlMs, scenario.credit, false, result);
+                        node.nextSendMs[s] = now + jitteredInterval(trafficRng, scenario.commandIntervalMs);
+                    }
+                }
+            } else if (i > 0 && i <= scenario.slaves && scenario.telemetryIntervalMs &&
+                       (long)(now - node.nextSendMs[0]) >= 0) {
+                sendMessage(node, DEVICE_ID_MASTER, CMD_TELEMETRY_FRAGMENT, scenario.telemetryPayload,
+                            scenario.telemetryAck, scenario.ttlMs, scenario.credit, scenario.latestTelemetry, result);
+                node.nextSendMs[0] = now + jitteredInterval(trafficRng, scenario.telemetryIntervalMs);
+            }
+        }
+        if (traffic && (long)(now - nextTimeCheckMs) >= 0) {
+            // Время стоит, пока задача исполняется: micros() master - точное сетевое время
+            for (size_t i = 1; i <= scenario.slaves; i++) {
+                LoRaNetworkTime t = nodes[i].core->getNetworkTime();
+                result.timeChecks++;
+                if (!t.synced)
+                    continue;
+                uint32_t error = (uint32_t)abs((int32_t)(t.us - (uint32_t)micros()));
+                result.timeSynced++;
+                result.timeMaxErrorUs = std::max(result.timeMaxErrorUs, error);
+                result.timeMaxStatedUs = std::max(result.timeMaxStatedUs, t.errorUs);
+                if (error > t.errorUs)
+                    result.timeViolations++;
+            }
+            nextTimeCheckMs = now + 1000;
+        }
+        delay(SIM_TICK_MS);
+    }
+
+    nodes[0].core->setTransferCallback(nullptr);
+    if (transferSink && transferSink->isComplete() && transferSink->data() == *transferData) {
+        result.transferBytes = scenario.transferBytes;
+        result.deliveredBytes += scenario.transferBytes;
+    }
+
+    result.finalProfile = nodes[0].core->getCurrentProfileIndex();
+    for (size_t i = 1; i <= scenario.slaves; i++)
+        result.slaveMtu.push_back(nodes[0].core->getMtu(nodes[i].address));
+    result.channel = channel.getStats();
+    nodes[0].core->getMetricsSnapshot(result.masterMetrics);
+    for (SimNode &node : nodes) {
+        LoRaMetricsSnapshot snapshot;
+        node.core->getMetricsSnapshot(snapshot);
+        result.superseded += snapshot.counters[LORA_CNT_TX_COALESCED];
+        result.expired += snapshot.counters[LORA_CNT_TX_EXPIRED_QUEUED] + snapshot.counters[LORA_CNT_TX_EXPIRED_PENDING];
+        result.dutyDeferred += snapshot.counters[LORA_CNT_TX_DUTY_DEFERRED];
+        result.dutyBlocked += snapshot.counters[LORA_CNT_TX_DUTY_BLOCKED];
+        result.linkReports += snapshot.counters[LORA_CNT_LINK_REPORTS];
+    }
+    result.dutyBudgetUs = nodes[0].core->getAirtimeBudget().budgetUs;
+    channel.setFrameObserver(nullptr);
+
+    for (SimNode &node : nodes) {
+        node.core.release();
+        node.radio.release();
+    }
+    return result;
+}
+
+void printResult(const SimScenario &scenario, const SimResult &r)
+{
+    const SimChannelStats &c = r.channel;
+    printf("═══ %s: profile %u, 1 master + %u slaves + %u relays%s, %u m, %u s, seed %llu\n",
+           scenario.name.c_str(), scenario.profile, scenario.slaves, scenario.relays, scenario.tdma ? ", TDMA" : scenario.polling ? ", polling" : "",
+           (unsigned)scenario.distanceM, scenario.durationS, (unsigned long long)scenario.seed);
+    printf("  Messages:   sent=%u delivered=%u (%.1f%%) duplicates=%u acked=%u\n",
+           r.sent, r.delivered, 100.0f * r.deliveryRatio(), r.duplicates, r.acked);
+    if (scenario.credit) {
+        printf("  Credit:     throttled=%u (not queued, no send credit)\n", r.throttled);
+    }
+    if (scenario.latestTelemetry) {
+        printf("  Latest:     superseded=%u (replaced by a newer sample)\n", r.superseded);
+    }
+    if (scenario.ttlMs) {
+        printf("  Deadline:   ttl=%u ms, expired=%u (dropped from queue or pending)\n", scenario.ttlMs, r.expired);
+    }
+    printf("  Goodput:    %.1f B/s\n", r.goodputBps());
+    printf("  Latency:    avg=%.0f ms p50=%u ms p99=%u ms\n",
+           r.latencyAvgMs(), r.latencyPercentile(50), r.latencyPercentile(99));
+    printf("  Frames:     tx=%u ack=%u (%u B) retransmissions=%u airtime=%.1f s (%.1f%%)\n",
+           r.framesTx, r.ackFrames, r.ackBytes, r.retransmissions, r.airtimeUs / 1e6,
+           r.durationS ? 100.0 * r.airtimeUs / (r.durationS * 1e6) : 0.0);
+    printf("  Channel:    delivered=%u collisions=%u captured=%u weak=%u aborted=%u dropped=%u overwritten=%u\n",
+           c.delivered, c.collisions, c.captured, c.belowSensitivity, c.aborted, c.randomDrops, c.overwritten);
+    if (scenario.heartbeatIntervalMs || scenario.tdma) {
+        printf("  Time:       synced %.1f%% of checks, max error=%u us, max stated=%u us, violations=%u\n",
+               r.timeChecks ? 100.0f * r.timeSynced / r.timeChecks : 0.0f, r.timeMaxErrorUs, r.timeMaxStatedUs,
+               r.timeViolations);
+    }
+    if (scenario.dutyCycle) {
+        printf("  Duty:       max node airtime in window=%.1f s of %.1f s budget (%.1f%%), deferred=%u blocked=%u\n",
+               r.dutyMaxUsedUs / 1e6, r.dutyBudgetUs / 1e6,
+               r.dutyBudgetUs ? 100.0 * r.dutyMaxUsedUs / r.dutyBudgetUs : 0.0, r.dutyDeferred, r.dutyBlocked);
+    }
+    if (scenario.txPowerControl) {
+        printf("  Power:      mean=%.1f dBm, radiated energy=%.1f%% of %d dBm, reduced frames=%u/%u, reports=%u\n",
+               r.airtimeUs ? r.txPowerDbmUs / r.airtimeUs : 0.0,
+               r.txFullEnergyMwUs ? 100.0 * r.txEnergyMwUs / r.txFullEnergyMwUs : 0.0, LORA_TX_POWER,
+               r.reducedFrames, r.framesTx, r.linkReports);
+    }
+    printf("  ASA:        profile switches=%u, final master profile=%u\n", r.profileSwitches, r.finalProfile);
+    if (scenario.autoAsa || scenario.legacyAsa) {
+        printf("  MTU:        master -> slave");
+        for (size_t i = 0; i < r.slaveMtu.size(); i++)
+            printf(" %u=%u%s", (unsigned)(DEVICE_ID_SLAVE + i), r.slaveMtu[i], i < scenario.legacyAsa ? " (legacy)" : "");
+        printf(", frames > %u B to legacy=%u\n", LORA_BASE_MTU, r.legacyOversize);
+    }
+    if (scenario.transferBytes) {
+        printf("  Transfer:   %u B, %s, %.1f s, %.1f B/s, verified %u B\n", scenario.transferBytes,
+               r.transferResult < 0 ? "unfinished" : transferResultName(r.transferResult), r.transferMs / 1000.0,
+               r.transferMs ? 1000.0 * scenario.transferBytes / r.transferMs : 0.0, r.transferBytes);
+    }
+}
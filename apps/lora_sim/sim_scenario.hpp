@@ -0,0 +1,121 @@
+// sim_scenario.hpp - Multi-node LoRaCore scenario over SimChannel
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "lora_metrics.hpp"
+#include "sim_channel.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCENARIO
+// ═══════════════════════════════════════════════════════════════════════════
+// 1 master + N slaves на окружности radius вокруг master. Master шлёт каждому slave
+// команды, slave шлют master телеметрию. С relays > 0 - цепочка: ретрансляторы поровну
+// на отрезке master -> (distanceM, 0), slave вокруг дальнего конца. Payload несёт (origin, seq, время отправки),
+// по нему считаются доставка, дубликаты и задержка end-to-end.
+//
+// Один сценарий на процесс: задачи LoRaCore живут до выхода.
+struct SimScenario
+{
+    std::string name = "default";
+    uint64_t seed = 1;
+    uint32_t durationS = 600;
+
+    // Сеть
+    uint8_t profile = 4;                // Индекс loraProfiles на всех узлах
+    uint8_t slaves = 1;
+    float distanceM = 500.0f;
+    uint8_t relays = 0;                 // Узлы с LoRaCore::setRelayEnabled, без своего трафика
+    bool tdma = false;                  // Master - TdmaRole::MASTER, slave - TdmaRole::SLAVE
+    bool polling = false;               // Master - PollRole::MASTER, slave - PollRole::SLAVE
+    SimChannelConfig channel;
+    float badLinkLoss = 0.0f;           // Потери на линии master - первый slave (0 = как у остальных)
+
+    // Трафик (0 = выключен)
+    uint32_t commandIntervalMs = 5000;  // Master -> каждый slave
+    uint32_t telemetryIntervalMs = 5000;// Каждый slave -> master
+    uint8_t commandPayload = 12;
+    uint8_t telemetryPayload = 12;
+    bool commandAck = true;
+    bool telemetryAck = false;          // Без ACK телеметрия может агрегироваться
+    uint32_t transferBytes = 0;         // Master -> первый slave блоками startTransfer() в начале, 0 = нет
+    bool credit = false;                // Сообщение ставится, только если getSendCredit() к узлу > 0
+    bool latestTelemetry = false;       // Телеметрия через sendPacketLatest(): новый образец заменяет старый
+    uint32_t ttlMs = 0;                 // PacketBase::ttlMs команд и телеметрии, 0 = без срока
+    uint32_t heartbeatIntervalMs = 0;   // Broadcast heartbeat master с меткой сетевого времени
+    bool dutyCycle = false;             // LoRaCore::setDutyCycleEnforced на всех узлах
+    bool txPowerControl = false;        // LoRaCore::setTxPowerControlEnabled на всех узлах
+
+    // Протокол
+    bool aggregation = true;            // LoRaCore::setAggregationEnabled
+    uint32_t bulkAckIntervalMs = 0;     // LoRaCore::setBulkAckInterval, 0 = по профилю
+    bool autoAsa = false;
+    uint8_t legacyAsa = 0;              // Первые N slave - как прошивка без MTU: setAsaMtuEnabled(false)
+    bool verbose = false;               // Лог LoRaCore всех узлов в stdout
+
+    // Трассировка этапов пакета (LoRaCore::setPacketTracing): гистограммы в метриках,
+    // каждый traceSampleEvery-й кадр печатается (0 - без печати)
+    bool trace = false;
+    uint16_t traceSampleEvery = 0;
+};
+
+struct SimResult
+{
+    uint32_t sent = 0;                  // Сообщений приложения
+    uint32_t delivered = 0;             // Уникальных доставленных
+    uint32_t duplicates = 0;
+    uint32_t acked = 0;                 // ACK callback у отправителя
+    uint32_t throttled = 0;             // Не поставлены: нет кредита отправки (credit)
+    uint32_t superseded = 0;            // Заменены более новым образцом (latestTelemetry), все узлы
+    uint32_t expired = 0;               // Сняты по ttlMs с очереди или pending, все узлы
+    uint64_t deliveredBytes = 0;        // Полезная нагрузка приложения
+
+    std::vector<uint32_t> latencyMs;    // End-to-end, по доставленным
+
+    uint32_t framesTx = 0;              // Кадров в эфире, всех типов
+    uint32_t ackFrames = 0;             // ACK + BULK ACK
+    uint32_t ackBytes = 0;
+    uint32_t retransmissions = 0;       // Повторные кадры с тем же (sender, id)
+    uint64_t airtimeUs = 0;
+
+    int transferResult = -1;            // LoRaTransferResult, -1 - передачи не было или не завершилась
+    uint32_t transferMs = 0;
+    uint32_t transferBytes = 0;         // Принято и совпало с источником
+
+    // Сетевое время slave раз в секунду против часов master (часы симуляции общие)
+    uint32_t timeChecks = 0;
+    uint32_t timeSynced = 0;
+    uint32_t timeMaxErrorUs = 0;        // |getNetworkTime() - время master|
+    uint32_t timeMaxStatedUs = 0;       // Наибольшая заявленная точность errorUs
+    uint32_t timeViolations = 0;        // Ошибка больше заявленной
+
+    // Эфир одного узла в скользящем окне LORA_DUTY_CYCLE_WINDOW_MS по кадрам в канале
+    uint32_t dutyBudgetUs = 0;          // Бюджет поддиапазона частоты, 0 - вне таблицы
+    uint32_t dutyMaxUsedUs = 0;         // Наибольший эфир узла в окне
+    uint32_t dutyDeferred = 0;          // LORA_CNT_TX_DUTY_DEFERRED, все узлы
+    uint32_t dutyBlocked = 0;           // LORA_CNT_TX_DUTY_BLOCKED, все узлы
+
+    // Мощность кадров в канале, взвешенная по эфиру
+    double txPowerDbmUs = 0;            // Сумма мощность (дБм) * эфир
+    double txEnergyMwUs = 0;            // Излучённая энергия, мВт * мкс
+    double txFullEnergyMwUs = 0;        // Та же энергия при LORA_TX_POWER на каждом кадре
+    uint32_t reducedFrames = 0;         // Кадров ниже LORA_TX_POWER
+    uint32_t linkReports = 0;           // LORA_CNT_LINK_REPORTS, все узлы
+
+    uint32_t profileSwitches = 0;
+    uint8_t finalProfile = 0;
+    std::vector<uint8_t> slaveMtu;      // getMtu() master к каждому slave в конце прогона
+    uint32_t legacyOversize = 0;        // Кадров длиннее LORA_BASE_MTU к узлам legacyAsa
+    SimChannelStats channel;
+    LoRaMetricsSnapshot masterMetrics;  // Метрики LoRaCore master в конце прогона
+
+    float deliveryRatio() const { return sent ? (float)delivered / sent : 0.0f; }
+    float goodputBps() const;           // Полезные байты приложения в секунду
+    uint32_t latencyPercentile(float p) const;
+    float latencyAvgMs() const;
+
+    uint32_t durationS = 0;
+};
+
+SimResult runScenario(const SimScenario &scenario);
+void printResult(const SimScenario &scenario, const SimResult &result);
@@ -20,7 +20,11 @@ unsigned long lastHeartbeatTime = 0;
 bool autoHeartbeat = false;
 unsigned long heartbeatInterval = 5000; // 5 seconds default
 uint32_t heartbeatCounter = 0; // Persistent heartbeat counter
-PacketId_t lastHeartbeatPacketId = 0; // Track last heartbeat packet ID
+volatile bool heartbeatInFlight = false; // Previous heartbeat not yet on air (async send completion)
+
+// Block transfer test data (xfer command)
+std::vector<uint8_t> xferData;
+LoRaMemorySource* xferSource = nullptr;
 
 // Buffered logging system
 std::vector<String> logBuffer;
@@ -115,7 +119,7 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         log("Sending: " + msg);
         
         PacketCommand pkt;
-        pkt.payloadLen = min((int)msg.length(), (int)MAX_LORA_PAYLOAD);
+        pkt.payloadLen = min((int)msg.length(), (int)lora->getMtu(TARGET_DEVICE_ID));
         
         lora->sendPacketBase(TARGET_DEVICE_ID, &pkt, (const uint8_t*)msg.c_str());
         packetsSent++;
@@ -162,8 +166,34 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         log(lora->getQueueStatus());
         log(lora->getAdaptiveRetryInfo());
         log(lora->getPendingPacketsInfo());
+        log(lora->getAirtimeInfo());
+        log(lora->getTxPowerInfo());
+        log(lora->getMtuInfo());
         log("==================\n");
         
+    } else if (cmd_lower == "metrics") {
+        LoRaMetricsSnapshot snapshot;
+        lora->getMetricsSnapshot(snapshot);
+        log("\n=== Metrics ===");
+        log(snapshot.toString());
+        log("===============\n");
+        
+    } else if (cmd_lower == "metrics remote") {
+        logf("Requesting metrics from %d...", TARGET_DEVICE_ID);
+        PacketRequestInfo pkt;
+        pkt.requestType = INFO_REQUEST_METRICS;
+        lora->sendPacketBase(TARGET_DEVICE_ID, &pkt, &pkt.requestType);
+        packetsSent++;
+        
+    } else if (cmd_lower.startsWith("trace on")) {
+        int sampleEvery = cmd_lower.length() > 9 ? cmd_lower.substring(9).toInt() : 0;
+        lora->setPacketTracing(true, sampleEvery);
+        logf("✓ Packet tracing enabled, printing every %d frame (0 = metrics only)", sampleEvery);
+        
+    } else if (cmd_lower == "trace off") {
+        lora->setPacketTracing(false);
+        log("✓ Packet tracing disabled");
+        
     } else if (cmd_lower == "rssi") {
         float rssi = lora->getRadio().getRSSI();
         float snr = lora->getRadio().getSNR();
@@ -204,6 +234,7 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         packetsSent = 0;
         packetsReceived = 0;
         lastStatsTime = millis();
+        lora->getMetrics().reset();
         log("✓ Statistics reset");
         
     } else if (cmd_lower == "reboot") {
@@ -367,6 +398,104 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         logf("RSSI hysteresis: %.1f dBm", lora->getAutoAsaRssiHysteresis());
         log("=======================\n");
         
+    } else if (cmd_lower.startsWith("wake ")) {
+        // wake <id> on|off - узел спит в duty-cycle RX, слать с длинной преамбулой
+        String arg = cmd_lower.substring(5);
+        int space = arg.indexOf(' ');
+        int peer = arg.substring(0, space).toInt();
+        String state = (space > 0) ? arg.substring(space + 1) : "";
+        if (peer > 0 && peer < DEVICE_ID_BROADCAST && (state == "on" || state == "off")) {
+            lora->setPeerWakePreamble(peer, state == "on");
+            logf("✓ Wake preamble for %d: %s", peer, state.c_str());
+        } else {
+            log("Usage: wake <id> on|off");
+        }
+        
+    } else if (cmd_lower == "relay on" || cmd_lower == "relay off") {
+        lora->setRelayEnabled(cmd_lower == "relay on");
+        logf("✓ Relay %s", lora->isRelayEnabled() ? "enabled" : "disabled");
+        
+    } else if (cmd_lower == "routes") {
+        std::vector<LoRaRoute> routes = lora->getRoutes();
+        logf("\n=== Routes (%u, relay %s) ===", (unsigned)routes.size(), lora->isRelayEnabled() ? "on" : "off");
+        for (const LoRaRoute &route : routes) {
+            log("  " + route.toString());
+        }
+        log("=================\n");
+        
+    } else if (cmd_lower.startsWith("route ")) {
+        // route <dst> <via> - статический маршрут, route <dst> off - удалить
+        String arg = cmd_lower.substring(6);
+        int space = arg.indexOf(' ');
+        int dst = arg.substring(0, space).toInt();
+        String via = (space > 0) ? arg.substring(space + 1) : "";
+        if (dst > 0 && dst < DEVICE_ID_BROADCAST && via == "off") {
+            logf(lora->clearRoute(dst) ? "✓ Route to %d removed" : "No route to %d", dst);
+        } else if (dst > 0 && dst < DEVICE_ID_BROADCAST && via.toInt() > 0 && via.toInt() < DEVICE_ID_BROADCAST) {
+            lora->setRoute(dst, via.toInt());
+            logf("✓ Static route: %d via %d", dst, (int)via.toInt());
+        } else {
+            log("Usage: route <id> <via>|off");
+        }
+        
+    } else if (cmd_lower == "tdma on" || cmd_lower == "tdma off") {
+        lora->setTdmaRole(cmd_lower == "tdma on" ? TdmaRole::MASTER : TdmaRole::OFF);
+        logf("✓ TDMA %s", tdmaRoleName(lora->getTdmaRole()));
+        
+    } else if (cmd_lower == "tdma") {
+        log(lora->getTdmaInfo());
+        
+    } else if (cmd_lower == "time") {
+        log(lora->getTimeSyncInfo());
+        
+    } else if (cmd_lower == "duty on" || cmd_lower == "duty off") {
+        lora->setDutyCycleEnforced(cmd_lower == "duty on");
+        log(lora->isDutyCycleEnforced() ? "✓ Duty cycle enforced" : "✓ Duty cycle not enforced (airtime still counted)");
+        
+    } else if (cmd_lower == "tpc on" || cmd_lower == "tpc off") {
+        lora->setTxPowerControlEnabled(cmd_lower == "tpc on");
+        log(lora->isTxPowerControlEnabled() ? "✓ TX power control enabled" : "✓ TX power control disabled (full power)");
+        
+    } else if (cmd_lower == "poll on" || cmd_lower == "poll off") {
+        lora->setPollRole(cmd_lower == "poll on" ? PollRole::MASTER : PollRole::OFF);
+        logf("✓ Polling %s", pollRoleName(lora->getPollRole()));
+        
+    } else if (cmd_lower == "poll") {
+        log(lora->getPollInfo());
+        
+    } else if (cmd_lower == "xfer") {
+        log(lora->getTransferInfo());
+        
+    } else if (cmd_lower == "xfer abort") {
+        lora->abortTransfer();
+        log("✓ Transfer aborted");
+        
+    } else if (cmd_lower.startsWith("xfer ")) {
+        int space = cmd_lower.indexOf(' ', 5);
+        int target = space > 0 ? cmd_lower.substring(5, space).toInt() : -1;
+        int kb = space > 0 ? cmd_lower.substring(space + 1).toInt() : 0;
+        if (target < 0 || target > 254 || kb < 1 || kb > 128) {
+            log("Usage: xfer <id> <1-128 KB>|abort");
+        } else if (lora->isTransferActive()) {
+            log("✗ Transfer in progress, use 'xfer abort'");
+        } else {
+            // Тестовые данные: псевдослучайный блок, получатель сверяет SHA-256
+            delete xferSource;
+            xferData.resize(kb * 1024);
+            uint32_t x = millis() | 1;
+            for (auto& b : xferData) {
+                x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+                b = (uint8_t)x;
+            }
+            xferSource = new LoRaMemorySource(xferData.data(), xferData.size());
+            if (lora->startTransfer(target, *xferSource)) {
+                logf("✓ Transfer of %d KB to %d started", kb, target);
+                packetsSent++;
+            } else {
+                log("✗ Transfer not started");
+            }
+        }
+        
     } else if (cmd_lower.startsWith("setid ")) {
         int newId = cmd.substring(6).toInt();
         if (newId >= 0 && newId <= 255) {
@@ -411,8 +540,13 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         Serial.println("║                                            ║");
         Serial.println("║ MONITORING                                 ║");
         Serial.println("║  stats             Show statistics         ║");
+        Serial.println("║  duty on|off       Enforce duty cycle      ║");
+        Serial.println("║  tpc on|off        TX power control        ║");
         Serial.println("║  status            Show system status      ║");
         Serial.println("║  rssi              Show RSSI/SNR/freq      ║");
+        Serial.println("║  metrics           Show LoRaCore metrics   ║");
+        Serial.println("║  metrics remote    Request slave metrics   ║");
+        Serial.println("║  trace on [N]|off  Packet stage tracing    ║");
         Serial.println("║  queue             Show queue status       ║");
         Serial.println("║  clients           Show client info        ║");
         Serial.println("║  log               Show log buffer info    ║");
@@ -423,6 +557,28 @@ void processCommand(const String& cmd, const String& cmd_lower) {
         Serial.println("║  heartbeat off     Disable auto heartbeat  ║");
         Serial.println("║  heartbeat interval 3000<ms>  Set interval ║");
         Serial.println("║                                            ║");
+        Serial.println("║ LOW-POWER PEERS                            ║");
+        Serial.println("║  wake <id> on|off  Long preamble to peer   ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ RELAY                                      ║");
+        Serial.println("║  relay on|off      Forward relayed frames  ║");
+        Serial.println("║  routes            Show route table        ║");
+        Serial.println("║  route <id> <via>|off  Static route        ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ TDMA                                       ║");
+        Serial.println("║  tdma on|off       Beacons and slot plan   ║");
+        Serial.println("║  tdma              Show TDMA state         ║");
+        Serial.println("║  time              Network time and clocks ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ POLLING                                    ║");
+        Serial.println("║  poll on|off       Poll clients in turn    ║");
+        Serial.println("║  poll              Show polling state      ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ BLOCK TRANSFER                             ║");
+        Serial.println("║  xfer <id> <KB>    Send test data to node  ║");
+        Serial.println("║  xfer              Show transfer progress  ║");
+        Serial.println("║  xfer abort        Abort outgoing transfer ║");
+        Serial.println("║                                            ║");
         Serial.println("║ SYSTEM                                     ║");
         Serial.println("║  setid <0-255>     Set device ID           ║");
         Serial.println("║  settarget <0-255> Set target ID           ║");
@@ -459,6 +615,14 @@ void processIncomingPackets() {
             String msg = String((char*)pkt.payload, pkt.payloadLen);
             log("Message: " + msg);
         }
+        
+        // Metrics page from remote node
+        else if (pkt.packetType == CMD_METRICS && pkt.payloadLen >= 2) {
+            logf("Metrics of %d, page %u/%u:", pkt.getSenderId(), pkt.payload[0] + 1, pkt.payload[1]);
+            forEachMetricRecord(pkt.payload, pkt.payloadLen, [](const String &name, const char *unit, int64_t value) {
+                logf("  %s: %lld %s", name.c_str(), (long long)value, unit);
+            });
+        }
     }
 }
 
@@ -479,6 +643,10 @@ void setup() {
         while(1) delay(1000);
     }
     
+    lora->setTransferCallback([](LoraAddress_t peer, bool outgoing, uint8_t result) {
+        logf("[XFER] %s %d: %s", outgoing ? "To" : "From", peer, transferResultName(result));
+    });
+    
     Serial.println("LoRa initialized successfully");
     Serial.println(lora->getCurrentProfileInfo());
     Serial.println("\nReady! Type 'help' for commands.\n");
@@ -506,21 +674,22 @@ void loop() {
     
     // Auto heartbeat
     if (autoHeartbeat && (millis() - lastHeartbeatTime > heartbeatInterval)) {
-        // Check if previous heartbeat is still pending
-        bool previousHeartbeatPending = false;
-        if (lastHeartbeatPacketId > 0) {
-            previousHeartbeatPending = lora->isPacketPending(lastHeartbeatPacketId);
-        }
-        
-        // Only send new heartbeat if previous one is not pending
-        if (!previousHeartbeatPending) {
+        // Only send new heartbeat if previous one already left the radio
+        if (!heartbeatInFlight) {
             PacketHeartbeat hb;
             hb.count = heartbeatCounter++; // Increment counter for each heartbeat
-            lastHeartbeatPacketId = lora->sendBroadcast(&hb, (uint8_t*)&hb.count); // Broadcast heartbeat!
+            hb.broadcast = true;
+            heartbeatInFlight = true;
+            // Broadcast heartbeat! Completion (sent / queue full / expired) clears the flag
+            if (!lora->sendPacketAsync(DEVICE_ID_BROADCAST, &hb, (uint8_t*)&hb.count,
+                                       [](SendHandle_t, SendResult) { heartbeatInFlight = false; },
+                                       heartbeatInterval)) {
+                heartbeatInFlight = false;
+            }
             lastHeartbeatTime = millis();
             logf("[♥️ HB-BC] Heartbeat broadcast #%lu", hb.count);
         } else {
-            logf("[♥️ HB] Skipping heartbeat - previous one still pending (ID: %u)", lastHeartbeatPacketId);
+            logf("[♥️ HB] Skipping heartbeat - previous one still queued");
         }
     }
     
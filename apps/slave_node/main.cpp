@@ -2,6 +2,7 @@
 // LoRa-Link Universal Application
 #include <Arduino.h>
 #include "LoRaCore.hpp"
+#include "ota_sink.hpp"
 
 // Device ID for this node
 #ifdef ROLE_MASTER
@@ -24,7 +25,7 @@ unsigned long lastHeartbeatTime = 0;
 bool autoHeartbeat = true;
 unsigned long heartbeatInterval = 30000; // 30 seconds default
 uint32_t heartbeatCounter = 0; // Persistent heartbeat counter
-PacketId_t lastHeartbeatPacketId = 0; // Track last heartbeat packet ID
+volatile bool heartbeatInFlight = false; // Previous heartbeat not yet on air (async send completion)
 
 // Boat mode settings
 bool boatMode = false;
@@ -34,6 +35,14 @@ const unsigned long BOAT_SLEEP_CHECK_INTERVAL = 5000; // Check every 5 seconds
 unsigned long lastBoatCheck = 0;
 int boatIdleProfile = 0; // Profile 0 - most reliable, lowest power
 int boatActiveProfile = 3; // Profile 3 - balanced
+bool boatLowPowerRx = false; // Duty-cycle RX while idle
+
+// Block transfer: files into RAM, firmware into the inactive OTA partition
+const uint32_t FILE_TRANSFER_MAX = 64 * 1024;
+LoRaMemorySink fileSink(FILE_TRANSFER_MAX);
+LoRaOtaSink otaSink;
+volatile unsigned long otaRebootAtMs = 0; // 0 - no pending reboot
+const unsigned long OTA_REBOOT_DELAY = 5000; // DONE reply goes out before reboot
 
 void processSerialCommands() {
     if (!Serial.available()) return;
@@ -55,7 +64,7 @@ void processSerialCommands() {
         Serial.println("Sending: " + msg);
         
         PacketCommand pkt;
-        pkt.payloadLen = min((int)msg.length(), (int)MAX_LORA_PAYLOAD);
+        pkt.payloadLen = min((int)msg.length(), (int)lora->getMtu(TARGET_DEVICE_ID));
         
         lora->sendPacketBase(TARGET_DEVICE_ID, &pkt, (const uint8_t*)msg.c_str());
         packetsSent++;
@@ -103,8 +112,90 @@ void processSerialCommands() {
         Serial.println(lora->getQueueStatus());
         Serial.println(lora->getAdaptiveRetryInfo());
         Serial.println(lora->getPendingPacketsInfo());
+        Serial.println(lora->getAirtimeInfo());
+        Serial.println(lora->getTxPowerInfo());
+        Serial.println(lora->getMtuInfo());
         Serial.println("==================\n");
         
+    } else if (cmd == "metrics") {
+        LoRaMetricsSnapshot snapshot;
+        lora->getMetricsSnapshot(snapshot);
+        Serial.println("\n=== Metrics ===");
+        Serial.print(snapshot.toString());
+        Serial.println("===============\n");
+        
+    } else if (cmd == "metrics remote") {
+        Serial.printf("Requesting metrics from %d...\n", TARGET_DEVICE_ID);
+        PacketRequestInfo pkt;
+        pkt.requestType = INFO_REQUEST_METRICS;
+        lora->sendPacketBase(TARGET_DEVICE_ID, &pkt, &pkt.requestType);
+        packetsSent++;
+        lastActivityTime = millis();
+        
+    } else if (cmd.startsWith("trace on")) {
+        int sampleEvery = cmd.length() > 9 ? cmd.substring(9).toInt() : 0;
+        lora->setPacketTracing(true, sampleEvery);
+        Serial.printf("✓ Packet tracing enabled, printing every %d frame (0 = metrics only)\n", sampleEvery);
+        
+    } else if (cmd == "trace off") {
+        lora->setPacketTracing(false);
+        Serial.println("✓ Packet tracing disabled");
+        
+    } else if (cmd == "relay on" || cmd == "relay off") {
+        lora->setRelayEnabled(cmd == "relay on");
+        Serial.printf("✓ Relay %s\n", lora->isRelayEnabled() ? "enabled" : "disabled");
+        
+    } else if (cmd == "routes") {
+        std::vector<LoRaRoute> routes = lora->getRoutes();
+        Serial.printf("\n=== Routes (%u, relay %s) ===\n", (unsigned)routes.size(), lora->isRelayEnabled() ? "on" : "off");
+        for (const LoRaRoute &route : routes) {
+            Serial.println("  " + route.toString());
+        }
+        Serial.println("=================\n");
+        
+    } else if (cmd.startsWith("route ")) {
+        // route <dst> <via> - статический маршрут, route <dst> off - удалить
+        String arg = cmd.substring(6);
+        int space = arg.indexOf(' ');
+        int dst = arg.substring(0, space).toInt();
+        String via = (space > 0) ? arg.substring(space + 1) : "";
+        if (dst > 0 && dst < DEVICE_ID_BROADCAST && via == "off") {
+            Serial.printf(lora->clearRoute(dst) ? "✓ Route to %d removed\n" : "No route to %d\n", dst);
+        } else if (dst > 0 && dst < DEVICE_ID_BROADCAST && via.toInt() > 0 && via.toInt() < DEVICE_ID_BROADCAST) {
+            lora->setRoute(dst, via.toInt());
+            Serial.printf("✓ Static route: %d via %d\n", dst, (int)via.toInt());
+        } else {
+            Serial.println("Usage: route <id> <via>|off");
+        }
+        
+    } else if (cmd == "tdma on" || cmd == "tdma off") {
+        lora->setTdmaRole(cmd == "tdma on" ? TdmaRole::SLAVE : TdmaRole::OFF);
+        Serial.printf("✓ TDMA %s\n", tdmaRoleName(lora->getTdmaRole()));
+        
+    } else if (cmd == "tdma") {
+        Serial.println(lora->getTdmaInfo());
+        
+    } else if (cmd == "time") {
+        Serial.println(lora->getTimeSyncInfo());
+        
+    } else if (cmd == "duty on" || cmd == "duty off") {
+        lora->setDutyCycleEnforced(cmd == "duty on");
+        Serial.println(lora->isDutyCycleEnforced() ? "✓ Duty cycle enforced" : "✓ Duty cycle not enforced (airtime still counted)");
+        
+    } else if (cmd == "tpc on" || cmd == "tpc off") {
+        lora->setTxPowerControlEnabled(cmd == "tpc on");
+        Serial.println(lora->isTxPowerControlEnabled() ? "✓ TX power control enabled" : "✓ TX power control disabled (full power)");
+        
+    } else if (cmd == "poll on" || cmd == "poll off") {
+        lora->setPollRole(cmd == "poll on" ? PollRole::SLAVE : PollRole::OFF);
+        Serial.printf("✓ Polling %s\n", pollRoleName(lora->getPollRole()));
+        
+    } else if (cmd == "poll") {
+        Serial.println(lora->getPollInfo());
+        
+    } else if (cmd == "xfer") {
+        Serial.println(lora->getTransferInfo());
+        
     } else if (cmd == "rssi") {
         float rssi = lora->getRadio().getRSSI();
         float snr = lora->getRadio().getSNR();
@@ -119,6 +210,7 @@ void processSerialCommands() {
         Serial.printf("Mode: %s\n", lora->mode() == RadioMode::LORA ? "LoRa" : "FSK");
         Serial.printf("Manual mode: %s\n", lora->isManualMode() ? "Yes" : "No");
         Serial.printf("Boat mode: %s\n", boatMode ? "ENABLED" : "DISABLED");
+        Serial.printf("Low-power RX: %s\n", lora->isLowPowerRx() ? "ON (duty-cycle)" : "OFF");
         if (boatMode) {
             unsigned long idleTime = millis() - lastActivityTime;
             Serial.printf("Idle time: %lu s\n", idleTime / 1000);
@@ -151,6 +243,7 @@ void processSerialCommands() {
         packetsSent = 0;
         packetsReceived = 0;
         lastStatsTime = millis();
+        lora->getMetrics().reset();
         Serial.println("✓ Statistics reset");
         
     } else if (cmd == "reboot") {
@@ -206,8 +299,28 @@ void processSerialCommands() {
         
     } else if (cmd == "boat off") {
         boatMode = false;
+        if (lora->isLowPowerRx()) {
+            lora->setLowPowerRx(false);
+        }
         Serial.println("✓ Boat mode DISABLED");
         
+    } else if (cmd == "boat lowpower on") {
+        boatLowPowerRx = true;
+        Serial.println("✓ Boat idle will use duty-cycle RX (master needs 'wake <id> on')");
+        
+    } else if (cmd == "boat lowpower off") {
+        boatLowPowerRx = false;
+        Serial.println("✓ Boat idle will keep continuous RX");
+        
+    } else if (cmd == "lowpower on") {
+        lora->setLowPowerRx(true);
+        Serial.println("✓ Low-power RX enabled (duty-cycle)");
+        Serial.println("  Master must send with wake preamble: 'wake <id> on'");
+        
+    } else if (cmd == "lowpower off") {
+        lora->setLowPowerRx(false);
+        Serial.println("✓ Low-power RX disabled (continuous)");
+        
     } else if (cmd.startsWith("boat idle ")) {
         int profile = cmd.substring(10).toInt();
         if (profile >= 0 && profile < LORA_PROFILE_COUNT) {
@@ -298,8 +411,13 @@ void processSerialCommands() {
         Serial.println("║                                            ║");
         Serial.println("║ MONITORING                                 ║");
         Serial.println("║  stats             Show statistics         ║");
+        Serial.println("║  duty on|off       Enforce duty cycle      ║");
+        Serial.println("║  tpc on|off        TX power control        ║");
         Serial.println("║  status            Show system status      ║");
         Serial.println("║  rssi              Show RSSI/SNR/freq      ║");
+        Serial.println("║  metrics           Show LoRaCore metrics   ║");
+        Serial.println("║  metrics remote    Request target metrics  ║");
+        Serial.println("║  trace on [N]|off  Packet stage tracing    ║");
         Serial.println("║  queue             Show queue status       ║");
         Serial.println("║  log               Show log buffer info    ║");
         Serial.println("║  info              Show device info        ║");
@@ -314,6 +432,25 @@ void processSerialCommands() {
         Serial.println("║  boat off          Disable boat mode       ║");
         Serial.println("║  boat idle <0-12>  Set idle profile        ║");
         Serial.println("║  boat active <0-12> Set active profile     ║");
+        Serial.println("║  boat lowpower on|off Duty-cycle RX idle   ║");
+        Serial.println("║  lowpower on|off   Duty-cycle RX (sniff)   ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ RELAY                                      ║");
+        Serial.println("║  relay on|off      Forward relayed frames  ║");
+        Serial.println("║  routes            Show route table        ║");
+        Serial.println("║  route <id> <via>|off  Static route        ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ TDMA                                       ║");
+        Serial.println("║  tdma on|off       Slot from master beacon ║");
+        Serial.println("║  tdma              Show TDMA state         ║");
+        Serial.println("║  time              Network time and clocks ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ POLLING                                    ║");
+        Serial.println("║  poll on|off       Reply to master polls   ║");
+        Serial.println("║  poll              Show polling state      ║");
+        Serial.println("║                                            ║");
+        Serial.println("║ BLOCK TRANSFER                             ║");
+        Serial.println("║  xfer              Show transfer progress  ║");
         Serial.println("║                                            ║");
         Serial.println("║ SYSTEM                                     ║");
         Serial.println("║  setid <0-255>     Set device ID           ║");
@@ -365,10 +502,18 @@ void processIncomingPackets() {
             String echo = "Echo: " + msg;
             PacketBase echoPkt;
             echoPkt.packetType = CMD_COMMAND_STRING;
-            echoPkt.payloadLen = min((int)echo.length(), (int)MAX_LORA_PAYLOAD);
+            echoPkt.payloadLen = min((int)echo.length(), (int)lora->getMtu(pkt.getSenderId()));
             lora->sendPacketBase(pkt.getSenderId(), &echoPkt, (const uint8_t*)echo.c_str());
             packetsSent++;
         }
+        
+        // Metrics page from remote node
+        else if (pkt.packetType == CMD_METRICS && pkt.payloadLen >= 2) {
+            Serial.printf("Metrics of %d, page %u/%u:\n", pkt.getSenderId(), pkt.payload[0] + 1, pkt.payload[1]);
+            forEachMetricRecord(pkt.payload, pkt.payloadLen, [](const String &name, const char *unit, int64_t value) {
+                Serial.printf("  %s: %lld %s\n", name.c_str(), (long long)value, unit);
+            });
+        }
     }
 }
 
@@ -387,11 +532,17 @@ void processBoatMode() {
         Serial.printf("[BOAT] Switching to idle profile %d (no activity for %lu s)\n", 
                      boatIdleProfile, idleTime / 1000);
         lora->applyProfileFromSettings(boatIdleProfile);
+        if (boatLowPowerRx) {
+            lora->setLowPowerRx(true);
+        }
     }
     // Switch back to active profile on activity
     else if (idleTime < BOAT_IDLE_TIMEOUT && currentProfile == boatIdleProfile) {
         Serial.printf("[BOAT] Switching to active profile %d (activity detected)\n", 
                      boatActiveProfile);
+        if (lora->isLowPowerRx()) {
+            lora->setLowPowerRx(false);
+        }
         lora->applyProfileFromSettings(boatActiveProfile);
     }
 }
@@ -420,6 +571,21 @@ void setup() {
         while(1) delay(1000);
     }
     
+    // Файлы до FILE_TRANSFER_MAX - в RAM, прошивка - в OTA раздел и перезагрузка
+    lora->setTransferHandler([](LoraAddress_t, const LoRaTransferOffer& offer) -> LoRaTransferSink* {
+        if (offer.kind == LORA_XFER_KIND_FIRMWARE) return &otaSink;
+        if (offer.kind == LORA_XFER_KIND_FILE && offer.size <= FILE_TRANSFER_MAX) return &fileSink;
+        return nullptr;
+    });
+    lora->setTransferCallback([](LoraAddress_t peer, bool outgoing, uint8_t result) {
+        Serial.printf("[XFER] %s %d: %s\r\n", outgoing ? "To" : "From", peer, transferResultName(result));
+        if (!outgoing && result == LORA_XFER_OK && otaSink.isReadyToBoot()) {
+            otaRebootAtMs = millis() + OTA_REBOOT_DELAY;
+        } else if (!outgoing && result == LORA_XFER_OK && fileSink.isComplete()) {
+            Serial.printf("[XFER] File received: %u bytes\r\n", (unsigned)fileSink.data().size());
+        }
+    });
+    
     Serial.println("✓ LoRa initialized successfully");
     Serial.println(lora->getCurrentProfileInfo());
     Serial.println("\nReady! Type 'help' for commands.\n");
@@ -446,19 +612,27 @@ void loop() {
     // Process boat mode (adaptive power management)
     processBoatMode();
     
+    // Firmware received over LoRa: boot into it
+    if (otaRebootAtMs && (long)(millis() - otaRebootAtMs) >= 0) {
+        Serial.println("[XFER] Rebooting into new firmware...");
+        delay(100);
+        ESP.restart();
+    }
+    
     // Auto heartbeat
     if (autoHeartbeat && (millis() - lastHeartbeatTime > heartbeatInterval)) {
-        // Check if previous heartbeat is still pending
-        bool previousHeartbeatPending = false;
-        if (lastHeartbeatPacketId > 0) {
-            previousHeartbeatPending = lora->isPacketPending(lastHeartbeatPacketId);
-        }
-        
-        // Only send new heartbeat if previous one is not pending
-        if (!previousHeartbeatPending) {
+        // Only send new heartbeat if previous one already left the radio
+        if (!heartbeatInFlight) {
             PacketHeartbeat hb;
             hb.count = heartbeatCounter++; // Increment counter for each heartbeat
-            lastHeartbeatPacketId = lora->sendBroadcast(&hb, (uint8_t*)&hb.count); // Broadcast heartbeat!
+            hb.broadcast = true;
+            heartbeatInFlight = true;
+            // Broadcast heartbeat! Completion (sent / queue full / expired) clears the flag
+            if (!lora->sendPacketAsync(DEVICE_ID_BROADCAST, &hb, (uint8_t*)&hb.count,
+                                       [](SendHandle_t, SendResult) { heartbeatInFlight = false; },
+                                       heartbeatInterval)) {
+                heartbeatInFlight = false;
+            }
             lastHeartbeatTime = millis();
             
 #ifdef ROLE_SLAVE
@@ -466,7 +640,7 @@ void loop() {
 #endif
         } else {
 #ifdef ROLE_SLAVE
-            Serial.printf("[♥️ HB] Skipping heartbeat - previous one still pending (ID: %u)\r\n", lastHeartbeatPacketId);
+            Serial.printf("[♥️ HB] Skipping heartbeat - previous one still queued\r\n");
 #endif
         }
     }
@@ -1,11 +1,5 @@
 #include "LoRaCore.hpp"
 
-// Static member definitions
-TaskHandle_t LoRaCore::receiverTaskHandle = nullptr;
-TaskHandle_t LoRaCore::senderTaskHandle = nullptr;
-TaskHandle_t LoRaCore::asaTaskHandle = nullptr;
-TaskHandle_t LoRaCore::autoAsaTaskHandle = nullptr;
-
 // Helper logging functions (global, not class methods)
 void LLog(const char *s)
 {
@@ -31,6 +25,11 @@ void LoRaCore::receiveTaskWrapper(void *param)
     static_cast<LoRaCore *>(param)->receiveTask();
 }
 
+void LoRaCore::radioTaskWrapper(void *param)
+{
+    static_cast<LoRaCore *>(param)->radioTask();
+}
+
 void LoRaCore::sendTaskWrapper(void *param)
 {
     static_cast<LoRaCore *>(param)->sendTask();
@@ -51,6 +50,21 @@ void LoRaCore::autoAsaTaskWrapper(void *param)
     static_cast<LoRaCore *>(param)->autoAsaTask();
 }
 
+void LoRaCore::routeTaskWrapper(void *param)
+{
+    static_cast<LoRaCore *>(param)->routeTask();
+}
+
+void LoRaCore::transferTaskWrapper(void *param)
+{
+    static_cast<LoRaCore *>(param)->transferTask();
+}
+
+void LoRaCore::completionTaskWrapper(void *param)
+{
+    static_cast<LoRaCore *>(param)->completionTask();
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // INITIALIZATION
 // ═══════════════════════════════════════════════════════════════════════════
@@ -60,17 +74,15 @@ bool LoRaCore::begin()
     _loraLong.sf = LORA_SF;
     _loraLong.cr = LORA_CODING_RATE;
     _loraLong.bw = LORA_BANDWIDTH;
+    metrics.set(LORA_GAUGE_LAST_RSSI, -200);
+    metrics.set(LORA_GAUGE_LAST_SNR, -200);
+    metrics.set(LORA_GAUGE_TIME_ERROR_US, -1);
 
-    LLog("LoRaCore: Инициализация SPI для LoRa...");
-    // Initialize SPI
-    SPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_SS);
-    digitalWrite(LORA_RST, LOW); // Software reset of LoRa module
-    delay(5);
-    digitalWrite(LORA_RST, HIGH);
-    delay(2);
-
-    pinMode(LORA_BUSY, INPUT);
-    LLog("LoRaCore: BUSY state before init: " + String(digitalRead(LORA_BUSY)));
+    if (!radio.begin())
+    {
+        LLog("LoRaCore: Radio init failed");
+        return false;
+    }
 
     if (!applyLoRa(&_loraLong))
     {
@@ -78,28 +90,57 @@ bool LoRaCore::begin()
         return false;
     }
 
-    radio.setDio1Action(onReceive);
-    radio.startReceive();
+    radio.setIrqHandler(onReceive, this);
+    startReceiveMode();
 
     // Initialize FreeRTOS components
-    incomingQueue = xQueueCreate(LORA_INCOMING_QUEUE_SIZE, sizeof(LoRaPacket));
+    incomingQueue = xQueueCreate(LORA_INCOMING_QUEUE_SIZE, sizeof(LoRaRxFrame));
+    rxDrainQueue = xQueueCreate(LORA_RX_DRAIN_QUEUE_SIZE, sizeof(LoRaRxFrame));
     outgoingQueue = xQueueCreate(LORA_OUTGOING_QUEUE_SIZE, sizeof(LoRaPacket));
-    radioSemaphore = xSemaphoreCreateBinary();
+    radioQueue = xQueueCreate(LORA_RADIO_QUEUE_SIZE, sizeof(RadioCommand));
+    radioWaiterPool = xQueueCreate(LORA_RADIO_QUEUE_SIZE, sizeof(RadioWaiter *));
+    for (RadioWaiter &waiter : radioWaiters) {
+        waiter.started = xSemaphoreCreateBinary();
+        waiter.done = xSemaphoreCreateBinary();
+        RadioWaiter *free = &waiter;
+        if (!radioWaiterPool || !waiter.started || !waiter.done || xQueueSendToBack(radioWaiterPool, &free, 0) != pdTRUE) {
+            LLog("LoRaCore: Failed to create radio waiters");
+            return false;
+        }
+    }
     pendingMutex = xSemaphoreCreateMutex();
     asaMutex = xSemaphoreCreateMutex();
     logMutex = xSemaphoreCreateMutex();
     clientsMutex = xSemaphoreCreateMutex();
+    routesMutex = xSemaphoreCreateMutex();
+    tdmaMutex = xSemaphoreCreateMutex();
+    pollMutex = xSemaphoreCreateMutex();
+    transferMutex = xSemaphoreCreateMutex();
+    completionMutex = xSemaphoreCreateMutex();
+    coalesceMutex = xSemaphoreCreateMutex();
+    timeSyncMutex = xSemaphoreCreateMutex();
+    airtimeMutex = xSemaphoreCreateMutex();
+    txPowerMutex = xSemaphoreCreateMutex();
+    mtuMutex = xSemaphoreCreateMutex();
+    for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+        TxClass cls = (TxClass)i;
+        txQueues[i] = cls == TxClass::NORMAL ? outgoingQueue : xQueueCreate(txClassQueueSize(cls), sizeof(LoRaPacket));
+        if (!txQueues[i]) {
+            LLog("LoRaCore: Failed to create TX class queues");
+            return false;
+        }
+    }
 
-    if (!incomingQueue || !outgoingQueue || !radioSemaphore || !pendingMutex || !asaMutex || !logMutex || !clientsMutex)
+    if (!incomingQueue || !rxDrainQueue || !outgoingQueue || !radioQueue || !pendingMutex || !asaMutex || !logMutex || !clientsMutex || !routesMutex || !tdmaMutex || !pollMutex || !transferMutex || !completionMutex || !coalesceMutex || !timeSyncMutex || !airtimeMutex || !txPowerMutex || !mtuMutex)
     {
         LLog("LoRaCore: Failed to create FreeRTOS objects");
         return false;
     }
 
-    xSemaphoreGive(radioSemaphore);
-
     // Create tasks
-    BaseType_t res1 = xTaskCreatePinnedToCore(receiveTaskWrapper, "LoRaRecv", 6144, this, 3, &receiverTaskHandle, 1);
+    // Владелец радио - выше всех на ядре радио; разбор и диспетчеризация - на другом ядре
+    BaseType_t res0 = xTaskCreatePinnedToCore(radioTaskWrapper, "LoRaRadio", 4096, this, 4, &radioTaskHandle, 1);
+    BaseType_t res1 = xTaskCreatePinnedToCore(receiveTaskWrapper, "LoRaRecv", 6144, this, 3, &receiverTaskHandle, 0);
     BaseType_t res2 = xTaskCreatePinnedToCore(sendTaskWrapper, "LoRaSend", 6144, this, 2, &senderTaskHandle, 1);
     
     BaseType_t res3 = xTaskCreatePinnedToCore(resendTaskWrapper, "LoRaRetry", 4096, this, 1, nullptr, 0);
@@ -107,7 +148,7 @@ bool LoRaCore::begin()
     BaseType_t res5 = xTaskCreatePinnedToCore(processAsaProfileSwitchWrapper, "LoRaASA", 4096, this, 1, &asaTaskHandle, 0);
     BaseType_t res6 = xTaskCreatePinnedToCore(autoAsaTaskWrapper, "AutoASA", 4096, this, 1, &autoAsaTaskHandle, 0);
 
-    if (res1 != pdPASS || res2 != pdPASS || res3 != pdPASS || res4 != pdPASS || res5 != pdPASS || res6 != pdPASS)
+    if (res0 != pdPASS || res1 != pdPASS || res2 != pdPASS || res3 != pdPASS || res4 != pdPASS || res5 != pdPASS || res6 != pdPASS)
     {
         LLog("LoRaCore: Failed to create tasks");
         return false;
@@ -119,19 +160,13 @@ bool LoRaCore::begin()
 
 void LoRaCore::applySettings(int sf, int cr, float bw)
 {
-    if (radioSemaphore)
-        xSemaphoreTake(radioSemaphore, portMAX_DELAY);
-    radio.standby();
-    radio.setSpreadingFactor(sf);
-    radio.setCodingRate(cr);
-    radio.setBandwidth(bw);
-    currentSF = sf;
-    currentCR = cr;
-    currentBW = bw;
-    updateRetryParameters();
-    radio.startReceive();
-    if (radioSemaphore)
-        xSemaphoreGive(radioSemaphore);
+    RadioCommand cmd;
+    cmd.op = RadioOp::APPLY_SETTINGS;
+    cmd.sf = sf;
+    cmd.cr = cr;
+    cmd.bw = bw;
+    int result;
+    radioCall(cmd, result);
 
     LLog("LoRaCore: Применены настройки LoRa: SF=" + String(sf) +
          ", CR=" + String(cr) +
@@ -160,33 +195,588 @@ bool LoRaCore::removePendingPacket(PacketId_t packetId)
             putToLogBuffer(String(s));
 
             pending.erase(it);
+            tracer.cancel(packetId);
             removed = true;
         }
         xSemaphoreGive(pendingMutex);
     }
+    if (removed) {
+        sendEvent(packetId, SendEvent::CANCELLED);
+    }
     return removed;
 }
 
-int LoRaCore::transmitPacket(const LoRaPacket *txPkt, const size_t len)
+int LoRaCore::transmitPacket(const LoRaPacket *txPkt, const size_t len, const std::function<void()> &whileOnAir,
+                             uint8_t *timeTrailer)
+{
+    RadioCommand cmd;
+    cmd.op = RadioOp::TRANSMIT;
+    cmd.pkt = txPkt;
+    cmd.len = len;
+    cmd.timeTrailer = timeTrailer;
+    // Получатель в duty-cycle RX услышит кадр, только если преамбула перекрывает его сон
+    cmd.wakePreamble = (_mode == RadioMode::LORA) && isPeerWakePreamble(txPkt->getReceiverId());
+    cmd.traced = !isForwardedFrame(*txPkt);
+    cmd.txPower = txPowerFor(*txPkt);
+    bool traced = cmd.traced;
+    int result;
+    radioCall(cmd, result, portMAX_DELAY, whileOnAir);
+
+    LoRaPacketTrace trace;
+    uint32_t txDoneUs = result == LORA_RADIO_OK ? txTimes.get(txPkt->packetId) : 0;
+    if (traced && tracer.txEnd(txPkt->packetId, result == LORA_RADIO_OK, trace, txDoneUs)) {
+        emitTrace(trace);
+    }
+    if (traced) {
+        sendEvent(txPkt->packetId, result == LORA_RADIO_OK ? SendEvent::TRANSMITTED : SendEvent::TX_FAILED);
+    }
+    return result;
+}
+
+void LoRaCore::emitTrace(const LoRaPacketTrace &trace)
+{
+    if (traceCallback) {
+        traceCallback(trace);
+    } else {
+        putToLogBuffer(trace.toString());
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RADIO OWNER
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Единственная задача, которая трогает радио. Ждёт команду; IRQ приёма встаёт в начало
+// очереди, окно RX после передачи закрывается по таймауту ожидания
+void LoRaCore::radioTask()
+{
+    RadioCommand cmd;
+    while (true) {
+        TickType_t waitTicks = portMAX_DELAY;
+        if (rxWindowOpen) {
+            long leftMs = (long)(rxWindowUntil - millis());
+            waitTicks = leftMs > 0 ? pdMS_TO_TICKS(leftMs) + 1 : 0;
+        }
+        if (xQueueReceive(radioQueue, &cmd, waitTicks) != pdTRUE) {
+            closeRxWindowIfExpired();
+            continue;
+        }
+        int result = executeRadioCommand(cmd);
+        if (cmd.result) {
+            *cmd.result = result;
+        }
+        if (cmd.done) {
+            xSemaphoreGive(cmd.done);
+        }
+    }
+}
+
+// Семафоры ожидания - из пула radioWaiters, созданного в begin(). Задача радио отдаёт каждый
+// ровно раз на принятую команду, а вызывающий забирает его до возврата пары в пул: в пуле оба пусты
+bool LoRaCore::radioCall(RadioCommand &cmd, int &result, TickType_t waitTicks,
+                         const std::function<void()> &whileOnAir)
+{
+    // До begin() и после ошибки в нём других владельцев радио нет
+    if (!radioQueue || !radioTaskHandle || xTaskGetCurrentTaskHandle() == radioTaskHandle) {
+        result = executeRadioCommand(cmd);
+        if (whileOnAir) {
+            whileOnAir();
+        }
+        return true;
+    }
+    result = LORA_RADIO_ERR_UNKNOWN;
+    cmd.result = &result;
+    RadioWaiter *waiter = nullptr;
+    if (!radioWaiterPool || xQueueReceive(radioWaiterPool, &waiter, waitTicks) != pdTRUE) {
+        return false;
+    }
+    cmd.done = waiter->done;
+    cmd.started = whileOnAir ? waiter->started : nullptr;
+    bool accepted = xQueueSendToBack(radioQueue, &cmd, waitTicks) == pdTRUE;
+    if (accepted) {
+        if (cmd.started) {
+            xSemaphoreTake(cmd.started, portMAX_DELAY);
+            whileOnAir();
+        }
+        // Принятую команду ждём до конца: задача радио пишет в result на нашем стеке
+        xSemaphoreTake(cmd.done, portMAX_DELAY);
+        if (whileOnAir && !cmd.started) {
+            whileOnAir();
+        }
+    }
+    cmd.started = nullptr;
+    cmd.done = nullptr;
+    xQueueSendToBack(radioWaiterPool, &waiter, 0);
+    return accepted;
+}
+
+int LoRaCore::executeRadioCommand(const RadioCommand &cmd)
+{
+    // Кадр в буфере радио - первым: передача и перенастройка его затёрли бы
+    bool pending = rxPending;
+    drainRxFrame();
+    switch (cmd.op) {
+    case RadioOp::IRQ:
+        if (pending) {
+            startReceiveMode();
+        }
+        return LORA_RADIO_OK;
+    case RadioOp::TRANSMIT:
+        return radioTransmit(cmd);
+    case RadioOp::APPLY_SETTINGS:
+        radioApplySettings(cmd.sf, cmd.cr, cmd.bw);
+        return LORA_RADIO_OK;
+    case RadioOp::APPLY_PROFILE:
+        return radioApplyProfile(cmd.profileIndex) ? LORA_RADIO_OK : LORA_RADIO_ERR_CONFIG;
+    case RadioOp::SWITCH_MODE:
+        return switchTo(cmd.mode) ? LORA_RADIO_OK : LORA_RADIO_ERR_CONFIG;
+    case RadioOp::LOW_POWER_RX:
+        return radioSetLowPowerRx(cmd.enabled);
+    case RadioOp::SCAN_CHANNEL:
+        return radioScanChannel();
+    default:
+        return LORA_RADIO_ERR_UNKNOWN;
+    }
+}
+
+int LoRaCore::radioTransmit(const RadioCommand &cmd)
+{
+    const LoRaPacket *txPkt = cmd.pkt;
+    uint16_t preambleLen = cmd.wakePreamble ? LORA_WAKE_PREAMBLE_LEN : LORA_PREAMBLE_LEN;
+    uint32_t expectedUs = _mode == RadioMode::LORA
+                              ? loraTimeOnAirUs(currentSF, currentBW, currentCR, preambleLen, cmd.len)
+                              : fskTimeOnAirUs(currentBitrate, cmd.len);
+    // Последний рубеж duty cycle: кадры MAC и ACK идут мимо ожидания бюджета в sendTask
+    if (dutyCycleEnforced && dutyCycleWaitMs(expectedUs) > 0) {
+        metrics.add(LORA_CNT_TX_DUTY_BLOCKED);
+        if (cmd.started) {
+            xSemaphoreGive(cmd.started);
+        }
+        return LORA_RADIO_ERR_DUTY_CYCLE;
+    }
+    radio.standby();
+    if (cmd.wakePreamble) {
+        radio.setPreambleLength(preambleLen);
+    }
+    if (cmd.txPower != radioPower && radio.setOutputPower(cmd.txPower) == LORA_RADIO_OK) {
+        radioPower = cmd.txPower;
+    }
+
+    // Уведомление от передачи, брошенной по таймауту, не должно закончить эту
+    ulTaskNotifyTake(pdTRUE, 0);
+    txActive = true;
+    uint32_t txStartUs = micros();
+    if (cmd.traced) {
+        tracer.txStart(txPkt->packetId, txStartUs);
+    }
+    if (cmd.timeTrailer) {
+        // Метка - прямо перед передачей: ожидаемый TX done по времени в эфире
+        LoRaTimeTrailer trailer;
+        memcpy(&trailer, cmd.timeTrailer, sizeof(trailer));
+        timeStamper.stamp(trailer, txPkt->packetId, txStartUs, expectedUs);
+        memcpy(cmd.timeTrailer, &trailer, sizeof(trailer));
+    }
+    int result = radio.startTransmit((const uint8_t *)txPkt, cmd.len);
+    bool started = result == LORA_RADIO_OK;
+    if (cmd.started) {
+        xSemaphoreGive(cmd.started);
+    }
+    if (result == LORA_RADIO_OK) {
+        // Кадр передаёт радио: задача спит до IRQ TX done, ядро свободно весь эфир
+        TickType_t timeout = pdMS_TO_TICKS(2 * expectedUs / 1000 + LORA_TX_DONE_MARGIN_MS);
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0) {
+            result = LORA_RADIO_ERR_TX_TIMEOUT;
+        }
+    }
+    txActive = false;
+    lastTxEndUs = result == LORA_RADIO_OK ? txDoneUs : micros();
+    if (cmd.timeTrailer) {
+        if (result == LORA_RADIO_OK) {
+            timeStamper.onTxDone(lastTxEndUs);
+        } else {
+            timeStamper.onTxFailed();
+        }
+    }
+    radio.finishTransmit();
+    // Приём - сразу после TX done, учёт - уже в приёме
+    if (cmd.wakePreamble) {
+        radio.setPreambleLength(LORA_PREAMBLE_LEN);
+    }
+    if (result == LORA_RADIO_OK && lowPowerRx && txPkt->isAckRequired()) {
+        openRxWindow();
+    }
+    startReceiveMode();
+    uint32_t airtimeUs = lastTxEndUs - txStartUs;
+    // Без TX done кадр мог всё равно уйти в эфир: учитывается любая начатая передача
+    if (started && airtimeMutex && xSemaphoreTake(airtimeMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        airtime.record(millis(), currentFreq, txPkt->getReceiverId(), txPkt->packetType, airtimeUs);
+        xSemaphoreGive(airtimeMutex);
+    }
+    if (result == LORA_RADIO_OK) {
+        if (cmd.traced) {
+            txTimes.set(txPkt->packetId, lastTxEndUs);
+        }
+        metrics.record(LORA_HIST_TX_AIRTIME_US, airtimeUs);
+        metrics.add(LORA_CNT_TX_AIRTIME_MS, (airtimeUs + 500) / 1000);
+        metrics.set(LORA_GAUGE_TX_POWER, radioPower);
+        if (radioPower < currentTX) {
+            metrics.add(LORA_CNT_TX_POWER_REDUCED);
+        }
+    }
+    return result;
+}
+
+void LoRaCore::radioApplySettings(int sf, int cr, float bw)
+{
+    radio.standby();
+    radio.configureLoRa(currentFreq, sf, cr, bw, LORA_PREAMBLE_LEN, currentTX, LORA_SYNC_WORD);
+    radioPower = currentTX;
+    currentSF = sf;
+    currentCR = cr;
+    currentBW = bw;
+    updateRetryParameters();
+    resetTxPower();
+    startReceiveMode();
+}
+
+int LoRaCore::scanChannel()
+{
+    RadioCommand cmd;
+    cmd.op = RadioOp::SCAN_CHANNEL;
+    int result;
+    radioCall(cmd, result);
+    return result;
+}
+
+int LoRaCore::radioScanChannel()
 {
-    xSemaphoreTake(radioSemaphore, portMAX_DELAY);
+    if (_mode != RadioMode::LORA) {
+        return LORA_RADIO_ERR_CONFIG;
+    }
     radio.standby();
-    int result = radio.transmit((uint8_t *)txPkt, len);
-    radio.startReceive();
-    xSemaphoreGive(radioSemaphore);
+    int result = radio.scanChannel();
+    startReceiveMode();
     return result;
 }
 
+// ═══════════════════════════════════════════════════════════════════════════
+// LOW-POWER RX
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Перезапуск приёма в текущем режиме. Вызывать из задачи радио.
+int LoRaCore::startReceiveMode()
+{
+    if (lowPowerRx && _mode == RadioMode::LORA && !rxWindowOpen) {
+        return radio.startReceiveDutyCycle(LORA_WAKE_PREAMBLE_LEN, LORA_RX_DUTY_MIN_SYMBOLS);
+    }
+    return radio.startReceive();
+}
+
+// Короткое окно непрерывного RX после нашей передачи: ACK/ответ на текущем профиле.
+// Вызывать из задачи радио, перед startReceiveMode().
+void LoRaCore::openRxWindow()
+{
+    size_t ackLen = offsetof(LoRaPacket, payload) + sizeof(uint8_t) + sizeof(PacketId_t);
+    uint32_t ackAirMs = profileTimeOnAirUs(currentProfileIndex, ackLen, LORA_WAKE_PREAMBLE_LEN) / 1000;
+    rxWindowUntil = millis() + ackAirMs + LORA_RX_WINDOW_MARGIN_MS;
+    rxWindowOpen = true;
+}
+
+void LoRaCore::closeRxWindowIfExpired()
+{
+    if (!rxWindowOpen || (long)(millis() - rxWindowUntil) < 0) {
+        return;
+    }
+    drainRxFrame();
+    rxWindowOpen = false;
+    startReceiveMode();
+}
+
+void LoRaCore::setLowPowerRx(bool enabled)
+{
+    RadioCommand cmd;
+    cmd.op = RadioOp::LOW_POWER_RX;
+    cmd.enabled = enabled;
+    int result;
+    if (radioCall(cmd, result, pdMS_TO_TICKS(3000))) {
+        char s[100];
+        snprintf(s, sizeof(s), "[LowPower] RX %s (state=%d%s)", enabled ? "duty-cycle" : "continuous", result,
+                 (enabled && _mode != RadioMode::LORA) ? ", FSK: continuous" : "");
+        putToLogBuffer(String(s));
+        sendLowPowerNotice(enabled);
+    }
+}
+
+// Адресат по умолчанию шлёт нам команды: без объявления он не знает, что нужна длинная преамбула.
+// Повтор прежнего объявления снимается: пришедший позже нового, он вернул бы старый режим
+void LoRaCore::sendLowPowerNotice(bool enabled)
+{
+    if (dstAddress == 0 || dstAddress == DEVICE_ID_BROADCAST) {
+        return;
+    }
+    PacketId_t previous = lowPowerNoticeId.exchange(0);
+    if (previous) {
+        removePendingPacket(previous);
+    }
+    PacketLowPower notice;
+    notice.enabled = enabled ? 1 : 0;
+    lowPowerNoticeId = sendPacketBase(dstAddress, &notice, &notice.enabled);
+}
+
+// Режим соседа меняется до ACK: на объявление о duty-cycle ACK уходит уже с длинной преамбулой
+void LoRaCore::onLowPowerNotice(const LoRaPacket &pkt)
+{
+    bool enabled = false;
+    if (!PacketLowPower::parse(pkt.payload, pkt.payloadLen, enabled)) {
+        metrics.add(LORA_CNT_RX_ERRORS);
+        return;
+    }
+    LoraAddress_t sender = pkt.getSenderId();
+    if (enabled != isPeerWakePreamble(sender)) {
+        setPeerWakePreamble(sender, enabled);
+        char s[80];
+        snprintf(s, sizeof(s), "[LowPower] Peer %u: %s RX", sender, enabled ? "duty-cycle" : "continuous");
+        putToLogBuffer(String(s));
+    }
+    if (pkt.isAckRequired()) {
+        addAckToBulk(pkt.packetId, sender);
+        flushBulkAck(sender);
+    }
+}
+
+int LoRaCore::radioSetLowPowerRx(bool enabled)
+{
+    lowPowerRx = enabled;
+    rxWindowOpen = false;
+    radio.standby();
+    return startReceiveMode();
+}
+
 PacketId_t LoRaCore::sendPacketBase(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload)
+{
+    PacketId_t packetId = 0;
+    enqueuePacket(receiverId, base, payload, 0, true, packetId);
+    return packetId;
+}
+
+SendStatus LoRaCore::trySendPacket(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload,
+                                   PacketId_t *packetId)
+{
+    PacketId_t id = 0;
+    SendStatus status = enqueuePacket(receiverId, base, payload, 0, false, id);
+    if (packetId) {
+        *packetId = id;
+    }
+    return status;
+}
+
+LoRaSendCredit LoRaCore::getSendCredit(LoraAddress_t destination)
+{
+    LoraAddress_t peer = destination == DEVICE_ID_BROADCAST ? DEVICE_ID_BROADCAST : findNextHop(destination);
+    uint8_t mtu = getMtu(peer);
+    unsigned long airMs = profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + mtu) / 1000;
+    uint32_t frameMs = airMs + sendPacingMs(airMs);
+    return credits.credit(peer, LoRaCreditLedger::windowFor(frameMs), getOutgoingQueueFree(), frameMs, mtu);
+}
+
+PacketId_t LoRaCore::sendPacketLatest(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload, uint8_t key)
+{
+    if (!coalesceMutex || xSemaphoreTake(coalesceMutex, pdMS_TO_TICKS(200)) != pdTRUE) {
+        return 0;
+    }
+    if (receiverId == DEVICE_ID_BROADCAST || base->broadcast) {
+        receiverId = DEVICE_ID_BROADCAST;
+    }
+    LoRaCoalesceTarget target;
+    target.found = coalesce.find(receiverId, key, target.packetId);
+    PacketId_t packetId = 0;
+    SendStatus status = enqueuePacket(receiverId, base, payload, 0, true, packetId, &target);
+    if (status == SendStatus::QUEUED) {
+        coalesce.set(receiverId, key, packetId, millis());
+    }
+    xSemaphoreGive(coalesceMutex);
+    return status == SendStatus::QUEUED ? packetId : 0;
+}
+
+// Свой кадр oldId в outgoingQueue заменяется frame на том же месте. Очередь проворачивается
+// целиком, как при поиске AGR; кадры, поставленные другими задачами за это время, встают после
+bool LoRaCore::replaceQueuedFrame(PacketId_t oldId, const LoRaPacket &frame)
+{
+    QueueHandle_t queue = txQueues[(uint8_t)txClassOf(frame)];
+    bool replaced = false;
+    UBaseType_t count = uxQueueMessagesWaiting(queue);
+    LoRaPacket pkt;
+    for (UBaseType_t i = 0; i < count && xQueueReceive(queue, &pkt, 0) == pdTRUE; i++) {
+        if (!replaced && pkt.packetId == oldId && pkt.packetType == frame.packetType &&
+            pkt.getReceiverId() == frame.getReceiverId() && !isForwardedFrame(pkt)) {
+            credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+            credits.onQueued(frame.getReceiverId(), frame.payloadLen);
+            if (pkt.isAckRequired()) {
+                txQueued.remove(pkt.packetId);
+            }
+            pkt = frame;
+            replaced = true;
+        }
+        if (xQueueSendToBack(queue, &pkt, pdMS_TO_TICKS(10)) != pdTRUE) {
+            metrics.add(LORA_CNT_TX_QUEUE_FULL);
+            if (!isForwardedFrame(pkt)) {
+                credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+                tracer.cancel(pkt.packetId);
+            }
+        }
+    }
+    wakeSendTask();
+    return replaced;
+}
+
+// Кадр, снятый с outgoingQueue под AGR, возвращается, если AGR не встал в очередь. Места нет и
+// для него - кадр с ACK повторит resendTask, без ACK - итог DROPPED
+void LoRaCore::restoreQueuedFrame(const LoRaPacket &pkt)
+{
+    if (queueTxFrame(pkt, TxClass::NORMAL, pdMS_TO_TICKS(10))) {
+        credits.onQueued(pkt.getReceiverId(), pkt.payloadLen);
+        return;
+    }
+    metrics.add(LORA_CNT_TX_QUEUE_FULL);
+    if (pkt.isAckRequired()) {
+        txQueued.remove(pkt.packetId);
+        return;
+    }
+    tracer.cancel(pkt.packetId);
+    sendEvent(pkt.packetId, SendEvent::TX_FAILED);
+}
+
+// AGR из кадра pkt и сообщения base - в agrFrame, с ID кадра pkt: AGR дополняется, если вместит
+// по MTU получателя, обычный кадр того же получателя становится AGR из двух
+bool LoRaCore::buildMergedAgr(const LoRaPacket &pkt, const PacketBase *base, const uint8_t *payload, uint8_t mtu,
+                              LoRaPacket &agrFrame)
+{
+    uint8_t types[PacketAggregated::MAX_SUB_PACKETS];
+    const uint8_t* payloads[PacketAggregated::MAX_SUB_PACKETS];
+    uint8_t lens[PacketAggregated::MAX_SUB_PACKETS];
+    uint8_t count = 0;
+    if (pkt.packetType == CMD_AGR) {
+        PacketAggregated agr;
+        agr.payloadLen = pkt.payloadLen;
+        if (!agr.canFit(base->payloadLen, mtu) ||
+            !agr.deserialize(pkt.payload, pkt.payloadLen,
+                             [&](uint8_t type, const uint8_t* pl, uint8_t len) {
+                                 if (count < PacketAggregated::MAX_SUB_PACKETS) {
+                                     types[count] = type;
+                                     payloads[count] = pl;
+                                     lens[count] = len;
+                                     count++;
+                                 }
+                             })) {
+            return false;
+        }
+    } else if (pkt.packetType != CMD_ACK &&
+               pkt.packetType != CMD_BULK_ACK &&
+               pkt.packetType != CMD_REQUEST_ASA &&
+               pkt.packetType != CMD_RESPONCE_ASA &&
+               pkt.packetType != CMD_RELAY &&
+               pkt.packetType != CMD_ROUTE_ADV &&
+               pkt.packetType != CMD_TRANSFER &&
+               pkt.packetType != CMD_LINK_REPORT &&
+               !pkt.isAckRequired() &&
+               pkt.payloadLen <= 30 &&
+               deadlines.deadline(pkt.packetId) == 0) {
+        // AGR без ACK: кадр с ACK так и ждёт его отдельно
+        types[0] = pkt.packetType;
+        payloads[0] = pkt.payload;
+        lens[0] = pkt.payloadLen;
+        count = 1;
+    } else {
+        return false;
+    }
+    if (count >= PacketAggregated::maxSubPackets(mtu)) {
+        return false;
+    }
+    types[count] = base->packetType;
+    payloads[count] = payload;
+    lens[count] = base->payloadLen;
+    count++;
+
+    // Заголовок AGR, подпакеты - сразу в кадр
+    PacketAggregated newAgr;
+    newAgr.packetId = pkt.packetId; // Keep original ID
+    newAgr.payloadLen = 0;
+    packBaseIntoLoRa(&agrFrame, srcAddress, pkt.getReceiverId(), &newAgr, nullptr);
+    agrFrame.payloadLen = newAgr.serialize(agrFrame.payload, mtu, types, payloads, lens, count);
+    return agrFrame.payloadLen > 0;
+}
+
+// Сообщение base вкладывается в первый подходящий кадр получателя в outgoingQueue, AGR встаёт на
+// место кадра - как в replaceQueuedFrame(), порядок очереди не меняется. agrFrame - буфер AGR
+bool LoRaCore::aggregateQueued(LoraAddress_t receiverId, const PacketBase *base, const uint8_t *payload,
+                               uint8_t mtu, LoRaPacket &agrFrame, PacketId_t &agrId)
+{
+    bool merged = false;
+    bool tried = false;
+    uint8_t foundType = 0;
+    UBaseType_t count = uxQueueMessagesWaiting(outgoingQueue);
+    LoRaPacket pkt;
+    for (UBaseType_t i = 0; i < count && xQueueReceive(outgoingQueue, &pkt, 0) == pdTRUE; i++) {
+        const LoRaPacket *out = &pkt;
+        if (!tried && pkt.getReceiverId() == receiverId && buildMergedAgr(pkt, base, payload, mtu, agrFrame)) {
+            tried = true;
+            out = &agrFrame;
+        }
+        if (xQueueSendToBack(outgoingQueue, out, pdMS_TO_TICKS(10)) == pdTRUE) {
+            if (out == &agrFrame) {
+                merged = true;
+                agrId = pkt.packetId;
+                foundType = pkt.packetType;
+                credits.onDequeued(receiverId, pkt.payloadLen);
+                credits.onQueued(receiverId, agrFrame.payloadLen);
+            }
+        } else if (out == &agrFrame) {
+            // Очередь заняли другие задачи: сообщение - обычным кадром
+            credits.onDequeued(receiverId, pkt.payloadLen);
+            restoreQueuedFrame(pkt);
+        } else {
+            metrics.add(LORA_CNT_TX_QUEUE_FULL);
+            if (!isForwardedFrame(pkt)) {
+                credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+                tracer.cancel(pkt.packetId);
+            }
+        }
+    }
+    wakeSendTask();
+    if (merged) {
+        char s[120];
+        if (foundType == CMD_AGR) {
+            snprintf(s, sizeof(s), "📦➕ Added to AGR: id=%u, type=%c, to=%u", base->packetId, base->packetType, receiverId);
+            metrics.add(LORA_CNT_AGGREGATED);
+        } else {
+            snprintf(s, sizeof(s), "📦✨ Created AGR: id=%u, types=[%c,%c], to=%u", agrId, foundType, base->packetType,
+                     receiverId);
+            metrics.add(LORA_CNT_AGGREGATED, 2);
+        }
+        putToLogBuffer(String(s));
+    }
+    return merged;
+}
+
+// handle != 0: асинхронная отправка, итог привязывается к кадру, в котором едет сообщение.
+// wait = false: без ожидания места в очереди и pendingMutex (WOULD_BLOCK).
+// packetId - ID кадра или AGR; при переполнении очереди в блокирующем режиме тоже заполняется
+SendStatus LoRaCore::enqueuePacket(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload,
+                                   SendHandle_t handle, bool wait, PacketId_t &packetId,
+                                   const LoRaCoalesceTarget *coalesce)
 {
     if (!outgoingQueue) {
         char s2[100];
         snprintf(s2, sizeof(s2), "⚠️ outgoingQueue is null! Cannot send packet type=%c", base->packetType);
         putToLogBuffer(String(s2));
-        return 0;
+        return SendStatus::NOT_READY;
     }
     
     base->packetId = ++nextPacketId;
+    deadlines.set(base->packetId, base->ttlMs, millis());
+    UBaseType_t queueDepth = uxQueueMessagesWaiting(outgoingQueue);
+    metrics.record(LORA_HIST_TX_QUEUE_DEPTH, queueDepth);
+    metrics.set(LORA_GAUGE_TX_QUEUE, queueDepth);
     
     // === BROADCAST HANDLING ===
     // Broadcast packets NEVER require ACK or retry
@@ -198,6 +788,41 @@ PacketId_t LoRaCore::sendPacketBase(LoraAddress_t receiverId, PacketBase *base,
         base->noRetry = true;        // Fire-and-forget
         receiverId = DEVICE_ID_BROADCAST;  // Force broadcast address
     }
+
+    // Кадр длиннее MTU узел не примет или держит эфир дольше, чем допускает профиль
+    uint8_t mtu = getMtu(receiverId);
+    if (base->payloadLen > mtu) {
+        char s[100];
+        snprintf(s, sizeof(s), "⚠️ payload %u > MTU %u to %u, type=%c not sent", base->payloadLen, mtu, receiverId,
+                 base->packetType);
+        putToLogBuffer(String(s));
+        if (handle) {
+            completeSend(handle, SendResult::TOO_LARGE);
+        }
+        return SendStatus::TOO_LARGE;
+    }
+    tracer.begin(base->packetId, receiverId, base->packetType, base->ackRequired);
+    if (handle) {
+        // До постановки в очередь: sendTask может передать кадр сразу
+        bindCompletion(handle, base->packetId, base->ackRequired);
+    }
+
+    // === RELAY ===
+    // Unicast уходит через next hop из таблицы маршрутов кадром CMD_RELAY.
+    // ASA меняет профиль конкретного радиоканала - только напрямую, как и отчёт о линии и режим RX соседа.
+    LoraAddress_t nextHop = receiverId;
+    if (!isBroadcast && base->packetType != CMD_REQUEST_ASA && base->packetType != CMD_RESPONCE_ASA &&
+        base->packetType != CMD_LINK_REPORT && base->packetType != CMD_LOW_POWER) {
+        nextHop = findNextHop(receiverId);
+    }
+    bool relayed = nextHop != receiverId;
+    if (relayed && base->payloadLen > LORA_RELAY_MAX_INNER_PAYLOAD) {
+        char s[100];
+        snprintf(s, sizeof(s), "⚠️ Relay: payload %u > %u, sending id=%u to %u directly",
+                 base->payloadLen, LORA_RELAY_MAX_INNER_PAYLOAD, base->packetId, receiverId);
+        putToLogBuffer(String(s));
+        relayed = false;
+    }
     
     // === AUTOMATIC AGGREGATION LOGIC ===
     // Try to aggregate if:
@@ -206,218 +831,154 @@ PacketId_t LoRaCore::sendPacketBase(LoraAddress_t receiverId, PacketBase *base,
     // 3. Not broadcast (broadcast should be sent immediately)
     // 4. Queue has packets waiting
     // 5. Payload is small enough (leaving room for headers)
-    bool canAggregate = base->highPriority == false && 
+    // 6. Aggregation is not disabled (setAggregationEnabled)
+    // 7. Not relayed (AGR is a single-hop frame)
+    // 8. Not a block transfer frame or link report (handled by the core, AGR goes to the application)
+    // 9. Not a latest-value sample (it must stay replaceable in the queue)
+    // 10. No deadline (AGR has one deadline for all sub-packets)
+    bool canAggregate = aggregationEnabled &&
+                        !coalesce &&
+                        base->ttlMs == 0 &&
+                        !relayed &&
+                        base->packetType != CMD_TRANSFER &&
+                        base->packetType != CMD_LINK_REPORT &&
+                        base->highPriority == false && 
                         base->ackRequired == false &&
                         !isBroadcast &&
                         base->payloadLen <= 30 &&
                         uxQueueMessagesWaiting(outgoingQueue) > 0;
     
+    // Кадр собирается в frame: он же буфер AGR при вложении
+    LoRaPacket frame = {};
     if (canAggregate) {
-        // Search for existing AGR packet or regular packet for same receiver
-        LoRaPacket searchPkt = {};
-        LoRaPacket foundPkt = {};
-        bool foundAggregated = false;
-        bool foundRegular = false;
-        int queueSize = uxQueueMessagesWaiting(outgoingQueue);
-        
-        // Peek through queue (max 10 packets to avoid delays)
-        for (int i = 0; i < queueSize && i < 30; i++) {
-            if (xQueuePeek(outgoingQueue, &searchPkt, 0) == pdTRUE) {
-                // Check if it's for same receiver
-                if (searchPkt.getReceiverId() == receiverId) {
-                    if (searchPkt.packetType == CMD_AGR) {
-                        // Found existing aggregated packet!
-                        PacketAggregated agr;
-                        if (agr.canFit(base->payloadLen)) {
-                            foundAggregated = true;
-                            foundPkt = searchPkt;
-                            break;
-                        }
-                    } else if (!foundRegular && 
-                               searchPkt.packetType != CMD_ACK && 
-                               searchPkt.packetType != CMD_BULK_ACK &&
-                               searchPkt.packetType != CMD_REQUEST_ASA &&
-                               searchPkt.packetType != CMD_RESPONCE_ASA &&
-                               searchPkt.payloadLen <= 30) {
-                        // Found regular packet that can be aggregated
-                        foundRegular = true;
-                        foundPkt = searchPkt;
-                    }
-                }
-                
-                // Remove and re-add to rotate queue for peeking next
-                if (xQueueReceive(outgoingQueue, &searchPkt, 0) == pdTRUE) {
-                    xQueueSendToFront(outgoingQueue, &searchPkt, 0);
-                }
-            }
-        }
-        
-
-        if (foundAggregated) {
-            // Add to existing AGR packet
-            PacketAggregated agr;
-            if (agr.deserialize(foundPkt.payload, foundPkt.payloadLen, 
-                               [](uint8_t, const uint8_t*, uint8_t){})) {
-                
-                // Remove old AGR from queue
-                LoRaPacket tempPkt;
-                bool removed = false;
-                int attempts = queueSize;
-                while (attempts-- > 0 && xQueueReceive(outgoingQueue, &tempPkt, 0) == pdTRUE) {
-                    if (tempPkt.packetId == foundPkt.packetId && 
-                        tempPkt.packetType == CMD_AGR) {
-                        removed = true;
-                        break;
-                    }
-                    xQueueSendToBack(outgoingQueue, &tempPkt, 10);
-                }
-                
-                if (removed) {
-                    // Create new AGR with additional packet
-                    uint8_t types[PacketAggregated::MAX_SUB_PACKETS];
-                    const uint8_t* payloads[PacketAggregated::MAX_SUB_PACKETS];
-                    uint8_t lens[PacketAggregated::MAX_SUB_PACKETS];
-                    uint8_t count = 0;
-                    
-                    // Extract existing sub-packets
-                    agr.deserialize(foundPkt.payload, foundPkt.payloadLen,
-                                   [&](uint8_t type, const uint8_t* pl, uint8_t len) {
-                                       if (count < PacketAggregated::MAX_SUB_PACKETS) {
-                                           types[count] = type;
-                                           payloads[count] = pl;
-                                           lens[count] = len;
-                                           count++;
-                                       }
-                                   });
-                    
-                    // Add new packet
-                    if (count < PacketAggregated::MAX_SUB_PACKETS) {
-                        types[count] = base->packetType;
-                        payloads[count] = payload;
-                        lens[count] = base->payloadLen;
-                        count++;
-                        
-                        // Serialize new AGR
-                        PacketAggregated newAgr;
-                        uint8_t agrPayload[MAX_LORA_PAYLOAD];
-                        uint8_t agrLen = newAgr.serialize(agrPayload, MAX_LORA_PAYLOAD, 
-                                                         types, payloads, lens, count);
-                        
-                        if (agrLen > 0) {
-                            newAgr.payloadLen = agrLen;
-                            newAgr.packetId = foundPkt.packetId; // Keep original ID
-                            
-                            LoRaPacket agrFrame = {};
-                            packBaseIntoLoRa(&agrFrame, srcAddress, receiverId, &newAgr, agrPayload);
-                            xQueueSendToBack(outgoingQueue, &agrFrame, 20);
-                            
-                            char s[120];
-                            snprintf(s, sizeof(s), "📦➕ Added to AGR: id=%u, type=%c, count=%u→%u, to=%u", 
-                                    base->packetId, base->packetType, count-1, count, receiverId);
-                            putToLogBuffer(String(s));
-                            
-                            return foundPkt.packetId; // Return AGR's ID
-                        }
-                    }
-                }
-            }
-        } else if (foundRegular) {
-            // Create new AGR from two packets
-            // Remove found packet from queue
-            LoRaPacket tempPkt;
-            bool removed = false;
-            int attempts = queueSize;
-            while (attempts-- > 0 && xQueueReceive(outgoingQueue, &tempPkt, 0) == pdTRUE) {
-                if (tempPkt.packetId == foundPkt.packetId) {
-                    removed = true;
-                    break;
-                }
-                xQueueSendToBack(outgoingQueue, &tempPkt, 10);
-            }
-            
-            if (removed) {
-                PacketAggregated newAgr;
-                uint8_t types[2] = {foundPkt.packetType, base->packetType};
-                const uint8_t* payloads[2] = {foundPkt.payload, payload};
-                uint8_t lens[2] = {foundPkt.payloadLen, base->payloadLen};
-                
-                uint8_t agrPayload[MAX_LORA_PAYLOAD];
-                uint8_t agrLen = newAgr.serialize(agrPayload, MAX_LORA_PAYLOAD, types, payloads, lens, 2);
-                
-                if (agrLen > 0) {
-                    newAgr.payloadLen = agrLen;
-                    newAgr.packetId = foundPkt.packetId; // Use first packet's ID
-                    
-                    LoRaPacket agrFrame = {};
-                    packBaseIntoLoRa(&agrFrame, srcAddress, receiverId, &newAgr, agrPayload);
-                    xQueueSendToFront(outgoingQueue, &agrFrame, pdMS_TO_TICKS(10));
-                    
-                    char s[150];
-                    snprintf(s, sizeof(s), "📦✨ Created AGR: id=%u, types=[%c,%c], lens=[%u,%u], to=%u", 
-                            foundPkt.packetId, foundPkt.packetType, base->packetType, 
-                            foundPkt.payloadLen, base->payloadLen, receiverId);
-                    putToLogBuffer(String(s));
-                    
-                    // Add to pending if waitForAck
-                    if (base->ackRequired && pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-                        PendingSend pendingItem = {};
-                        pendingItem.pkt = agrFrame;
-                        pendingItem.timestamp = millis();
-                        pendingItem.retries = 0;
-                        pending.push_back(pendingItem);
-                        xSemaphoreGive(pendingMutex);
-                    }
-                    
-                    return foundPkt.packetId; // Return AGR's ID (first packet's ID)
-                }
+        PacketId_t agrId = 0;
+        if (aggregateQueued(receiverId, base, payload, mtu, frame, agrId)) {
+            tracer.cancel(base->packetId);
+            if (handle) {
+                bindCompletion(handle, agrId, false);
             }
+            packetId = agrId; // Return AGR's ID
+            return SendStatus::QUEUED;
         }
     }
     
     // === NORMAL SENDING (no aggregation) ===
-    LoRaPacket frame = {};
     packBaseIntoLoRa(&frame, srcAddress, receiverId, base, payload);
-    
-    bool ok;
-    if (base->highPriority) {
-        ok = xQueueSendToFront(outgoingQueue, &frame, pdMS_TO_TICKS(100)) == pdTRUE;
-    } else {
-        ok = xQueueSendToBack(outgoingQueue, &frame, pdMS_TO_TICKS(200)) == pdTRUE;
+    if (relayed) {
+        wrapRelayFrame(frame, srcAddress, receiverId, LORA_RELAY_MAX_HOPS, nextHop, frame);
     }
     
-    if (ok && base->ackRequired) {
-        if (pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(2100)) == pdTRUE) {
-            auto existingIt = std::find_if(pending.begin(), pending.end(),
-                                          [&frame](const PendingSend &p)
-                                          { return p.pkt.packetId == frame.packetId; });
+    packetId = base->packetId;
+
+    // Квота узла: узел с плохой связью и длинной очередью не занимает место остальных.
+    // Блокирующая отправка ждёт, пока sendTask передаст кадры узла: производитель идёт со скоростью канала
+    TickType_t waitTicks = wait ? pdMS_TO_TICKS(base->highPriority ? 100 : 200) : 0;
+    TickType_t quotaTicks = wait ? pdMS_TO_TICKS(base->highPriority ? 100 : LORA_PEER_QUOTA_WAIT_MS) : 0;
+    if (!(coalesce && coalesce->found) && !waitPeerQuota(frame.getReceiverId(), quotaTicks)) {
+        metrics.add(LORA_CNT_TX_PEER_QUOTA);
+        tracer.cancel(base->packetId);
+        if (handle) {
+            completeSend(handle, SendResult::QUEUE_FULL);
+        }
+        return SendStatus::WOULD_BLOCK;
+    }
 
-            if (existingIt != pending.end()) {
-                char s[100];
-                snprintf(s, sizeof(s), "⚠️ Duplicate packet ID detected: id=%u, type=%c, to=%u", 
-                        frame.packetId, frame.packetType, frame.getReceiverId());
-                putToLogBuffer(String(s));
-                existingIt->timestamp = millis();
-                existingIt->retries = 0;
-            } else {
-                PendingSend pendingItem = {};
-                pendingItem.pkt = frame;
-                pendingItem.timestamp = millis();
-                pendingItem.retries = 0;
-                pending.push_back(pendingItem);
-            }
-            xSemaphoreGive(pendingMutex);
+    // Без ожидания pending занимается до постановки: кадр с ACK не уходит без записи в pending
+    bool pendingHeld = false;
+    if (!wait && base->ackRequired) {
+        pendingHeld = pendingMutex && xSemaphoreTake(pendingMutex, 0) == pdTRUE;
+        if (!pendingHeld) {
+            metrics.add(LORA_CNT_TX_WOULD_BLOCK);
+            tracer.cancel(base->packetId);
+            return SendStatus::WOULD_BLOCK;
         }
     }
-    return base->packetId;
-}
 
-void LoRaCore::packBaseIntoLoRa(LoRaPacket *out,
-                                LoraAddress_t senderId,
-                                LoraAddress_t receiverId,
-                                const PacketBase *base,
-                                const uint8_t *payload)
-{
-    memset(out, 0, sizeof(*out));
+    if (base->ackRequired) {
+        txQueued.add(frame.packetId);
+    }
+
+    // Образец канала встаёт на место предыдущего, если тот ещё в очереди
+    bool superseding = coalesce && coalesce->found;
+    bool replaced = superseding && replaceQueuedFrame(coalesce->packetId, frame);
+    bool ok;
+    if (replaced) {
+        ok = true;
+    } else {
+        // FIFO внутри класса: highPriority больше не встаёт в голову очереди
+        ok = queueTxFrame(frame, txClassOf(frame), waitTicks);
+    }
+    if (ok) {
+        tracer.queued(base->packetId);
+        if (!replaced) {
+            credits.onQueued(frame.getReceiverId(), frame.payloadLen);
+        }
+    } else {
+        metrics.add(wait ? LORA_CNT_TX_QUEUE_FULL : LORA_CNT_TX_WOULD_BLOCK);
+        tracer.cancel(base->packetId);
+        if (base->ackRequired) {
+            txQueued.remove(frame.packetId);
+        }
+        if (handle) {
+            completeSend(handle, SendResult::QUEUE_FULL);
+        }
+    }
+    
+    if (!ok && pendingHeld) {
+        xSemaphoreGive(pendingMutex);
+    }
+    if (ok && (base->ackRequired || superseding)) {
+        if (pendingHeld || (pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(2100)) == pdTRUE)) {
+            // Повторы предыдущего образца канала больше не нужны
+            bool superseded = replaced;
+            if (superseding) {
+                PacketId_t oldId = coalesce->packetId;
+                auto oldIt = std::find_if(pending.begin(), pending.end(),
+                                          [oldId, &frame](const PendingSend &p)
+                                          { return p.pkt.packetId == oldId && p.pkt.packetType == frame.packetType &&
+                                                   p.pkt.getReceiverId() == frame.getReceiverId(); });
+                if (oldIt != pending.end()) {
+                    pending.erase(oldIt);
+                    superseded = true;
+                }
+            }
+            if (superseded) {
+                tracer.cancel(coalesce->packetId);
+                metrics.add(LORA_CNT_TX_COALESCED);
+            }
+            if (base->ackRequired) {
+                auto existingIt = std::find_if(pending.begin(), pending.end(),
+                                              [&frame](const PendingSend &p)
+                                              { return p.pkt.packetId == frame.packetId; });
+
+                if (existingIt != pending.end()) {
+                    char s[100];
+                    snprintf(s, sizeof(s), "⚠️ Duplicate packet ID detected: id=%u, type=%c, to=%u", 
+                            frame.packetId, frame.packetType, frame.getReceiverId());
+                    putToLogBuffer(String(s));
+                    existingIt->timestamp = millis();
+                    existingIt->retries = 0;
+                } else {
+                    PendingSend pendingItem = {};
+                    pendingItem.pkt = frame;
+                    pendingItem.timestamp = millis();
+                    pendingItem.retries = 0;
+                    pending.push_back(pendingItem);
+                }
+            }
+            xSemaphoreGive(pendingMutex);
+        }
+    }
+    return ok ? SendStatus::QUEUED : SendStatus::WOULD_BLOCK;
+}
+
+void LoRaCore::packBaseIntoLoRa(LoRaPacket *out,
+                                LoraAddress_t senderId,
+                                LoraAddress_t receiverId,
+                                const PacketBase *base,
+                                const uint8_t *payload)
+{
+    memset(out, 0, sizeof(*out));
     out->setSenderId(senderId);
     out->setReceiverId(receiverId);
     out->packetType = base->packetType;
@@ -481,7 +1042,7 @@ void LoRaCore::packBaseIntoLoRa(LoRaPacket *out,
 // ACK HANDLING
 // ═══════════════════════════════════════════════════════════════════════════
 
-void LoRaCore::handleAck(const LoRaPacket *pkt)
+void LoRaCore::handleAck(const LoRaPacket *pkt, uint32_t irqUs)
 {
     if (pkt->payloadLen != sizeof(PacketId_t))
     {
@@ -496,10 +1057,10 @@ void LoRaCore::handleAck(const LoRaPacket *pkt)
     snprintf(s, sizeof(s), "📩 Single ACK received: id=%u from device %u", ackedId, pkt->getSenderId());
     putToLogBuffer(String(s));
 
-    handleSingleAck(ackedId, pkt->getSenderId(), pkt->packetType);
+    handleSingleAck(ackedId, pkt->getSenderId(), pkt->packetType, irqUs);
 }
 
-void LoRaCore::handleBulkAck(const LoRaPacket *pkt)
+void LoRaCore::handleBulkAck(const LoRaPacket *pkt, uint32_t irqUs)
 {
     if (pkt->payloadLen < sizeof(uint8_t))
     {
@@ -558,12 +1119,14 @@ void LoRaCore::handleBulkAck(const LoRaPacket *pkt)
     putToLogBuffer(String(successLog));
 
     for (uint8_t i = 0; i < uniqueCount; i++) {
-        handleSingleAck(uniqueIds[i], pkt->getSenderId(), pkt->packetType);
+        handleSingleAck(uniqueIds[i], pkt->getSenderId(), pkt->packetType, irqUs);
     }
 }
 
-void LoRaCore::handleSingleAck(PacketId_t ackedId, LoraAddress_t senderId, uint8_t packetType)
+void LoRaCore::handleSingleAck(PacketId_t ackedId, LoraAddress_t senderId, uint8_t packetType, uint32_t irqUs)
 {
+    bool acked = false;
+    uint8_t originalPacketType = 0;
     if (pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
         char s[100];
@@ -571,28 +1134,45 @@ void LoRaCore::handleSingleAck(PacketId_t ackedId, LoraAddress_t senderId, uint8
                                { return p.pkt.packetId == ackedId; });
         if (it != pending.end())
         {
-            uint8_t originalPacketType = it->pkt.packetType;
+            originalPacketType = it->pkt.packetType;
+            acked = true;
+            metrics.add(LORA_CNT_ACK_RECEIVED);
+            metrics.record(LORA_HIST_ACK_RTT_MS, millis() - it->timestamp);
+            // Обе метки из ISR: без очередей и планировщика задач на нашей стороне
+            uint32_t txDoneUs = txTimes.get(ackedId);
+            if (irqUs && txDoneUs && (int32_t)(irqUs - txDoneUs) > 0) {
+                metrics.record(LORA_HIST_ACK_AIR_RTT_US, irqUs - txDoneUs);
+            }
+            metrics.record(LORA_HIST_RETRIES, it->retries);
             pending.erase(it);
+            LoRaPacketTrace trace;
+            if (tracer.acked(ackedId, trace, irqUs)) {
+                emitTrace(trace);
+            }
             snprintf(s, sizeof(s), "✅ACK confirmed: id=%u, from=%u, type=%c, origType=%c", ackedId, senderId, packetType, originalPacketType);
             putToLogBuffer(String(s));
-            
-            if (ackCallback)
-            {
-                ackCallback(ackedId, senderId, originalPacketType);
-                _ack_received++;
-                char callbackLog[120];
-                snprintf(callbackLog, sizeof(callbackLog), "[TO CHECK]🔔 Calling ACK callback: id=%u, sender=%u, origType=%c", ackedId, senderId, originalPacketType);
-                putToLogBuffer(String(callbackLog));
-            }
         }
         else
         {
-            _duplicated_acks++;
+            metrics.add(LORA_CNT_DUPLICATE_ACKS);
             // snprintf(s, sizeof(s), "[Warnings]⚠️ Duplicate ACK ignored: id=%u from device %u (not in pending)", ackedId, senderId);
             // putToLogBuffer(String(s));
         }
         xSemaphoreGive(pendingMutex);
     }
+    if (!acked) {
+        return;
+    }
+    txPowerFeedback(senderId, true);
+    // Callback приложения - вне pendingMutex: из него можно отправлять и смотреть pending
+    if (ackCallback)
+    {
+        ackCallback(ackedId, senderId, originalPacketType);
+        char callbackLog[120];
+        snprintf(callbackLog, sizeof(callbackLog), "[TO CHECK]🔔 Calling ACK callback: id=%u, sender=%u, origType=%c", ackedId, senderId, originalPacketType);
+        putToLogBuffer(String(callbackLog));
+    }
+    sendEvent(ackedId, SendEvent::ACKED);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -628,36 +1208,1805 @@ void LoRaCore::addToBulkAck(PacketId_t packetId, uint8_t targetDeviceId)
     }
 }
 
-void LoRaCore::sendBulkAck(uint8_t targetDeviceId)
-{
-    if (pendingBulkAck.isEmpty())
-        return;
+void LoRaCore::sendBulkAck(uint8_t targetDeviceId)
+{
+    if (pendingBulkAck.isEmpty())
+        return;
+
+    if (pendingBulkAck.hasDuplicates())
+    {
+        putToLogBuffer(String("⚠️ WARNING: BULK ACK contains duplicates: ") + pendingBulkAck.getDebugInfo());
+    }
+
+    uint8_t payload[1 + 10 * sizeof(PacketId_t)];
+    payload[0] = pendingBulkAck.count;
+    memcpy(&payload[1], pendingBulkAck.ackedIds, pendingBulkAck.count * sizeof(PacketId_t));
+
+    size_t payloadSize = sizeof(uint8_t) + (pendingBulkAck.count * sizeof(PacketId_t));
+
+    // receiveTask не ждёт места в очереди: при WOULD_BLOCK подтверждения уйдут по таймауту
+    if (trySendPacket(targetDeviceId, &pendingBulkAck, payload) != SendStatus::QUEUED) {
+        return;
+    }
+
+    //putToLogBuffer(String("✅ Sent BULK ACK for ") + String(pendingBulkAck.count) + " packets: " + pendingBulkAck.getDebugInfo());
+
+    pendingBulkAck.clear();
+    lastBulkAckTime = millis();
+}
+
+void LoRaCore::setBulkAckInterval(unsigned long intervalMs)
+{
+    bulkAckIntervalOverrideMs = intervalMs;
+    updateRetryParameters();
+}
+
+void LoRaCore::checkBulkAckTimeout(uint8_t targetDeviceId)
+{
+    if (!pendingBulkAck.isEmpty() &&
+        (millis() - lastBulkAckTime > BULK_ACK_INTERVAL_MS))
+    {
+        sendBulkAck(targetDeviceId);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// METRICS
+// ═══════════════════════════════════════════════════════════════════════════
+
+void LoRaCore::getMetricsSnapshot(LoRaMetricsSnapshot &out)
+{
+    metrics.set(LORA_GAUGE_TX_QUEUE, getOutgoingQueueCount());
+    metrics.set(LORA_GAUGE_RX_QUEUE, getIncomingQueueCount());
+    metrics.set(LORA_GAUGE_PENDING, getPendingCount());
+    LoRaNetworkTime time = getNetworkTime();
+    metrics.set(LORA_GAUGE_TIME_ERROR_US, time.synced ? (int32_t)time.errorUs : -1);
+    LoRaAirtimeBudget budget = getAirtimeBudget();
+    metrics.set(LORA_GAUGE_DUTY_LEFT_MS, budget.band ? (int32_t)(budget.remainingUs() / 1000) : -1);
+    metrics.snapshot(out);
+}
+
+void LoRaCore::sendMetrics(LoraAddress_t receiver)
+{
+    LoRaMetricsSnapshot &snapshot = metricsReply;
+    getMetricsSnapshot(snapshot);
+
+    // Страницы, не поместившиеся в очередь, не ставятся: ответ - снимок на момент запроса
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    uint8_t sent = 0;
+    for (uint8_t page = 0; page < LoRaMetricsSnapshot::pageCount(); page++) {
+        PacketMetrics pkt;
+        pkt.payloadLen = snapshot.serializePage(page, payload);
+        if (trySendPacket(receiver, &pkt, payload) != SendStatus::QUEUED) {
+            metrics.add(LORA_CNT_METRICS_PAGES_DROPPED, LoRaMetricsSnapshot::pageCount() - page);
+            break;
+        }
+        sent++;
+    }
+    char s[80];
+    snprintf(s, sizeof(s), "📊 Metrics sent: %u/%u pages to %u", sent, LoRaMetricsSnapshot::pageCount(), receiver);
+    putToLogBuffer(String(s));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RELAY / ROUTING
+// ═══════════════════════════════════════════════════════════════════════════
+
+void LoRaCore::setRelayEnabled(bool enabled)
+{
+    if (enabled) {
+        // Первый анонс вскоре после включения: соседи узнают о ретрансляторе
+        routeAdvertIntervalMs = LORA_ROUTE_ADVERT_MIN_MS;
+        nextRouteAdvertMs = millis() + lc_randomRange(0, LORA_ROUTE_ADVERT_MIN_MS);
+    }
+    relayEnabled = enabled;
+    if (enabled && !startRouteTask()) {
+        relayEnabled = false;
+        return;
+    }
+    putToLogBuffer(String("🔀 Relay ") + (relayEnabled ? "enabled" : "disabled"));
+}
+
+// Задача анонсов нужна только в сети с ретрансляторами: создаётся при включении relay
+// или при первом услышанном анонсе
+bool LoRaCore::startRouteTask()
+{
+    if (routeTaskHandle) {
+        return true;
+    }
+    if (xTaskCreatePinnedToCore(routeTaskWrapper, "LoRaRoute", 4096, this, 1, &routeTaskHandle, 0) != pdPASS) {
+        routeTaskHandle = nullptr;
+        LLog("LoRaCore: Failed to create route task");
+        return false;
+    }
+    return true;
+}
+
+void LoRaCore::setRoute(LoraAddress_t destination, LoraAddress_t nextHop)
+{
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        routes.setStatic(destination, nextHop);
+        xSemaphoreGive(routesMutex);
+    }
+}
+
+bool LoRaCore::clearRoute(LoraAddress_t destination)
+{
+    bool removed = false;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        removed = routes.remove(destination);
+        xSemaphoreGive(routesMutex);
+    }
+    return removed;
+}
+
+bool LoRaCore::getRoute(LoraAddress_t destination, LoRaRoute &out)
+{
+    bool found = false;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        found = routes.find(destination, millis(), out);
+        xSemaphoreGive(routesMutex);
+    }
+    return found;
+}
+
+std::vector<LoRaRoute> LoRaCore::getRoutes()
+{
+    std::vector<LoRaRoute> result;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        result = routes.list(millis());
+        xSemaphoreGive(routesMutex);
+    }
+    return result;
+}
+
+// Нет маршрута - напрямую
+LoraAddress_t LoRaCore::findNextHop(LoraAddress_t destination)
+{
+    LoraAddress_t nextHop = destination;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        LoRaRoute route;
+        if (routes.find(destination, millis(), route)) {
+            nextHop = route.nextHop;
+        }
+        xSemaphoreGive(routesMutex);
+    }
+    return nextHop;
+}
+
+void LoRaCore::learnRoute(LoraAddress_t destination, LoraAddress_t nextHop, uint8_t hops)
+{
+    if (destination == srcAddress || destination == DEVICE_ID_BROADCAST || nextHop == srcAddress) {
+        return;
+    }
+    bool changed = false;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        changed = routes.learn(destination, nextHop, hops, millis());
+        xSemaphoreGive(routesMutex);
+    }
+    if (!changed) {
+        return;
+    }
+    char s[80];
+    snprintf(s, sizeof(s), "🧭 Route: %u via %u, %u hops", destination, nextHop, hops);
+    putToLogBuffer(String(s));
+
+    // Таблица изменилась - ускоренный анонс, как после включения
+    if (relayEnabled) {
+        routeAdvertIntervalMs = LORA_ROUTE_ADVERT_MIN_MS;
+        unsigned long at = millis() + lc_randomRange(LORA_ROUTE_ADVERT_MIN_MS / 2, LORA_ROUTE_ADVERT_MIN_MS);
+        if ((long)(nextRouteAdvertMs - at) > 0) {
+            nextRouteAdvertMs = at;
+        }
+    }
+}
+
+// Отправитель - сосед; кадр CMD_RELAY даёт обратный путь к origin, анонс - маршруты соседа
+void LoRaCore::learnFromFrame(const LoRaPacket &pkt)
+{
+    LoraAddress_t sender = pkt.getSenderId();
+    if (sender == DEVICE_ID_BROADCAST) {
+        return;
+    }
+    learnRoute(sender, sender, 1);
+
+    LoRaRelayHeader hdr;
+    if (readRelayHeader(pkt, hdr)) {
+        if (hdr.origin != sender && hdr.hopsLeft >= 1 && hdr.hopsLeft <= LORA_RELAY_MAX_HOPS) {
+            learnRoute(hdr.origin, sender, LORA_RELAY_MAX_HOPS - hdr.hopsLeft + 1);
+        }
+    } else if (pkt.packetType == CMD_ROUTE_ADV && pkt.payloadLen <= MAX_LORA_PAYLOAD) {
+        bool knowsUs = false;
+        PacketRouteAdvert::deserialize(pkt.payload, pkt.payloadLen, [&](LoraAddress_t destination, uint8_t hops) {
+            knowsUs |= destination == srcAddress;
+            learnRoute(destination, sender, hops + 1);
+        });
+        // Ретранслятор не знает нас (узел только слушает) - ответный пустой анонс со случайной задержкой
+        if (!knowsUs && !relayEnabled && presenceAdvertAtMs == 0 && startRouteTask()) {
+            presenceAdvertAtMs = millis() + lc_randomRange(1, LORA_ROUTE_ADVERT_MIN_MS);
+        }
+    }
+}
+
+bool LoRaCore::handleRelayFrame(LoRaPacket &pkt)
+{
+    char s[120];
+    LoRaRelayHeader hdr;
+    if (!readRelayHeader(pkt, hdr)) {
+        metrics.add(LORA_CNT_RX_ERRORS);
+        return false;
+    }
+
+    if (hdr.destination == srcAddress) {
+        snprintf(s, sizeof(s), "🔀 Relay in: id=%u, T=%c, from %u via %u, %u hops", pkt.packetId, hdr.innerType,
+                 hdr.origin, pkt.getSenderId(), LORA_RELAY_MAX_HOPS - hdr.hopsLeft + 1);
+        putToLogBuffer(String(s));
+        unwrapRelayFrame(pkt, pkt);
+        return true;
+    }
+
+    const char *reason = nullptr;
+    LoraAddress_t nextHop = hdr.destination;
+    if (!relayEnabled) {
+        reason = "relay disabled";
+    } else if (hdr.hopsLeft <= 1) {
+        reason = "hop limit";
+    } else {
+        bool duplicate = false;
+        if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+            duplicate = relayDuplicates.check(hdr.origin, pkt.packetId, millis());
+            xSemaphoreGive(routesMutex);
+        }
+        nextHop = findNextHop(hdr.destination);
+        if (duplicate) {
+            reason = "duplicate";
+        } else if (nextHop == pkt.getSenderId() || nextHop == hdr.origin) {
+            reason = "loop";
+        }
+    }
+    if (reason) {
+        metrics.add(LORA_CNT_RELAY_DROPPED);
+        snprintf(s, sizeof(s), "🔀❌ Relay drop: id=%u, %u->%u via %u (%s)", pkt.packetId, hdr.origin,
+                 hdr.destination, pkt.getSenderId(), reason);
+        putToLogBuffer(String(s));
+        return false;
+    }
+
+    pkt.payload[offsetof(LoRaRelayHeader, hopsLeft)] = hdr.hopsLeft - 1;
+    pkt.setSenderId(srcAddress);
+    pkt.setReceiverId(nextHop);
+    if (queueTxFrame(pkt, txClassOf(pkt), pdMS_TO_TICKS(10))) {
+        metrics.add(LORA_CNT_RELAY_FORWARDED);
+        snprintf(s, sizeof(s), "🔀 Relay: id=%u, T=%c, %u->%u next %u, hops left %u", pkt.packetId, hdr.innerType,
+                 hdr.origin, hdr.destination, nextHop, hdr.hopsLeft - 1);
+    } else {
+        metrics.add(LORA_CNT_TX_QUEUE_FULL);
+        metrics.add(LORA_CNT_RELAY_DROPPED);
+        snprintf(s, sizeof(s), "🔀❌ Relay drop: id=%u, %u->%u (queue full)", pkt.packetId, hdr.origin, hdr.destination);
+    }
+    putToLogBuffer(String(s));
+    return false;
+}
+
+// Повтор идёт по текущему маршруту: путь мог появиться или смениться после первой передачи
+void LoRaCore::rerouteFrame(LoRaPacket &frame)
+{
+    LoRaRelayHeader hdr;
+    bool isRelay = readRelayHeader(frame, hdr);
+    LoraAddress_t destination = isRelay ? hdr.destination : frame.getReceiverId();
+    if (frame.isBroadcast() || frame.packetType == CMD_REQUEST_ASA || frame.packetType == CMD_RESPONCE_ASA ||
+        frame.packetType == CMD_LINK_REPORT || frame.packetType == CMD_LOW_POWER) {
+        return;
+    }
+    LoraAddress_t nextHop = findNextHop(destination);
+    if (nextHop == frame.getReceiverId()) {
+        return;
+    }
+    if (isRelay && nextHop == destination) {
+        unwrapRelayFrame(frame, frame);
+        frame.setSenderId(srcAddress);
+    } else if (isRelay) {
+        frame.setReceiverId(nextHop);
+    } else if (!wrapRelayFrame(frame, srcAddress, destination, LORA_RELAY_MAX_HOPS, nextHop, frame)) {
+        return;
+    }
+    char s[80];
+    snprintf(s, sizeof(s), "🧭 Reroute: id=%u to %u via %u", frame.packetId, destination, nextHop);
+    putToLogBuffer(String(s));
+}
+
+// Кадр CMD_RELAY и ACK на него идут через все ретрансляторы: hops по текущему маршруту.
+// Маршрут устарел - не меньше одного ретранслятора
+uint8_t LoRaCore::frameHops(const LoRaPacket &frame)
+{
+    LoRaRelayHeader hdr;
+    if (!readRelayHeader(frame, hdr)) {
+        return 1;
+    }
+    uint8_t hops = 2;
+    if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        LoRaRoute route;
+        if (routes.find(hdr.destination, millis(), route)) {
+            hops = std::max<uint8_t>(route.hops, 2);
+        }
+        xSemaphoreGive(routesMutex);
+    }
+    return std::min<uint8_t>(hops, LORA_RELAY_MAX_HOPS);
+}
+
+void LoRaCore::sendRouteAdvert()
+{
+    PacketRouteAdvert advert;
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    if (!routesMutex || xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    advert.payloadLen = routes.serializeAdvert(payload, millis());
+    xSemaphoreGive(routesMutex);
+
+    sendBroadcast(&advert, payload);
+    char s[60];
+    snprintf(s, sizeof(s), "🧭 Route advert: %u routes", payload[0]);
+    putToLogBuffer(String(s));
+}
+
+void LoRaCore::routeTask()
+{
+    while (true) {
+        unsigned long now = millis();
+        if (relayEnabled && (long)(now - nextRouteAdvertMs) >= 0) {
+            sendRouteAdvert();
+            // Trickle: интервал удваивается до LORA_ROUTE_ADVERT_INTERVAL_MS, момент - во второй половине
+            routeAdvertIntervalMs = std::min<uint32_t>(routeAdvertIntervalMs * 2, LORA_ROUTE_ADVERT_INTERVAL_MS);
+            nextRouteAdvertMs = now + lc_randomRange(routeAdvertIntervalMs / 2, routeAdvertIntervalMs);
+            presenceAdvertAtMs = 0;
+        } else if (presenceAdvertAtMs && (long)(now - presenceAdvertAtMs) >= 0) {
+            // Пустой анонс: ретранслятор учит нас как соседа, чужие маршруты мы не раздаём
+            PacketRouteAdvert advert;
+            uint8_t payload[1] = {0};
+            sendBroadcast(&advert, payload);
+            presenceAdvertAtMs = 0;
+        }
+        if (routesMutex && xSemaphoreTake(routesMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            routes.expire(now);
+            xSemaphoreGive(routesMutex);
+        }
+        vTaskDelay(pdMS_TO_TICKS(250));
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TDMA
+// ═══════════════════════════════════════════════════════════════════════════
+
+void LoRaCore::setTdmaRole(TdmaRole role)
+{
+    if (role != TdmaRole::OFF && pollRole != PollRole::OFF) {
+        setPollRole(PollRole::OFF);
+    }
+    if (!tdmaMutex || xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    tdmaScheduler.reset();
+    tdmaLayout = LoRaTdmaLayout();
+    tdmaBeaconEndUs = 0;
+    tdmaMaster = DEVICE_ID_BROADCAST;
+    tdmaSuperframeMs = 0;
+    tdmaNextBeaconUs = micros();        // Master: первый маяк сразу
+    tdmaRole = role;
+    xSemaphoreGive(tdmaMutex);
+    putToLogBuffer(String("⏱️ TDMA ") + tdmaRoleName(role));
+}
+
+bool LoRaCore::isTdmaSynced()
+{
+    bool synced = false;
+    if (tdmaRole != TdmaRole::OFF && tdmaMutex && xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        uint32_t lossUs = LORA_TDMA_SYNC_LOSS_SUPERFRAMES * tdmaSuperframeUs(tdmaLayout);
+        synced = tdmaBeaconEndUs != 0 && (int32_t)(micros() - tdmaBeaconEndUs) <= (int32_t)lossUs;
+        xSemaphoreGive(tdmaMutex);
+    }
+    return synced;
+}
+
+String LoRaCore::getTdmaInfo()
+{
+    String info = String("TDMA ") + tdmaRoleName(tdmaRole);
+    if (tdmaRole == TdmaRole::OFF) {
+        return info;
+    }
+    bool synced = isTdmaSynced();
+    if (!tdmaMutex || xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return info;
+    }
+    char s[140];
+    if (!synced) {
+        snprintf(s, sizeof(s), ": no beacon");
+    } else if (tdmaRole == TdmaRole::MASTER) {
+        snprintf(s, sizeof(s), ": superframe #%lu, %lu ms, %u slots, %u members", (unsigned long)tdmaBeaconCount,
+                 (unsigned long)tdmaSuperframeMs, tdmaLayout.slotCount, (unsigned)tdmaScheduler.memberCount());
+    } else {
+        LoRaTdmaWindow slot;
+        if (tdmaFindSlot(tdmaLayout, srcAddress, slot)) {
+            snprintf(s, sizeof(s), ": master %u, superframe #%lu, %lu ms, slot %lu ms at +%lu ms", tdmaMaster,
+                     (unsigned long)tdmaBeaconCount, (unsigned long)tdmaSuperframeMs,
+                     (unsigned long)(slot.lenUs / 1000), (unsigned long)(slot.offsetUs / 1000));
+        } else {
+            snprintf(s, sizeof(s), ": master %u, superframe #%lu, %lu ms, joining", tdmaMaster,
+                     (unsigned long)tdmaBeaconCount, (unsigned long)tdmaSuperframeMs);
+        }
+    }
+    xSemaphoreGive(tdmaMutex);
+    return info + s + ", backlog " + String((unsigned)macBacklogSize);
+}
+
+// Один шаг sendTask в режиме TDMA: маяк, ожидание слота или один кадр в слоте
+bool LoRaCore::tdmaSendStep()
+{
+    uint32_t now = micros();
+    if (tdmaRole == TdmaRole::MASTER && (int32_t)(now - tdmaNextBeaconUs) >= 0) {
+        sendTdmaBeacon();
+        return true;
+    }
+
+    if (!tdmaMutex || xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+        return true;
+    }
+    LoRaTdmaLayout layout = tdmaLayout;
+    uint32_t beaconEndUs = tdmaBeaconEndUs;
+    LoraAddress_t master = tdmaMaster;
+    uint32_t superframeUs = tdmaSuperframeUs(layout);
+    bool lost = tdmaRole == TdmaRole::SLAVE && beaconEndUs != 0 &&
+                (int32_t)(now - beaconEndUs) > (int32_t)(LORA_TDMA_SYNC_LOSS_SUPERFRAMES * superframeUs);
+    if (lost) {
+        tdmaBeaconEndUs = 0;
+    }
+    xSemaphoreGive(tdmaMutex);
+    if (lost) {
+        putToLogBuffer(String("⏱️ TDMA sync lost: no beacon from ") + master);
+    }
+    if (beaconEndUs == 0 || lost) {
+        if (tdmaRole != TdmaRole::MASTER) {
+            return false;
+        }
+        tdmaWaitUntil(tdmaNextBeaconUs, 100);
+        return true;
+    }
+
+    // Новый суперкадр: слот снова свободен, молчание считается для keepalive
+    if (beaconEndUs != tdmaSeenBeaconUs) {
+        if (tdmaSeenBeaconUs && !tdmaTxInSuperframe && tdmaIdleSuperframes < 255) {
+            tdmaIdleSuperframes++;
+        }
+        tdmaSeenBeaconUs = beaconEndUs;
+        tdmaSlotDone = false;
+        tdmaTxInSuperframe = false;
+        tdmaContentionAtUs = 0;
+    }
+
+    uint32_t guardUs = layout.guardUs();
+    uint32_t requestAirUs = profileTimeOnAirUs(currentProfileIndex, LORA_TDMA_REQUEST_FRAME_SIZE);
+    uint32_t nextSuperframeUs = tdmaRole == TdmaRole::MASTER ? tdmaNextBeaconUs : beaconEndUs + superframeUs;
+    LoRaTdmaWindow slot;
+    bool own = tdmaFindSlot(layout, srcAddress, slot);
+    if (tdmaSlotDone || (!own && (tdmaRole != TdmaRole::SLAVE || !tdmaFindSlot(layout, DEVICE_ID_BROADCAST, slot)))) {
+        tdmaWaitUntil(nextSuperframeUs, 100);
+        return true;
+    }
+    uint32_t startUs = beaconEndUs + slot.offsetUs;
+    uint32_t endUs = startUs + slot.lenUs;
+
+    if (!own) {
+        // Нет своего слота: запрос в случайной позиции слота конкуренции. Без ответа окно
+        // попыток удваивается: при одновременном старте многих slave запросы не сталкиваются бесконечно.
+        // Окно считается в суперкадрах, а суперкадр растёт с сетью: пропуск не длиннее LORA_TDMA_JOIN_BACKOFF_MS
+        if (tdmaContentionAtUs == 0 && tdmaJoinSkip > 0) {
+            tdmaJoinSkip--;
+            tdmaSlotDone = true;
+            return true;
+        }
+        if (tdmaContentionAtUs == 0) {
+            uint32_t positions = std::max<uint32_t>(1, slot.lenUs / (requestAirUs + guardUs));
+            tdmaContentionAtUs = startUs + lc_randomRange(0, positions - 1) * (requestAirUs + guardUs);
+        }
+        if ((int32_t)(now - tdmaContentionAtUs) < 0) {
+            tdmaWaitUntil(tdmaContentionAtUs, 100);
+            return true;
+        }
+        if ((int32_t)(endUs - (now + requestAirUs)) >= 0) {
+            pullMacBacklog();
+            sendTdmaRequest(master, tdmaBacklogDemandMs(guardUs));
+            uint32_t maxSkip = std::max<uint32_t>(1, (uint64_t)LORA_TDMA_JOIN_BACKOFF_MS * 1000 / std::max<uint32_t>(1, superframeUs));
+            tdmaJoinSkip = lc_randomRange(0, std::min<uint32_t>(tdmaJoinWindow, maxSkip) - 1);
+            tdmaJoinWindow = std::min<uint32_t>(tdmaJoinWindow * 2, 64);
+        }
+        tdmaSlotDone = true;
+        return true;
+    }
+    tdmaJoinWindow = 1;
+    tdmaJoinSkip = 0;
+
+    if ((int32_t)(now - startUs) < 0) {
+        tdmaWaitUntil(startUs, 100);
+        return true;
+    }
+    pullMacBacklog();
+
+    // Кадр уходит, если после него остаётся место для запроса на остаток очереди
+    if (!macBacklog.empty()) {
+        uint32_t needUs = frameAirtimeUs(macBacklog.front());
+        if (tdmaRole == TdmaRole::SLAVE && macBacklog.size() > 1) {
+            needUs += guardUs + requestAirUs;
+        }
+        if ((int32_t)(endUs - (now + needUs)) >= 0) {
+            LoRaPacket pkt = macBacklog.front();
+            macBacklog.pop_front();
+            macBacklogSize = macBacklog.size();
+            unsigned long txDuration = 0;
+            sendFrame(pkt, txDuration);
+            tdmaTxInSuperframe = true;
+            tdmaIdleSuperframes = 0;
+            vTaskDelay(pdMS_TO_TICKS(guardUs / 1000));
+            return true;
+        }
+    }
+
+    // Очередь не уместилась - запрос на следующий суперкадр; молчащий slave - keepalive
+    bool report = !macBacklog.empty() || tdmaIdleSuperframes >= LORA_TDMA_KEEPALIVE_SUPERFRAMES;
+    if (tdmaRole == TdmaRole::SLAVE && report && (int32_t)(endUs - (micros() + requestAirUs)) >= 0 &&
+        sendTdmaRequest(master, tdmaBacklogDemandMs(guardUs))) {
+        tdmaTxInSuperframe = true;
+        tdmaIdleSuperframes = 0;
+    }
+    tdmaSlotDone = true;
+    return true;
+}
+
+// Кадры из outgoingQueue в очередь слота: время очереди нужно целиком, а не по одному кадру
+void LoRaCore::pullMacBacklog()
+{
+    // Кадры с истёкшим сроком не занимают слот и не попадают в спрос
+    for (auto it = macBacklog.begin(); it != macBacklog.end();) {
+        it = expireFrame(*it) ? macBacklog.erase(it) : it + 1;
+    }
+    LoRaPacket pkt;
+    auto insert = [this](const LoRaPacket &pkt) {
+        if (!expireFrame(pkt)) {
+            auto it = std::find_if(macBacklog.begin(), macBacklog.end(),
+                                   [this, &pkt](const LoRaPacket &p) { return sendsBefore(pkt, p); });
+            macBacklog.insert(it, pkt);
+        }
+    };
+    // Очереди узлов - раньше очередей классов: их кадры поставлены раньше
+    while (macBacklog.size() < LORA_OUTGOING_QUEUE_SIZE && fairQueue.pop(pkt)) {
+        insert(pkt);
+    }
+    fairQueueSize = fairQueue.size();
+    for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+        while (macBacklog.size() < LORA_OUTGOING_QUEUE_SIZE && xQueueReceive(txQueues[i], &pkt, 0) == pdTRUE) {
+            insert(pkt);
+        }
+    }
+    macBacklogSize = macBacklog.size();
+}
+
+// Порядок macBacklog: класс передачи (повторы здесь не отличить - идут со своим классом),
+// внутри класса по сроку (EDF). Кадры без срока и пересылаемые чужие - после, в порядке очереди
+bool LoRaCore::sendsBefore(const LoRaPacket &a, const LoRaPacket &b) const
+{
+    TxClass ca = txClassOf(a);
+    TxClass cb = txClassOf(b);
+    if (ca != cb) {
+        return ca < cb;
+    }
+    if (isForwardedFrame(a)) {
+        return false;
+    }
+    if (isForwardedFrame(b)) {
+        return deadlines.deadline(a.packetId) != 0;
+    }
+    return deadlines.earlier(a.packetId, b.packetId);
+}
+
+// Свой кадр с истёкшим ttlMs не передаётся: снимается с учёта и pending, итог EXPIRED
+bool LoRaCore::expireFrame(const LoRaPacket &pkt)
+{
+    if (isForwardedFrame(pkt) || !deadlines.expired(pkt.packetId, millis())) {
+        return false;
+    }
+    credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+    if (pkt.isAckRequired()) {
+        txQueued.remove(pkt.packetId);
+    }
+    tracer.cancel(pkt.packetId);
+    metrics.add(LORA_CNT_TX_EXPIRED_QUEUED);
+    if (pkt.isAckRequired() && pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        auto it = std::find_if(pending.begin(), pending.end(),
+                               [&pkt](const PendingSend &p) { return p.pkt.packetId == pkt.packetId; });
+        if (it != pending.end()) {
+            pending.erase(it);
+        }
+        xSemaphoreGive(pendingMutex);
+    }
+    char s[80];
+    snprintf(s, sizeof(s), "⌛ Expired: id=%u, T=%c, to=%u (not sent)", pkt.packetId, pkt.packetType, pkt.getReceiverId());
+    putToLogBuffer(String(s));
+    sendEvent(pkt.packetId, SendEvent::EXPIRED);
+    return true;
+}
+
+// Время в эфире очереди слота на текущем профиле, с guard после каждого кадра
+uint32_t LoRaCore::tdmaBacklogDemandMs(uint32_t guardUs) const
+{
+    uint32_t demandUs = 0;
+    for (const LoRaPacket &pkt : macBacklog) {
+        demandUs += frameAirtimeUs(pkt) + guardUs;
+    }
+    return (demandUs + 999) / 1000;
+}
+
+void LoRaCore::tdmaWaitUntil(uint32_t atUs, uint32_t maxWaitMs)
+{
+    int32_t leftUs = (int32_t)(atUs - micros());
+    // Момент прошёл (slave ждёт опоздавший маяк) - короткий опрос
+    uint32_t waitMs = leftUs > 0 ? std::min<uint32_t>(maxWaitMs, (leftUs + 999) / 1000) : 10;
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+}
+
+void LoRaCore::sendTdmaBeacon()
+{
+    pullMacBacklog();
+    uint32_t demandMs = tdmaBacklogDemandMs(LORA_TDMA_GUARD_MS * 1000);
+
+    PacketTdmaBeacon beacon;
+    LoRaTdmaLayout layout;
+    if (!tdmaMutex || xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    beacon.count = tdmaScheduler.build(srcAddress, currentProfileIndex, demandMs, layout);
+    xSemaphoreGive(tdmaMutex);
+
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    beacon.payloadLen = beacon.serialize(layout, payload);
+    beacon.packetId = ++nextPacketId;
+    LoRaPacket frame = {};
+    packBaseIntoLoRa(&frame, srcAddress, DEVICE_ID_BROADCAST, &beacon, payload);
+
+    unsigned long txDuration = 0;
+    if (sendFrame(frame, txDuration, false) != LORA_RADIO_OK) {
+        tdmaNextBeaconUs = micros() + layout.guardUs();
+        return;
+    }
+    // Отсчёт слотов - от конца маяка, как у slave по IRQ приёма
+    uint32_t endUs = lastTxEndUs;
+    uint32_t superframeUs = tdmaSuperframeUs(layout);
+    if (xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        tdmaLayout = layout;
+        tdmaBeaconEndUs = endUs;
+        tdmaBeaconCount = beacon.count;
+        xSemaphoreGive(tdmaMutex);
+    }
+    tdmaNextBeaconUs = endUs + superframeUs;
+    tdmaSuperframeMs = (superframeUs + frameAirtimeUs(frame)) / 1000;
+}
+
+bool LoRaCore::sendTdmaRequest(LoraAddress_t master, uint32_t demandMs)
+{
+    PacketTdmaRequest request;
+    request.frames = (uint8_t)std::min<size_t>(macBacklog.size(), 255);
+    request.airtimeMs = (uint16_t)std::min<uint32_t>(demandMs, 0xFFFF);
+    request.packetId = ++nextPacketId;
+    LoRaPacket frame = {};
+    packBaseIntoLoRa(&frame, srcAddress, master, &request, &request.frames);
+    unsigned long txDuration = 0;
+    return sendFrame(frame, txDuration, false) == LORA_RADIO_OK;
+}
+
+// Slave: раскладка суперкадра и момент конца маяка (IRQ приёма)
+void LoRaCore::onTdmaBeacon(const LoRaPacket &pkt, uint32_t irqUs)
+{
+    uint32_t count = 0;
+    LoRaTdmaLayout layout;
+    if (!PacketTdmaBeacon::deserialize(pkt.payload, pkt.payloadLen, count, layout)) {
+        return;
+    }
+    if (!tdmaMutex || xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return;
+    }
+    bool wasSynced = tdmaBeaconEndUs != 0 && tdmaMaster == pkt.getSenderId();
+    tdmaLayout = layout;
+    tdmaBeaconEndUs = irqUs ? irqUs : 1;
+    tdmaBeaconCount = count;
+    tdmaMaster = pkt.getSenderId();
+    xSemaphoreGive(tdmaMutex);
+    uint32_t superframeUs = tdmaSuperframeUs(layout);
+    tdmaSuperframeMs = (superframeUs + frameAirtimeUs(pkt)) / 1000;
+
+    if (!wasSynced) {
+        char s[100];
+        snprintf(s, sizeof(s), "⏱️ TDMA sync: master %u, %u slots, superframe %lu ms", pkt.getSenderId(),
+                 layout.slotCount, (unsigned long)tdmaSuperframeMs);
+        putToLogBuffer(String(s));
+    }
+}
+
+// Master: запрос слота или любой кадр участника
+void LoRaCore::onTdmaFrameHeard(const LoRaPacket &pkt)
+{
+    LoraAddress_t sender = pkt.getSenderId();
+    bool request = pkt.packetType == CMD_TDMA_REQUEST && pkt.getReceiverId() == srcAddress && pkt.payloadLen == 3;
+    uint16_t airtimeMs = 0;
+    if (request) {
+        memcpy(&airtimeMs, pkt.payload + 1, sizeof(airtimeMs));
+    }
+    bool joined = false;
+    if (tdmaMutex && xSemaphoreTake(tdmaMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        if (request) {
+            joined = tdmaScheduler.onRequest(sender, airtimeMs);
+        } else {
+            tdmaScheduler.onHeard(sender);
+        }
+        xSemaphoreGive(tdmaMutex);
+    }
+    if (joined) {
+        char s[60];
+        snprintf(s, sizeof(s), "⏱️ TDMA join: %u", sender);
+        putToLogBuffer(String(s));
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// NETWORK TIME
+// ═══════════════════════════════════════════════════════════════════════════
+
+LoRaNetworkTime LoRaCore::getNetworkTime()
+{
+    bool root = isTimeSyncRoot();
+    LoRaNetworkTime time;
+    if (!timeSyncMutex || xSemaphoreTake(timeSyncMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        time.us = micros();
+        return time;
+    }
+    time = timeSync.networkTime(root, micros());
+    xSemaphoreGive(timeSyncMutex);
+    if (root) {
+        time.reference = srcAddress;
+    }
+    return time;
+}
+
+bool LoRaCore::networkToLocalUs(uint32_t networkUs, uint32_t &localUs)
+{
+    if (isTimeSyncRoot()) {
+        localUs = networkUs;
+        return true;
+    }
+    if (!timeSyncMutex || xSemaphoreTake(timeSyncMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return false;
+    }
+    bool synced = timeSync.toLocalUs(networkUs, micros(), localUs);
+    xSemaphoreGive(timeSyncMutex);
+    return synced;
+}
+
+bool LoRaCore::getPeerClock(LoraAddress_t peer, LoRaPeerClock &out)
+{
+    if (!timeSyncMutex || xSemaphoreTake(timeSyncMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return false;
+    }
+    bool known = timeSync.peerClock(peer, micros(), out);
+    xSemaphoreGive(timeSyncMutex);
+    return known;
+}
+
+String LoRaCore::getTimeSyncInfo()
+{
+    LoRaNetworkTime time = getNetworkTime();
+    String info = String("Time ") + (isTimeSyncRoot() ? "root" : time.toString()) +
+                  ", start latency " + String((long)timeStamper.getStartLatencyUs()) + " us";
+    for (const auto &client : getAllClients()) {
+        LoRaPeerClock clock;
+        if (getPeerClock(client.address, clock)) {
+            info += "\n  " + String(client.address) + ": " + clock.toString();
+        }
+    }
+    return info;
+}
+
+// Корень - 0, узел, слышащий корень, - 1
+uint8_t LoRaCore::timeStratum()
+{
+    LoRaNetworkTime time = getNetworkTime();
+    return time.synced ? time.stratum : LORA_TIME_UNSYNCED;
+}
+
+void LoRaCore::onTimeTrailer(LoRaPacket &pkt, uint32_t irqUs)
+{
+    uint8_t bodyLen = timeTrailerBodyLen(pkt.payload, pkt.payloadLen);
+    if (bodyLen == 0) {
+        return;
+    }
+    LoRaTimeTrailer trailer;
+    memcpy(&trailer, pkt.payload + bodyLen, sizeof(trailer));
+    // Приложение и маяк TDMA видят heartbeat как без метки
+    pkt.payloadLen = bodyLen;
+    if (!irqUs || !timeSyncMutex || xSemaphoreTake(timeSyncMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return;
+    }
+    int32_t deviation = timeSync.onTrailer(pkt.getSenderId(), pkt.packetId, trailer, irqUs);
+    xSemaphoreGive(timeSyncMutex);
+    if (deviation >= 0) {
+        metrics.record(LORA_HIST_TIME_RESIDUAL_US, (uint32_t)deviation);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DUTY CYCLE
+// ═══════════════════════════════════════════════════════════════════════════
+
+LoRaAirtimeBudget LoRaCore::getAirtimeBudget()
+{
+    LoRaAirtimeBudget budget;
+    if (airtimeMutex && xSemaphoreTake(airtimeMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        budget = airtime.budget(millis(), currentFreq);
+        xSemaphoreGive(airtimeMutex);
+    }
+    budget.enforced = dutyCycleEnforced;
+    return budget;
+}
+
+String LoRaCore::getAirtimeInfo()
+{
+    String info = "Duty cycle " + getAirtimeBudget().toString();
+    if (airtimeMutex && xSemaphoreTake(airtimeMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        info += "\n" + airtime.toString(millis());
+        xSemaphoreGive(airtimeMutex);
+    }
+    return info;
+}
+
+// Без учёта под рукой кадр ждёт: передать сверх бюджета хуже, чем опоздать
+uint32_t LoRaCore::dutyCycleWaitMs(uint32_t airtimeUs)
+{
+    if (!airtimeMutex || xSemaphoreTake(airtimeMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return LORA_DUTY_CYCLE_RECHECK_MS;
+    }
+    uint32_t waitMs = airtime.waitMs(millis(), currentFreq, airtimeUs);
+    xSemaphoreGive(airtimeMutex);
+    return waitMs;
+}
+
+uint32_t LoRaCore::txAirtimeUs(const LoRaPacket &pkt)
+{
+    uint16_t preambleLen = (_mode == RadioMode::LORA && isPeerWakePreamble(pkt.getReceiverId()))
+                               ? LORA_WAKE_PREAMBLE_LEN : LORA_PREAMBLE_LEN;
+    // Метку sendFrame добавит не к каждому heartbeat - с запасом
+    size_t len = offsetof(LoRaPacket, payload) + pkt.payloadLen +
+                 (pkt.packetType == CMD_HEARTBEAT ? LORA_TIME_TRAILER_SIZE : 0);
+    return profileTimeOnAirUs(currentProfileIndex, len, preambleLen);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TX POWER CONTROL
+// ═══════════════════════════════════════════════════════════════════════════
+
+void LoRaCore::setTxPowerControlEnabled(bool enabled)
+{
+    txPowerControl = enabled;
+    if (!enabled) {
+        resetTxPower();
+    }
+}
+
+int8_t LoRaCore::getTxPower(LoraAddress_t peer)
+{
+    int8_t power = currentTX;
+    if (txPowerControl && txPowerMutex && xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        power = std::min(txPower.powerFor(peer, millis()), currentTX);
+        xSemaphoreGive(txPowerMutex);
+    }
+    return power;
+}
+
+String LoRaCore::getTxPowerInfo()
+{
+    String info = String("TX power control ") + (txPowerControl ? "on" : "off") + ", " + String(LORA_TPC_MIN_DBM) +
+                  ".." + String(currentTX) + " dBm, target margin " + String(LORA_TPC_TARGET_MARGIN_DB) + " dB";
+    if (txPowerControl && txPowerMutex && xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        info += "\n" + txPower.toString(millis());
+        xSemaphoreGive(txPowerMutex);
+    }
+    return info;
+}
+
+// Broadcast слышат все узлы, у GFSK нет порогов SF: полная мощность
+int8_t LoRaCore::txPowerFor(const LoRaPacket &pkt)
+{
+    if (!txPowerControl || pkt.isBroadcast() || _mode != RadioMode::LORA || !txPowerMutex ||
+        xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return currentTX;
+    }
+    int8_t power = std::min(txPower.powerFor(pkt.getReceiverId(), millis()), currentTX);
+    txPower.onSent(pkt.packetId, power);
+    xSemaphoreGive(txPowerMutex);
+    return power;
+}
+
+void LoRaCore::txPowerFeedback(LoraAddress_t peer, bool delivered)
+{
+    if (!txPowerControl || !txPowerMutex || xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return;
+    }
+    if (delivered) {
+        txPower.onAck(peer);
+    } else {
+        txPower.onLoss(peer);
+    }
+    xSemaphoreGive(txPowerMutex);
+}
+
+void LoRaCore::onLinkReport(const LoRaPacket &pkt)
+{
+    LoRaLinkReport report;
+    if (!PacketLinkReport::parse(pkt.payload, pkt.payloadLen, report)) {
+        metrics.add(LORA_CNT_RX_ERRORS);
+        return;
+    }
+    metrics.add(LORA_CNT_LINK_REPORTS);
+    if (_mode != RadioMode::LORA || !txPowerMutex || xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return;
+    }
+    txPower.onReport(pkt.getSenderId(), report.packetId, report.snr(), report.rssiDbm, currentSF, currentBW,
+                     millis());
+    xSemaphoreGive(txPowerMutex);
+}
+
+// Из receiveTask: отчёт ставится без ожидания места в очереди, потерянный заменит следующий
+void LoRaCore::sendLinkReportIfDue(const LoRaPacket &pkt, float rssi, float snr)
+{
+    if (_mode != RadioMode::LORA || !txPowerMutex || xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return;
+    }
+    bool due = txPower.reportDue(pkt.getSenderId(), snr, millis());
+    xSemaphoreGive(txPowerMutex);
+    if (!due) {
+        return;
+    }
+    PacketLinkReport report;
+    LoRaLinkReport body = PacketLinkReport::make(pkt.packetId, snr, rssi);
+    trySendPacket(pkt.getSenderId(), &report, (const uint8_t *)&body);
+}
+
+void LoRaCore::resetTxPower()
+{
+    if (txPowerMutex && xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        txPower.reset();
+        xSemaphoreGive(txPowerMutex);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// MTU
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Запись действует, пока профиль тот, для которого согласована: смена профиля без ASA
+// (setLoRaProfile, возврат после передачи) возвращает узел к LORA_BASE_MTU без сброса таблицы.
+// Слоты TDMA рассчитаны на кадр LORA_BASE_MTU
+uint8_t LoRaCore::getMtu(LoraAddress_t peer)
+{
+    if (peer == DEVICE_ID_BROADCAST || tdmaRole != TdmaRole::OFF || !mtuMutex ||
+        xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return LORA_BASE_MTU;
+    }
+    uint8_t mtu = LORA_BASE_MTU;
+    auto it = peerMtu.find(peer);
+    if (it != peerMtu.end() && it->second.profile == currentProfileIndex) {
+        mtu = it->second.mtu;
+    }
+    xSemaphoreGive(mtuMutex);
+    return mtu;
+}
+
+uint8_t LoRaCore::maxMtu()
+{
+    if (tdmaRole != TdmaRole::OFF || !mtuMutex || xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return LORA_BASE_MTU;
+    }
+    uint8_t mtu = LORA_BASE_MTU;
+    for (const auto &entry : peerMtu) {
+        if (entry.second.profile == currentProfileIndex) {
+            mtu = std::max(mtu, entry.second.mtu);
+        }
+    }
+    xSemaphoreGive(mtuMutex);
+    return mtu;
+}
+
+void LoRaCore::setPeerMtu(LoraAddress_t peer, uint8_t profile, uint8_t mtu)
+{
+    if (!mtuMutex || xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    // Полная таблица: сначала уходят записи других профилей
+    if (!peerMtu.count(peer) && peerMtu.size() >= LORA_MTU_MAX_PEERS) {
+        auto victim = peerMtu.begin();
+        for (auto it = peerMtu.begin(); it != peerMtu.end(); ++it) {
+            if (it->second.profile != currentProfileIndex) {
+                victim = it;
+                break;
+            }
+        }
+        peerMtu.erase(victim);
+    }
+    peerMtu[peer] = {profile, std::max(mtu, LORA_BASE_MTU)};
+    xSemaphoreGive(mtuMutex);
+}
+
+// Прошивка без MTU профиля отбрасывает ASA в 2 байта: запрос с MTU - только узлу, от которого
+// такой кадр уже пришёл
+bool LoRaCore::isMtuPeer(LoraAddress_t peer)
+{
+    if (!mtuMutex || xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return false;
+    }
+    bool known = std::find(mtuPeers.begin(), mtuPeers.end(), peer) != mtuPeers.end();
+    xSemaphoreGive(mtuMutex);
+    return known;
+}
+
+void LoRaCore::addMtuPeer(LoraAddress_t peer)
+{
+    if (!mtuMutex || xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    if (std::find(mtuPeers.begin(), mtuPeers.end(), peer) == mtuPeers.end()) {
+        // Полный список: вытесняется самый старый, он снова получит запрос в 1 байт
+        if (mtuPeers.size() >= LORA_MTU_MAX_PEERS) {
+            mtuPeers.erase(mtuPeers.begin());
+        }
+        mtuPeers.push_back(peer);
+    }
+    xSemaphoreGive(mtuMutex);
+}
+
+String LoRaCore::getMtuInfo()
+{
+    String info = "MTU: profile " + String(currentProfileIndex) + " " + String(profileMtu(currentProfileIndex)) +
+                  " B, base " + String(LORA_BASE_MTU) + " B" + (tdmaRole != TdmaRole::OFF ? " (TDMA: base)" : "");
+    if (mtuMutex && xSemaphoreTake(mtuMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        String peers;
+        for (const auto &entry : peerMtu) {
+            if (entry.second.profile == currentProfileIndex) {
+                peers += " " + String(entry.first) + "=" + String(entry.second.mtu);
+            }
+        }
+        xSemaphoreGive(mtuMutex);
+        if (peers.length()) {
+            info += "\n  Negotiated:" + peers;
+        }
+    }
+    return info;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// POLLING
+// ═══════════════════════════════════════════════════════════════════════════
+
+void LoRaCore::setPollRole(PollRole role)
+{
+    if (role != PollRole::OFF && tdmaRole != TdmaRole::OFF) {
+        setTdmaRole(TdmaRole::OFF);
+    }
+    if (!pollMutex || xSemaphoreTake(pollMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    pollScheduler.reset();
+    xSemaphoreGive(pollMutex);
+    pollAwaiting = DEVICE_ID_BROADCAST;
+    pollAnswered = false;
+    pollPending = false;
+    pollMaster = DEVICE_ID_BROADCAST;
+    pollLastMs = 0;
+    pollCycleMs = 0;
+    pollRole = role;
+    putToLogBuffer(String("📋 Poll ") + pollRoleName(role));
+}
+
+bool LoRaCore::isPollActive()
+{
+    if (pollRole == PollRole::MASTER) {
+        return !activePollClients().empty();
+    }
+    unsigned long lastMs = pollLastMs;
+    uint32_t lossMs = std::max<uint32_t>(LORA_POLL_LOSS_MIN_MS, LORA_POLL_LOSS_CYCLES * pollCycleMs);
+    return pollRole == PollRole::SLAVE && lastMs != 0 && millis() - lastMs <= lossMs;
+}
+
+String LoRaCore::getPollInfo()
+{
+    String info = String("Poll ") + pollRoleName(pollRole);
+    if (pollRole == PollRole::OFF) {
+        return info;
+    }
+    char s[100];
+    if (pollRole == PollRole::MASTER) {
+        snprintf(s, sizeof(s), ": %u clients, cycle %lu ms", (unsigned)activePollClients().size(),
+                 (unsigned long)pollCycleMs);
+    } else if (isPollActive()) {
+        snprintf(s, sizeof(s), ": master %u, cycle %lu ms", pollMaster, (unsigned long)pollCycleMs);
+    } else {
+        snprintf(s, sizeof(s), ": not polled");
+    }
+    return info + s + ", backlog " + String((unsigned)macBacklogSize);
+}
+
+// Клиенты, от которых master недавно слышал кадры, и те, кому он писал, но ещё не слышал
+std::vector<LoraAddress_t> LoRaCore::activePollClients()
+{
+    std::vector<LoraAddress_t> active;
+    if (clientsMutex && xSemaphoreTake(clientsMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        for (const auto &pair : clients) {
+            if (!pair.second.hasReceivedPackets || pair.second.isActive(LORA_POLL_CLIENT_TIMEOUT_MS)) {
+                active.push_back(pair.first);
+            }
+        }
+        xSemaphoreGive(clientsMutex);
+    }
+    return active;
+}
+
+// Кадр приложения для master без ACK: в ответ на опрос идёт подпакетом AGR
+bool LoRaCore::isPollAggregatable(const LoRaPacket &pkt, LoraAddress_t master, uint8_t mtu)
+{
+    return pkt.getReceiverId() == master && !pkt.isAckRequired() && !pkt.isService() && !pkt.isBroadcast() &&
+           pkt.packetType != CMD_ACK && pkt.packetType != CMD_BULK_ACK && pkt.packetType != CMD_RELAY &&
+           pkt.payloadLen + LORA_POLL_HEADER_SIZE + 2 <= mtu;
+}
+
+bool LoRaCore::pollSendStep()
+{
+    return pollRole == PollRole::MASTER ? pollMasterStep() : pollSlaveStep();
+}
+
+// Свои кадры, затем опрос следующего клиента и ожидание его ответа
+bool LoRaCore::pollMasterStep()
+{
+    // Канал принадлежит master: свои кадры идут без случайных задержек
+    pullMacBacklog();
+    for (uint8_t i = 0; i < LORA_POLL_MASTER_FRAMES && !macBacklog.empty(); i++) {
+        LoRaPacket pkt = macBacklog.front();
+        macBacklog.pop_front();
+        macBacklogSize = macBacklog.size();
+        unsigned long txDuration = 0;
+        sendFrame(pkt, txDuration);
+    }
+
+    std::vector<LoraAddress_t> active = activePollClients();
+    LoraAddress_t target = DEVICE_ID_BROADCAST;
+    PacketId_t acks[LORA_POLL_MAX_ACKS];
+    uint8_t ackCount = 0;
+    if (!pollMutex || xSemaphoreTake(pollMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+        return true;
+    }
+    uint32_t waitMs = 0;
+    bool found = pollScheduler.next(active, target, waitMs);
+    if (found) {
+        ackCount = pollScheduler.takeAcks(target, acks);
+    }
+    pollCycleMs = pollScheduler.cycleMs();
+    xSemaphoreGive(pollMutex);
+    if (!found && waitMs) {
+        // Пауза до следующего обхода; свои кадры master отправит на следующем шаге
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(std::min<uint32_t>(waitMs, 50)));
+        return true;
+    }
+    if (!found) {
+        return false;
+    }
+
+    PacketPoll poll;
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    poll.payloadLen = PacketPoll::writeHeader(payload, 0, acks, ackCount);
+    poll.packetId = ++nextPacketId;
+    LoRaPacket frame = {};
+    packBaseIntoLoRa(&frame, srcAddress, target, &poll, payload);
+
+    pollAnswered = false;
+    pollMore = false;
+    pollAwaiting = target;
+    unsigned long txDuration = 0;
+    bool sent = sendFrame(frame, txDuration, false) == LORA_RADIO_OK;
+    if (sent) {
+        metrics.add(LORA_CNT_POLLS_SENT);
+    }
+
+    // Ответ: разворот slave и кадр длиной в его MTU. receiveTask будит задачу уведомлением
+    waitMs = (profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + getMtu(target)) + 999) / 1000 +
+             LORA_POLL_REPLY_MARGIN_MS;
+    unsigned long startMs = millis();
+    while (sent && !pollAnswered && millis() - startMs < waitMs) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs - (millis() - startMs)));
+    }
+    pollAwaiting = DEVICE_ID_BROADCAST;
+    bool answered = pollAnswered;
+    if (sent && !answered) {
+        metrics.add(LORA_CNT_POLLS_MISSED);
+    }
+    if (xSemaphoreTake(pollMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        pollScheduler.onReply(target, answered, pollMore);
+        xSemaphoreGive(pollMutex);
+    }
+    return true;
+}
+
+bool LoRaCore::pollSlaveStep()
+{
+    if (!isPollActive()) {
+        if (pollLastMs) {
+            pollLastMs = 0;
+            putToLogBuffer(String("📋 Poll lost: no poll from ") + pollMaster);
+        }
+        return false;
+    }
+    if (!pollPending) {
+        // Опрос будит задачу уведомлением из receiveTask
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+        return true;
+    }
+    pollPending = false;
+    sendPollReply(pollMaster);
+    return true;
+}
+
+// Один кадр на опрос: ACK для master в заголовке, очередь - подпакетами AGR
+void LoRaCore::sendPollReply(LoraAddress_t master)
+{
+    pullMacBacklog();
+
+    PacketId_t acks[LORA_POLL_MAX_ACKS];
+    uint8_t ackCount = 0;
+    for (auto it = macBacklog.begin(); it != macBacklog.end();) {
+        uint8_t ids = 0;
+        const uint8_t *src = nullptr;
+        if (it->getReceiverId() == master && it->packetType == CMD_ACK && it->payloadLen == sizeof(PacketId_t)) {
+            ids = 1;
+            src = it->payload;
+        } else if (it->getReceiverId() == master && it->packetType == CMD_BULK_ACK && it->payloadLen >= 1 &&
+                   it->payloadLen == 1 + it->payload[0] * sizeof(PacketId_t)) {
+            ids = it->payload[0];
+            src = it->payload + 1;
+        }
+        if (!src || ackCount + ids > LORA_POLL_MAX_ACKS) {
+            ++it;
+            continue;
+        }
+        memcpy(acks + ackCount, src, ids * sizeof(PacketId_t));
+        ackCount += ids;
+        credits.onDequeued(it->getReceiverId(), it->payloadLen);
+        it = macBacklog.erase(it);
+    }
+    macBacklogSize = macBacklog.size();
+
+    unsigned long txDuration = 0;
+    // Кадр, который нельзя вложить (с ACK, служебный, другому узлу), уходит вместо ответа.
+    // Если есть ACK для master - сначала ответ с MORE, кадр - на повторный опрос
+    uint8_t mtu = getMtu(master);
+    if (!macBacklog.empty() && !isPollAggregatable(macBacklog.front(), master, mtu) && ackCount == 0) {
+        LoRaPacket pkt = macBacklog.front();
+        macBacklog.pop_front();
+        macBacklogSize = macBacklog.size();
+        sendFrame(pkt, txDuration);
+        return;
+    }
+
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    uint8_t len = PacketPoll::writeHeader(payload, 0, acks, ackCount);
+    uint32_t subPackets = 0;
+    PacketId_t carried[MAX_LORA_PAYLOAD / 2];       // Вложенные кадры: их итог - передача ответа
+    uint8_t carriedCount = 0;
+    while (!macBacklog.empty() && isPollAggregatable(macBacklog.front(), master, mtu)) {
+        const LoRaPacket &pkt = macBacklog.front();
+        bool agr = pkt.packetType == CMD_AGR;
+        uint8_t need = agr ? pkt.payloadLen : 2 + pkt.payloadLen;
+        if (len + need > mtu) {
+            break;
+        }
+        if (agr) {
+            memcpy(payload + len, pkt.payload, pkt.payloadLen);
+            PacketAggregated().deserialize(pkt.payload, pkt.payloadLen,
+                                           [&subPackets](uint8_t, const uint8_t *, uint8_t) { subPackets++; });
+        } else {
+            payload[len] = pkt.packetType;
+            payload[len + 1] = pkt.payloadLen;
+            memcpy(payload + len + 2, pkt.payload, pkt.payloadLen);
+            subPackets++;
+            metrics.add(LORA_CNT_AGGREGATED);
+        }
+        len += need;
+        tracer.cancel(pkt.packetId);
+        if (!isForwardedFrame(pkt)) {
+            credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+        }
+        carried[carriedCount++] = pkt.packetId;
+        macBacklog.pop_front();
+    }
+    macBacklogSize = macBacklog.size();
+    if (!macBacklog.empty()) {
+        payload[0] |= LORA_POLL_FLAG_MORE;
+    }
+    if (subPackets) {
+        metrics.record(LORA_HIST_AGGREGATION, subPackets);
+    }
+
+    PacketPoll reply;
+    reply.payloadLen = len;
+    reply.packetId = ++nextPacketId;
+    LoRaPacket frame = {};
+    packBaseIntoLoRa(&frame, srcAddress, master, &reply, payload);
+    int result = sendFrame(frame, txDuration, false);
+    for (uint8_t i = 0; i < carriedCount; i++) {
+        sendEvent(carried[i], result == LORA_RADIO_OK ? SendEvent::TRANSMITTED : SendEvent::TX_FAILED);
+    }
+}
+
+// Slave: опрос с ACK на наши кадры. Master: ответ с ACK и подпакетами
+void LoRaCore::onPollFrame(const LoRaRxFrame &rx)
+{
+    const LoRaPacket &pkt = rx.pkt;
+    uint8_t flags = 0;
+    uint8_t ackCount = 0;
+    uint8_t dataLen = 0;
+    const PacketId_t *acks = nullptr;
+    const uint8_t *data = nullptr;
+    if (pkt.isBroadcast() || !PacketPoll::parse(pkt.payload, pkt.payloadLen, flags, acks, ackCount, data, dataLen)) {
+        return;
+    }
+    LoraAddress_t sender = pkt.getSenderId();
+    for (uint8_t i = 0; i < ackCount; i++) {
+        handleSingleAck(acks[i], sender, pkt.packetType, rx.irqUs);
+    }
+
+    if (pollRole == PollRole::SLAVE) {
+        // Накопленные ACK для master уходят в этом же ответе
+        flushBulkAck(sender);
+        unsigned long now = millis();
+        bool wasActive = isPollActive();
+        // Период - медленно спадающий максимум: повторные опросы (MORE) идут чаще цикла
+        if (wasActive) {
+            pollCycleMs = std::max<uint32_t>(now - pollLastMs, pollCycleMs - pollCycleMs / 8);
+        }
+        pollMaster = sender;
+        pollLastMs = now ? now : 1;
+        if (!wasActive) {
+            putToLogBuffer(String("📋 Poll: master ") + sender);
+        }
+        pollPending = true;
+        if (senderTaskHandle) {
+            xTaskNotifyGive(senderTaskHandle);
+        }
+    } else if (pollRole == PollRole::MASTER && dataLen > 0) {
+        // Подпакеты ответа приложение получает обычным кадром AGR от slave
+        PacketAggregated agr;
+        agr.payloadLen = dataLen;
+        agr.packetId = pkt.packetId;
+        LoRaRxFrame frame = rx;
+        frame.pkt = {};
+        packBaseIntoLoRa(&frame.pkt, sender, srcAddress, &agr, data);
+        if (xQueueSendToBack(incomingQueue, &frame, pdMS_TO_TICKS(500)) != pdTRUE) {
+            metrics.add(LORA_CNT_RX_QUEUE_FULL);
+        }
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// BLOCK TRANSFER
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Задача и очередь нужны только узлам, которые передают или принимают: создаются по требованию
+bool LoRaCore::startTransferTask()
+{
+    if (transferTaskHandle) {
+        return true;
+    }
+    if (!transferMutex) {
+        return false;
+    }
+    if (!transferQueue) {
+        transferQueue = xQueueCreate(LORA_XFER_RX_QUEUE_SIZE, sizeof(LoRaPacket));
+    }
+    if (!transferQueue ||
+        xTaskCreatePinnedToCore(transferTaskWrapper, "LoRaXfer", 6144, this, 1, &transferTaskHandle, 0) != pdPASS) {
+        transferTaskHandle = nullptr;
+        LLog("LoRaCore: Failed to create transfer task");
+        return false;
+    }
+    return true;
+}
+
+bool LoRaCore::startTransfer(LoraAddress_t receiver, LoRaTransferSource &source, uint8_t kind)
+{
+    if (receiver == DEVICE_ID_BROADCAST || receiver == srcAddress || !startTransferTask()) {
+        return false;
+    }
+    if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
+    }
+    bool started = !xferOut.isActive() && xferOut.start(receiver, source, kind, ++xferNextId, millis());
+    if (started) {
+        xferBoostTried = false;
+    }
+    xSemaphoreGive(transferMutex);
+
+    char s[80];
+    snprintf(s, sizeof(s), "📦 Transfer to %u: %lu B, %s", receiver, (unsigned long)source.size(),
+             started ? "offering" : "not started");
+    putToLogBuffer(String(s));
+    return started;
+}
+
+void LoRaCore::abortTransfer()
+{
+    if (transferMutex && xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        xferOut.cancel(LORA_XFER_CANCELLED, millis());
+        xSemaphoreGive(transferMutex);
+    }
+}
+
+bool LoRaCore::isTransferActive()
+{
+    bool active = false;
+    if (transferMutex && xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        active = xferOut.isActive() || xferIn.isActive();
+        xSemaphoreGive(transferMutex);
+    }
+    return active;
+}
+
+void LoRaCore::setTransferHandler(LoRaTransferReceiver::SinkHandler &&handler)
+{
+    if (!startTransferTask() || xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    transferHandler = std::move(handler);
+    xSemaphoreGive(transferMutex);
+}
+
+String LoRaCore::getTransferInfo()
+{
+    if (!transferMutex || xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return "Transfer: mutex timeout";
+    }
+    unsigned long now = millis();
+    String info = xferOut.getProgress().toString(true, now) + "\n" + xferIn.getProgress().toString(false, now);
+    xSemaphoreGive(transferMutex);
+    return info;
+}
+
+// Отчёты и итоги - отправителю, предложения и данные - получателю, ABORT - обоим (фильтр по transferId)
+void LoRaCore::onTransferFrame(const LoRaPacket &pkt)
+{
+    if (pkt.payloadLen < LORA_XFER_HEADER_SIZE || pkt.payloadLen > MAX_LORA_PAYLOAD) {
+        metrics.add(LORA_CNT_RX_ERRORS);
+        return;
+    }
+    uint8_t op = pkt.payload[0] & LORA_XFER_OP_MASK;
+    LoraAddress_t sender = pkt.getSenderId();
+    unsigned long now = millis();
+    uint8_t reply[MAX_LORA_PAYLOAD];
+    uint8_t replyLen = 0;
+    if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    if (op == LORA_XFER_OP_STATUS || op == LORA_XFER_OP_DONE || op == LORA_XFER_OP_ABORT) {
+        if (xferOut.getProgress().peer == sender) {
+            xferOut.onFrame(pkt.payload, pkt.payloadLen, now);
+        }
+    }
+    if (op == LORA_XFER_OP_OFFER || op == LORA_XFER_OP_DATA || op == LORA_XFER_OP_ABORT) {
+        uint16_t before = xferIn.getProgress().blocksDone;
+        replyLen = xferIn.onFrame(sender, pkt.payload, pkt.payloadLen, now, transferHandler, reply);
+        const LoRaTransferProgress &in = xferIn.getProgress();
+        if (in.state == TransferState::RECEIVING && in.blocksDone > before) {
+            metrics.add(LORA_CNT_XFER_BLOCKS_RECEIVED, in.blocksDone - before);
+        } else if (op == LORA_XFER_OP_DATA && in.state == TransferState::DONE && before < in.blockCount) {
+            metrics.add(LORA_CNT_XFER_BLOCKS_RECEIVED, in.blockCount - before);
+        }
+    }
+    xSemaphoreGive(transferMutex);
+
+    if (replyLen) {
+        PacketTransfer frame;
+        frame.payloadLen = replyLen;
+        frame.highPriority = true;      // Отчёт держит окно отправителя
+        sendPacketBase(sender, &frame, reply);
+    }
+}
+
+// Кадры DATA не копятся в outgoingQueue: отчёт получателя успевает повлиять на следующий раунд
+void LoRaCore::transferSendStep()
+{
+    uint8_t payload[MAX_LORA_PAYLOAD];
+    if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    LoraAddress_t peer = xferOut.getProgress().peer;
+    xSemaphoreGive(transferMutex);
+    // Через relay - базовый MTU: он вмещает один блок вместе с заголовком relay
+    uint8_t mtu = findNextHop(peer) == peer ? getMtu(peer) : LORA_BASE_MTU;
+    uint32_t frameMs = profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + mtu) / 1000 + 1;
+    while (getOutgoingQueueCount() < LORA_XFER_QUEUE_DEPTH) {
+        if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+            return;
+        }
+        uint8_t len = xferOut.nextFrame(millis(), frameMs, payload, mtu);
+        peer = xferOut.getProgress().peer;
+        xSemaphoreGive(transferMutex);
+        if (!len) {
+            return;
+        }
+
+        PacketTransfer frame;
+        frame.payloadLen = len;
+        bool isData = (payload[0] & LORA_XFER_OP_MASK) == LORA_XFER_OP_DATA;
+        frame.highPriority = !isData;
+        if (isData) {
+            metrics.add(LORA_CNT_XFER_BLOCKS_SENT);
+        }
+        if (!sendPacketBase(peer, &frame, payload)) {
+            return;
+        }
+    }
+}
+
+// Самый быстрый профиль, который держит связь с соседом (как авто-ASA), на время передачи
+void LoRaCore::boostTransferProfile(LoraAddress_t peer)
+{
+    xferBoostTried = true;
+    if (findNextHop(peer) != peer) {
+        return;
+    }
+    uint8_t current = currentProfileIndex;
+    uint8_t target = recommendProfileForClient(peer);
+    size_t frameBytes = offsetof(LoRaPacket, payload) + LORA_BASE_MTU;
+    if (target >= LORA_PROFILE_COUNT || profileTimeOnAirUs(target, frameBytes) >= profileTimeOnAirUs(current, frameBytes)) {
+        return;
+    }
+    if (!sendAsaRequest(target, peer)) {
+        return;
+    }
+    // DATA ждут смены профиля: обмен ASA на медленном профиле длится дольше ASA_SWITCH_DELAY
+    xferOutProfile = current;
+    xferBoostTarget = target;
+    xferBoostUntilMs = millis() + ASA_SWITCH_DELAY + LORA_XFER_STALL_MS;
+    if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        xferOut.pause(millis() + LORA_XFER_PROFILE_SETTLE_MS);
+        xSemaphoreGive(transferMutex);
+    }
+    char s[80];
+    snprintf(s, sizeof(s), "📦 Transfer to %u: profile %u -> %u", peer, current, target);
+    putToLogBuffer(String(s));
+}
+
+// Переходы состояний: журнал, callback, ускорение и возврат профиля
+void LoRaCore::checkTransferEvents()
+{
+    unsigned long now = millis();
+    LoRaTransferProgress out, in;
+    bool inStalled = false;
+    if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    xferIn.expire(now);
+    out = xferOut.getProgress();
+    in = xferIn.getProgress();
+    inStalled = xferIn.isStalled(now);
+    xSemaphoreGive(transferMutex);
+
+    if (xferBoostTarget >= 0) {
+        bool switched = currentProfileIndex == xferBoostTarget;
+        if (switched || (long)(now - xferBoostUntilMs) < 0) {
+            if (xSemaphoreTake(transferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                xferOut.pause(now + LORA_XFER_PROFILE_SETTLE_MS);
+                xSemaphoreGive(transferMutex);
+            }
+        } else {
+            xferOutProfile = -1;        // ASA не прошёл: передача на текущем профиле
+        }
+        if (switched || xferOutProfile < 0) {
+            xferBoostTarget = -1;
+        }
+    }
+
+    if (out.state != xferOutSeen.state || out.startedMs != xferOutSeen.startedMs) {
+        xferOutSeen = out;
+        if (out.state == TransferState::SENDING && !xferBoostTried) {
+            boostTransferProfile(out.peer);
+        } else if (out.state == TransferState::STALLED && xferOutProfile >= 0) {
+            // Связь потеряна на ускоренном профиле: пробы OFFER - на исходном
+            applyProfileFromSettings(xferOutProfile);
+            xferOutProfile = -1;
+            xferBoostTarget = -1;
+        } else if (out.state == TransferState::DONE || out.state == TransferState::FAILED) {
+            if (xferOutProfile >= 0 && xferOutProfile != currentProfileIndex) {
+                if (out.state == TransferState::DONE) {
+                    sendAsaRequest(xferOutProfile, out.peer);
+                } else {
+                    applyProfileFromSettings(xferOutProfile);
+                }
+            }
+            xferOutProfile = -1;
+            xferBoostTarget = -1;
+            putToLogBuffer("📦 Transfer " + out.toString(true, now));
+            if (transferCallback) {
+                transferCallback(out.peer, true, out.result);
+            }
+        }
+    }
+
+    if (in.state != xferInSeen.state || in.startedMs != xferInSeen.startedMs) {
+        xferInSeen = in;
+        if (in.state == TransferState::RECEIVING) {
+            if (xferInProfile < 0) {
+                xferInProfile = currentProfileIndex;
+                xferInLastProfile = currentProfileIndex;
+                xferInSwitchMs = now;
+            }
+            putToLogBuffer("📦 Transfer " + in.toString(false, now));
+        } else if (in.state == TransferState::DONE || in.state == TransferState::FAILED) {
+            putToLogBuffer("📦 Transfer " + in.toString(false, now));
+            if (transferCallback) {
+                transferCallback(in.peer, false, in.result);
+            }
+        }
+    }
+    // Получатель сам возвращает исходный профиль, если отправитель пропал или его ASA потерялся.
+    // Тишина до смены профиля и сразу после неё - обмен ASA, не потеря связи
+    if (currentProfileIndex != xferInLastProfile) {
+        xferInLastProfile = currentProfileIndex;
+        xferInSwitchMs = now;
+    }
+    bool lost = inStalled && now - xferInSwitchMs > LORA_XFER_STALL_MS;
+    bool settled = in.state != TransferState::RECEIVING && now - in.finishedMs > LORA_XFER_STALL_MS;
+    if (xferInProfile >= 0 && (lost || settled) && xferInProfile != currentProfileIndex && !hasPendingAsa()) {
+        applyProfileFromSettings(xferInProfile);
+    }
+    if (settled) {
+        xferInProfile = -1;
+    }
+}
+
+void LoRaCore::transferTask()
+{
+    LoRaPacket pkt;
+    while (true) {
+        if (xQueueReceive(transferQueue, &pkt, pdMS_TO_TICKS(20)) == pdTRUE) {
+            onTransferFrame(pkt);
+        }
+        checkTransferEvents();
+        transferSendStep();
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ASYNC SEND
+// ═══════════════════════════════════════════════════════════════════════════
 
-    if (pendingBulkAck.hasDuplicates())
-    {
-        putToLogBuffer(String("⚠️ WARNING: BULK ACK contains duplicates: ") + pendingBulkAck.getDebugInfo());
+// Задача завершений нужна только приложениям с sendPacketAsync(): создаётся по требованию
+bool LoRaCore::startCompletionTask()
+{
+    if (completionTaskHandle) {
+        return true;
     }
+    if (!completionMutex ||
+        xTaskCreatePinnedToCore(completionTaskWrapper, "LoRaDone", 4096, this, 1, &completionTaskHandle, 0) != pdPASS) {
+        completionTaskHandle = nullptr;
+        LLog("LoRaCore: Failed to create completion task");
+        return false;
+    }
+    return true;
+}
 
-    uint8_t payload[1 + 10 * sizeof(PacketId_t)];
-    payload[0] = pendingBulkAck.count;
-    memcpy(&payload[1], pendingBulkAck.ackedIds, pendingBulkAck.count * sizeof(PacketId_t));
-
-    size_t payloadSize = sizeof(uint8_t) + (pendingBulkAck.count * sizeof(PacketId_t));
+SendHandle_t LoRaCore::sendPacketAsync(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload,
+                                       SendCallback &&callback, uint32_t timeoutMs)
+{
+    if (!outgoingQueue || !startCompletionTask()) {
+        return 0;
+    }
+    if (xSemaphoreTake(completionMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return 0;
+    }
+    SendHandle_t handle = completions.add(receiverId, std::move(callback), millis(), timeoutMs);
+    completionsActive = completions.activeCount();
+    xSemaphoreGive(completionMutex);
+    if (!handle) {
+        putToLogBuffer("⚠️ Async send: too many sends awaiting completion");
+        return 0;
+    }
+    PacketId_t packetId = 0;
+    enqueuePacket(receiverId, base, payload, handle, true, packetId);
+    return handle;
+}
 
-    sendPacketBase(targetDeviceId, &pendingBulkAck, payload);
+void LoRaCore::bindCompletion(SendHandle_t handle, PacketId_t packetId, bool waitAck)
+{
+    if (xSemaphoreTake(completionMutex, portMAX_DELAY) == pdTRUE) {
+        completions.bind(handle, packetId, waitAck);
+        xSemaphoreGive(completionMutex);
+    }
+}
 
-    //putToLogBuffer(String("✅ Sent BULK ACK for ") + String(pendingBulkAck.count) + " packets: " + pendingBulkAck.getDebugInfo());
+void LoRaCore::completeSend(SendHandle_t handle, SendResult result)
+{
+    if (xSemaphoreTake(completionMutex, portMAX_DELAY) == pdTRUE) {
+        completions.complete(handle, result, millis());
+        completionsActive = completions.activeCount();
+        xSemaphoreGive(completionMutex);
+    }
+    if (completionTaskHandle) {
+        xTaskNotifyGive(completionTaskHandle);
+    }
+}
 
-    pendingBulkAck.clear();
-    lastBulkAckTime = millis();
+// Событие кадра из задач LoRaCore. Вызывать вне pendingMutex и не из задачи радио
+void LoRaCore::sendEvent(PacketId_t packetId, SendEvent event)
+{
+    if (!completionsActive || !completionMutex) {
+        return;
+    }
+    uint8_t finished = 0;
+    if (xSemaphoreTake(completionMutex, portMAX_DELAY) == pdTRUE) {
+        finished = completions.onEvent(packetId, event, millis());
+        completionsActive = completions.activeCount();
+        xSemaphoreGive(completionMutex);
+    }
+    if (finished && completionTaskHandle) {
+        xTaskNotifyGive(completionTaskHandle);
+    }
 }
 
-void LoRaCore::checkBulkAckTimeout(uint8_t targetDeviceId)
+void LoRaCore::completionTask()
 {
-    if (!pendingBulkAck.isEmpty() &&
-        (millis() - lastBulkAckTime > BULK_ACK_INTERVAL_MS))
-    {
-        sendBulkAck(targetDeviceId);
+    std::vector<PacketId_t> expiredAck;
+    std::vector<LoRaSendCompletion> done;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LORA_SEND_EXPIRE_CHECK_MS));
+
+        expiredAck.clear();
+        if (xSemaphoreTake(completionMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            completions.expire(millis(), expiredAck);
+            completions.take(done);
+            completionsActive = completions.activeCount();
+            xSemaphoreGive(completionMutex);
+        }
+
+        // Срок вышел: повторы кадра больше не нужны
+        if (!expiredAck.empty() && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(200)) == pdTRUE) {
+            for (PacketId_t id : expiredAck) {
+                auto it = std::find_if(pending.begin(), pending.end(),
+                                       [id](const PendingSend &p) { return p.pkt.packetId == id; });
+                if (it != pending.end()) {
+                    pending.erase(it);
+                    tracer.cancel(id);
+                }
+            }
+            xSemaphoreGive(pendingMutex);
+        }
+
+        for (auto &completion : done) {
+            if (completion.result != SendResult::DELIVERED && completion.result != SendResult::SENT) {
+                char s[100];
+                snprintf(s, sizeof(s), "⌛ Async send #%lu: id=%u, to=%u, %s after %lu ms",
+                         (unsigned long)completion.handle, completion.packetId, completion.receiver,
+                         sendResultName(completion.result), (unsigned long)completion.elapsedMs);
+                putToLogBuffer(String(s));
+            }
+            if (completion.callback) {
+                completion.callback(completion.handle, completion.result);
+            }
+        }
+        done.clear();
     }
 }
 
@@ -714,6 +3063,10 @@ void LoRaCore::updateRetryParameters()
                  currentBitrate / 1000, currentRetryTimeoutMs, currentMaxRetries, packetTime);
         putToLogBuffer(String(s));
     }
+    if (bulkAckIntervalOverrideMs) {
+        BULK_ACK_INTERVAL_MS = bulkAckIntervalOverrideMs;
+        BULK_ACK_MAX_WAIT_MS = std::min(BULK_ACK_MAX_WAIT_MS, bulkAckIntervalOverrideMs);
+    }
     putToLogBuffer(String("Curent profile=") + getCurrentProfileIndex());
     putToLogBuffer(String("Curent Bitrate   :") + currentBitrate + "bps");
     putToLogBuffer(String("Curent Bandwidth :") + currentBW + "kHz");
@@ -757,165 +3110,439 @@ void LoRaCore::receiveTask()
     static char s[200];
     static String fullLog = "";
 
+    LoRaRxFrame frame;
     while (true) {
-        LoRaPacket pkt = {};
         fullLog = "";
+
+        if (xQueueReceive(rxDrainQueue, &frame, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
         receivingInProgress = true;
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        if (radioSemaphore && xSemaphoreTake(radioSemaphore, 0) == pdTRUE) {
-
-            unsigned long t0 = millis();
-            int len = radio.getPacketLength();
-
-            if (len > 0 && len <= sizeof(LoRaPacket)) {
-                if (len < offsetof(LoRaPacket, payload)){
-                    radio.startReceive();
-                    if (radioSemaphore)
-                        xSemaphoreGive(radioSemaphore);
-                    receivingInProgress = false;
-                    char shortLog[80];
-                    _rx_errors++;
-                    snprintf(shortLog, sizeof(shortLog), "[ERROR] PACKET TOO SHORT: len=%d < header_size=%d", len, (int)offsetof(LoRaPacket, payload));
-                    putToLogBuffer(String(shortLog));
-                    continue;
-                }
+        uint32_t irqUs = frame.irqUs;
 
-                memset(&pkt, 0, sizeof(pkt));
-                
-                int16_t crcState = radio.readData((uint8_t *)&pkt, len);
-                unsigned long t1 = millis();
-                
-                // Получаем RSSI и SNR для статистики
-                float rssi = radio.getRSSI();
-                float snr = radio.getSNR();
-                _last_rssi = (int)rssi;
-                _last_snr = (int)snr;
-                
-                radio.startReceive();
-
-                xSemaphoreGive(radioSemaphore);
-
-                if (pkt.getSenderId() == srcAddress || crcState != RADIOLIB_ERR_NONE){
-                    receivingInProgress = false;
-                    _rx_errors++;
-                    continue;
-                }
-                
-                // === BROADCAST PACKET HANDLING ===
-                // Accept broadcast packets (receiverId == 0xFF) regardless of our address
-                // Also accept packets addressed directly to us
-                bool isBroadcast = pkt.isBroadcast();
-                bool isForUs = (pkt.getReceiverId() == srcAddress);
-                
-                if (!isBroadcast && !isForUs) {
-                    // Packet is not for us and not broadcast - ignore it
-                    receivingInProgress = false;
-                    continue;
-                }
+        int len = frame.len;
 
-                // Обновляем информацию о клиенте
-                updateClientOnReceive(pkt.getSenderId(), rssi, snr);
+        if (len > 0 && len <= sizeof(LoRaPacket)) {
+            if (len < offsetof(LoRaPacket, payload)){
+                receivingInProgress = false;
+                char shortLog[80];
+                metrics.add(LORA_CNT_RX_ERRORS);
+                snprintf(shortLog, sizeof(shortLog), "[ERROR] PACKET TOO SHORT: len=%d < header_size=%d", len, (int)offsetof(LoRaPacket, payload));
+                putToLogBuffer(String(shortLog));
+                continue;
+            }
 
-                String payloadHex = "";
-                int safePayloadLen = (pkt.payloadLen > MAX_LORA_PAYLOAD) ? 0 : pkt.payloadLen;
-                int maxPayloadToShow = std::min(safePayloadLen, 54);
-                for (int i = 0; i < maxPayloadToShow; i++){
-                    char hexByte[4];
-                    snprintf(hexByte, sizeof(hexByte), "%02X ", pkt.payload[i]);
-                    payloadHex += hexByte;
-                }
-                if (pkt.payloadLen > MAX_LORA_PAYLOAD) { payloadHex = "❌CORRUPTED_LEN=" + String(pkt.payloadLen); }
-                else if (pkt.payloadLen > 30) { payloadHex += "...";}
-
-                snprintf(s, sizeof(s), "[P:%d][RX on %d][L:%d]%lums→[%u->%u%s], T=[%d], id:%u,  state:%d, %u", 
-                        pending.size(), getCurrentProfileIndex(), len, t1 - t0, 
-                        pkt.getSenderId(), pkt.getReceiverId(), 
-                        isBroadcast ? "📡BC" : "", 
-                        pkt.packetType, pkt.packetId, crcState, pkt.payloadLen);
-                fullLog = String(s) + ":[" + payloadHex + "]";
-                putToLogBuffer(fullLog);
-                
-                // Broadcast packets NEVER require ACK - skip ACK logic
-                if (pkt.packetType == CMD_ACK && !pkt.isAckRequired()) { handleAck(&pkt); } 
-                else if(pkt.packetType == CMD_BULK_ACK && !pkt.isAckRequired()) { handleBulkAck(&pkt); }
-                        // Handle ASA response - DON'T apply yet, wait for ACK to be sent first
-                else if (pkt.packetType == CMD_RESPONCE_ASA) { handleAsaResponse(&pkt); }
-                // Handle ASA request - respond with ASA response (DON'T switch yet!)
-                else if (pkt.packetType == CMD_REQUEST_ASA) { handleAsaRequest(&pkt); }
-                else {
-                    // Broadcast packets don't require ACK
-                    if (pkt.isAckRequired() && !isBroadcast) {
-                        addAckToBulk(pkt.packetId, pkt.getSenderId());
-                        if(pkt.isHighPriority()){ flushBulkAck(pkt.getSenderId()); }
-                    }
-                    if(pkt.isHighPriority()){ xQueueSendToFront(incomingQueue, &pkt, 10); } 
-                    else { xQueueSendToBack(incomingQueue, &pkt, 500); }
-                }
-            } else {
-                _rx_errors++;
-                radio.startReceive();
-                if (radioSemaphore) { 
-                    xSemaphoreGive(radioSemaphore); 
+            LoRaPacket &pkt = frame.pkt;
+            int16_t crcState = frame.crcState;
+            float rssi = frame.rssi;
+            float snr = frame.snr;
+            metrics.set(LORA_GAUGE_LAST_RSSI, (int32_t)rssi);
+            metrics.set(LORA_GAUGE_LAST_SNR, (int32_t)snr);
+
+            if (pkt.getSenderId() == srcAddress || crcState != LORA_RADIO_OK){
+                receivingInProgress = false;
+                metrics.add(LORA_CNT_RX_ERRORS);
+                continue;
             }
 
+            // Маршруты учатся на всех услышанных кадрах, включая чужие
+            learnFromFrame(pkt);
+            
+            // === BROADCAST PACKET HANDLING ===
+            // Accept broadcast packets (receiverId == 0xFF) regardless of our address
+            // Also accept packets addressed directly to us
+            bool isBroadcast = pkt.isBroadcast();
+            bool isForUs = (pkt.getReceiverId() == srcAddress);
+            
+            if (!isBroadcast && !isForUs) {
+                // Packet is not for us and not broadcast - ignore it
                 receivingInProgress = false;
+                continue;
             }
-        }
-    }
-}
 
-void LoRaCore::sendTask()
-{
-    static char s[200];
-    unsigned int send_in_row = 0;
-    while (true)
-    {
-        LoRaPacket pkt = {};
-        if (xQueueReceive(outgoingQueue, &pkt, pdMS_TO_TICKS(500)) == pdTRUE){
+            // Обновляем информацию о клиенте
+            metrics.add(LORA_CNT_RX_FRAMES);
+            updateClientOnReceive(pkt.getSenderId(), rssi, snr);
+
+            // Мощность: отчёт о нашем кадре - в таблицу, о кадре отправителя - ему (замер до распаковки relay)
+            if (txPowerControl && isForUs) {
+                if (pkt.packetType == CMD_LINK_REPORT) { onLinkReport(pkt); }
+                else { sendLinkReportIfDue(pkt, rssi, snr); }
+            }
+
+            // Кадр ретранслятора: переслать дальше или распаковать исходный пакет
+            bool viaRelay = pkt.packetType == CMD_RELAY;
+            if (viaRelay && isForUs && !handleRelayFrame(pkt)) {
+                receivingInProgress = false;
+                continue;
+            }
 
-            LoRaPacket txPkt = pkt;
-            ssize_t len = offsetof(LoRaPacket, payload) + pkt.payloadLen;
-            unsigned long t0 = millis();
-            int result = transmitPacket(&txPkt, len);
-            unsigned long txDuration = millis() - t0;
+            // Метка времени верна только для кадра, который передал сам отправитель
+            if (pkt.packetType == CMD_HEARTBEAT && isBroadcast && !viaRelay) {
+                onTimeTrailer(pkt, irqUs);
+            }
+
+            // TDMA: master учитывает участников и запросы, slave синхронизируется по маяку
+            if (tdmaRole == TdmaRole::MASTER) {
+                onTdmaFrameHeard(pkt);
+            } else if (tdmaRole == TdmaRole::SLAVE && pkt.packetType == CMD_HEARTBEAT && isBroadcast) {
+                onTdmaBeacon(pkt, irqUs);
+            }
 
-            // Обновляем информацию о клиенте при успешной отправке
-            if (result == RADIOLIB_ERR_NONE) {
-                updateClientOnSend(pkt.getReceiverId());
+            // Polling: любой кадр опрошенного slave завершает ожидание ответа
+            if (pollRole == PollRole::MASTER && pkt.getSenderId() == pollAwaiting) {
+                pollMore = pkt.packetType != CMD_POLL || (pkt.payloadLen > 0 && (pkt.payload[0] & LORA_POLL_FLAG_MORE));
+                pollAnswered = true;
+                xTaskNotifyGive(senderTaskHandle);
             }
 
             String payloadHex = "";
             int safePayloadLen = (pkt.payloadLen > MAX_LORA_PAYLOAD) ? 0 : pkt.payloadLen;
-            for (int i = 0; i < safePayloadLen; i++){
+            int maxPayloadToShow = std::min(safePayloadLen, 54);
+            for (int i = 0; i < maxPayloadToShow; i++){
                 char hexByte[4];
                 snprintf(hexByte, sizeof(hexByte), "%02X ", pkt.payload[i]);
                 payloadHex += hexByte;
             }
             if (pkt.payloadLen > MAX_LORA_PAYLOAD) { payloadHex = "❌CORRUPTED_LEN=" + String(pkt.payloadLen); }
+            else if (pkt.payloadLen > 30) { payloadHex += "...";}
+
+            snprintf(s, sizeof(s), "[P:%d][RX on %d][L:%d]%lums→[%u->%u%s], T=[%d], id:%u,  state:%d, %u", 
+                    pending.size(), getCurrentProfileIndex(), len, (unsigned long)((micros() - irqUs) / 1000), 
+                    pkt.getSenderId(), pkt.getReceiverId(), 
+                    isBroadcast ? "📡BC" : "", 
+                    pkt.packetType, pkt.packetId, crcState, pkt.payloadLen);
+            fullLog = String(s) + ":[" + payloadHex + "]";
+            putToLogBuffer(fullLog);
+            
+            // Broadcast packets NEVER require ACK - skip ACK logic
+            if (pkt.packetType == CMD_ACK && !pkt.isAckRequired()) { handleAck(&pkt, irqUs); } 
+            else if(pkt.packetType == CMD_BULK_ACK && !pkt.isAckRequired()) { handleBulkAck(&pkt, irqUs); }
+                    // Handle ASA response - DON'T apply yet, wait for ACK to be sent first
+            else if (pkt.packetType == CMD_RESPONCE_ASA) { handleAsaResponse(&pkt); }
+            // Handle ASA request - respond with ASA response (DON'T switch yet!)
+            else if (pkt.packetType == CMD_REQUEST_ASA) { handleAsaRequest(&pkt); }
+            // Запрос метрик обслуживает ядро, приложение его не видит
+            else if (pkt.packetType == CMD_REQUEST_INFO && pkt.payloadLen == 1 &&
+                     pkt.payload[0] == INFO_REQUEST_METRICS && !isBroadcast) { metricsRequester = pkt.getSenderId(); }
+            // Анонс маршрутов уже учтён в learnFromFrame()
+            else if (pkt.packetType == CMD_ROUTE_ADV) { }
+            // Запрос слота обработан в onTdmaFrameHeard()
+            else if (pkt.packetType == CMD_TDMA_REQUEST) { }
+            // Отчёт о линии учтён выше
+            else if (pkt.packetType == CMD_LINK_REPORT) { }
+            // Режим RX соседа обслуживает ядро; через relay преамбулу слышит не он
+            else if (pkt.packetType == CMD_LOW_POWER && !isBroadcast && !viaRelay) { onLowPowerNotice(pkt); }
+            else if (pkt.packetType == CMD_POLL) { onPollFrame(frame); }
+            // Кадры передачи обслуживает transferTask; без неё предложение отклоняется
+            else if (pkt.packetType == CMD_TRANSFER && !isBroadcast) {
+                if (transferQueue) {
+                    if (xQueueSendToBack(transferQueue, &pkt, pdMS_TO_TICKS(10)) != pdTRUE) {
+                        metrics.add(LORA_CNT_RX_QUEUE_FULL);
+                    }
+                } else if (pkt.payloadLen > LORA_XFER_HEADER_SIZE && pkt.payload[0] == LORA_XFER_OP_OFFER) {
+                    PacketTransfer reject;
+                    uint8_t payload[LORA_XFER_HEADER_SIZE + 1] = {LORA_XFER_OP_ABORT, pkt.payload[1], LORA_XFER_REJECTED};
+                    reject.payloadLen = sizeof(payload);
+                    trySendPacket(pkt.getSenderId(), &reject, payload);
+                }
+            }
+            else {
+                // Broadcast packets don't require ACK. Master в режиме polling отдаёт ACK в следующем опросе
+                bool pollAck = false;
+                if (pkt.isAckRequired() && !isBroadcast && pollRole == PollRole::MASTER &&
+                    xSemaphoreTake(pollMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+                    pollAck = pollScheduler.addAck(pkt.getSenderId(), pkt.packetId);
+                    xSemaphoreGive(pollMutex);
+                }
+                if (pkt.isAckRequired() && !isBroadcast && !pollAck) {
+                    addAckToBulk(pkt.packetId, pkt.getSenderId());
+                    // Узел в low-power RX слушает только короткое окно после своей передачи: ACK - сразу
+                    if(pkt.isHighPriority() || isPeerWakePreamble(pkt.getSenderId())){ flushBulkAck(pkt.getSenderId()); }
+                }
+                // Метка до постановки: приложение может забрать кадр сразу
+                tracer.rxQueued(pkt.packetId, pkt.getSenderId(), irqUs);
+                BaseType_t queued;
+                if(pkt.isHighPriority()){ queued = xQueueSendToFront(incomingQueue, &frame, 10); } 
+                else { queued = xQueueSendToBack(incomingQueue, &frame, 500); }
+                if (queued == pdTRUE) { metrics.record(LORA_HIST_RX_DISPATCH_US, micros() - irqUs); }
+                else { metrics.add(LORA_CNT_RX_QUEUE_FULL); }
+            }
+        } else {
+            metrics.add(LORA_CNT_RX_ERRORS);
+            receivingInProgress = false;
+        }
+    }
+}
+
+void LoRaCore::drainRxFrame()
+{
+    if (!rxPending) {
+        return;
+    }
+    rxPending = false;
+    LoRaRxFrame frame;
+    frame.irqUs = rxIrqUs;
+    int len = radio.getPacketLength();
+    frame.len = len;
+    if (len > 0 && len <= (int)sizeof(LoRaPacket)) {
+        frame.crcState = radio.readData((uint8_t *)&frame.pkt, len);
+        frame.rssi = radio.getRSSI();
+        frame.snr = radio.getSNR();
+    }
+    // Без ожидания: drain никогда не блокируется, переполнение видно в метрике
+    if (xQueueSendToBack(rxDrainQueue, &frame, 0) != pdTRUE) {
+        metrics.add(LORA_CNT_RX_DRAIN_FULL);
+    }
+}
 
-            snprintf(s, sizeof(s), "[TxRxQ:%d/%d P:%d][TX:%d][L:%d]%lums→[%u->%u], T=[%c/%d], id=%u, %u:[", getOutgoingQueueCount(), getIncomingQueueCount(), pending.size(), getCurrentProfileIndex(), (int)len, txDuration, pkt.getSenderId(), pkt.getReceiverId(), pkt.packetType, pkt.packetType, pkt.packetId, pkt.payloadLen);
-            putToLogBuffer( String(s) + payloadHex + "]");
+// Передача кадра из очереди: эфир, метрики, лог. Задержки после передачи - у вызывающего.
+int LoRaCore::sendFrame(const LoRaPacket &pkt, unsigned long &txDuration, bool queued)
+{
+    static char s[200];
+    bool forwarded = isForwardedFrame(pkt);
+    if (!forwarded) {
+        tracer.dequeued(pkt.packetId);
+    }
+    if (queued && !forwarded) {
+        credits.onDequeued(pkt.getReceiverId(), pkt.payloadLen);
+        if (pkt.isAckRequired()) {
+            txQueued.remove(pkt.packetId);
+        }
+    }
 
-            if (result != RADIOLIB_ERR_NONE){
-                snprintf(s, sizeof(s),  "[ERROR] TX Error: code=%d, id=%u, len=%d, duration=%lums", result, pkt.packetId, (int)len, txDuration);
-                putToLogBuffer(String(s));
-                _tx_errors++;
+    LoRaPacket txPkt = pkt;
+    // Свой heartbeat несёт метку сетевого времени: stratum здесь, время - задача радио.
+    // Маяк TDMA - каждый LORA_TIMESYNC_BEACON_EVERY-й: маяки и так частые, эфир дорог
+    uint8_t *timeTrailer = nullptr;
+    uint32_t heartbeatCount = 0;
+    if (pkt.payloadLen >= sizeof(heartbeatCount)) {
+        memcpy(&heartbeatCount, pkt.payload, sizeof(heartbeatCount));
+    }
+    if (timeSyncEnabled && !forwarded && pkt.packetType == CMD_HEARTBEAT && pkt.isBroadcast() &&
+        pkt.getSenderId() == srcAddress && timeTrailerFits(pkt.payload, pkt.payloadLen) &&
+        (pkt.payloadLen == sizeof(heartbeatCount) || heartbeatCount % LORA_TIMESYNC_BEACON_EVERY == 0)) {
+        timeTrailer = txPkt.payload + txPkt.payloadLen;
+        timeTrailer[0] = timeStratum();
+        txPkt.payloadLen += LORA_TIME_TRAILER_SIZE;
+    }
+    ssize_t len = offsetof(LoRaPacket, payload) + txPkt.payloadLen;
+    // Фактор агрегации: пакетов приложения в кадре (служебные кадры не считаются)
+    uint32_t subPackets = 0;
+    String payloadHex = "";
+    auto whileOnAir = [&]() {
+        if (pkt.packetType == CMD_AGR) {
+            PacketAggregated().deserialize(pkt.payload, pkt.payloadLen,
+                                           [&subPackets](uint8_t, const uint8_t *, uint8_t) { subPackets++; });
+        } else if (!pkt.isService() && !forwarded && pkt.packetType != CMD_ACK && pkt.packetType != CMD_BULK_ACK) {
+            subPackets = 1;
+        }
+        int safePayloadLen = (pkt.payloadLen > MAX_LORA_PAYLOAD) ? 0 : pkt.payloadLen;
+        for (int i = 0; i < safePayloadLen; i++){
+            char hexByte[4];
+            snprintf(hexByte, sizeof(hexByte), "%02X ", pkt.payload[i]);
+            payloadHex += hexByte;
+        }
+        if (pkt.payloadLen > MAX_LORA_PAYLOAD) { payloadHex = "❌CORRUPTED_LEN=" + String(pkt.payloadLen); }
+    };
+
+    // Разбор AGR и hex для лога - пока кадр в эфире
+    unsigned long t0 = millis();
+    int result = transmitPacket(&txPkt, len, whileOnAir, timeTrailer);
+    txDuration = millis() - t0;
+
+    // Обновляем информацию о клиенте при успешной отправке
+    if (result == LORA_RADIO_OK) {
+        updateClientOnSend(pkt.getReceiverId());
+        metrics.add(LORA_CNT_TX_FRAMES);
+        if (subPackets > 0) {
+            metrics.record(LORA_HIST_AGGREGATION, subPackets);
+        }
+    }
+    metrics.set(LORA_GAUGE_TX_QUEUE, getOutgoingQueueCount());
+
+    snprintf(s, sizeof(s), "[TxRxQ:%d/%d P:%d][TX:%d][L:%d]%lums→[%u->%u], T=[%c/%d], id=%u, %u:[", getOutgoingQueueCount(), getIncomingQueueCount(), pending.size(), getCurrentProfileIndex(), (int)len, txDuration, pkt.getSenderId(), pkt.getReceiverId(), pkt.packetType, pkt.packetType, pkt.packetId, pkt.payloadLen);
+    putToLogBuffer( String(s) + payloadHex + "]");
+
+    if (result != LORA_RADIO_OK){
+        snprintf(s, sizeof(s),  "[ERROR] TX Error: code=%d, id=%u, len=%d, duration=%lums", result, pkt.packetId, (int)len, txDuration);
+        putToLogBuffer(String(s));
+        metrics.add(LORA_CNT_TX_ERRORS);
+    }
+
+    if (pkt.payloadLen + (timeTrailer ? LORA_TIME_TRAILER_SIZE : 0) != txPkt.payloadLen){
+        char corruptionBuf[50];
+        snprintf(s, sizeof(corruptionBuf), "[ERROR] TX Error: CORRUPTION: orig_len=%u, tx_len=%u", pkt.payloadLen, txPkt.payloadLen);
+        putToLogBuffer(String(corruptionBuf));
+    }
+    return result;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TX CLASSES
+// ═══════════════════════════════════════════════════════════════════════════
+
+bool LoRaCore::queueTxFrame(const LoRaPacket &pkt, TxClass cls, TickType_t waitTicks, bool front)
+{
+    QueueHandle_t queue = txQueues[(uint8_t)cls];
+    if (!queue) {
+        return false;
+    }
+    BaseType_t ok = front ? xQueueSendToFront(queue, &pkt, waitTicks) : xQueueSendToBack(queue, &pkt, waitTicks);
+    if (ok != pdTRUE) {
+        return false;
+    }
+    wakeSendTask();
+    return true;
+}
+
+bool LoRaCore::waitPeerQuota(LoraAddress_t peer, TickType_t waitTicks)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (credits.queuedFrames(peer) >= LORA_PEER_QUEUE_QUOTA) {
+        if (xTaskGetTickCount() - start >= waitTicks) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+// Повторы и данные делят эфир между узлами, остальные классы - FIFO
+static bool isFairClass(TxClass cls)
+{
+    return cls == TxClass::RETRY || cls == TxClass::NORMAL;
+}
+
+// Повторы и данные из очередей классов - в очереди узлов, не больше LORA_FAIR_STAGE_FRAMES
+// каждого класса: остальные ждут в outgoingQueue, где их ещё можно вложить в AGR
+void LoRaCore::stageFairFrames()
+{
+    LoRaPacket pkt;
+    for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+        TxClass cls = (TxClass)i;
+        if (!isFairClass(cls)) {
+            continue;
+        }
+        while (fairQueue.classSize(cls) < LORA_FAIR_STAGE_FRAMES && xQueueReceive(txQueues[i], &pkt, 0) == pdTRUE) {
+            fairQueue.push(pkt, cls, frameAirtimeUs(pkt));
+        }
+    }
+    fairQueueSize = fairQueue.size();
+}
+
+// Кадр первого непустого класса, RETRY и NORMAL вместе - по DRR узлов.
+// Пусто - ждём уведомления о постановке до waitTicks
+bool LoRaCore::takeTxFrame(LoRaPacket &pkt, TickType_t waitTicks)
+{
+    fairQueue.setQuantumUs(profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + maxMtu()));
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        bool fairDone = false;
+        for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+            if (!isFairClass((TxClass)i)) {
+                if (xQueueReceive(txQueues[i], &pkt, 0) == pdTRUE) {
+                    return true;
+                }
+            } else if (!fairDone) {
+                fairDone = true;
+                stageFairFrames();
+                if (fairQueue.pop(pkt)) {
+                    fairQueueSize = fairQueue.size();
+                    return true;
+                }
             }
+        }
+        if (attempt == 0) {
+            ulTaskNotifyTake(pdTRUE, waitTicks);
+        }
+    }
+    return false;
+}
+
+// Пауза sendTask после кадра: тем длиннее, чем дольше эфир
+uint32_t LoRaCore::sendPacingMs(unsigned long txDuration)
+{
+    if (txDuration > 900){
+        return txDuration * 3.5;
+    } else if (txDuration > 600){
+        return txDuration * 3;
+    } else if (txDuration > 300){
+        return txDuration * 2;
+    }
+    return (txDuration+2)/2;
+}
 
-            if (pkt.payloadLen != txPkt.payloadLen){
-                char corruptionBuf[50];
-                snprintf(s, sizeof(corruptionBuf), "[ERROR] TX Error: CORRUPTION: orig_len=%u, tx_len=%u", pkt.payloadLen, txPkt.payloadLen);
-                putToLogBuffer(String(corruptionBuf));
+void LoRaCore::sendTask()
+{
+    unsigned int send_in_row = 0;
+    while (true)
+    {
+        // Шаги TDMA и polling передают сами: шаг - только с бюджетом duty cycle на полный кадр
+        if (dutyCycleEnforced && (tdmaRole != TdmaRole::OFF || pollRole != PollRole::OFF)) {
+            uint32_t waitMs = dutyCycleWaitMs(profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + maxMtu()));
+            if (waitMs > 0 && waitMs != UINT32_MAX) {
+                metrics.add(LORA_CNT_TX_DUTY_DEFERRED);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(std::min<uint32_t>(waitMs, LORA_DUTY_CYCLE_RECHECK_MS)));
+                continue;
             }
-            if (txDuration > 900){
-                vTaskDelay(pdMS_TO_TICKS(txDuration * 3.5));
-            } else if (txDuration > 600){
-                vTaskDelay(pdMS_TO_TICKS(txDuration * 3));
-            } else if (txDuration > 300){
-                vTaskDelay(pdMS_TO_TICKS(txDuration * 2));
-            } else {
-                vTaskDelay(pdMS_TO_TICKS((txDuration+2)/2));
+        }
+        if (tdmaRole != TdmaRole::OFF && tdmaSendStep()) {
+            send_in_row = 0;
+            continue;
+        }
+        if (pollRole != PollRole::OFF && pollSendStep()) {
+            send_in_row = 0;
+            continue;
+        }
+
+        LoRaPacket pkt = {};
+        bool dequeued;
+        // Пока есть кадры со сроком, очередь целиком в macBacklog: выбор по EDF
+        if (deadlines.active(millis())) {
+            pullMacBacklog();
+        }
+        if (!macBacklog.empty()) {
+            // Кадры, ждавшие слота или опроса до потери синхронизации, уходят первыми
+            pkt = macBacklog.front();
+            macBacklog.pop_front();
+            macBacklogSize = macBacklog.size();
+            if (expireFrame(pkt)) {
+                continue;
+            }
+            dequeued = true;
+        } else {
+            // В TDMA и polling просыпаемся чаще: маяк или опрос может прийти во время ожидания
+            bool mac = tdmaRole != TdmaRole::OFF || pollRole != PollRole::OFF;
+            TickType_t waitTicks = pdMS_TO_TICKS(mac ? 50 : 500);
+            dequeued = takeTxFrame(pkt, waitTicks);
+            if (dequeued && expireFrame(pkt)) {
+                continue;
             }
+            if (dequeued && ((tdmaRole != TdmaRole::OFF && isTdmaSynced()) ||
+                             (pollRole == PollRole::SLAVE && isPollActive()))) {
+                macBacklog.push_front(pkt);
+                macBacklogSize = macBacklog.size();
+                continue;
+            }
+        }
+
+        if (dequeued && dutyCycleEnforced) {
+            // Нет бюджета поддиапазона: кадр ждёт первым в macBacklog, очередь его не обгоняет
+            uint32_t waitMs = dutyCycleWaitMs(txAirtimeUs(pkt));
+            if (waitMs > 0 && waitMs != UINT32_MAX) {
+                macBacklog.push_front(pkt);
+                macBacklogSize = macBacklog.size();
+                metrics.add(LORA_CNT_TX_DUTY_DEFERRED);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(std::min<uint32_t>(waitMs, LORA_DUTY_CYCLE_RECHECK_MS)));
+                continue;
+            }
+        }
+
+        if (dequeued){
+            unsigned long txDuration = 0;
+            sendFrame(pkt, txDuration);
+            // С duty cycle темп задаёт бюджет: после кадра - только короткая пауза для ответа
+            vTaskDelay(pdMS_TO_TICKS(dutyCycleEnforced ? (txDuration + 2) / 2 : sendPacingMs(txDuration)));
             send_in_row++;
             if (send_in_row >= 9) {
                 send_in_row = 0;
@@ -939,35 +3566,91 @@ void LoRaCore::sendTask()
 void LoRaCore::resendTask()
 {
     static char s[120];
+    std::vector<PacketId_t> droppedIds;
+    std::vector<PacketId_t> expiredIds;
     while (true)
     {
         uint32_t now = millis();
+        // В TDMA кадр и ACK на него ждут своих слотов: до двух суперкадров сверху; в polling - до двух циклов опроса
+        uint32_t macWaitMs = (tdmaRole != TdmaRole::OFF ? 2 * tdmaSuperframeMs : 0) +
+                             (pollRole != PollRole::OFF ? 2 * pollCycleMs : 0);
+        uint32_t retryTimeoutMs = currentRetryTimeoutMs + macWaitMs;
+        // Через ретрансляторы: на каждый hop кадр и ACK в эфире с паузой sendTask после каждого,
+        // плюс накопление bulk ACK у получателя. Таймаут - не меньше прямого
+        uint32_t relayAirMs = profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + LORA_BASE_MTU) / 1000;
+        uint32_t relayHopMs = 2 * (relayAirMs + sendPacingMs(relayAirMs));
+        droppedIds.clear();
+        expiredIds.clear();
         if (pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(1500)) == pdTRUE){
             for (auto it = pending.begin(); it != pending.end();) {
-                if (now - it->timestamp > currentRetryTimeoutMs) {
+                // Срок истёк: повторы бесполезны, ACK уже не нужен
+                if (deadlines.expired(it->pkt.packetId, now)) {
+                    snprintf(s, sizeof(s), "⌛ Expired: id=%u, T=%c, to=%u (after %u retries)", it->pkt.packetId, it->pkt.packetType, it->pkt.getReceiverId(), it->retries);
+                    putToLogBuffer(String(s));
+                    metrics.add(LORA_CNT_TX_EXPIRED_PENDING);
+                    tracer.cancel(it->pkt.packetId);
+                    expiredIds.push_back(it->pkt.packetId);
+                    it = pending.erase(it);
+                    continue;
+                }
+                uint8_t hops = frameHops(it->pkt);
+                uint32_t timeoutMs = hops > 1 ? std::max<uint32_t>(retryTimeoutMs, hops * relayHopMs + BULK_ACK_INTERVAL_MS + macWaitMs)
+                                              : retryTimeoutMs;
+                if (now - it->timestamp > timeoutMs && txQueued.queued(it->pkt.packetId)) {
+                    // Кадр ещё ждёт в очереди: ACK не мог прийти, таймаут - от выхода из очереди
+                    it->timestamp = now;
+                    ++it;
+                } else if (now - it->timestamp > timeoutMs) {
                     if (it->retries < currentMaxRetries) {
-                        if (xQueueSendToBack(outgoingQueue, &it->pkt, pdMS_TO_TICKS(1500)) == pdTRUE) {
+                        rerouteFrame(it->pkt);
+                        // Очередь повторов полна - запись остаётся просроченной и уйдёт на следующем проходе
+                        txQueued.add(it->pkt.packetId);
+                        if (queueTxFrame(it->pkt, TxClass::RETRY, 0)) {
+                            credits.onQueued(it->pkt.getReceiverId(), it->pkt.payloadLen);
                             it->timestamp = now;
                             it->retries++;
+                            metrics.add(LORA_CNT_RETRANSMISSIONS);
+                            tracer.queued(it->pkt.packetId, true);
+                            txPowerFeedback(it->pkt.getReceiverId(), false);
                             if (it->retries >= currentMaxRetries - 1) {
                                 snprintf(s, sizeof(s), "🔄Retry: id=%u #%u, T=%c, to=%u", it->pkt.packetId, it->retries, it->pkt.packetType, it->pkt.getReceiverId());
                                 putToLogBuffer(String(s));
                             }
                             ++it;
                         } else {
+                            txQueued.remove(it->pkt.packetId);
                             ++it;
                         }
                     } else {
                         snprintf(s, sizeof(s), "❌Drop: id=%u, T=%c, to=%u (max retries)", it->pkt.packetId, it->pkt.packetType, it->pkt.getReceiverId());
                         putToLogBuffer(String(s));
+                        metrics.add(LORA_CNT_DROPPED_MAX_RETRIES);
+                        metrics.record(LORA_HIST_RETRIES, it->retries);
+                        LoRaPacketTrace trace;
+                        if (tracer.dropped(it->pkt.packetId, trace)) {
+                            emitTrace(trace);
+                        }
+                        droppedIds.push_back(it->pkt.packetId);
                         it = pending.erase(it);
                     }
                 } else {
                     ++it;
                 }
             }
+            metrics.set(LORA_GAUGE_PENDING, pending.size());
             xSemaphoreGive(pendingMutex);
         }
+        for (PacketId_t id : droppedIds) {
+            sendEvent(id, SendEvent::DROPPED);
+        }
+        for (PacketId_t id : expiredIds) {
+            sendEvent(id, SendEvent::EXPIRED);
+        }
+        // Запрос метрик, принятый receiveTask: снимок и постановка страниц - вне приёма
+        LoraAddress_t requester = metricsRequester.exchange(DEVICE_ID_BROADCAST);
+        if (requester != DEVICE_ID_BROADCAST) {
+            sendMetrics(requester);
+        }
         uint32_t randomDelay = 211 + lc_randomRange(0, 99);
         vTaskDelay(pdMS_TO_TICKS(randomDelay));
     }
@@ -984,117 +3667,64 @@ bool LoRaCore::applyProfileFromSettings(uint8_t profileIndex)
         return false;
     }
 
-    const auto &profile = loraProfiles[profileIndex];
+    RadioCommand cmd;
+    cmd.op = RadioOp::APPLY_PROFILE;
+    cmd.profileIndex = profileIndex;
+    int result;
+    if (radioCall(cmd, result, pdMS_TO_TICKS(3000))) {
+        return result == LORA_RADIO_OK;
+    }
 
-    if (radioSemaphore && xSemaphoreTake(radioSemaphore, pdMS_TO_TICKS(3000)) == pdTRUE) {
-        radio.standby();
+    LLog("LoRaCore: radio queue busy, profile " + String(profileIndex) + " not applied");
+    return false;
+}
 
-        bool stat = false;
-
-        if (profile.mode == RadioProfileMode::LORA) {
-            stat =
-                radio.setModem(RADIOLIB_MODEM_LORA) == RADIOLIB_ERR_NONE &&
-                radio.setFrequency(currentFreq) == RADIOLIB_ERR_NONE &&
-                radio.setSpreadingFactor(profile.spreadingFactor) == RADIOLIB_ERR_NONE &&
-                radio.setCodingRate(profile.codingRate) == RADIOLIB_ERR_NONE &&
-                radio.setBandwidth(profile.bandwidth) == RADIOLIB_ERR_NONE &&
-                radio.setPreambleLength(LORA_PREAMBLE_LEN) == RADIOLIB_ERR_NONE &&
-                radio.setCRC(true) == RADIOLIB_ERR_NONE &&
-                radio.setOutputPower(currentTX) == RADIOLIB_ERR_NONE &&
-                radio.setSyncWord(LORA_SYNC_WORD) == RADIOLIB_ERR_NONE;
-
-            if (stat) {
-                _mode = RadioMode::LORA;
-                currentSF = profile.spreadingFactor;
-                currentCR = profile.codingRate;
-                currentBW = profile.bandwidth;
-                currentProfileIndex = profileIndex;
-                updateRetryParameters();
-            }
-        } else if (profile.mode == RadioProfileMode::FSK) {
-            int result;
-            radio.standby();
-            vTaskDelay(pdMS_TO_TICKS(400));
-            
-            result = radio.setModem(RADIOLIB_MODEM_FSK);
-            if (result != RADIOLIB_ERR_NONE) {
-                LLog("LoRaCore: GFSK setModem error: " + String(result));
-                xSemaphoreGive(radioSemaphore);
-                return false;
-            }
-            result = radio.setFrequency(currentFreq);
-            if (result != RADIOLIB_ERR_NONE) {
-                LLog("LoRaCore: GFSK setFrequency error: " + String(result));
-                xSemaphoreGive(radioSemaphore);
-                return false;
-            }
-            
-            result = radio.setBitRate(profile.bitrate / 1000.0f);
-            if (result == RADIOLIB_ERR_NONE) {
-                LLog("LoRaCore: GFSK setBitRate успешно, используем классический подход");
-
-                result = radio.setFrequencyDeviation(profile.deviation / 1000.0f);
-                if (result != RADIOLIB_ERR_NONE) {
-                    LLog("LoRaCore: GFSK setFrequencyDeviation error: " + String(result));
-                    xSemaphoreGive(radioSemaphore);
-                    return false;
-                }
+bool LoRaCore::radioApplyProfile(uint8_t profileIndex)
+{
+    const auto &profile = loraProfiles[profileIndex];
+    radio.standby();
 
-                result = radio.setRxBandwidth(profile.bandwidth);
-                if (result != RADIOLIB_ERR_NONE) {
-                    LLog("LoRaCore: GFSK setRxBandwidth error: " + String(result) +
-                         " (trying to set " + String(profile.bandwidth, 1) + "kHz)");
-                    xSemaphoreGive(radioSemaphore);
-                    return false;
-                }
-            } else {
-                LLog("LoRaCore: setBitRate не поддерживается, пробуем beginFSK...");
+    bool stat = false;
 
-                if (profile.bitrate < 4800) {
-                    LLog("LoRaCore: GFSK bitrate " + String(profile.bitrate) + " below SX1262 minimum (4800)");
-                    xSemaphoreGive(radioSemaphore);
-                    return false;
-                }
-                
-                result = radio.beginFSK(profile.bitrate / 1000.0f, profile.deviation / 1000.0f,
-                                        profile.bandwidth, 32, 10.0f, false);
-                if (result != RADIOLIB_ERR_NONE) {
-                    LLog("LoRaCore: GFSK beginFSK error: " + String(result) +
-                         " (bitrate=" + String(profile.bitrate / 1000.0f, 1) + "kbps" +
-                         ", dev=" + String(profile.deviation / 1000.0f, 1) + "kHz" +
-                         ", rxBw=" + String(profile.bandwidth, 1) + "kHz)");
-                    xSemaphoreGive(radioSemaphore);
-                    return false;
-                }
-            }
-            
-            result = radio.setCRC(true);
-            if (result != RADIOLIB_ERR_NONE) {
-                LLog("LoRaCore: GFSK setCRC error: " + String(result));
-                xSemaphoreGive(radioSemaphore);
-                return false;
-            } else {
-                LLog("LoRaCore: GFSK setCRC успешно");
-            }
+    if (profile.mode == RadioProfileMode::LORA) {
+        stat = radio.configureLoRa(currentFreq, profile.spreadingFactor, profile.codingRate, profile.bandwidth,
+                                   LORA_PREAMBLE_LEN, currentTX, LORA_SYNC_WORD) == LORA_RADIO_OK;
+        radioPower = currentTX;
 
-            stat = true;
-            _mode = RadioMode::FSK;
-            currentBitrate = profile.bitrate;
-            currentDeviation = profile.deviation;
+        if (stat) {
+            _mode = RadioMode::LORA;
+            currentSF = profile.spreadingFactor;
+            currentCR = profile.codingRate;
             currentBW = profile.bandwidth;
             currentProfileIndex = profileIndex;
             updateRetryParameters();
         }
+    } else if (profile.mode == RadioProfileMode::FSK) {
+        radio.standby();
+        vTaskDelay(pdMS_TO_TICKS(400));
+
+        int result = radio.configureFSK(currentFreq, profile.bitrate, profile.deviation, profile.bandwidth);
+        if (result != LORA_RADIO_OK) {
+            LLog("LoRaCore: GFSK configure error: " + String(result));
+            return false;
+        }
 
-        if (stat) { radio.startReceive(); }
-        else { LLog("LoRaCore: Ошибка применения профиля " + String(profileIndex)); }
+        stat = true;
+        _mode = RadioMode::FSK;
+        currentBitrate = profile.bitrate;
+        currentDeviation = profile.deviation;
+        currentBW = profile.bandwidth;
+        currentProfileIndex = profileIndex;
+        updateRetryParameters();
+    }
 
-        xSemaphoreGive(radioSemaphore);
-        return stat;
+    if (stat) {
+        resetTxPower();
+        startReceiveMode();
     }
+    else { LLog("LoRaCore: Ошибка применения профиля " + String(profileIndex)); }
 
-    LLog("LoRaCore:failed to get semaphore for profile " + String(profileIndex));
-    return false;
+    return stat;
 }
 
 String LoRaCore::getCurrentProfileInfo() const {
@@ -1107,14 +3737,9 @@ String LoRaCore::getCurrentProfileInfo() const {
 
 
 bool LoRaCore::applyLoRa(const LoRaProfile *p) {
-    bool success = radio.setModem(RADIOLIB_MODEM_LORA) == RADIOLIB_ERR_NONE &&
-                   radio.setFrequency(currentFreq) == RADIOLIB_ERR_NONE &&
-                   radio.setSpreadingFactor(p->sf) == RADIOLIB_ERR_NONE &&
-                   radio.setCodingRate(p->cr) == RADIOLIB_ERR_NONE &&
-                   radio.setBandwidth(p->bw) == RADIOLIB_ERR_NONE &&
-                   radio.setPreambleLength(8) == RADIOLIB_ERR_NONE &&
-                   radio.setCRC(true) == RADIOLIB_ERR_NONE &&
-                   radio.setOutputPower(currentTX) == RADIOLIB_ERR_NONE;
+    bool success = radio.configureLoRa(currentFreq, p->sf, p->cr, p->bw,
+                                       LORA_PREAMBLE_LEN, currentTX, LORA_SYNC_WORD) == LORA_RADIO_OK;
+    radioPower = currentTX;
 
     if (success) {
         currentSF = p->sf;
@@ -1126,11 +3751,7 @@ bool LoRaCore::applyLoRa(const LoRaProfile *p) {
 }
 
 bool LoRaCore::applyFSK(const FSKProfile *p) {
-    int result = radio.beginFSK(p->bitrate / 1000.0f, p->deviation / 1000.0f, p->rxBw / 1000.0f, 4);
-    if (result != RADIOLIB_ERR_NONE) {
-        return false;
-    }
-    bool success = radio.setCRC(true) == RADIOLIB_ERR_NONE;
+    bool success = radio.configureFSK(currentFreq, p->bitrate, p->deviation, p->rxBw / 1000.0f) == LORA_RADIO_OK;
     if (success) {
         currentBitrate = p->bitrate;
         currentDeviation = p->deviation;
@@ -1167,7 +3788,7 @@ bool LoRaCore::switchTo(RadioMode m) {
     if (ok) {
         _mode = m;
         LLog(String("[Warning] LoRaCore: Switched to ") + (m == RadioMode::LORA ? "[LoRa]" : "[GFSK]"));
-        radio.startReceive();
+        startReceiveMode();
     }
     return ok;
 }
@@ -1176,33 +3797,55 @@ bool LoRaCore::switchTo(RadioMode m) {
 PacketId_t LoRaCore::sendAsaRequest(uint8_t profileIndex, LoraAddress_t receiver) {
     PacketAsaExchange pkt(CMD_REQUEST_ASA);
     pkt.setProfile(profileIndex);
+    pkt.mtu = profileMtu(profileIndex);
+    // Узлу, не присылавшему ASA с MTU, - старый формат: 2 байта он бы отбросил
+    if (!asaMtuEnabled || !isMtuPeer(receiver)) {
+        pkt.payloadLen = sizeof(pkt.profileIndex);
+    }
 
     // Create proper payload buffer instead of relying on memory layout
-    uint8_t payload[1];
+    uint8_t payload[2];
     payload[0] = pkt.profileIndex;
+    payload[1] = pkt.mtu;
 
     return sendPacketBase(receiver, &pkt, payload);
 }
 
-PacketId_t LoRaCore::sendAsaResponse(uint8_t profileIndex, LoraAddress_t receiver) {
+PacketId_t LoRaCore::sendAsaResponse(uint8_t profileIndex, LoraAddress_t receiver, uint8_t mtu) {
     PacketAsaExchange pkt(CMD_RESPONCE_ASA);
     pkt.setProfile(profileIndex);
+    pkt.mtu = mtu;
+    if (!mtu) {
+        pkt.payloadLen = sizeof(pkt.profileIndex);
+    }
 
     // Create proper payload buffer instead of relying on memory layout
-    uint8_t payload[1];
+    uint8_t payload[2];
     payload[0] = pkt.profileIndex;
+    payload[1] = pkt.mtu;
 
     return sendPacketBase(receiver, &pkt, payload);
 }
 
 // -----------------------------------------------------------------------------
 bool LoRaCore::handleAsaRequest(const LoRaPacket *pkt) {
-    if (pkt->packetType != CMD_REQUEST_ASA || pkt->payloadLen != 1) {
+    uint8_t requestedProfile, offeredMtu;
+    bool withMtu = pkt->payloadLen > 1;
+    if (pkt->packetType != CMD_REQUEST_ASA || (withMtu && !asaMtuEnabled) ||
+        !parseAsaRequest(pkt->payload, pkt->payloadLen, requestedProfile, offeredMtu)) {
         return false;
     }
     
-    uint8_t requestedProfile = pkt->payload[0];
-    LLog("[ASA]request received: profile " + String(requestedProfile) + " from device " + String(pkt->getSenderId()));
+    LLog("[ASA]request received: profile " + String(requestedProfile) + " (MTU " + String(offeredMtu) + ") from device " + String(pkt->getSenderId()));
+    
+    // MTU - меньший из названных: запросивший примет кадр такой длины. Запрос в 1 байт - LORA_BASE_MTU
+    uint8_t agreedMtu = std::min(offeredMtu, profileMtu(requestedProfile));
+    if (requestedProfile < LORA_PROFILE_COUNT) {
+        if (withMtu) {
+            addMtuPeer(pkt->getSenderId());
+        }
+        setPeerMtu(pkt->getSenderId(), requestedProfile, agreedMtu);
+    }
     
     if (requestedProfile == getCurrentProfileIndex()) {
         LLog("[ASA]✓ Requested profile " + String(requestedProfile) + " is already active. No switch needed.");
@@ -1211,7 +3854,12 @@ bool LoRaCore::handleAsaRequest(const LoRaPacket *pkt) {
     else if (requestedProfile < LORA_PROFILE_COUNT) {
         // Send ASA response on CURRENT profile
         LLog("[ASA]Sending ASA response for profile " + String(requestedProfile) + " (staying on current profile for now)...");
-        sendAsaResponse(requestedProfile, pkt->getSenderId());
+        sendAsaResponse(requestedProfile, pkt->getSenderId(), withMtu ? agreedMtu : 0);
+        // Запрос в 1 байт: ответ в 1 байт для старой прошивки, за ним - в 2 байта с MTU профиля.
+        // Старая прошивка второй отбросит, новая узнает, что к этому узлу можно ASA с MTU
+        if (!withMtu && asaMtuEnabled) {
+            sendAsaResponse(requestedProfile, pkt->getSenderId(), profileMtu(requestedProfile));
+        }
         
         // Schedule profile switch after delay (with mutex protection)
         if (asaMutex && xSemaphoreTake(asaMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
@@ -1235,15 +3883,27 @@ bool LoRaCore::handleAsaRequest(const LoRaPacket *pkt) {
 
 // -----------------------------------------------------------------------------
 bool LoRaCore::handleAsaResponse(const LoRaPacket* pkt) {
-    if (pkt->packetType != CMD_RESPONCE_ASA || pkt->payloadLen != 1) {
+    uint8_t responseProfile, agreedMtu;
+    bool withMtu = pkt->payloadLen > 1;
+    if (pkt->packetType != CMD_RESPONCE_ASA || (withMtu && !asaMtuEnabled) ||
+        !parseAsaRequest(pkt->payload, pkt->payloadLen, responseProfile, agreedMtu)) {
         return false;
     }
     
-    uint8_t responseProfile = pkt->payload[0];
-    LLog("[ASA]response received: profile " + String(responseProfile) + " from device " + String(pkt->getSenderId()));
+    LLog("[ASA]response received: profile " + String(responseProfile) + " (MTU " + String(agreedMtu) + ") from device " + String(pkt->getSenderId()));
+    // Ответ в 1 байт MTU не меняет: за ним от новой прошивки идёт ответ с MTU
+    if (withMtu && responseProfile < LORA_PROFILE_COUNT) {
+        addMtuPeer(pkt->getSenderId());
+        setPeerMtu(pkt->getSenderId(), responseProfile, std::min(agreedMtu, profileMtu(responseProfile)));
+    }
     
     // Schedule profile switch after delay (to allow ACK to be sent) - with mutex protection
     if (asaMutex && xSemaphoreTake(asaMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        // Второй ответ того же обмена не сдвигает переключение: ответивший считает от первого
+        if (pendingAsaProfile == responseProfile || responseProfile == getCurrentProfileIndex()) {
+            xSemaphoreGive(asaMutex);
+            return true;
+        }
         pendingAsaProfile = responseProfile;
         asaResponseReceivedTime = millis();
         xSemaphoreGive(asaMutex);
@@ -1367,6 +4027,12 @@ uint8_t LoRaCore::recommendProfileForClient(LoraAddress_t clientAddr) {
     
     float rssi = info.getFilteredRssi();
     float snr = info.lastSnr;
+    // С управлением мощностью клиент шлёт нам тише, чем может: линия на полной мощности -
+    // по его отчёту о нашем кадре, мощность которого известна
+    if (txPowerControl && txPowerMutex && xSemaphoreTake(txPowerMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        txPower.fullPowerLink(clientAddr, millis(), rssi, snr);
+        xSemaphoreGive(txPowerMutex);
+    }
     
     // Проверка валидности данных
     // SNR часто может быть невалидным (-20 или другие некорректные значения)
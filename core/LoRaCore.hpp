@@ -1,26 +1,46 @@
 #pragma once
 // LoRaCore.hpp - Unified LoRa Communication System
 #include <Arduino.h>
-#include <RadioLib.h>
 #include <random>
 
-#include <SPI.h>
 #include <vector>
 #include <map>
+#include <deque>
+#include <algorithm>
 #include <functional>
+#include <atomic>
 #include "lora_config.h"
 #include "lora_helpers.hpp"
+#include "lora_metrics.hpp"
+#include "lora_trace.hpp"
 #include "lora_packets.hpp"
+#include "lora_radio.hpp"
+#include "lora_routing.hpp"
+#include "lora_tdma.hpp"
+#include "lora_poll.hpp"
+#include "lora_transfer.hpp"
+#include "lora_completion.hpp"
+#include "lora_credit.hpp"
+#include "lora_coalesce.hpp"
+#include "lora_deadline.hpp"
+#include "lora_txclass.hpp"
+#include "lora_fair.hpp"
+#include "lora_timesync.hpp"
+#include "lora_airtime.hpp"
+#include "lora_txpower.hpp"
 
 // Forward declarations for logging functions
 void LLog(const char *s);
 void LLog(const String &s);
 
 // Универсальный случайный 32-битный для Arduino/ESP
-static uint32_t lc_random32() {
+static inline uint32_t lc_random32() {
 #if defined(ESP32)
     // На ESP32 — аппаратный RNG, самый честный
     return esp_random();
+#elif defined(NATIVE_BUILD)
+    // Host — общий seeded RNG, симуляция воспроизводима (host::seedRandom)
+    return host::random32();
 #else
     // На обычных Arduino/STM32 — лёгкий LCG
     static uint32_t seed = 0;
@@ -39,7 +59,7 @@ static uint32_t lc_random32() {
 }
 
 // Диапазон [min, max] включительно
-static uint32_t lc_randomRange(uint32_t minVal, uint32_t maxVal) {
+static inline uint32_t lc_randomRange(uint32_t minVal, uint32_t maxVal) {
     if (maxVal <= minVal) return minVal;
     uint32_t span = maxVal - minVal + 1;
     return minVal + (lc_random32() % span);
@@ -50,17 +70,51 @@ static uint32_t lc_randomRange(uint32_t minVal, uint32_t maxVal) {
 class LoRaCore
 {
 private:
-    static TaskHandle_t receiverTaskHandle;
-    static TaskHandle_t senderTaskHandle;
-    static TaskHandle_t asaTaskHandle;
+    TaskHandle_t receiverTaskHandle = nullptr;
+    TaskHandle_t radioTaskHandle = nullptr;
+    TaskHandle_t senderTaskHandle = nullptr;
+    TaskHandle_t asaTaskHandle = nullptr;
     LoraAddress_t srcAddress;     // Current source address (can be changed)
     LoraAddress_t dstAddress;     // Default destination address (can be changed)
-    Module *_module;
-    SX1262 radio;
+    LoRaRadio *_ownedRadio;       // Радио платформы, если не передано снаружи
+    LoRaRadio &radio;
     QueueHandle_t incomingQueue = nullptr;
+    QueueHandle_t rxDrainQueue = nullptr;           // Пул вычитанных кадров: задача радио -> receiveTask
     QueueHandle_t outgoingQueue = nullptr;
-    SemaphoreHandle_t radioSemaphore = nullptr;
-    
+    QueueHandle_t txQueues[TX_CLASS_COUNT] = {};    // По классу передачи; txQueues[NORMAL] = outgoingQueue
+    QueueHandle_t radioQueue = nullptr;             // Команды задаче-владельцу радио (RadioCommand)
+
+    // Команда задаче радио. Вызывающий ждёт done: result и пакет живут на его стеке
+    enum class RadioOp : uint8_t { IRQ, TRANSMIT, APPLY_SETTINGS, APPLY_PROFILE, SWITCH_MODE, LOW_POWER_RX, SCAN_CHANNEL };
+    struct RadioCommand
+    {
+        RadioOp op = RadioOp::IRQ;
+        const LoRaPacket *pkt = nullptr;    // TRANSMIT
+        size_t len = 0;
+        bool wakePreamble = false;
+        bool traced = false;
+        uint8_t *timeTrailer = nullptr;     // Метка времени в конце кадра: дописывает задача радио
+        int8_t txPower = LORA_TX_POWER;     // Мощность кадра, дБм
+        int sf = 0;                         // APPLY_SETTINGS
+        int cr = 0;
+        float bw = 0;
+        uint8_t profileIndex = 0;           // APPLY_PROFILE
+        RadioMode mode = RadioMode::LORA;   // SWITCH_MODE
+        bool enabled = false;               // LOW_POWER_RX
+        int *result = nullptr;
+        SemaphoreHandle_t started = nullptr;   // TRANSMIT: кадр в эфире (или не начат)
+        SemaphoreHandle_t done = nullptr;
+    };
+    // Семафоры ожидания radioCall(): пул на LORA_RADIO_QUEUE_SIZE вызовов - больше команд в очереди
+    // не поместится. Свободные - в radioWaiterPool, вызов берёт пару и возвращает её
+    struct RadioWaiter
+    {
+        SemaphoreHandle_t started = nullptr;   // Кадр в эфире
+        SemaphoreHandle_t done = nullptr;
+    };
+    RadioWaiter radioWaiters[LORA_RADIO_QUEUE_SIZE];
+    QueueHandle_t radioWaiterPool = nullptr;        // RadioWaiter *
+
     unsigned long asaResponseSentTime = 0;
     unsigned long asaResponseReceivedTime = 0;
     int pendingAsaProfile = -1; // -1 means no pending profile switch
@@ -76,10 +130,20 @@ private:
 
     // Флаг активного приема - блокирует передачу
     volatile bool receivingInProgress = false;
+
+    // Low-power RX: duty-cycle приём вместо непрерывного startReceive()
+    // Пишет задача радио, isLowPowerRx() читают задачи приложения
+    std::atomic<bool> lowPowerRx{false};
+    std::atomic<bool> rxWindowOpen{false};          // Окно непрерывного RX после нашей TX
+    std::atomic<unsigned long> rxWindowUntil{0};
+    std::vector<LoraAddress_t> wakePreamblePeers;   // Узлы в low-power RX (под clientsMutex)
+    std::atomic<PacketId_t> lowPowerNoticeId{0};    // Последнее объявление своего режима RX
     uint8_t currentMaxRetries = 4;
     uint32_t currentRetryTimeoutMs = 3200;
     unsigned long BULK_ACK_INTERVAL_MS = 600;
     unsigned long BULK_ACK_MAX_WAIT_MS = 250;
+    unsigned long bulkAckIntervalOverrideMs = 0;    // 0 = интервал по SF/bitrate
+    bool aggregationEnabled = true;                 // Автоматическая агрегация в AGR
 
     static const uint32_t FAST_TX_THRESHOLD_MS = 100;  // Быстрая передача < 100мс
     static const uint32_t SLOW_TX_THRESHOLD_MS = 1000; // Медленная передача > 1сек
@@ -105,17 +169,139 @@ private:
     PacketBulkAck pendingBulkAck;
     unsigned long lastBulkAckTime = 0;
 
-    int _rx_errors = 0;
-    int _tx_errors = 0;
-    int _duplicated_acks = 0;
-    int _ack_received = 0;
-    int _last_rssi = -200;
-    int _last_snr = -200;
+    // Счётчики, gauges и гистограммы (lock-free, пишутся из задач и ISR)
+    LoRaMetrics metrics;
+    volatile uint32_t rxIrqUs = 0;                  // micros() последнего IRQ приёма
+    volatile bool rxPending = false;                // IRQ приёма был, кадр ещё в буфере радио
+    volatile bool txActive = false;                 // Кадр startTransmit() в эфире: IRQ DIO1 - это TX done
+    volatile uint32_t txDoneUs = 0;                 // micros() IRQ TX done
+    uint32_t lastTxEndUs = 0;                       // micros() конца последней передачи (пишет задача радио)
+    LoRaPacketTracer tracer{metrics};               // Этапы жизни пакета (выключено по умолчанию)
+    LoRaTxTimeTable txTimes;                        // IRQ TX done своих кадров: ack_air_rtt
+    std::function<void(const LoRaPacketTrace &)> traceCallback = nullptr;
 
     // Хранилище информации о клиентах/узлах
     std::map<LoraAddress_t, ClientInfo> clients;
     SemaphoreHandle_t clientsMutex = nullptr;
 
+    // Ретрансляция: маршруты учатся на всех узлах, чужие кадры пересылаются только при relayEnabled
+    volatile bool relayEnabled = false;
+    LoRaRouteTable routes;
+    SemaphoreHandle_t routesMutex = nullptr;         // routes и relayDuplicates
+    LoRaRelayDuplicateFilter relayDuplicates;
+    TaskHandle_t routeTaskHandle = nullptr;          // Создаётся при первом setRelayEnabled(true)
+    uint32_t routeAdvertIntervalMs = LORA_ROUTE_ADVERT_MIN_MS;
+    volatile unsigned long nextRouteAdvertMs = 0;
+    volatile unsigned long presenceAdvertAtMs = 0;   // Ответ узла без relay на анонс, 0 - нет
+
+    // TDMA: master рассылает маяки с раскладкой суперкадра, slave передают только в своём слоте
+    volatile TdmaRole tdmaRole = TdmaRole::OFF;
+    SemaphoreHandle_t tdmaMutex = nullptr;           // tdmaScheduler, tdmaLayout, tdmaBeaconEndUs, tdmaMaster
+    LoRaTdmaScheduler tdmaScheduler;
+    LoRaTdmaLayout tdmaLayout;                       // Текущий суперкадр: принятый (slave) или отправленный (master)
+    uint32_t tdmaBeaconEndUs = 0;                    // Конец маяка текущего суперкадра, 0 - синхронизации нет
+    uint32_t tdmaBeaconCount = 0;
+    LoraAddress_t tdmaMaster = DEVICE_ID_BROADCAST;  // Отправитель маяков (slave)
+    volatile uint32_t tdmaSuperframeMs = 0;          // Добавка к retry timeout: ACK ждёт слота
+    // Только sendTask
+    uint32_t tdmaNextBeaconUs = 0;                   // Master: начало следующего маяка
+    uint32_t tdmaSeenBeaconUs = 0;                   // Суперкадр, к которому относятся флаги ниже
+    bool tdmaSlotDone = false;                       // Наш слот (или запрос в конкуренции) отработан
+    bool tdmaTxInSuperframe = false;
+    uint32_t tdmaContentionAtUs = 0;                 // Slave без слота: момент запроса, 0 - не выбран
+    uint8_t tdmaJoinWindow = 1;                      // Slave без слота: окно backoff запросов, суперкадров
+    uint8_t tdmaJoinSkip = 0;                        // Суперкадров до следующей попытки
+    uint8_t tdmaIdleSuperframes = 0;                 // Slave: суперкадров без наших кадров
+
+    // Polling: master опрашивает клиентов по очереди, slave передаёт только в ответ
+    volatile PollRole pollRole = PollRole::OFF;
+    SemaphoreHandle_t pollMutex = nullptr;           // pollScheduler
+    LoRaPollScheduler pollScheduler;
+    volatile LoraAddress_t pollAwaiting = DEVICE_ID_BROADCAST;  // Master: чей ответ ждём
+    volatile bool pollAnswered = false;
+    volatile bool pollMore = false;
+    volatile bool pollPending = false;               // Slave: опрос принят, sendTask должен ответить
+    volatile LoraAddress_t pollMaster = DEVICE_ID_BROADCAST;
+    volatile unsigned long pollLastMs = 0;           // Slave: последний опрос, 0 - не опрашивают
+    volatile uint32_t pollCycleMs = 0;               // Период опроса: добавка к retry timeout
+
+    // Передача блоков: кадры CMD_TRANSFER обрабатывает transferTask, не приложение
+    SemaphoreHandle_t transferMutex = nullptr;       // xferOut, xferIn, transferHandler
+    QueueHandle_t transferQueue = nullptr;           // Создаётся с задачей при первой передаче или setTransferHandler()
+    TaskHandle_t transferTaskHandle = nullptr;
+    LoRaTransferSender xferOut;
+    LoRaTransferReceiver xferIn;
+    LoRaTransferReceiver::SinkHandler transferHandler = nullptr;
+    std::function<void(LoraAddress_t, bool, uint8_t)> transferCallback = nullptr;
+    // Только transferTask
+    uint8_t xferNextId = 0;
+    LoRaTransferProgress xferOutSeen;                // Последнее обработанное состояние: события и смена профиля
+    LoRaTransferProgress xferInSeen;
+    int xferOutProfile = -1;                         // Профиль до ускорения передачи, -1 - не менялся
+    int xferBoostTarget = -1;                        // Ускорение запрошено, профиль ещё не сменился
+    unsigned long xferBoostUntilMs = 0;              // Срок смены профиля по ASA
+    bool xferBoostTried = false;
+    int xferInProfile = -1;                          // Профиль получателя в начале приёма
+    uint8_t xferInLastProfile = 0;
+    unsigned long xferInSwitchMs = 0;                // Последняя смена профиля во время приёма
+
+    // Асинхронные отправки: итоги забирает completionTask и вызывает callback вне блокировок
+    SemaphoreHandle_t completionMutex = nullptr;     // completions
+    LoRaCompletionTracker completions;
+    TaskHandle_t completionTaskHandle = nullptr;     // Создаётся при первой sendPacketAsync()
+    volatile uint16_t completionsActive = 0;         // Без ожидающих отправок события кадров не ищутся
+
+    // Запрос метрик: receiveTask запоминает узел, страницы ставит resendTask
+    std::atomic<LoraAddress_t> metricsRequester{DEVICE_ID_BROADCAST};  // DEVICE_ID_BROADCAST - запроса нет
+    LoRaMetricsSnapshot metricsReply;                // Снимок sendMetrics(): ~1.8 КБ, не на стеке resendTask
+
+    // Сетевое время: метки в своих heartbeat, часы соседей по их меткам
+    volatile bool timeSyncEnabled = true;
+    volatile int8_t timeRoot = -1;                   // setTimeSyncRoot(), -1 - корень DEVICE_ID_MASTER
+    SemaphoreHandle_t timeSyncMutex = nullptr;       // timeSync
+    LoRaTimeSync timeSync;
+    LoRaTimeStamper timeStamper;                     // Только задача радио
+
+    // Эфир по поддиапазону, узлу и типу: пишет задача радио, бюджет смотрит sendTask
+    volatile bool dutyCycleEnforced = LORA_DUTY_CYCLE_ENFORCE;
+    SemaphoreHandle_t airtimeMutex = nullptr;        // airtime
+    LoRaAirtimeLedger airtime;
+
+    // Мощность по узлу: отчёты пишет receiveTask, потери - resendTask, мощность кадра берёт transmitPacket
+    volatile bool txPowerControl = LORA_TPC_ENABLE;
+    SemaphoreHandle_t txPowerMutex = nullptr;        // txPower
+    LoRaTxPowerControl txPower;
+    int8_t radioPower = LORA_TX_POWER;               // Мощность, выставленная в радио: только задача радио
+
+    // MTU по узлу из обмена ASA: пишут обработчики ASA, читают постановка кадров и шаги MAC
+    struct PeerMtu
+    {
+        uint8_t profile;                             // Профиль, для которого согласован
+        uint8_t mtu;
+    };
+    SemaphoreHandle_t mtuMutex = nullptr;            // peerMtu, mtuPeers
+    std::map<LoraAddress_t, PeerMtu> peerMtu;
+    std::vector<LoraAddress_t> mtuPeers;             // Прислали ASA в 2 байта: им запрос ASA с MTU
+    volatile bool asaMtuEnabled = true;
+
+    // Свои кадры в очереди по получателю кадра: кредит отправки (без блокировок)
+    LoRaCreditLedger credits;
+
+    // Каналы latest-value-wins: ID последнего образца по (получатель, ключ)
+    SemaphoreHandle_t coalesceMutex = nullptr;       // coalesce; держится на всё время постановки образца
+    LoRaCoalesceTable coalesce;
+
+    // Сроки своих кадров (PacketBase::ttlMs) по ID: порядок EDF в sendTask, сброс истёкших (без блокировок)
+    LoRaDeadlineTable deadlines;
+    LoRaTxQueuedTable txQueued;      // Свои кадры с ACK, ещё не переданные: их не повторять
+
+    // Кадры, которые sendTask забрал из outgoingQueue до своего слота TDMA или опроса (только sendTask)
+    std::deque<LoRaPacket> macBacklog;
+    volatile uint16_t macBacklogSize = 0;
+    // Повторы и данные, забранные sendTask из очередей RETRY и NORMAL: DRR по узлам (только sendTask)
+    LoRaFairScheduler fairQueue;
+    volatile uint16_t fairQueueSize = 0;
+
     // ═══════════════════════════════════════════════════════════════════════════
     // AUTO ASA SYSTEM - Автоматическая адаптация профилей на основе RSSI клиентов
     // ═══════════════════════════════════════════════════════════════════════════
@@ -123,7 +309,7 @@ private:
     unsigned long autoAsaCheckInterval = 10000;      // Интервал проверки (10 сек)
     unsigned long lastAutoAsaCheck = 0;              // Время последней проверки
     float autoAsaRssiHysteresis = 5.0f;             // Гистерезис для предотвращения частых переключений (5 dBm)
-    static TaskHandle_t autoAsaTaskHandle;           // Задача для авто-ASA
+    TaskHandle_t autoAsaTaskHandle = nullptr;        // Задача для авто-ASA
     
     // Последний рекомендованный профиль для каждого клиента
     std::map<LoraAddress_t, uint8_t> lastRecommendedProfile;
@@ -134,12 +320,35 @@ private:
     void processAsaProfileSwitchTask();
     bool hasPendingAsa();
 public:
-    int getRxErrorCount() const { return _rx_errors; }
-    int getDuplicatedAcksCount() const { return _duplicated_acks; }
-    int getAckReceivedCount() const { return _ack_received; }
-    int getTxErrorCount() const { return _tx_errors; }
-    int getLastRssi() const { return _last_rssi; }
-    int getLastSnr() const { return _last_snr; }
+    int getRxErrorCount() const { return metrics.counter(LORA_CNT_RX_ERRORS); }
+    int getDuplicatedAcksCount() const { return metrics.counter(LORA_CNT_DUPLICATE_ACKS); }
+    int getAckReceivedCount() const { return metrics.counter(LORA_CNT_ACK_RECEIVED); }
+    int getTxErrorCount() const { return metrics.counter(LORA_CNT_TX_ERRORS); }
+    int getLastRssi() const { return metrics.gauge(LORA_GAUGE_LAST_RSSI); }
+    int getLastSnr() const { return metrics.gauge(LORA_GAUGE_LAST_SNR); }
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // METRICS
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    LoRaMetrics &getMetrics() { return metrics; }
+
+    // Снимок всех метрик; gauges очередей и pending обновляются перед снятием
+    void getMetricsSnapshot(LoRaMetricsSnapshot &out);
+
+    // Отправить снимок страницами CMD_METRICS (ответ на INFO_REQUEST_METRICS).
+    // Не ждёт места в очереди: не поставленные страницы - в счётчике metrics_pages_dropped
+    void sendMetrics(LoraAddress_t receiver);
+
+    // Трассировка этапов: enqueue, очередь, задача радио, эфир, повторы, ACK, выдача приложению.
+    // Гистограммы этапов - в метриках; каждый sampleEvery-й завершённый кадр - в поток (0 - без потока)
+    void setPacketTracing(bool enabled, uint16_t sampleEvery = 0) { tracer.setEnabled(enabled, sampleEvery); }
+    bool isPacketTracing() const { return tracer.isEnabled(); }
+
+    // Поток трассировки: вызывается из задач LoRaCore, без callback - строка в лог
+    void setTraceCallback(std::function<void(const LoRaPacketTrace &)> &&callback) {
+        traceCallback = std::move(callback);
+    }
 
     // ═══════════════════════════════════════════════════════════════════════════
     // CLIENT INFO MANAGEMENT
@@ -194,6 +403,45 @@ public:
         return found;
     }
     
+    // ═══════════════════════════════════════════════════════════════════════════
+    // LOW-POWER RX
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Включить duty-cycle приём (только LoRa профили; в FSK приём остаётся непрерывным)
+    void setLowPowerRx(bool enabled);
+    bool isLowPowerRx() const { return lowPowerRx; }
+
+    // CAD на текущем профиле LoRa: LORA_RADIO_CHANNEL_FREE, LORA_RADIO_LORA_DETECTED или ошибка
+    // (LORA_RADIO_ERR_CONFIG на GFSK). Приём перезапускается сразу после проверки
+    int scanChannel();
+
+    // Узел-получатель работает в low-power RX: слать ему кадры с длинной преамбулой
+    void setPeerWakePreamble(LoraAddress_t address, bool enabled) {
+        if (clientsMutex && xSemaphoreTake(clientsMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            auto it = std::find(wakePreamblePeers.begin(), wakePreamblePeers.end(), address);
+            if (enabled && it == wakePreamblePeers.end()) {
+                wakePreamblePeers.push_back(address);
+            } else if (!enabled && it != wakePreamblePeers.end()) {
+                wakePreamblePeers.erase(it);
+            }
+            xSemaphoreGive(clientsMutex);
+        }
+    }
+
+    bool isPeerWakePreamble(LoraAddress_t address) {
+        bool found = false;
+        if (clientsMutex && xSemaphoreTake(clientsMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+            // Broadcast должен разбудить всех спящих
+            if (address == DEVICE_ID_BROADCAST) {
+                found = !wakePreamblePeers.empty();
+            } else {
+                found = std::find(wakePreamblePeers.begin(), wakePreamblePeers.end(), address) != wakePreamblePeers.end();
+            }
+            xSemaphoreGive(clientsMutex);
+        }
+        return found;
+    }
+
     // Получить количество известных клиентов
     size_t getClientsCount() const {
         return clients.size();
@@ -226,6 +474,136 @@ public:
         }
     }
 
+    // ═══════════════════════════════════════════════════════════════════════════
+    // RELAY / ROUTING
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Пересылать чужие кадры CMD_RELAY и рассылать анонсы маршрутов (CMD_ROUTE_ADV)
+    void setRelayEnabled(bool enabled);
+    bool isRelayEnabled() const { return relayEnabled; }
+
+    // Статический маршрут: пакеты для destination уходят через nextHop (nextHop == destination - напрямую)
+    void setRoute(LoraAddress_t destination, LoraAddress_t nextHop);
+    bool clearRoute(LoraAddress_t destination);
+    bool getRoute(LoraAddress_t destination, LoRaRoute &out);
+    std::vector<LoRaRoute> getRoutes();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // TDMA
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // MASTER - маяки и раздача слотов, SLAVE - передача в своём слоте, OFF - случайный доступ
+    void setTdmaRole(TdmaRole role);
+    TdmaRole getTdmaRole() const { return tdmaRole; }
+
+    // Slave слышит маяки; master - всегда после первого маяка
+    bool isTdmaSynced();
+
+    // Роль, суперкадр, слоты и участники (для команды tdma)
+    String getTdmaInfo();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // NETWORK TIME
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Сетевое время - micros() корня, errorUs - заявленная точность (lora_timesync.hpp)
+    LoRaNetworkTime getNetworkTime();
+    // Свой micros() в момент networkUs сетевого времени: общий момент для нескольких узлов
+    bool networkToLocalUs(uint32_t networkUs, uint32_t &localUs);
+    // Смещение и дрейф часов соседа по его меткам
+    bool getPeerClock(LoraAddress_t peer, LoRaPeerClock &out);
+
+    // Корень сетевого времени; по умолчанию - узел с адресом DEVICE_ID_MASTER
+    void setTimeSyncRoot(bool root) { timeRoot = root ? 1 : 0; }
+    bool isTimeSyncRoot() const { return timeRoot < 0 ? srcAddress == DEVICE_ID_MASTER : timeRoot == 1; }
+    // Метки в своих heartbeat (включено по умолчанию). Приём меток работает всегда
+    void setTimeSyncEnabled(bool enabled) { timeSyncEnabled = enabled; }
+    bool isTimeSyncEnabled() const { return timeSyncEnabled; }
+
+    // Сетевое время и часы соседей (для команды time)
+    String getTimeSyncInfo();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // DUTY CYCLE
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Соблюдать duty cycle поддиапазона EU868 (lora_airtime.hpp): кадр ждёт бюджета в sendTask,
+    // задача радио не передаёт сверх него. По умолчанию LORA_DUTY_CYCLE_ENFORCE; учёт идёт всегда
+    void setDutyCycleEnforced(bool enforced) { dutyCycleEnforced = enforced; }
+    bool isDutyCycleEnforced() const { return dutyCycleEnforced; }
+
+    // Эфир в окне и бюджет поддиапазона текущей частоты
+    LoRaAirtimeBudget getAirtimeBudget();
+    // Бюджет, эфир по поддиапазонам, узлам и типам (для команды stats)
+    String getAirtimeInfo();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // TX POWER CONTROL
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Мощность кадра к узлу по его отчётам о линии (lora_txpower.hpp). Включать на обоих концах:
+    // отчёты шлёт и принимает только узел с управлением мощностью. По умолчанию LORA_TPC_ENABLE
+    void setTxPowerControlEnabled(bool enabled);
+    bool isTxPowerControlEnabled() const { return txPowerControl; }
+
+    // Мощность кадров к узлу сейчас, дБм
+    int8_t getTxPower(LoraAddress_t peer);
+    // Мощность и запас по узлам (для команды stats)
+    String getTxPowerInfo();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // MTU
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Наибольший payload кадра к узлу на текущем профиле (docs/MTU.md): MTU профиля, если узел
+    // назвал его в обмене ASA, иначе LORA_BASE_MTU. Broadcast и TDMA - всегда LORA_BASE_MTU
+    uint8_t getMtu(LoraAddress_t peer);
+    // MTU профиля и согласованные по узлам (для команды stats)
+    String getMtuInfo();
+    // MTU в обмене ASA (по умолчанию включено). Выключено - узел ведёт себя как прошивка без MTU
+    // профиля: ASA в 1 байт, ASA в 2 байта отбрасывается. Для проверки совместимости в lora_sim
+    void setAsaMtuEnabled(bool enabled) { asaMtuEnabled = enabled; }
+    bool isAsaMtuEnabled() const { return asaMtuEnabled; }
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // POLLING
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // MASTER - опрос клиентов по очереди, SLAVE - передача только в ответ на опрос.
+    // Включение выключает TDMA: режимы доступа к каналу взаимоисключающие
+    void setPollRole(PollRole role);
+    PollRole getPollRole() const { return pollRole; }
+
+    // Slave: опросы приходят; master - есть кого опрашивать
+    bool isPollActive();
+
+    // Роль, период цикла, очередь (для команды poll)
+    String getPollInfo();
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // BLOCK TRANSFER
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // Передать source узлу receiver блоками с окном и возобновлением (lora_transfer.hpp).
+    // Одна исходящая передача за раз; source живёт до callback. На время передачи прямому
+    // соседу запрашивается самый быстрый профиль, который держит связь с ним
+    bool startTransfer(LoraAddress_t receiver, LoRaTransferSource &source, uint8_t kind = LORA_XFER_KIND_FILE);
+    // Отменить исходящую передачу (получатель узнает кадром ABORT)
+    void abortTransfer();
+    bool isTransferActive();
+
+    // Приём: handler выбирает приёмник данных по предложению, nullptr - отказ.
+    // Без handler входящие передачи отклоняются
+    void setTransferHandler(LoRaTransferReceiver::SinkHandler &&handler);
+
+    // Итог передачи: callback(peer, outgoing, result) из задачи передачи
+    void setTransferCallback(std::function<void(LoraAddress_t, bool, uint8_t)> &&callback) {
+        transferCallback = std::move(callback);
+    }
+
+    // Исходящая и входящая передачи (для команды xfer)
+    String getTransferInfo();
+
     // ═══════════════════════════════════════════════════════════════════════════
     // AUTO ASA MANAGEMENT
     // ═══════════════════════════════════════════════════════════════════════════
@@ -259,10 +637,33 @@ public:
     void clearManualMode() { _manual = false;}
     bool isManualMode() const { return _manual;}
     RadioMode mode() const { return _mode;}
-    SX1262 &getRadio() { return radio;}
+    LoRaRadio &getRadio() { return radio;}
     bool removePendingPacket(PacketId_t );  // Метод для принудительного удаления пакета из pending списка (например, при успешном ASA ответе)
     PacketId_t sendPacketBase(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload);
-    PacketId_t sendAsaResponse(uint8_t profileIndex, LoraAddress_t receiver);
+
+    // Асинхронная отправка: итог (DELIVERED, SENT, DROPPED, EXPIRED...) - callback(handle, result)
+    // из задачи завершений, вне блокировок LoRaCore. timeoutMs - срок итога, 0 - до конца повторов.
+    // Возвращает handle, 0 - отправка не принята (callback не будет)
+    SendHandle_t sendPacketAsync(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload,
+                                 SendCallback &&callback, uint32_t timeoutMs = 0);
+    // Асинхронных отправок в ожидании итога
+    size_t getAsyncPendingCount() const { return completionsActive; }
+
+    // Неблокирующая отправка: не ждёт места в outgoingQueue и pendingMutex, WOULD_BLOCK - повторить позже.
+    // packetId (если не nullptr) - ID кадра или AGR, в который пакет вложен
+    SendStatus trySendPacket(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload,
+                             PacketId_t *packetId = nullptr);
+    // Сколько кадров и байт можно поставить к destination, чтобы его очередь не превысила
+    // LORA_CREDIT_WINDOW_MS эфира на текущем профиле (lora_credit.hpp)
+    LoRaSendCredit getSendCredit(LoraAddress_t destination);
+
+    // Канал latest-value-wins для состояния (телеметрия, позиция, уставка): образец заменяет
+    // предыдущий образец того же (receiverId, key) на его месте в outgoingQueue и снимает его
+    // повторы из pending. Не агрегируется. Возвращает ID кадра, 0 - не поставлен
+    PacketId_t sendPacketLatest(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload, uint8_t key);
+    // mtu 0 - ответ в 1 байт, как у прошивки без MTU профиля
+    PacketId_t sendAsaResponse(uint8_t profileIndex, LoraAddress_t receiver, uint8_t mtu);
+    // Запрос в 2 байта - только узлу, который уже присылал ASA в 2 байта, иначе в 1 байт
     PacketId_t sendAsaRequest(uint8_t profileIndex, LoraAddress_t receiver);
     
     bool handleAsaRequest(const LoRaPacket *pkt);   // Handle ASA request packet and schedule profile switch
@@ -271,11 +672,20 @@ public:
     // Process pending ASA profile switch (call in main loop)
     bool processAsaProfileSwitch();
     
+    // Радио платформы по умолчанию (SX1262 на ESP32, loopback в native сборке)
     LoRaCore(LoraAddress_t deviceId, LoraAddress_t defaultDestination = 0)
         : srcAddress(deviceId),
           dstAddress(defaultDestination),
-          _module(new Module(LORA_SS, LORA_DIO1, LORA_RST, LORA_BUSY)),
-          radio(_module)
+          _ownedRadio(createPlatformRadio()),
+          radio(*_ownedRadio)
+    {}
+
+    // Внешнее радио (симулятор, другие пины) - LoRaCore им не владеет
+    LoRaCore(LoRaRadio &radioDriver, LoraAddress_t deviceId, LoraAddress_t defaultDestination = 0)
+        : srcAddress(deviceId),
+          dstAddress(defaultDestination),
+          _ownedRadio(nullptr),
+          radio(radioDriver)
     {}
 
     ~LoRaCore()
@@ -286,8 +696,24 @@ public:
         if (outgoingQueue){
             vQueueDelete(outgoingQueue);
         }
-        if (radioSemaphore){
-            vSemaphoreDelete(radioSemaphore);
+        for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+            if (txQueues[i] && txQueues[i] != outgoingQueue) {
+                vQueueDelete(txQueues[i]);
+            }
+        }
+        if (radioQueue){
+            vQueueDelete(radioQueue);
+        }
+        if (radioWaiterPool){
+            vQueueDelete(radioWaiterPool);
+        }
+        for (RadioWaiter &waiter : radioWaiters) {
+            if (waiter.started) {
+                vSemaphoreDelete(waiter.started);
+            }
+            if (waiter.done) {
+                vSemaphoreDelete(waiter.done);
+            }
         }
         if (pendingMutex){
             vSemaphoreDelete(pendingMutex);
@@ -298,24 +724,75 @@ public:
         if (clientsMutex){
             vSemaphoreDelete(clientsMutex);
         }
-        radio.clearDio1Action();
-        delete _module;
+        if (routesMutex){
+            vSemaphoreDelete(routesMutex);
+        }
+        if (tdmaMutex){
+            vSemaphoreDelete(tdmaMutex);
+        }
+        if (pollMutex){
+            vSemaphoreDelete(pollMutex);
+        }
+        if (transferMutex){
+            vSemaphoreDelete(transferMutex);
+        }
+        if (transferQueue){
+            vQueueDelete(transferQueue);
+        }
+        if (completionMutex){
+            vSemaphoreDelete(completionMutex);
+        }
+        if (coalesceMutex){
+            vSemaphoreDelete(coalesceMutex);
+        }
+        if (timeSyncMutex){
+            vSemaphoreDelete(timeSyncMutex);
+        }
+        if (airtimeMutex){
+            vSemaphoreDelete(airtimeMutex);
+        }
+        if (txPowerMutex){
+            vSemaphoreDelete(txPowerMutex);
+        }
+        if (mtuMutex){
+            vSemaphoreDelete(mtuMutex);
+        }
+        radio.clearIrqHandler();
+        delete _ownedRadio;
     }
 
-    static void onReceive()
+    static void onReceive(void *context)
     {
-        if (receiverTaskHandle == nullptr) {
+        LoRaCore *self = static_cast<LoRaCore *>(context);
+        if (self == nullptr || self->radioQueue == nullptr) {
             return;
         }
-        // STATIC INTERRUPT HANDLER
+        // INTERRUPT HANDLER (DIO1)
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        vTaskNotifyGiveFromISR(receiverTaskHandle, &xHigherPriorityTaskWoken);
+        if (self->txActive) {
+            // TX done: задача радио ждёт его уведомлением, очередь команд не трогаем
+            self->txActive = false;
+            self->txDoneUs = micros();
+            vTaskNotifyGiveFromISR(self->radioTaskHandle, &xHigherPriorityTaskWoken);
+            portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+            return;
+        }
+        self->rxIrqUs = micros();
+        self->rxPending = true;
+        // В начало очереди: кадр вычитывается до следующей команды. Очередь полна - кадр
+        // вычитает первая же команда из неё (rxPending)
+        RadioCommand irq;
+        xQueueSendToFrontFromISR(self->radioQueue, &irq, &xHigherPriorityTaskWoken);
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 
     void forceMode(RadioMode m) {
         _manual = true;
-        switchTo(m);
+        RadioCommand cmd;
+        cmd.op = RadioOp::SWITCH_MODE;
+        cmd.mode = m;
+        int result;
+        radioCall(cmd, result);
     }
 
     void setAckCallback(std::function<void(PacketId_t, LoraAddress_t, uint8_t)> &&callback){
@@ -328,17 +805,32 @@ public:
 
     // Низкоуровневая отправка без ACK и повторов (для служебных пакетов)
     bool send(const LoRaPacket &pkt) {
-        if (!outgoingQueue)
+        if (!outgoingQueue || !queueTxFrame(pkt, txClassOf(pkt), 0))
             return false;
-        return xQueueSendToBack(outgoingQueue, &pkt, 0) == pdTRUE;
+        credits.onQueued(pkt.getReceiverId(), pkt.payloadLen);
+        return true;
     }
 
     bool receive(LoRaPacket &pkt) {
-        if (!incomingQueue)
+        LoRaRxFrame frame;
+        if (!receive(frame))
             return false;
-        return xQueueReceive(incomingQueue, &pkt, 0) == pdTRUE;
+        pkt = frame.pkt;
+        return true;
     }
 
+    // Кадр с метками приёма: irqUs (ISR), RSSI, SNR. Для пакета из AGR или relay - метки
+    // кадра, который его принёс
+    bool receive(LoRaRxFrame &frame) {
+        if (!incomingQueue || xQueueReceive(incomingQueue, &frame, 0) != pdTRUE)
+            return false;
+        tracer.rxDelivered(frame.pkt.packetId, frame.pkt.getSenderId());
+        return true;
+    }
+
+    // micros() IRQ TX done последней передачи своего кадра с этим ID (0 - не передавался)
+    uint32_t getTxDoneUs(PacketId_t packetId) const { return txTimes.get(packetId); }
+
     // Получить текущий ID (без инкремента) - только для диагностики
     PacketId_t getCurrentPacketId() const {
         return nextPacketId;
@@ -355,6 +847,14 @@ public:
         sendBulkAck(targetDeviceId);
     }
 
+    // Интервал отправки bulk ACK вместо выбранного по профилю (0 = по профилю)
+    void setBulkAckInterval(unsigned long intervalMs);
+    unsigned long getBulkAckInterval() const { return BULK_ACK_INTERVAL_MS; }
+
+    // Включить/выключить автоматическую агрегацию мелких пакетов без ACK
+    void setAggregationEnabled(bool enabled) { aggregationEnabled = enabled; }
+    bool isAggregationEnabled() const { return aggregationEnabled; }
+
     // Проверить таймаут bulk ACK (вызывать в главном цикле)
     void processBulkAckTimeout(uint8_t targetDeviceId) {
         checkBulkAckTimeout(targetDeviceId);
@@ -388,10 +888,17 @@ public:
     }
 
     void clearPending() {
+        std::vector<PacketId_t> cleared;
         if (pendingMutex && xSemaphoreTake(pendingMutex, pdMS_TO_TICKS(1100)) == pdTRUE) {
+            for (const auto& p : pending) {
+                cleared.push_back(p.pkt.packetId);
+            }
             pending.clear();
             xSemaphoreGive(pendingMutex);
         }
+        for (PacketId_t id : cleared) {
+            sendEvent(id, SendEvent::CANCELLED);
+        }
     }
 
     size_t getLogBufferSize() const  {
@@ -413,15 +920,26 @@ public:
     }
 
     bool isHealthy() const {
-        return incomingQueue != nullptr && outgoingQueue != nullptr && radioSemaphore != nullptr && pendingMutex != nullptr;
+        return incomingQueue != nullptr && outgoingQueue != nullptr && radioQueue != nullptr && pendingMutex != nullptr;
     }
 
     size_t getIncomingQueueCount() const {
         return incomingQueue ? uxQueueMessagesWaiting(incomingQueue) : 0;
     }
 
+    // Все классы передачи вместе с кадрами, которые sendTask уже забрал в macBacklog
     size_t getOutgoingQueueCount() const {
-        return outgoingQueue ? uxQueueMessagesWaiting(outgoingQueue) : 0;
+        size_t count = macBacklogSize + fairQueueSize;
+        for (uint8_t i = 0; i < TX_CLASS_COUNT; i++) {
+            count += txQueues[i] ? uxQueueMessagesWaiting(txQueues[i]) : 0;
+        }
+        return count;
+    }
+
+    // Кадров в очереди класса (без macBacklog и очередей узлов sendTask)
+    size_t getTxClassCount(TxClass cls) const {
+        QueueHandle_t queue = txQueues[(uint8_t)cls];
+        return queue ? uxQueueMessagesWaiting(queue) : 0;
     }
 
     size_t getIncomingQueueFree() const {
@@ -502,18 +1020,26 @@ private:
     // Task wrappers - implemented in .cpp
     static void logTaskWrapper(void *param);
     static void receiveTaskWrapper(void *param);
+    static void radioTaskWrapper(void *param);
     static void sendTaskWrapper(void *param);
     static void resendTaskWrapper(void *param);
     static void processAsaProfileSwitchWrapper(void *param);
+    static void routeTaskWrapper(void *param);
+    static void transferTaskWrapper(void *param);
+    static void completionTaskWrapper(void *param);
 
     void updateRetryParameters();
+    int startReceiveMode();
+    void openRxWindow();
+    void closeRxWindowIfExpired();
     bool applyLoRa(const LoRaProfile *p);
     bool applyFSK(const FSKProfile *p);
     bool switchTo(RadioMode m);
     // ACK handling methods
-    void handleAck(const LoRaPacket *pkt);
-    void handleBulkAck(const LoRaPacket *pkt);
-    void handleSingleAck(PacketId_t ackedId, LoraAddress_t senderId, uint8_t packetType);
+    // irqUs - IRQ приёма кадра с ACK (0 - неизвестно)
+    void handleAck(const LoRaPacket *pkt, uint32_t irqUs = 0);
+    void handleBulkAck(const LoRaPacket *pkt, uint32_t irqUs = 0);
+    void handleSingleAck(PacketId_t ackedId, LoraAddress_t senderId, uint8_t packetType, uint32_t irqUs = 0);
     
     // Bulk ACK methods
     void addToBulkAck(PacketId_t packetId, uint8_t targetDeviceId);
@@ -526,9 +1052,131 @@ private:
     // Task implementations
     void logTask();
     void receiveTask();
+    // Задача-владелец радио: IRQ, команды из radioQueue, закрытие окна RX. Радио трогает только она
+    void radioTask();
+    // Выполнить команду в задаче радио и дождаться результата. До begin() и из самой задачи
+    // радио - напрямую. false - очередь команд не освободилась за waitTicks.
+    // whileOnAir (TRANSMIT) выполняется в вызывающей задаче, пока кадр в эфире
+    bool radioCall(RadioCommand &cmd, int &result, TickType_t waitTicks = portMAX_DELAY,
+                   const std::function<void()> &whileOnAir = nullptr);
+    int executeRadioCommand(const RadioCommand &cmd);
+    int radioTransmit(const RadioCommand &cmd);
+    void radioApplySettings(int sf, int cr, float bw);
+    bool radioApplyProfile(uint8_t profileIndex);
+    int radioSetLowPowerRx(bool enabled);
+    void sendLowPowerNotice(bool enabled);          // Адресату по умолчанию: свой режим RX
+    void onLowPowerNotice(const LoRaPacket &pkt);   // receiveTask: режим RX соседа и ACK
+    int radioScanChannel();
+    // Кадр из буфера радио - в rxDrainQueue. Задача радио вызывает до любой операции с радио
+    void drainRxFrame();
     void sendTask();
+    static uint32_t sendPacingMs(unsigned long txDuration);
     void resendTask();
-    int transmitPacket(const LoRaPacket *txPkt, const size_t len);
+    int transmitPacket(const LoRaPacket *txPkt, const size_t len, const std::function<void()> &whileOnAir = nullptr,
+                       uint8_t *timeTrailer = nullptr);
+    // queued = false - кадр MAC (опрос, ответ, маяк), не из outgoingQueue: кредит не меняется
+    int sendFrame(const LoRaPacket &pkt, unsigned long &txDuration, bool queued = true);
+    void emitTrace(const LoRaPacketTrace &trace);
+
+    // Relay
+    void routeTask();
+    bool startRouteTask();
+    void sendRouteAdvert();
+    LoraAddress_t findNextHop(LoraAddress_t destination);
+    void learnRoute(LoraAddress_t destination, LoraAddress_t nextHop, uint8_t hops);
+    void learnFromFrame(const LoRaPacket &pkt);
+    bool handleRelayFrame(LoRaPacket &pkt);     // true - кадр для нас, pkt распакован
+    void rerouteFrame(LoRaPacket &frame);
+    uint8_t frameHops(const LoRaPacket &frame);  // Передач до получателя: множитель retry timeout
+
+    // TDMA
+    bool tdmaSendStep();                        // false - slave без маяков, sendTask работает как без TDMA
+    uint32_t tdmaBacklogDemandMs(uint32_t guardUs) const;
+    void sendTdmaBeacon();
+    bool sendTdmaRequest(LoraAddress_t master, uint32_t demandMs);
+    void tdmaWaitUntil(uint32_t atUs, uint32_t maxWaitMs);
+    void onTdmaBeacon(const LoRaPacket &pkt, uint32_t irqUs);
+    void onTdmaFrameHeard(const LoRaPacket &pkt);
+
+    // Сетевое время
+    uint8_t timeStratum();
+    void onTimeTrailer(LoRaPacket &pkt, uint32_t irqUs);  // Снимает метку с кадра
+
+    // Duty cycle: ожидание бюджета для кадра airtimeUs, UINT32_MAX - не поместится никогда
+    uint32_t dutyCycleWaitMs(uint32_t airtimeUs);
+    // Эфир кадра, как его передаст задача радио: длинная преамбула и метка heartbeat учтены
+    uint32_t txAirtimeUs(const LoRaPacket &pkt);
+
+    // Управление мощностью
+    int8_t txPowerFor(const LoRaPacket &pkt);   // Мощность кадра; запоминается для отчёта о нём
+    void txPowerFeedback(LoraAddress_t peer, bool delivered);
+    void onLinkReport(const LoRaPacket &pkt);
+    void sendLinkReportIfDue(const LoRaPacket &pkt, float rssi, float snr);
+    void resetTxPower();                        // Смена профиля: запас по старому SF недействителен
+
+    // MTU
+    void setPeerMtu(LoraAddress_t peer, uint8_t profile, uint8_t mtu);
+    uint8_t maxMtu();                           // Наибольший MTU к узлам на текущем профиле: длинный кадр
+    bool isMtuPeer(LoraAddress_t peer);         // Узел понимает ASA в 2 байта
+    void addMtuPeer(LoraAddress_t peer);
+
+    // Polling
+    bool pollSendStep();                        // false - опросов нет, sendTask работает как без polling
+    bool pollMasterStep();
+    bool pollSlaveStep();
+    void sendPollReply(LoraAddress_t master);
+    void onPollFrame(const LoRaRxFrame &rx);    // Опрос (slave) или ответ (master)
+    std::vector<LoraAddress_t> activePollClients();
+    static bool isPollAggregatable(const LoRaPacket &pkt, LoraAddress_t master, uint8_t mtu);
+
+    // Block transfer
+    bool startTransferTask();
+    void transferTask();
+    void onTransferFrame(const LoRaPacket &pkt);
+    void transferSendStep();
+    void checkTransferEvents();
+    void boostTransferProfile(LoraAddress_t peer);
+
+    // Асинхронная отправка
+    // coalesce != nullptr - образец канала sendPacketLatest()
+    SendStatus enqueuePacket(LoraAddress_t receiverId, PacketBase *base, const uint8_t *payload, SendHandle_t handle,
+                             bool wait, PacketId_t &packetId, const LoRaCoalesceTarget *coalesce = nullptr);
+    bool replaceQueuedFrame(PacketId_t oldId, const LoRaPacket &frame);
+    void restoreQueuedFrame(const LoRaPacket &pkt);
+    bool aggregateQueued(LoraAddress_t receiverId, const PacketBase *base, const uint8_t *payload, uint8_t mtu,
+                         LoRaPacket &agrFrame, PacketId_t &agrId);
+    bool buildMergedAgr(const LoRaPacket &pkt, const PacketBase *base, const uint8_t *payload, uint8_t mtu,
+                        LoRaPacket &agrFrame);
+    bool expireFrame(const LoRaPacket &pkt);        // true - срок истёк, кадр снят
+
+    // Классы передачи: очередь класса и пробуждение sendTask
+    bool queueTxFrame(const LoRaPacket &pkt, TxClass cls, TickType_t waitTicks, bool front = false);
+    bool takeTxFrame(LoRaPacket &pkt, TickType_t waitTicks);
+    void stageFairFrames();
+    // false - к узлу LORA_PEER_QUEUE_QUOTA кадров и за waitTicks не освободилось
+    bool waitPeerQuota(LoraAddress_t peer, TickType_t waitTicks);
+    void wakeSendTask() {
+        if (senderTaskHandle) {
+            xTaskNotifyGive(senderTaskHandle);
+        }
+    }
+    bool startCompletionTask();
+    void completionTask();
+    void bindCompletion(SendHandle_t handle, PacketId_t packetId, bool waitAck);
+    void completeSend(SendHandle_t handle, SendResult result);
+    void sendEvent(PacketId_t packetId, SendEvent event);
+
+    // macBacklog: общая очередь sendTask для TDMA, polling и кадров со сроком
+    void pullMacBacklog();
+    bool sendsBefore(const LoRaPacket &a, const LoRaPacket &b) const;
+    uint32_t frameAirtimeUs(const LoRaPacket &pkt) const {
+        return profileTimeOnAirUs(currentProfileIndex, offsetof(LoRaPacket, payload) + pkt.payloadLen);
+    }
+
+    // Пересылаемый чужой кадр: его id принадлежит origin, трассировка его не касается
+    bool isForwardedFrame(const LoRaPacket &pkt) const {
+        return pkt.packetType == CMD_RELAY && pkt.payloadLen >= LORA_RELAY_HEADER_SIZE && pkt.payload[0] != srcAddress;
+    }
 
     static PacketBase PacketBaseFromLoRa(const LoRaPacket *pkt)
     {
@@ -0,0 +1,219 @@
+// lora_airtime.cpp - Airtime ledger: EU868 sub-band duty cycle, airtime per peer and packet type
+#include "lora_airtime.hpp"
+#include <algorithm>
+#include <vector>
+
+// Последний - общий 0.1% между поддиапазонами: ищется после остальных
+static const LoRaSubBand SUB_BANDS[LORA_SUBBAND_COUNT] = {
+    {"863.0-865.0", 863.0f, 865.0f, 10},
+    {"865.0-868.0", 865.0f, 868.0f, 100},
+    {"868.0-868.6", 868.0f, 868.6f, 100},
+    {"868.7-869.2", 868.7f, 869.2f, 10},
+    {"869.4-869.65", 869.4f, 869.65f, 1000},
+    {"869.7-870.0", 869.7f, 870.0f, 100},
+    {"863.0-870.0", 863.0f, 870.0f, 10},
+};
+
+const LoRaSubBand *loraSubBandFor(float freqMHz)
+{
+    for (const LoRaSubBand &band : SUB_BANDS) {
+        if (freqMHz >= band.lowMHz && freqMHz < band.highMHz) {
+            return &band;
+        }
+    }
+    return nullptr;
+}
+
+static String dutyPercent(uint16_t dutyBp)
+{
+    return String(dutyBp / 100.0f, dutyBp % 100 ? 1 : 0) + "%";
+}
+
+String LoRaAirtimeBudget::toString() const
+{
+    if (!band) {
+        return String("not regulated: used ") + String((unsigned long)(usedUs / 1000)) + " ms";
+    }
+    char s[120];
+    snprintf(s, sizeof(s), "%s MHz %s: used %lu of %lu ms (%.1f%%), left %lu ms, %s", band->name,
+             dutyPercent(band->dutyBp).c_str(), (unsigned long)(usedUs / 1000), (unsigned long)(budgetUs / 1000),
+             budgetUs ? 100.0f * usedUs / budgetUs : 0.0f, (unsigned long)(remainingUs() / 1000),
+             enforced ? "enforced" : "not enforced");
+    return String(s);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// WINDOW
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaAirtimeWindow::advance(uint32_t nowMs)
+{
+    if (!started) {
+        started = true;
+        headStartMs = nowMs;
+        return;
+    }
+    uint32_t elapsed = nowMs - headStartMs;
+    if (elapsed < BUCKET_MS) {
+        return;
+    }
+    uint32_t steps = elapsed / BUCKET_MS;
+    headStartMs += steps * BUCKET_MS;
+    if (steps >= SLOTS) {
+        std::fill(buckets, buckets + SLOTS, 0);
+        return;
+    }
+    while (steps--) {
+        head = (head + 1) % SLOTS;
+        buckets[head] = 0;
+    }
+}
+
+void LoRaAirtimeWindow::add(uint32_t nowMs, uint32_t airtimeUs)
+{
+    advance(nowMs);
+    buckets[head] += airtimeUs;
+}
+
+uint32_t LoRaAirtimeWindow::used(uint32_t nowMs)
+{
+    advance(nowMs);
+    uint32_t total = 0;
+    for (uint32_t us : buckets) {
+        total += us;
+    }
+    return total;
+}
+
+uint32_t LoRaAirtimeWindow::waitMs(uint32_t nowMs, uint32_t airtimeUs, uint32_t budgetUs)
+{
+    if (airtimeUs > budgetUs) {
+        return UINT32_MAX;
+    }
+    uint32_t total = used(nowMs);
+    if (total <= budgetUs - airtimeUs) {
+        return 0;
+    }
+    uint32_t excess = total - (budgetUs - airtimeUs);
+    // От старой корзины к новой: корзина k от старой уходит из суммы в headStartMs + (k + 1) * BUCKET_MS
+    uint32_t freed = 0;
+    for (uint8_t k = 0; k < SLOTS; k++) {
+        freed += buckets[(head + 1 + k) % SLOTS];
+        if (freed >= excess) {
+            return headStartMs + (k + 1) * BUCKET_MS - nowMs;
+        }
+    }
+    return UINT32_MAX;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LEDGER
+// ═══════════════════════════════════════════════════════════════════════════
+LoRaAirtimeWindow *LoRaAirtimeLedger::bandWindow(float freqMHz)
+{
+    const LoRaSubBand *band = loraSubBandFor(freqMHz);
+    return &bands[band ? band - SUB_BANDS : LORA_SUBBAND_COUNT];
+}
+
+// Новый ключ при полной таблице вытесняет ключ с наименьшим эфиром в окне
+template <typename Key>
+void LoRaAirtimeLedger::addKeyed(std::map<Key, LoRaAirtimeWindow> &windows, Key key, size_t limit, uint32_t nowMs,
+                                 uint32_t airtimeUs)
+{
+    auto it = windows.find(key);
+    if (it == windows.end()) {
+        if (windows.size() >= limit) {
+            auto victim = windows.begin();
+            uint32_t victimUs = UINT32_MAX;
+            for (auto w = windows.begin(); w != windows.end(); ++w) {
+                uint32_t us = w->second.used(nowMs);
+                if (us < victimUs) {
+                    victim = w;
+                    victimUs = us;
+                }
+            }
+            windows.erase(victim);
+        }
+        it = windows.emplace(key, LoRaAirtimeWindow()).first;
+    }
+    it->second.add(nowMs, airtimeUs);
+}
+
+void LoRaAirtimeLedger::record(uint32_t nowMs, float freqMHz, LoraAddress_t peer, uint8_t packetType,
+                               uint32_t airtimeUs)
+{
+    bandWindow(freqMHz)->add(nowMs, airtimeUs);
+    addKeyed(peers, peer, LORA_DUTY_CYCLE_MAX_PEERS, nowMs, airtimeUs);
+    addKeyed(types, packetType, LORA_DUTY_CYCLE_MAX_TYPES, nowMs, airtimeUs);
+}
+
+uint32_t LoRaAirtimeLedger::waitMs(uint32_t nowMs, float freqMHz, uint32_t airtimeUs)
+{
+    const LoRaSubBand *band = loraSubBandFor(freqMHz);
+    if (!band) {
+        return 0;
+    }
+    return bandWindow(freqMHz)->waitMs(nowMs, airtimeUs, band->budgetUs());
+}
+
+LoRaAirtimeBudget LoRaAirtimeLedger::budget(uint32_t nowMs, float freqMHz)
+{
+    LoRaAirtimeBudget out;
+    out.band = loraSubBandFor(freqMHz);
+    out.usedUs = bandWindow(freqMHz)->used(nowMs);
+    out.budgetUs = out.band ? out.band->budgetUs() : 0;
+    return out;
+}
+
+String LoRaAirtimeLedger::toString(uint32_t nowMs)
+{
+    String info = String("Airtime in last ") + String((unsigned long)(LORA_DUTY_CYCLE_WINDOW_MS / 60000)) + " min:";
+    for (uint8_t i = 0; i <= LORA_SUBBAND_COUNT; i++) {
+        uint32_t us = bands[i].used(nowMs);
+        if (us == 0) {
+            continue;
+        }
+        info += "\n  ";
+        info += i < LORA_SUBBAND_COUNT ? String(SUB_BANDS[i].name) + " MHz " + dutyPercent(SUB_BANDS[i].dutyBp)
+                                       : String("not regulated");
+        info += ": " + String((unsigned long)(us / 1000)) + " ms";
+        if (i < LORA_SUBBAND_COUNT) {
+            info += " of " + String((unsigned long)(SUB_BANDS[i].budgetUs() / 1000)) + " ms";
+        }
+    }
+
+    std::vector<std::pair<uint32_t, LoraAddress_t>> byPeer;
+    for (auto &entry : peers) {
+        uint32_t us = entry.second.used(nowMs);
+        if (us) {
+            byPeer.push_back({us, entry.first});
+        }
+    }
+    std::sort(byPeer.rbegin(), byPeer.rend());
+    info += "\n  Peers:";
+    for (const auto &p : byPeer) {
+        info += " " + String(p.second) + "=" + String((unsigned long)(p.first / 1000)) + "ms";
+    }
+
+    std::vector<std::pair<uint32_t, uint8_t>> byType;
+    for (auto &entry : types) {
+        uint32_t us = entry.second.used(nowMs);
+        if (us) {
+            byType.push_back({us, entry.first});
+        }
+    }
+    std::sort(byType.rbegin(), byType.rend());
+    info += "\n  Types:";
+    for (const auto &t : byType) {
+        info += " " + String(t.second) + "=" + String((unsigned long)(t.first / 1000)) + "ms";
+    }
+    return info;
+}
+
+void LoRaAirtimeLedger::reset()
+{
+    for (LoRaAirtimeWindow &window : bands) {
+        window = LoRaAirtimeWindow();
+    }
+    peers.clear();
+    types.clear();
+}
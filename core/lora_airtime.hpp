@@ -0,0 +1,95 @@
+// lora_airtime.hpp - Airtime ledger: EU868 sub-band duty cycle, airtime per peer and packet type
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SUB-BANDS
+// ═══════════════════════════════════════════════════════════════════════════
+// Поддиапазон EU868 (ERC/REC 70-03, приложение 1, ETSI EN 300 220): доля эфира одного
+// передатчика в любом окне LORA_DUTY_CYCLE_WINDOW_MS
+struct LoRaSubBand
+{
+    const char *name;
+    float lowMHz;
+    float highMHz;
+    uint16_t dutyBp;                            // 1/10000: 10 = 0.1%, 100 = 1%, 1000 = 10%
+
+    uint32_t budgetUs() const { return (uint32_t)((uint64_t)LORA_DUTY_CYCLE_WINDOW_MS * dutyBp / 10); }
+};
+
+static constexpr uint8_t LORA_SUBBAND_COUNT = 7;
+
+// Поддиапазон по центральной частоте. Между поддиапазонами внутри 863-870 МГц - общий 0.1%,
+// вне 863-870 МГц - nullptr: ограничение не известно, эфир только учитывается
+const LoRaSubBand *loraSubBandFor(float freqMHz);
+
+// Бюджет поддиапазона текущей частоты (getAirtimeBudget())
+struct LoRaAirtimeBudget
+{
+    const LoRaSubBand *band = nullptr;          // nullptr - вне таблицы, без ограничения
+    uint32_t usedUs = 0;                        // Эфир в окне
+    uint32_t budgetUs = 0;
+    bool enforced = false;
+
+    uint32_t remainingUs() const { return usedUs < budgetUs ? budgetUs - usedUs : 0; }
+
+    // "863.0-865.0 MHz 0.1%: used 1234 of 3600 ms (34.3%), left 2366 ms, enforced"
+    String toString() const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// WINDOW
+// ═══════════════════════════════════════════════════════════════════════════
+// Эфир за последние LORA_DUTY_CYCLE_WINDOW_MS: кольцо из LORA_DUTY_CYCLE_BUCKETS корзин
+// и текущей. Корзина уходит из суммы, только когда её последняя передача старше окна:
+// сумма не меньше эфира в любом окне, кончающемся сейчас, запас - не больше одной корзины.
+class LoRaAirtimeWindow
+{
+public:
+    void add(uint32_t nowMs, uint32_t airtimeUs);
+    uint32_t used(uint32_t nowMs);
+    // Через сколько мс в бюджет поместится ещё airtimeUs: 0 - сейчас, UINT32_MAX - никогда
+    uint32_t waitMs(uint32_t nowMs, uint32_t airtimeUs, uint32_t budgetUs);
+
+private:
+    static constexpr uint32_t BUCKET_MS = LORA_DUTY_CYCLE_WINDOW_MS / LORA_DUTY_CYCLE_BUCKETS;
+    static constexpr uint8_t SLOTS = LORA_DUTY_CYCLE_BUCKETS + 1;
+
+    void advance(uint32_t nowMs);
+
+    uint32_t buckets[SLOTS] = {};
+    uint8_t head = 0;                           // Текущая корзина
+    uint32_t headStartMs = 0;
+    bool started = false;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LEDGER
+// ═══════════════════════════════════════════════════════════════════════════
+// Окна эфира по поддиапазону, узлу-получателю и типу кадра. Ограничивает только поддиапазон:
+// узлы и типы - для отчёта. Без блокировок: LoRaCore держит учёт под airtimeMutex.
+class LoRaAirtimeLedger
+{
+public:
+    void record(uint32_t nowMs, float freqMHz, LoraAddress_t peer, uint8_t packetType, uint32_t airtimeUs);
+
+    // Ожидание бюджета поддиапазона для кадра airtimeUs, вне таблицы - 0
+    uint32_t waitMs(uint32_t nowMs, float freqMHz, uint32_t airtimeUs);
+    LoRaAirtimeBudget budget(uint32_t nowMs, float freqMHz);
+
+    // Поддиапазоны с эфиром в окне, затем узлы и типы по убыванию эфира
+    String toString(uint32_t nowMs);
+    void reset();
+
+private:
+    LoRaAirtimeWindow *bandWindow(float freqMHz);
+    template <typename Key>
+    static void addKeyed(std::map<Key, LoRaAirtimeWindow> &windows, Key key, size_t limit, uint32_t nowMs,
+                         uint32_t airtimeUs);
+
+    LoRaAirtimeWindow bands[LORA_SUBBAND_COUNT + 1]; // Последнее - вне таблицы
+    std::map<LoraAddress_t, LoRaAirtimeWindow> peers;
+    std::map<uint8_t, LoRaAirtimeWindow> types;
+};
@@ -0,0 +1,55 @@
+// lora_coalesce.cpp - Latest-value-wins channels: newest sample per (destination, key)
+#include "lora_coalesce.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+bool LoRaCoalesceTable::find(LoraAddress_t destination, uint8_t key, PacketId_t &packetId) const
+{
+    for (const Entry &entry : entries) {
+        if (entry.used && entry.destination == destination && entry.key == key) {
+            packetId = entry.packetId;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoRaCoalesceTable::set(LoraAddress_t destination, uint8_t key, PacketId_t packetId, unsigned long nowMs)
+{
+    Entry *slot = nullptr;
+    for (Entry &entry : entries) {
+        if (entry.used && entry.destination == destination && entry.key == key) {
+            slot = &entry;
+            break;
+        }
+        if (!entry.used) {
+            if (!slot || slot->used) {
+                slot = &entry;
+            }
+        } else if (!slot || (slot->used && (long)(entry.updatedMs - slot->updatedMs) < 0)) {
+            slot = &entry;
+        }
+    }
+    slot->destination = destination;
+    slot->key = key;
+    slot->packetId = packetId;
+    slot->used = true;
+    slot->updatedMs = nowMs;
+}
+
+void LoRaCoalesceTable::clear()
+{
+    for (Entry &entry : entries) {
+        entry.used = false;
+    }
+}
+
+size_t LoRaCoalesceTable::size() const
+{
+    size_t count = 0;
+    for (const Entry &entry : entries) {
+        count += entry.used ? 1 : 0;
+    }
+    return count;
+}
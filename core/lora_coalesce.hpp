@@ -0,0 +1,37 @@
+// lora_coalesce.hpp - Latest-value-wins channels: newest sample per (destination, key)
+#pragma once
+#include <Arduino.h>
+#include "lora_config.h"
+
+// Образец, который заменяет новый кадр канала (found = false - предыдущего нет)
+struct LoRaCoalesceTarget
+{
+    bool found = false;
+    PacketId_t packetId = 0;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+// Канал sendPacketLatest(): (получатель, ключ) -> ID последнего поставленного кадра.
+// По этому ID LoRaCore находит старый образец в outgoingQueue или pending и заменяет его.
+// Переполнение вытесняет канал, обновлявшийся давнее всех. Без блокировок: LoRaCore держит под мьютексом.
+class LoRaCoalesceTable
+{
+public:
+    bool find(LoraAddress_t destination, uint8_t key, PacketId_t &packetId) const;
+    void set(LoraAddress_t destination, uint8_t key, PacketId_t packetId, unsigned long nowMs);
+    void clear();
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        LoraAddress_t destination;
+        uint8_t key;
+        PacketId_t packetId;
+        bool used;
+        unsigned long updatedMs;
+    };
+    Entry entries[LORA_COALESCE_MAX] = {};
+};
@@ -0,0 +1,128 @@
+// lora_completion.cpp - Async send: per-message completion tracking
+#include "lora_completion.hpp"
+
+const char *sendResultName(SendResult result)
+{
+    switch (result) {
+    case SendResult::DELIVERED:  return "delivered";
+    case SendResult::SENT:       return "sent";
+    case SendResult::DROPPED:    return "dropped";
+    case SendResult::EXPIRED:    return "expired";
+    case SendResult::QUEUE_FULL: return "queue full";
+    case SendResult::CANCELLED:  return "cancelled";
+    case SendResult::TOO_LARGE:  return "too large";
+    default:                     return "?";
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRACKER
+// ═══════════════════════════════════════════════════════════════════════════
+SendHandle_t LoRaCompletionTracker::add(LoraAddress_t receiver, SendCallback &&callback, unsigned long nowMs,
+                                        uint32_t timeoutMs)
+{
+    if (active.size() >= LORA_SEND_TRACK_MAX) {
+        return 0;
+    }
+    if (++lastHandle == 0) {
+        ++lastHandle;
+    }
+    Entry entry;
+    entry.handle = lastHandle;
+    entry.packetId = 0;
+    entry.receiver = receiver;
+    entry.bound = false;
+    entry.waitAck = false;
+    entry.startedMs = nowMs;
+    entry.deadlineMs = timeoutMs ? (nowMs + timeoutMs) | 1 : 0;
+    entry.callback = std::move(callback);
+    active.push_back(std::move(entry));
+    return lastHandle;
+}
+
+void LoRaCompletionTracker::bind(SendHandle_t handle, PacketId_t packetId, bool waitAck)
+{
+    for (auto &entry : active) {
+        if (entry.handle == handle) {
+            entry.packetId = packetId;
+            entry.bound = true;
+            entry.waitAck = waitAck;
+            return;
+        }
+    }
+}
+
+void LoRaCompletionTracker::complete(SendHandle_t handle, SendResult result, unsigned long nowMs)
+{
+    for (size_t i = 0; i < active.size(); i++) {
+        if (active[i].handle == handle) {
+            finish(i, result, nowMs);
+            return;
+        }
+    }
+}
+
+uint8_t LoRaCompletionTracker::onEvent(PacketId_t packetId, SendEvent event, unsigned long nowMs)
+{
+    uint8_t finished = 0;
+    for (size_t i = 0; i < active.size();) {
+        const Entry &entry = active[i];
+        if (!entry.bound || entry.packetId != packetId) {
+            i++;
+            continue;
+        }
+        // Кадр с ACK передаётся повторно: итог только по ACK, max retries или снятию с pending
+        bool hit = true;
+        SendResult result = SendResult::SENT;
+        switch (event) {
+        case SendEvent::TRANSMITTED: hit = !entry.waitAck; result = SendResult::SENT; break;
+        case SendEvent::TX_FAILED:   hit = !entry.waitAck; result = SendResult::DROPPED; break;
+        case SendEvent::ACKED:       hit = entry.waitAck;  result = SendResult::DELIVERED; break;
+        case SendEvent::DROPPED:     hit = entry.waitAck;  result = SendResult::DROPPED; break;
+        case SendEvent::CANCELLED:   hit = entry.waitAck;  result = SendResult::CANCELLED; break;
+        case SendEvent::EXPIRED:     hit = true;           result = SendResult::EXPIRED; break;
+        }
+        if (!hit) {
+            i++;
+            continue;
+        }
+        finish(i, result, nowMs);
+        finished++;
+    }
+    return finished;
+}
+
+void LoRaCompletionTracker::expire(unsigned long nowMs, std::vector<PacketId_t> &expiredAck)
+{
+    for (size_t i = 0; i < active.size();) {
+        const Entry &entry = active[i];
+        if (!entry.deadlineMs || (long)(nowMs - entry.deadlineMs) < 0) {
+            i++;
+            continue;
+        }
+        if (entry.bound && entry.waitAck) {
+            expiredAck.push_back(entry.packetId);
+        }
+        finish(i, SendResult::EXPIRED, nowMs);
+    }
+}
+
+void LoRaCompletionTracker::take(std::vector<LoRaSendCompletion> &out)
+{
+    out.clear();
+    out.swap(done);
+}
+
+void LoRaCompletionTracker::finish(size_t index, SendResult result, unsigned long nowMs)
+{
+    Entry &entry = active[index];
+    LoRaSendCompletion completion;
+    completion.handle = entry.handle;
+    completion.packetId = entry.packetId;
+    completion.receiver = entry.receiver;
+    completion.result = result;
+    completion.elapsedMs = nowMs - entry.startedMs;
+    completion.callback = std::move(entry.callback);
+    done.push_back(std::move(completion));
+    active.erase(active.begin() + index);
+}
@@ -0,0 +1,92 @@
+// lora_completion.hpp - Async send: per-message completion tracking
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RESULT
+// ═══════════════════════════════════════════════════════════════════════════
+enum class SendResult : uint8_t
+{
+    DELIVERED,      // ACK получен
+    SENT,           // Кадр без ACK передан в эфир
+    DROPPED,        // Нет ACK после всех повторов или ошибка передачи кадра без ACK
+    EXPIRED,        // Срок timeoutMs или PacketBase::ttlMs истёк до ACK или передачи
+    QUEUE_FULL,     // outgoingQueue переполнена, кадр не поставлен
+    CANCELLED,      // removePendingPacket() / clearPending()
+    TOO_LARGE       // payload больше MTU узла, кадр не поставлен
+};
+
+const char *sendResultName(SendResult result);
+
+// Номер асинхронной отправки: в отличие от PacketId_t не повторяется. 0 - отправка не принята
+typedef uint32_t SendHandle_t;
+using SendCallback = std::function<void(SendHandle_t, SendResult)>;
+
+// Событие кадра packetId из задач LoRaCore
+enum class SendEvent : uint8_t
+{
+    TRANSMITTED,    // Кадр (или AGR / ответ на опрос, куда он вложен) ушёл в эфир
+    TX_FAILED,
+    ACKED,
+    DROPPED,        // Max retries
+    CANCELLED,      // Снят с pending
+    EXPIRED         // Истёк PacketBase::ttlMs: снят с очереди или pending
+};
+
+struct LoRaSendCompletion
+{
+    SendHandle_t handle = 0;
+    PacketId_t packetId = 0;
+    LoraAddress_t receiver = 0;
+    SendResult result = SendResult::SENT;
+    uint32_t elapsedMs = 0;
+    SendCallback callback;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRACKER
+// ═══════════════════════════════════════════════════════════════════════════
+// Отправки в ожидании итога и готовые итоги. Запись привязана к ID кадра, в котором едет
+// сообщение: своему, AGR после слияния. Итоги забирает задача завершений и вызывает
+// callback вне блокировок. Без блокировок: LoRaCore держит его под completionMutex.
+class LoRaCompletionTracker
+{
+public:
+    // Новая отправка, timeoutMs = 0 - без срока. Возвращает 0, если занято LORA_SEND_TRACK_MAX записей
+    SendHandle_t add(LoraAddress_t receiver, SendCallback &&callback, unsigned long nowMs, uint32_t timeoutMs);
+    // Сообщение едет в кадре packetId; waitAck - итог по ACK, иначе по передаче
+    void bind(SendHandle_t handle, PacketId_t packetId, bool waitAck);
+    void complete(SendHandle_t handle, SendResult result, unsigned long nowMs);
+
+    // Событие кадра для всех привязанных к нему записей. Возвращает число завершённых
+    uint8_t onEvent(PacketId_t packetId, SendEvent event, unsigned long nowMs);
+    // Завершить записи с истёкшим сроком (EXPIRED). ID кадров с ACK - в expiredAck: снять с pending
+    void expire(unsigned long nowMs, std::vector<PacketId_t> &expiredAck);
+
+    // Забрать готовые итоги
+    void take(std::vector<LoRaSendCompletion> &out);
+    bool hasCompleted() const { return !done.empty(); }
+    size_t activeCount() const { return active.size(); }
+
+private:
+    struct Entry
+    {
+        SendHandle_t handle;
+        PacketId_t packetId;
+        LoraAddress_t receiver;
+        bool bound;
+        bool waitAck;
+        unsigned long startedMs;
+        unsigned long deadlineMs;   // 0 - без срока
+        SendCallback callback;
+    };
+
+    void finish(size_t index, SendResult result, unsigned long nowMs);
+
+    std::vector<Entry> active;
+    std::vector<LoRaSendCompletion> done;
+    SendHandle_t lastHandle = 0;
+};
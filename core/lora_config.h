@@ -8,7 +8,10 @@
 typedef uint8_t PacketId_t;
 typedef uint8_t LoraAddress_t;
 
-static constexpr size_t MAX_LORA_PAYLOAD = 85;
+// Буфер payload кадра в очередях и pending: FIFO SX1262 (255 байт) минус заголовок LoRaPacket
+static constexpr size_t MAX_LORA_PAYLOAD = 249;
+// MTU без согласования (docs/MTU.md): broadcast, узлы без обмена ASA, прошивки без MTU профиля
+static constexpr uint8_t LORA_BASE_MTU = 85;
 
 // ═══════════════════════════════════════════════════════════════════════════
 // PROFILE CONFIGURATION
@@ -29,22 +32,23 @@ static constexpr struct {
     int codingRate;            // 5–8 (LoRa only, 0 for GFSK)
     uint32_t bitrate;          // bit/s (GFSK only, 0 for LoRa)
     uint32_t deviation;        // Hz (GFSK only, 0 for LoRa)
+    uint8_t mtu;               // Payload кадра: кадр до ~200 мс в эфире, не меньше LORA_BASE_MTU
 } loraProfiles[LORA_PROFILE_COUNT] = {
     // LoRa profiles (0-8): от максимально надёжного до быстрого
-    {RadioProfileMode::LORA, 125.0, 12, 7, 0, 0},      // 0: Maximum reliability (very slow, max range)
-    {RadioProfileMode::LORA, 125.0, 11, 7, 0, 0},      // 1: Very good stability
-    {RadioProfileMode::LORA, 125.0, 10, 7, 0, 0},      // 2: Reliable compromise
-    {RadioProfileMode::LORA, 250.0,  9, 6, 0, 0},      // 3: Medium mode (urban)
-    {RadioProfileMode::LORA, 250.0,  8, 6, 0, 0},      // 4: Medium, open terrain
-    {RadioProfileMode::LORA, 250.0,  7, 5, 0, 0},      // 5: Fast with good signal
-    {RadioProfileMode::LORA, 500.0,  9, 5, 0, 0},      // 6: Speed + range
-    {RadioProfileMode::LORA, 500.0,  8, 5, 0, 0},      // 7: Very fast, LOS preferred
-    {RadioProfileMode::LORA, 500.0,  7, 5, 0, 0},      // 8: Maximum LoRa speed
+    {RadioProfileMode::LORA, 125.0, 12, 7, 0, 0, 85},      // 0: Maximum reliability (very slow, max range)
+    {RadioProfileMode::LORA, 125.0, 11, 7, 0, 0, 85},      // 1: Very good stability
+    {RadioProfileMode::LORA, 125.0, 10, 7, 0, 0, 85},      // 2: Reliable compromise
+    {RadioProfileMode::LORA, 250.0,  9, 6, 0, 0, 85},      // 3: Medium mode (urban)
+    {RadioProfileMode::LORA, 250.0,  8, 6, 0, 0, 108},     // 4: Medium, open terrain
+    {RadioProfileMode::LORA, 250.0,  7, 5, 0, 0, 249},     // 5: Fast with good signal
+    {RadioProfileMode::LORA, 500.0,  9, 5, 0, 0, 150},     // 6: Speed + range
+    {RadioProfileMode::LORA, 500.0,  8, 5, 0, 0, 249},     // 7: Very fast, LOS preferred
+    {RadioProfileMode::LORA, 500.0,  7, 5, 0, 0, 249},     // 8: Maximum LoRa speed
     // GFSK profiles (9-12): SX1262/RadioLib supports GFSK
-    {RadioProfileMode::FSK, 117.3, 0, 0, 19200, 10000}, // 9: GFSK standard
-    {RadioProfileMode::FSK, 156.2, 0, 0, 38400, 20000}, // 10: GFSK medium  
-    {RadioProfileMode::FSK, 187.2, 0, 0, 50000, 25000}, // 11: GFSK fast 
-    {RadioProfileMode::FSK, 234.3, 0, 0, 100000, 50000} // 12: GFSK maximum speed
+    {RadioProfileMode::FSK, 117.3, 0, 0, 19200, 10000, 249}, // 9: GFSK standard
+    {RadioProfileMode::FSK, 156.2, 0, 0, 38400, 20000, 249}, // 10: GFSK medium  
+    {RadioProfileMode::FSK, 187.2, 0, 0, 50000, 25000, 249}, // 11: GFSK fast 
+    {RadioProfileMode::FSK, 234.3, 0, 0, 100000, 50000, 249} // 12: GFSK maximum speed
 };
 
 // Extended RSSI mapping table: RSSI >= X → profile Y (including FSK)
@@ -94,12 +98,169 @@ constexpr size_t rssiProfileCount = sizeof(rssiToProfileTable) / sizeof(rssiToPr
 #define LORA_SYNC_WORD      0x16    // Must match on all devices
 #define LORA_TX_POWER       22      // dBm (max 22 for SX1262, check regional limits)
 #define LORA_PREAMBLE_LEN   8       // Preamble length (typically 8)
+#define LORA_TX_DONE_MARGIN_MS 200  // IRQ TX done не пришёл за 2x расчётного эфира + запас - ошибка передачи
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LOW-POWER RX (RX duty-cycle / sniff)
+// ═══════════════════════════════════════════════════════════════════════════
+// Приёмник спит (sleepSymbols = WAKE_PREAMBLE - 2*MIN_SYMBOLS) и просыпается на ~MIN_SYMBOLS+1
+// символов. При 96/8: окно ~9 символов, сон ~80 → ток RX падает примерно в 10 раз.
+// Передатчик обязан слать длинную преамбулу узлам в этом режиме.
+#define LORA_WAKE_PREAMBLE_LEN      96      // Длинная преамбула для пробуждения duty-cycle приёмника
+#define LORA_RX_DUTY_MIN_SYMBOLS    8       // Символов преамбулы, нужных для детекции
+#define LORA_RX_WINDOW_MARGIN_MS    150      // Запас окна непрерывного RX после своей передачи
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RELAY / MESH
+// ═══════════════════════════════════════════════════════════════════════════
+// Ретрансляция включается на узле setRelayEnabled(true); маршруты учатся на всех узлах.
+#define LORA_RELAY_MAX_HOPS             4       // Пересылок на пути, включая первую передачу
+#define LORA_RELAY_DUP_WINDOW_MS        1000    // Окно подавления дублей; меньше минимального retry timeout
+#define LORA_ROUTE_TIMEOUT_MS           120000  // Выученный маршрут без подтверждения устаревает
+#define LORA_ROUTE_ADVERT_MIN_MS        2000    // Первый анонс и анонс после изменения таблицы
+#define LORA_ROUTE_ADVERT_INTERVAL_MS   30000   // Интервал анонсов в стабильной сети
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TDMA
+// ═══════════════════════════════════════════════════════════════════════════
+// Режим включается setTdmaRole(): master рассылает маяки с раскладкой суперкадра,
+// slave передают только в своём слоте. Без маяка slave работает как без TDMA.
+#define LORA_TDMA_GUARD_MS              20      // Перед каждым слотом и между кадрами в слоте
+#define LORA_TDMA_MIN_SLOT_BYTES        24      // Слот без заявки: запрос или короткий кадр
+#define LORA_TDMA_MAX_SLOT_FRAMES       4       // Кадров максимальной длины в самом длинном слоте
+#define LORA_TDMA_CONTENTION_FRAMES     3       // Позиций для запросов в слоте конкуренции
+#define LORA_TDMA_CONTENTION_PER_MEMBERS 4      // И ещё одна на каждые столько участников
+#define LORA_TDMA_JOIN_BACKOFF_MS       10000   // Backoff запроса входа не длиннее, при любом суперкадре
+#define LORA_TDMA_KEEPALIVE_SUPERFRAMES 8       // Молчащий slave напоминает о себе запросом
+#define LORA_TDMA_MEMBER_TIMEOUT        20      // Суперкадров без кадров от slave - слот снимается
+#define LORA_TDMA_SYNC_LOSS_SUPERFRAMES 3       // Без маяка дольше - slave теряет синхронизацию
+
+// ═══════════════════════════════════════════════════════════════════════════
+// POLLING
+// ═══════════════════════════════════════════════════════════════════════════
+// Режим включается setPollRole(): master по очереди опрашивает активных клиентов,
+// slave передаёт только в ответ на опрос. Без опросов slave работает как без polling.
+#define LORA_POLL_MASTER_FRAMES         4       // Своих кадров master между опросами
+#define LORA_POLL_MAX_BURST             4       // Опросов подряд одного slave, пока он ставит MORE
+#define LORA_POLL_MIN_CYCLE_MS          1000    // Обход не чаще: в тихой сети эфир свободен для новых slave
+#define LORA_POLL_REPLY_MARGIN_MS       40      // Ожидание ответа сверх эфира кадра в MTU узла
+#define LORA_POLL_CLIENT_TIMEOUT_MS     30000   // Клиент без кадров дольше - не опрашивается
+#define LORA_POLL_LOSS_CYCLES           3       // Slave без опроса дольше стольких циклов...
+#define LORA_POLL_LOSS_MIN_MS           5000    // ...но не меньше - передаёт сам
+
+// ═══════════════════════════════════════════════════════════════════════════
+// BLOCK TRANSFER
+// ═══════════════════════════════════════════════════════════════════════════
+// Передача файлов и прошивок startTransfer(): окно блоков, bitmap-отчёты, возобновление.
+#define LORA_XFER_BLOCK_SIZE            76      // Данных в кадре DATA: 4 + 76 помещается в relay (80)
+#define LORA_XFER_WINDOW_BLOCKS         32      // Блоков в полёте до подтверждения base
+#define LORA_XFER_STATUS_EVERY          8       // Получатель сам шлёт отчёт через столько новых блоков
+#define LORA_XFER_QUEUE_DEPTH           4       // Кадров передачи в исходящей очереди одновременно
+#define LORA_XFER_STATUS_MARGIN_MS      500     // Ожидание отчёта сверх эфира очереди и ответа
+#define LORA_XFER_OFFER_INTERVAL_MS     3000    // Повтор OFFER до первого отчёта и при потере связи
+#define LORA_XFER_STALL_MS              20000   // Без кадров собеседника - связь потеряна, пробы OFFER
+#define LORA_XFER_ABORT_MS              300000  // Без кадров собеседника - отправитель сдаётся
+#define LORA_XFER_RESUME_MS             600000  // Незавершённый приём ждёт возобновления
+#define LORA_XFER_PROFILE_SETTLE_MS     2000    // Пауза после смены профиля на время передачи
+#define LORA_XFER_RX_QUEUE_SIZE         8       // Очередь кадров CMD_TRANSFER к transferTask
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ASYNC SEND
+// ═══════════════════════════════════════════════════════════════════════════
+// sendPacketAsync(): итог каждой отправки - callback из задачи завершений, вне блокировок.
+#define LORA_SEND_TRACK_MAX             32      // Отправок в ожидании итога одновременно
+#define LORA_SEND_EXPIRE_CHECK_MS       100     // Период проверки сроков timeoutMs
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SEND CREDIT
+// ═══════════════════════════════════════════════════════════════════════════
+// getSendCredit(): окно кадров к одному узлу - сколько sendTask передаст за LORA_CREDIT_WINDOW_MS.
+#define LORA_CREDIT_WINDOW_MS           2000    // Очередь к узлу не длиннее этого времени эфира
+#define LORA_CREDIT_MIN_FRAMES          2       // Окно на медленных профилях
+#define LORA_CREDIT_MAX_FRAMES          16      // Окно на быстрых профилях
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LATEST-VALUE CHANNELS
+// ═══════════════════════════════════════════════════════════════════════════
+// sendPacketLatest(): новый образец (получатель, ключ) заменяет старый в очереди и pending.
+#define LORA_COALESCE_MAX               16      // Каналов одновременно, старейший вытесняется
+
+// ═══════════════════════════════════════════════════════════════════════════
+// FAIR QUEUEING
+// ═══════════════════════════════════════════════════════════════════════════
+// Повторы и данные делят эфир между узлами по DRR (lora_fair.hpp); очередь к узлу ограничена квотой.
+#define LORA_PEER_QUEUE_QUOTA           24      // Своих кадров к одному узлу во всех очередях
+#define LORA_FAIR_STAGE_FRAMES          12      // Кадров класса, забранных sendTask в очереди узлов
+#define LORA_RETRY_BURST                1       // Повторов узла подряд, дальше - кадр данных, если он есть
+#define LORA_PEER_QUOTA_WAIT_MS         2500    // Ожидание квоты блокирующей отправкой (highPriority - 100 мс)
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TIME SYNC
+// ═══════════════════════════════════════════════════════════════════════════
+// Сетевое время (lora_timesync.hpp): метки в heartbeat, смещение и дрейф часов каждого соседа.
+#define LORA_TIMESYNC_SAMPLES           8       // Выборок в регрессии смещения и дрейфа
+#define LORA_TIMESYNC_TIMEOUT_MS        300000  // Без меток дольше - часы соседа забываются
+#define LORA_TIMESYNC_MAX_PEERS         16      // Соседей в таблице, с самой старой меткой вытесняется
+#define LORA_TIMESYNC_OUTLIER_US        2000    // Выборка дальше от прогноза - выброс
+#define LORA_TIMESYNC_MAX_REJECTS       3       // Выбросов подряд - часы соседа заново
+#define LORA_TIMESYNC_MAX_DRIFT_PPM     50      // Два кварца по +-20 ppm с запасом
+#define LORA_TIMESYNC_HOLDOVER_PPM      2       // Уход частоты кварца после оценки дрейфа
+#define LORA_TIMESYNC_BASE_ERROR_US     50      // Джиттер меток: задержка ISR DIO1 на обоих узлах
+#define LORA_TIMESYNC_BEACON_EVERY      8       // Метка в каждом N-м маяке TDMA (обычный heartbeat - в каждом)
+#define LORA_TIMESYNC_START_ERROR_US    2000    // Ошибка метки, пока отправитель не выучил задержку запуска TX
+#define LORA_TIMESYNC_RX_DELAY_US       0       // Калибровка: IRQ RX done позже TX done отправителя
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DUTY CYCLE
+// ═══════════════════════════════════════════════════════════════════════════
+// Учёт эфира (lora_airtime.hpp): скользящее окно по поддиапазону EU868, узлу и типу пакета.
+// Учёт ведётся всегда; с LORA_DUTY_CYCLE_ENFORCE кадр уходит, только если помещается в бюджет
+// поддиапазона, а длинная пауза sendTask после кадра заменяется бюджетом.
+#define LORA_DUTY_CYCLE_ENFORCE         0       // 1 - соблюдать duty cycle (развёртывание EU868)
+#define LORA_DUTY_CYCLE_WINDOW_MS       3600000 // Период наблюдения ETSI EN 300 220: 1 час
+#define LORA_DUTY_CYCLE_BUCKETS         60      // Корзин окна: запас учёта - одна корзина (1 мин)
+#define LORA_DUTY_CYCLE_MAX_PEERS       16      // Узлов в учёте, с наименьшим эфиром вытесняется
+#define LORA_DUTY_CYCLE_MAX_TYPES       16      // Типов пакетов в учёте
+#define LORA_DUTY_CYCLE_RECHECK_MS      500     // sendTask без бюджета: проверка не реже
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TX POWER CONTROL
+// ═══════════════════════════════════════════════════════════════════════════
+// Мощность передачи по узлу (lora_txpower.hpp): приёмник сообщает SNR/RSSI наших кадров
+// (CMD_LINK_REPORT), мощность снижается, пока запас над порогом демодуляции профиля больше
+// целевого, и растёт при потерях. Broadcast и GFSK - всегда LORA_TX_POWER.
+#define LORA_TPC_ENABLE                 0       // 1 - по умолчанию включено (setTxPowerControlEnabled)
+#define LORA_TPC_MIN_DBM                -9      // Нижняя граница SX1262
+#define LORA_TPC_TARGET_MARGIN_DB       10      // Запас над порогом демодуляции: замирания, помехи
+#define LORA_TPC_STEP_DOWN_DB           4       // Снижение за один отчёт, не больше
+#define LORA_TPC_STEP_UP_DB             6       // Рост после LORA_TPC_LOSS_LIMIT повторов подряд
+#define LORA_TPC_LOSS_LIMIT             2       // Повторов подряд к узлу до роста мощности
+#define LORA_TPC_REPORT_INTERVAL_MS     60000   // Отчёт узлу, который шлёт нам кадры, не реже
+#define LORA_TPC_REPORT_MIN_MS          10000   // ...и не чаще, даже при изменении SNR
+#define LORA_TPC_REPORT_DELTA_DB        3       // Изменение SNR для внеочередного отчёта
+#define LORA_TPC_REPORT_TIMEOUT_MS      180000  // Без отчётов дольше - снова LORA_TX_POWER
+#define LORA_TPC_SNR_SATURATION_DB      8       // SNR выше - запас и по RSSI (SNR SX1262 насыщается)
+#define LORA_TPC_NOISE_FIGURE_DB        6       // Шум-фактор приёмника для чувствительности по RSSI
+#define LORA_TPC_MAX_PEERS              16      // Узлов в таблице мощности и отчётов
+
+// ═══════════════════════════════════════════════════════════════════════════
+// MTU
+// ═══════════════════════════════════════════════════════════════════════════
+// MTU профиля (loraProfiles[].mtu) к узлу - после обмена ASA, в котором оба узла его назвали
+#define LORA_MTU_MAX_PEERS              16      // Узлов с согласованным MTU
 
 // ═══════════════════════════════════════════════════════════════════════════
 // QUEUE SIZES
 // ═══════════════════════════════════════════════════════════════════════════
 #define LORA_INCOMING_QUEUE_SIZE 35
-#define LORA_OUTGOING_QUEUE_SIZE 45
+#define LORA_RX_DRAIN_QUEUE_SIZE 16     // Кадров, вычитанных из радио и ещё не разобранных receiveTask
+#define LORA_RADIO_QUEUE_SIZE    8      // Команд задаче радио: передача, перенастройка, CAD, IRQ
+#define LORA_OUTGOING_QUEUE_SIZE 45     // Класс NORMAL (lora_txclass.hpp)
+// Очереди остальных классов передачи: строгий приоритет CONTROL > REALTIME > RETRY > NORMAL > BULK
+#define LORA_TXQ_CONTROL_SIZE    16     // ACK, BULK ACK, ASA, анонс маршрутов
+#define LORA_TXQ_REALTIME_SIZE   12     // highPriority
+#define LORA_TXQ_RETRY_SIZE      24     // Повторы resendTask
+#define LORA_TXQ_BULK_SIZE       8      // DATA блочной передачи
 
 // ═══════════════════════════════════════════════════════════════════════════
 // HARDWARE PIN CONFIGURATION (ESP32-S3 + SX1262)
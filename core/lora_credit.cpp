@@ -0,0 +1,75 @@
+// lora_credit.cpp - Non-blocking send status and per-peer send credit
+#include "lora_credit.hpp"
+#include <algorithm>
+
+const char *sendStatusName(SendStatus status)
+{
+    switch (status) {
+    case SendStatus::QUEUED:      return "queued";
+    case SendStatus::WOULD_BLOCK: return "would block";
+    case SendStatus::NOT_READY:   return "not ready";
+    case SendStatus::TOO_LARGE:   return "too large";
+    default:                      return "?";
+    }
+}
+
+String LoRaSendCredit::toString() const
+{
+    char s[100];
+    snprintf(s, sizeof(s), "%u frames / %u B (queued %u of %u, %lu ms per frame)", frames, bytes, queuedFrames,
+             windowFrames, (unsigned long)frameMs);
+    return String(s);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LEDGER
+// ═══════════════════════════════════════════════════════════════════════════
+LoRaCreditLedger::LoRaCreditLedger()
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        frames[i].store(0, std::memory_order_relaxed);
+        bytes[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LoRaCreditLedger::onQueued(LoraAddress_t peer, uint8_t payloadLen)
+{
+    frames[peer].fetch_add(1, std::memory_order_relaxed);
+    bytes[peer].fetch_add(payloadLen, std::memory_order_relaxed);
+}
+
+// Не ниже нуля: кадр мог попасть в очередь в обход учёта (send())
+static void subtractClamped(std::atomic<uint16_t> &value, uint16_t amount)
+{
+    uint16_t current = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(current, current > amount ? current - amount : 0,
+                                        std::memory_order_relaxed)) {
+    }
+}
+
+void LoRaCreditLedger::onDequeued(LoraAddress_t peer, uint8_t payloadLen)
+{
+    subtractClamped(frames[peer], 1);
+    subtractClamped(bytes[peer], payloadLen);
+}
+
+LoRaSendCredit LoRaCreditLedger::credit(LoraAddress_t peer, uint16_t windowFrames, size_t queueFree,
+                                        uint32_t frameMs, uint8_t mtu) const
+{
+    LoRaSendCredit c;
+    c.queuedFrames = frames[peer].load(std::memory_order_relaxed);
+    c.windowFrames = windowFrames;
+    c.frameMs = frameMs;
+    uint16_t windowBytes = windowFrames * mtu;
+    uint16_t queuedBytes = bytes[peer].load(std::memory_order_relaxed);
+    c.frames = (uint16_t)std::min<size_t>(windowFrames > c.queuedFrames ? windowFrames - c.queuedFrames : 0, queueFree);
+    c.bytes = std::min<uint16_t>(windowBytes > queuedBytes ? windowBytes - queuedBytes : 0,
+                                 c.frames * mtu);
+    return c;
+}
+
+uint16_t LoRaCreditLedger::windowFor(uint32_t frameMs)
+{
+    uint32_t window = frameMs ? LORA_CREDIT_WINDOW_MS / frameMs : LORA_CREDIT_MAX_FRAMES;
+    return (uint16_t)std::max<uint32_t>(LORA_CREDIT_MIN_FRAMES, std::min<uint32_t>(window, LORA_CREDIT_MAX_FRAMES));
+}
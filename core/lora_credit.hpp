@@ -0,0 +1,57 @@
+// lora_credit.hpp - Non-blocking send status and per-peer send credit
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "lora_config.h"
+
+// Итог trySendPacket()
+enum class SendStatus : uint8_t
+{
+    QUEUED,
+    WOULD_BLOCK,    // outgoingQueue полна или pending занят: повторить позже
+    NOT_READY,      // begin() не вызван
+    TOO_LARGE       // payload больше MTU узла (getMtu())
+};
+
+const char *sendStatusName(SendStatus status);
+
+// Сколько производитель может поставить к узлу сейчас (getSendCredit())
+struct LoRaSendCredit
+{
+    uint16_t frames = 0;        // Кадров: окно узла минус его очередь, не больше свободного места в outgoingQueue
+    uint16_t bytes = 0;         // Байт payload в тех же кадрах
+    uint16_t queuedFrames = 0;  // Уже ждут передачи к этому узлу
+    uint16_t windowFrames = 0;  // Окно узла на текущем профиле
+    uint32_t frameMs = 0;       // Эфир и пауза sendTask кадра в MTU узла: окно освобождается с этим темпом
+
+    String toString() const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LEDGER
+// ═══════════════════════════════════════════════════════════════════════════
+// Свои кадры в outgoingQueue и очереди sendTask по адресу получателя кадра (next hop).
+// Пишется из задач приложения, sendTask и resendTask без блокировок: атомарные счётчики
+// на каждый адрес. Пересылаемые чужие кадры не считаются.
+class LoRaCreditLedger
+{
+public:
+    LoRaCreditLedger();
+
+    void onQueued(LoraAddress_t peer, uint8_t payloadLen);
+    // Кадр передан, вложен в другой или выброшен из очереди
+    void onDequeued(LoraAddress_t peer, uint8_t payloadLen);
+
+    // windowFrames - окно узла, queueFree - свободно в outgoingQueue, mtu - payload кадра к узлу
+    LoRaSendCredit credit(LoraAddress_t peer, uint16_t windowFrames, size_t queueFree, uint32_t frameMs,
+                          uint8_t mtu) const;
+
+    uint16_t queuedFrames(LoraAddress_t peer) const { return frames[peer].load(std::memory_order_relaxed); }
+
+    // Окно на профиле: кадров длиной в MTU за LORA_CREDIT_WINDOW_MS, в пределах MIN..MAX
+    static uint16_t windowFor(uint32_t frameMs);
+
+private:
+    std::atomic<uint16_t> frames[256];
+    std::atomic<uint16_t> bytes[256];
+};
@@ -0,0 +1,45 @@
+// lora_deadline.cpp - Per-frame deadlines for EDF ordering and drop-on-expiry
+#include "lora_deadline.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+LoRaDeadlineTable::LoRaDeadlineTable()
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        deadlines[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LoRaDeadlineTable::set(PacketId_t packetId, uint32_t ttlMs, unsigned long nowMs)
+{
+    // | 1: срок не совпадает с 0 - "без срока"
+    uint32_t at = ttlMs ? (uint32_t)(nowMs + ttlMs) | 1 : 0;
+    deadlines[packetId].store(at, std::memory_order_relaxed);
+    if (!at) {
+        return;
+    }
+    uint32_t current = latest.load(std::memory_order_relaxed);
+    while ((!current || (int32_t)(at - current) > 0) &&
+           !latest.compare_exchange_weak(current, at, std::memory_order_relaxed)) {
+    }
+}
+
+bool LoRaDeadlineTable::expired(PacketId_t packetId, unsigned long nowMs) const
+{
+    uint32_t at = deadlines[packetId].load(std::memory_order_relaxed);
+    return at && (int32_t)((uint32_t)nowMs - at) >= 0;
+}
+
+bool LoRaDeadlineTable::earlier(PacketId_t a, PacketId_t b) const
+{
+    uint32_t da = deadlines[a].load(std::memory_order_relaxed);
+    uint32_t db = deadlines[b].load(std::memory_order_relaxed);
+    return da && (!db || (int32_t)(da - db) < 0);
+}
+
+bool LoRaDeadlineTable::active(unsigned long nowMs) const
+{
+    uint32_t at = latest.load(std::memory_order_relaxed);
+    return at && (int32_t)(at - (uint32_t)nowMs) > 0;
+}
@@ -0,0 +1,34 @@
+// lora_deadline.hpp - Per-frame deadlines for EDF ordering and drop-on-expiry
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+// Срок своего кадра по его PacketId_t (PacketBase::ttlMs). Запись перезаписывается при каждой
+// постановке кадра с этим ID, поэтому устаревших сроков не остаётся. Пишется из задач приложения,
+// читается sendTask и resendTask без блокировок.
+class LoRaDeadlineTable
+{
+public:
+    LoRaDeadlineTable();
+
+    // ttlMs = 0 - кадр без срока
+    void set(PacketId_t packetId, uint32_t ttlMs, unsigned long nowMs);
+    void clear(PacketId_t packetId) { deadlines[packetId].store(0, std::memory_order_relaxed); }
+
+    // 0 - без срока
+    unsigned long deadline(PacketId_t packetId) const { return deadlines[packetId].load(std::memory_order_relaxed); }
+    bool expired(PacketId_t packetId, unsigned long nowMs) const;
+    // a раньше b по EDF: кадр со сроком раньше кадра без срока
+    bool earlier(PacketId_t a, PacketId_t b) const;
+
+    // Есть кадры со сроком, ещё не наступившим: sendTask упорядочивает очередь по срокам
+    bool active(unsigned long nowMs) const;
+
+private:
+    std::atomic<uint32_t> deadlines[256];
+    std::atomic<uint32_t> latest{0};
+};
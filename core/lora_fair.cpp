@@ -0,0 +1,69 @@
+// lora_fair.cpp - Per-peer virtual queues with airtime deficit round robin
+#include "lora_fair.hpp"
+#include <algorithm>
+
+void LoRaFairScheduler::push(const LoRaPacket &pkt, TxClass cls, uint32_t airtimeUs)
+{
+    LoraAddress_t peer = pkt.getReceiverId();
+    auto it = std::find_if(flows.begin(), flows.end(), [peer](const Flow &f) { return f.peer == peer; });
+    if (it == flows.end()) {
+        // Новый узел встаёт в конец обхода: текущий узел не теряет свой квант
+        Flow flow;
+        flow.peer = peer;
+        flows.push_back(flow);
+        it = flows.end() - 1;
+    }
+    // После последнего кадра своего или старшего класса
+    auto pos = std::find_if(it->frames.begin(), it->frames.end(), [cls](const Entry &e) { return e.cls > cls; });
+    it->frames.insert(pos, {pkt, cls, airtimeUs});
+    frameCount++;
+    classCount[(uint8_t)cls]++;
+}
+
+bool LoRaFairScheduler::pop(LoRaPacket &out)
+{
+    if (flows.empty()) {
+        return false;
+    }
+    // Каждый обход добавляет узлу квант: цикл конечен, кадр дороже кванта уйдёт через несколько обходов
+    while (true) {
+        if (current >= flows.size()) {
+            current = 0;
+        }
+        Flow &flow = flows[current];
+        if (!credited) {
+            flow.deficitUs += quantumUs;
+            credited = true;
+        }
+        auto head = flow.frames.begin();
+        if (head->cls == TxClass::RETRY && flow.retryRun >= LORA_RETRY_BURST) {
+            auto data = std::find_if(flow.frames.begin(), flow.frames.end(),
+                                     [](const Entry &e) { return e.cls == TxClass::NORMAL; });
+            if (data != flow.frames.end()) {
+                head = data;
+            }
+        }
+        if (head->airtimeUs <= flow.deficitUs) {
+            out = head->pkt;
+            flow.deficitUs -= head->airtimeUs;
+            flow.retryRun = head->cls == TxClass::RETRY ? flow.retryRun + 1 : 0;
+            classCount[(uint8_t)head->cls]--;
+            flow.frames.erase(head);
+            frameCount--;
+            if (flow.frames.empty()) {
+                // Опустевший узел выходит из обхода без накопленного остатка
+                flows.erase(flows.begin() + current);
+                credited = false;
+            }
+            return true;
+        }
+        current++;
+        credited = false;
+    }
+}
+
+size_t LoRaFairScheduler::peerSize(LoraAddress_t peer) const
+{
+    auto it = std::find_if(flows.begin(), flows.end(), [peer](const Flow &f) { return f.peer == peer; });
+    return it == flows.end() ? 0 : it->frames.size();
+}
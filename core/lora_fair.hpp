@@ -0,0 +1,55 @@
+// lora_fair.hpp - Per-peer virtual queues with airtime deficit round robin
+#pragma once
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+#include "lora_config.h"
+#include "lora_txclass.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCHEDULER
+// ═══════════════════════════════════════════════════════════════════════════
+// Виртуальная очередь на каждый узел (получатель кадра, next hop ретрансляции) и deficit round
+// robin по времени эфира: за обход узел получает квант эфира и тратит его на свои кадры. Узел с
+// длинными кадрами и повторами получает столько же эфира, сколько остальные, а не больше.
+// Внутри узла кадры идут по классу передачи (повторы раньше данных), внутри класса - FIFO; после
+// LORA_RETRY_BURST повторов подряд - кадр данных, чтобы повторы не останавливали новые сообщения.
+// Без блокировок: только sendTask.
+class LoRaFairScheduler
+{
+public:
+    // Квант обхода - эфир одного кадра максимальной длины на текущем профиле
+    void setQuantumUs(uint32_t quantumUs) { this->quantumUs = quantumUs ? quantumUs : 1; }
+
+    void push(const LoRaPacket &pkt, TxClass cls, uint32_t airtimeUs);
+    // Следующий кадр по DRR. false - очереди пусты
+    bool pop(LoRaPacket &out);
+
+    bool empty() const { return frameCount == 0; }
+    size_t size() const { return frameCount; }
+    size_t peerCount() const { return flows.size(); }
+    size_t peerSize(LoraAddress_t peer) const;
+    size_t classSize(TxClass cls) const { return classCount[(uint8_t)cls]; }
+
+private:
+    struct Entry
+    {
+        LoRaPacket pkt;
+        TxClass cls;
+        uint32_t airtimeUs;
+    };
+    struct Flow
+    {
+        LoraAddress_t peer;
+        std::deque<Entry> frames;
+        uint32_t deficitUs = 0;
+        uint8_t retryRun = 0;       // Повторов подряд
+    };
+
+    std::vector<Flow> flows;        // Только узлы с кадрами, в порядке обхода
+    size_t current = 0;
+    bool credited = false;          // current уже получил квант в этом обходе
+    size_t frameCount = 0;
+    size_t classCount[TX_CLASS_COUNT] = {};
+    uint32_t quantumUs = 1;
+};
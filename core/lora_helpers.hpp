@@ -1,4 +1,6 @@
 #pragma once
+#include <math.h>
+#include <stddef.h>
 
 enum class RadioMode : uint8_t
 {
@@ -20,6 +22,49 @@ struct FSKProfile
     uint32_t rxBw{50000};      // Hz (Rx filter BW)
 };
 
+// ═══════════════════════════════════════════════════════════════════════════
+// TIME-ON-AIR
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Время в эфире LoRa кадра (мкс), формула из даташита SX1262: explicit header, CRC on.
+// cr - знаменатель coding rate (5..8 для 4/5..4/8), как в loraProfiles.
+inline uint32_t loraTimeOnAirUs(uint8_t sf, float bwKHz, uint8_t cr, uint16_t preambleLen, size_t payloadBytes)
+{
+    float symbolUs = (float)(1UL << sf) * 1000.0f / bwKHz;
+    int lowDataRateOpt = (symbolUs > 16000.0f) ? 1 : 0;
+    float preambleUs = (preambleLen + 4.25f) * symbolUs;
+    float num = 8.0f * payloadBytes - 4.0f * sf + 28.0f + 16.0f;
+    float den = 4.0f * (sf - 2 * lowDataRateOpt);
+    float payloadSymbols = 8.0f + fmaxf(ceilf(num / den), 0.0f) * cr;
+    return (uint32_t)(preambleUs + payloadSymbols * symbolUs);
+}
+
+// Время в эфире GFSK кадра (мкс): преамбула + sync word(2) + длина(1) + payload + CRC(2)
+inline uint32_t fskTimeOnAirUs(uint32_t bitrate, size_t payloadBytes, uint16_t preambleBits = 32)
+{
+    if (bitrate == 0) return 0;
+    uint32_t bits = preambleBits + 8 * (2 + 1 + payloadBytes + 2);
+    return (uint32_t)((uint64_t)bits * 1000000ULL / bitrate);
+}
+
+// Время в эфире кадра для профиля из loraProfiles (мкс)
+inline uint32_t profileTimeOnAirUs(uint8_t profileIndex, size_t payloadBytes, uint16_t preambleLen = LORA_PREAMBLE_LEN)
+{
+    if (profileIndex >= LORA_PROFILE_COUNT) return 0;
+    const auto &p = loraProfiles[profileIndex];
+    if (p.mode == RadioProfileMode::LORA) {
+        return loraTimeOnAirUs(p.spreadingFactor, p.bandwidth, p.codingRate, preambleLen, payloadBytes);
+    }
+    return fskTimeOnAirUs(p.bitrate, payloadBytes);
+}
+
+// MTU профиля, не больше буфера кадра. Неизвестный профиль - LORA_BASE_MTU
+inline uint8_t profileMtu(uint8_t profileIndex)
+{
+    if (profileIndex >= LORA_PROFILE_COUNT) return LORA_BASE_MTU;
+    return loraProfiles[profileIndex].mtu < MAX_LORA_PAYLOAD ? loraProfiles[profileIndex].mtu : MAX_LORA_PAYLOAD;
+}
+
 // Exponential Moving Average фильтр для RSSI
 class RssiFilter {
 private:
@@ -0,0 +1,248 @@
+// lora_metrics.cpp - Counters, gauges and log-scale histograms of LoRaCore
+#include "lora_metrics.hpp"
+
+const LoRaMetricInfo loraCounterInfo[LORA_COUNTER_COUNT] = {
+    {"rx_frames", ""},
+    {"rx_errors", ""},
+    {"rx_queue_full", ""},
+    {"tx_frames", ""},
+    {"tx_errors", ""},
+    {"tx_airtime", "ms"},
+    {"tx_queue_full", ""},
+    {"ack_received", ""},
+    {"duplicate_acks", ""},
+    {"retransmissions", ""},
+    {"dropped_max_retries", ""},
+    {"aggregated", ""},
+    {"relay_forwarded", ""},
+    {"relay_dropped", ""},
+    {"poll_sent", ""},
+    {"poll_missed", ""},
+    {"xfer_blocks_sent", ""},
+    {"xfer_blocks_recv", ""},
+    {"tx_would_block", ""},
+    {"tx_coalesced", ""},
+    {"tx_expired_queued", ""},
+    {"tx_expired_pending", ""},
+    {"tx_peer_quota", ""},
+    {"rx_drain_full", ""},
+    {"tx_duty_deferred", ""},
+    {"tx_duty_blocked", ""},
+    {"tx_power_reduced", ""},
+    {"link_reports", ""},
+    {"metrics_pages_dropped", ""},
+};
+
+const LoRaMetricInfo loraGaugeInfo[LORA_GAUGE_COUNT] = {
+    {"tx_queue", ""},
+    {"rx_queue", ""},
+    {"pending", ""},
+    {"last_rssi", "dBm"},
+    {"last_snr", "dB"},
+    {"time_error", "us"},
+    {"duty_left", "ms"},
+    {"tx_power", "dBm"},
+};
+
+const LoRaMetricInfo loraHistogramInfo[LORA_HISTOGRAM_COUNT] = {
+    {"tx_airtime", "us"},
+    {"tx_queue_depth", ""},
+    {"retries", ""},
+    {"ack_rtt", "ms"},
+    {"rx_dispatch", "us"},
+    {"aggregation", ""},
+    {"enqueue_wait", "us"},
+    {"queue_wait", "ms"},
+    {"radio_wait", "us"},
+    {"retry_delay", "ms"},
+    {"ack_wait", "ms"},
+    {"send_total", "ms"},
+    {"rx_delivery", "us"},
+    {"ack_air_rtt", "us"},
+    {"time_residual", "us"},
+};
+
+static const char *const HISTOGRAM_FIELDS[4] = {"count", "p50", "p99", "max"};
+static constexpr uint8_t RECORD_COUNT = LORA_COUNTER_COUNT + LORA_GAUGE_COUNT + 4 * LORA_HISTOGRAM_COUNT;
+// Страница уходит узлу, запросившему метрики: MTU без согласования
+static constexpr uint8_t RECORDS_PER_PAGE = (LORA_BASE_MTU - 2) / LORA_METRIC_RECORD_SIZE;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// HISTOGRAM
+// ═══════════════════════════════════════════════════════════════════════════
+uint8_t LoRaHistogramSnapshot::bucketOf(uint32_t value)
+{
+    if (value == 0)
+        return 0;
+    uint8_t bucket = 32 - __builtin_clz(value);
+    return bucket < LORA_HISTOGRAM_BUCKETS ? bucket : LORA_HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t LoRaHistogramSnapshot::bucketUpperBound(uint8_t bucket)
+{
+    if (bucket == 0)
+        return 0;
+    if (bucket >= LORA_HISTOGRAM_BUCKETS - 1)
+        return UINT32_MAX;
+    return (1UL << bucket) - 1;
+}
+
+uint32_t LoRaHistogramSnapshot::percentile(float p) const
+{
+    if (count == 0)
+        return 0;
+    uint32_t target = (uint32_t)(p / 100.0f * count + 0.999f);
+    if (target == 0)
+        target = 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LORA_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min(bucketUpperBound(i), max);
+    }
+    return max;
+}
+
+void LoRaMetrics::record(LoRaHistogramId id, uint32_t value)
+{
+    Histogram &h = histograms[id];
+    h.buckets[LoRaHistogramSnapshot::bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    uint32_t prev = h.max.load(std::memory_order_relaxed);
+    while (value > prev && !h.max.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LoRaMetrics::snapshot(LoRaMetricsSnapshot &out) const
+{
+    out.uptimeMs = millis();
+    for (uint8_t i = 0; i < LORA_COUNTER_COUNT; i++)
+        out.counters[i] = counters[i].load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < LORA_GAUGE_COUNT; i++)
+        out.gauges[i] = gauges[i].load(std::memory_order_relaxed);
+    for (uint8_t h = 0; h < LORA_HISTOGRAM_COUNT; h++) {
+        out.histograms[h].count = histograms[h].count.load(std::memory_order_relaxed);
+        out.histograms[h].max = histograms[h].max.load(std::memory_order_relaxed);
+        for (uint8_t b = 0; b < LORA_HISTOGRAM_BUCKETS; b++)
+            out.histograms[h].buckets[b] = histograms[h].buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+// Gauges отражают текущее состояние и не сбрасываются
+void LoRaMetrics::reset()
+{
+    for (auto &c : counters)
+        c.store(0, std::memory_order_relaxed);
+    for (auto &h : histograms) {
+        h.count.store(0, std::memory_order_relaxed);
+        h.max.store(0, std::memory_order_relaxed);
+        for (auto &b : h.buckets)
+            b.store(0, std::memory_order_relaxed);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// EXPORT
+// ═══════════════════════════════════════════════════════════════════════════
+static const char *unitSeparator(const char *unit)
+{
+    return unit[0] ? " " : "";
+}
+
+String LoRaMetricsSnapshot::toString() const
+{
+    char line[120];
+    String out;
+    snprintf(line, sizeof(line), "uptime: %lu s\n", (unsigned long)(uptimeMs / 1000));
+    out += line;
+    for (uint8_t i = 0; i < LORA_COUNTER_COUNT; i++) {
+        snprintf(line, sizeof(line), "%s: %lu%s%s\n", loraCounterInfo[i].name, (unsigned long)counters[i],
+                 unitSeparator(loraCounterInfo[i].unit), loraCounterInfo[i].unit);
+        out += line;
+    }
+    for (uint8_t i = 0; i < LORA_GAUGE_COUNT; i++) {
+        snprintf(line, sizeof(line), "%s: %ld%s%s\n", loraGaugeInfo[i].name, (long)gauges[i],
+                 unitSeparator(loraGaugeInfo[i].unit), loraGaugeInfo[i].unit);
+        out += line;
+    }
+    for (uint8_t i = 0; i < LORA_HISTOGRAM_COUNT; i++) {
+        const LoRaHistogramSnapshot &h = histograms[i];
+        snprintf(line, sizeof(line), "%s: n=%lu p50<=%lu p99<=%lu max=%lu%s%s\n", loraHistogramInfo[i].name,
+                 (unsigned long)h.count, (unsigned long)h.percentile(50), (unsigned long)h.percentile(99),
+                 (unsigned long)h.max, unitSeparator(loraHistogramInfo[i].unit), loraHistogramInfo[i].unit);
+        out += line;
+    }
+    return out;
+}
+
+uint8_t LoRaMetricsSnapshot::pageCount()
+{
+    return (RECORD_COUNT + RECORDS_PER_PAGE - 1) / RECORDS_PER_PAGE;
+}
+
+// Запись с порядковым номером index: сначала счётчики, затем gauges, затем гистограммы
+static void recordAt(const LoRaMetricsSnapshot &s, uint8_t index, uint8_t &id, uint32_t &value)
+{
+    if (index < LORA_COUNTER_COUNT) {
+        id = index;
+        value = s.counters[index];
+        return;
+    }
+    index -= LORA_COUNTER_COUNT;
+    if (index < LORA_GAUGE_COUNT) {
+        id = LORA_METRIC_ID_GAUGE + index;
+        value = (uint32_t)s.gauges[index];
+        return;
+    }
+    index -= LORA_GAUGE_COUNT;
+    const LoRaHistogramSnapshot &h = s.histograms[index / 4];
+    id = LORA_METRIC_ID_HISTOGRAM + index;
+    switch (index % 4) {
+    case 0: value = h.count; break;
+    case 1: value = h.percentile(50); break;
+    case 2: value = h.percentile(99); break;
+    default: value = h.max; break;
+    }
+}
+
+uint8_t LoRaMetricsSnapshot::serializePage(uint8_t page, uint8_t *buffer) const
+{
+    if (page >= pageCount())
+        return 0;
+    buffer[0] = page;
+    buffer[1] = pageCount();
+    uint8_t len = 2;
+    for (uint8_t i = page * RECORDS_PER_PAGE; i < RECORD_COUNT && i < (page + 1) * RECORDS_PER_PAGE; i++) {
+        uint8_t id;
+        uint32_t value;
+        recordAt(*this, i, id, value);
+        buffer[len++] = id;
+        buffer[len++] = value & 0xFF;
+        buffer[len++] = (value >> 8) & 0xFF;
+        buffer[len++] = (value >> 16) & 0xFF;
+        buffer[len++] = (value >> 24) & 0xFF;
+    }
+    return len;
+}
+
+bool loraMetricRecordName(uint8_t id, String &name, const char *&unit)
+{
+    if (id < LORA_COUNTER_COUNT) {
+        name = loraCounterInfo[id].name;
+        unit = loraCounterInfo[id].unit;
+        return true;
+    }
+    if (id >= LORA_METRIC_ID_GAUGE && id < LORA_METRIC_ID_GAUGE + LORA_GAUGE_COUNT) {
+        name = loraGaugeInfo[id - LORA_METRIC_ID_GAUGE].name;
+        unit = loraGaugeInfo[id - LORA_METRIC_ID_GAUGE].unit;
+        return true;
+    }
+    if (id >= LORA_METRIC_ID_HISTOGRAM && id < LORA_METRIC_ID_HISTOGRAM + 4 * LORA_HISTOGRAM_COUNT) {
+        uint8_t index = id - LORA_METRIC_ID_HISTOGRAM;
+        const LoRaMetricInfo &info = loraHistogramInfo[index / 4];
+        name = String(info.name) + "." + HISTOGRAM_FIELDS[index % 4];
+        unit = (index % 4 == 0) ? "" : info.unit;
+        return true;
+    }
+    return false;
+}
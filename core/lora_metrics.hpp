@@ -0,0 +1,183 @@
+// lora_metrics.hpp - Counters, gauges and log-scale histograms of LoRaCore
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// METRIC IDS
+// ═══════════════════════════════════════════════════════════════════════════
+enum LoRaCounterId : uint8_t
+{
+    LORA_CNT_RX_FRAMES = 0,         // Принятые кадры для нас (или broadcast)
+    LORA_CNT_RX_ERRORS,             // CRC, короткий кадр, ошибка чтения
+    LORA_CNT_RX_QUEUE_FULL,         // Кадр не поместился во входящую очередь
+    LORA_CNT_TX_FRAMES,
+    LORA_CNT_TX_ERRORS,
+    LORA_CNT_TX_AIRTIME_MS,         // Суммарное время в эфире
+    LORA_CNT_TX_QUEUE_FULL,         // sendPacketBase() не смог поставить кадр в очередь
+    LORA_CNT_ACK_RECEIVED,
+    LORA_CNT_DUPLICATE_ACKS,        // ACK на пакет, которого уже нет в pending
+    LORA_CNT_RETRANSMISSIONS,
+    LORA_CNT_DROPPED_MAX_RETRIES,
+    LORA_CNT_AGGREGATED,            // Пакетов, вложенных в AGR кадры
+    LORA_CNT_RELAY_FORWARDED,       // Чужих кадров CMD_RELAY переслано дальше
+    LORA_CNT_RELAY_DROPPED,         // Не пересланы: дубль, лимит hops, петля, ретрансляция выключена
+    LORA_CNT_POLLS_SENT,            // Опросов polling master
+    LORA_CNT_POLLS_MISSED,          // Опросов без ответа за время ожидания
+    LORA_CNT_XFER_BLOCKS_SENT,      // Кадров DATA передачи, включая повторы
+    LORA_CNT_XFER_BLOCKS_RECEIVED,  // Новых блоков, принятых передачей
+    LORA_CNT_TX_WOULD_BLOCK,        // trySendPacket() вернул WOULD_BLOCK
+    LORA_CNT_TX_COALESCED,          // Образцов sendPacketLatest(), заменённых более новым
+    LORA_CNT_TX_EXPIRED_QUEUED,     // Кадров с истёкшим ttlMs, снятых с очереди до передачи
+    LORA_CNT_TX_EXPIRED_PENDING,    // Кадров с истёкшим ttlMs, снятых с pending без повторов
+    LORA_CNT_TX_PEER_QUOTA,         // Отказов постановки: к узлу уже LORA_PEER_QUEUE_QUOTA кадров
+    LORA_CNT_RX_DRAIN_FULL,         // Кадров, вычитанных из радио, но не вместившихся в rxDrainQueue
+    LORA_CNT_TX_DUTY_DEFERRED,      // Ожиданий sendTask: кадр не помещался в бюджет duty cycle
+    LORA_CNT_TX_DUTY_BLOCKED,       // Передач, не начатых задачей радио: нет бюджета duty cycle
+    LORA_CNT_TX_POWER_REDUCED,      // Кадров, переданных ниже LORA_TX_POWER (управление мощностью)
+    LORA_CNT_LINK_REPORTS,          // Принятых отчётов о линии (CMD_LINK_REPORT)
+    LORA_CNT_METRICS_PAGES_DROPPED, // Страниц ответа на запрос метрик, не поставленных в очередь
+    LORA_COUNTER_COUNT
+};
+
+enum LoRaGaugeId : uint8_t
+{
+    LORA_GAUGE_TX_QUEUE = 0,        // Кадров в outgoingQueue
+    LORA_GAUGE_RX_QUEUE,            // Кадров в incomingQueue
+    LORA_GAUGE_PENDING,             // Ждут ACK
+    LORA_GAUGE_LAST_RSSI,           // dBm
+    LORA_GAUGE_LAST_SNR,            // dB
+    LORA_GAUGE_TIME_ERROR_US,       // Заявленная точность сетевого времени, -1 - нет синхронизации
+    LORA_GAUGE_DUTY_LEFT_MS,        // Остаток бюджета duty cycle поддиапазона, -1 - частота вне таблицы
+    LORA_GAUGE_TX_POWER,            // Мощность последнего переданного кадра, дБм
+    LORA_GAUGE_COUNT
+};
+
+enum LoRaHistogramId : uint8_t
+{
+    LORA_HIST_TX_AIRTIME_US = 0,    // Время в эфире одного кадра
+    LORA_HIST_TX_QUEUE_DEPTH,       // Глубина outgoingQueue при постановке кадра
+    LORA_HIST_RETRIES,              // Повторов на кадр (при ACK или drop)
+    LORA_HIST_ACK_RTT_MS,           // От последней (пере)отправки до ACK
+    LORA_HIST_RX_DISPATCH_US,       // От IRQ приёма до входящей очереди
+    LORA_HIST_AGGREGATION,          // Пакетов приложения в переданном кадре данных
+    // Этапы жизни пакета, только при включённой трассировке (lora_trace.hpp)
+    LORA_HIST_ENQUEUE_WAIT_US,      // Ожидание места в outgoingQueue внутри sendPacketBase()
+    LORA_HIST_QUEUE_WAIT_MS,        // В outgoingQueue до выборки sendTask
+    LORA_HIST_RADIO_WAIT_US,        // Выборка -> задача радио взяла кадр
+    LORA_HIST_RETRY_DELAY_MS,       // Конец первой передачи -> начало последней (только с повторами)
+    LORA_HIST_ACK_WAIT_MS,          // Конец последней передачи -> ACK (включая накопление bulk ACK)
+    LORA_HIST_SEND_TOTAL_MS,        // sendPacketBase() -> ACK, без ACK - до конца передачи
+    LORA_HIST_RX_DELIVERY_US,       // IRQ приёма -> receive() приложения
+    LORA_HIST_ACK_AIR_RTT_US,       // IRQ TX done последней передачи -> IRQ приёма кадра с ACK
+    LORA_HIST_TIME_RESIDUAL_US,     // |метка времени соседа - прогноз по его часам|
+    LORA_HISTOGRAM_COUNT
+};
+
+struct LoRaMetricInfo
+{
+    const char *name;
+    const char *unit;
+};
+
+extern const LoRaMetricInfo loraCounterInfo[LORA_COUNTER_COUNT];
+extern const LoRaMetricInfo loraGaugeInfo[LORA_GAUGE_COUNT];
+extern const LoRaMetricInfo loraHistogramInfo[LORA_HISTOGRAM_COUNT];
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SNAPSHOT
+// ═══════════════════════════════════════════════════════════════════════════
+// Корзина 0 - значение 0, корзина i - [2^(i-1), 2^i). Последняя собирает всё выше.
+static constexpr uint8_t LORA_HISTOGRAM_BUCKETS = 24;
+
+struct LoRaHistogramSnapshot
+{
+    uint32_t count = 0;
+    uint32_t max = 0;
+    uint32_t buckets[LORA_HISTOGRAM_BUCKETS] = {};
+
+    // Верхняя граница корзины, в которой лежит перцентиль p (0..100)
+    uint32_t percentile(float p) const;
+    static uint8_t bucketOf(uint32_t value);
+    static uint32_t bucketUpperBound(uint8_t bucket);
+};
+
+struct LoRaMetricsSnapshot
+{
+    uint32_t uptimeMs = 0;
+    uint32_t counters[LORA_COUNTER_COUNT] = {};
+    int32_t gauges[LORA_GAUGE_COUNT] = {};
+    LoRaHistogramSnapshot histograms[LORA_HISTOGRAM_COUNT];
+
+    // Текст для Serial: одна метрика на строку
+    String toString() const;
+
+    // ── Передача по радио (CMD_METRICS) ──
+    // Payload страницы: [page:1][pageCount:1] + записи [id:1][value:4 LE].
+    // id: счётчики 0.., gauges 64.., гистограммы 128 + 4*h + {count, p50, p99, max}.
+    // buffer - не меньше MAX_LORA_PAYLOAD. Возвращает длину payload, 0 для неверной страницы.
+    static uint8_t pageCount();
+    uint8_t serializePage(uint8_t page, uint8_t *buffer) const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// REGISTRY
+// ═══════════════════════════════════════════════════════════════════════════
+// Статически размещённые атомики: запись из любой задачи и из ISR без блокировок.
+// Снимок не атомарен целиком - отдельные значения могут разойтись на одно событие.
+class LoRaMetrics
+{
+public:
+    void add(LoRaCounterId id, uint32_t n = 1) { counters[id].fetch_add(n, std::memory_order_relaxed); }
+    void set(LoRaGaugeId id, int32_t value) { gauges[id].store(value, std::memory_order_relaxed); }
+    void record(LoRaHistogramId id, uint32_t value);
+
+    uint32_t counter(LoRaCounterId id) const { return counters[id].load(std::memory_order_relaxed); }
+    int32_t gauge(LoRaGaugeId id) const { return gauges[id].load(std::memory_order_relaxed); }
+
+    void snapshot(LoRaMetricsSnapshot &out) const;
+    void reset();
+
+private:
+    struct Histogram
+    {
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> max{0};
+        std::atomic<uint32_t> buckets[LORA_HISTOGRAM_BUCKETS] = {};
+    };
+
+    std::atomic<uint32_t> counters[LORA_COUNTER_COUNT] = {};
+    std::atomic<int32_t> gauges[LORA_GAUGE_COUNT] = {};
+    Histogram histograms[LORA_HISTOGRAM_COUNT];
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RECORD DECODING
+// ═══════════════════════════════════════════════════════════════════════════
+static constexpr uint8_t LORA_METRIC_ID_GAUGE = 64;
+static constexpr uint8_t LORA_METRIC_ID_HISTOGRAM = 128;
+static constexpr uint8_t LORA_METRIC_RECORD_SIZE = 5;
+
+// Имя записи по id: "rx_frames", "ack_rtt.p99". false для неизвестного id.
+bool loraMetricRecordName(uint8_t id, String &name, const char *&unit);
+
+// Разбор страницы CMD_METRICS: callback(const String &name, const char *unit, int64_t value)
+template <typename Callback>
+bool forEachMetricRecord(const uint8_t *payload, uint8_t len, Callback callback)
+{
+    if (len < 2 || (len - 2) % LORA_METRIC_RECORD_SIZE != 0)
+        return false;
+    for (uint8_t offset = 2; offset < len; offset += LORA_METRIC_RECORD_SIZE) {
+        uint32_t value = (uint32_t)payload[offset + 1] | ((uint32_t)payload[offset + 2] << 8) |
+                         ((uint32_t)payload[offset + 3] << 16) | ((uint32_t)payload[offset + 4] << 24);
+        uint8_t id = payload[offset];
+        bool isGauge = id >= LORA_METRIC_ID_GAUGE && id < LORA_METRIC_ID_HISTOGRAM;
+        String name;
+        const char *unit = "";
+        if (loraMetricRecordName(id, name, unit))
+            callback(name, unit, isGauge ? (int64_t)(int32_t)value : (int64_t)value);
+    }
+    return true;
+}
@@ -21,3 +21,10 @@
 #include "packets/packet_command_response.hpp"
 #include "packets/packet_telemetry_fragment.hpp"
 #include "packets/packet_aggregated.hpp"
+#include "packets/packet_metrics.hpp"
+#include "packets/packet_relay.hpp"
+#include "packets/packet_tdma.hpp"
+#include "packets/packet_poll.hpp"
+#include "packets/packet_transfer.hpp"
+#include "packets/packet_link_report.hpp"
+#include "packets/packet_low_power.hpp"
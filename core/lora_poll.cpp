@@ -0,0 +1,97 @@
+// lora_poll.cpp - Polling MAC: master-side poll order and piggybacked ACKs
+#include "lora_poll.hpp"
+#include <algorithm>
+#include <string.h>
+
+const char *pollRoleName(PollRole role)
+{
+    switch (role) {
+    case PollRole::MASTER: return "master";
+    case PollRole::SLAVE:  return "slave";
+    default:               return "off";
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCHEDULER (MASTER)
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaPollScheduler::reset()
+{
+    acks.clear();
+    current = 0;
+    burst = 0;
+    repeat = false;
+    cycleStartMs = 0;
+    lastCycleMs = 0;
+}
+
+bool LoRaPollScheduler::next(const std::vector<LoraAddress_t> &active, LoraAddress_t &out, uint32_t &waitMs)
+{
+    waitMs = 0;
+    if (active.empty()) {
+        return false;
+    }
+    bool present = std::find(active.begin(), active.end(), current) != active.end();
+    if (repeat && present && burst < LORA_POLL_MAX_BURST) {
+        burst++;
+        out = current;
+        return true;
+    }
+
+    // Следующий адрес после текущего; за последним - новый обход
+    LoraAddress_t best = 0;
+    LoraAddress_t first = *std::min_element(active.begin(), active.end());
+    bool found = false;
+    for (LoraAddress_t address : active) {
+        if (address > current && (!found || address < best)) {
+            best = address;
+            found = true;
+        }
+    }
+    if (!found) {
+        unsigned long now = millis();
+        if (cycleStartMs && now - cycleStartMs < LORA_POLL_MIN_CYCLE_MS) {
+            waitMs = LORA_POLL_MIN_CYCLE_MS - (now - cycleStartMs);
+            repeat = false;
+            return false;
+        }
+        if (cycleStartMs) {
+            lastCycleMs = now - cycleStartMs;
+        }
+        cycleStartMs = now;
+        best = first;
+    }
+    current = best;
+    burst = 1;
+    repeat = false;
+    out = current;
+    return true;
+}
+
+void LoRaPollScheduler::onReply(LoraAddress_t address, bool answered, bool more)
+{
+    if (address == current) {
+        repeat = answered && more;
+    }
+}
+
+bool LoRaPollScheduler::addAck(LoraAddress_t address, PacketId_t packetId)
+{
+    PacketBulkAck &list = acks[address];
+    if (list.count >= LORA_POLL_MAX_ACKS) {
+        return false;
+    }
+    return list.addAck(packetId);
+}
+
+uint8_t LoRaPollScheduler::takeAcks(LoraAddress_t address, PacketId_t *out)
+{
+    auto it = acks.find(address);
+    if (it == acks.end()) {
+        return 0;
+    }
+    uint8_t count = it->second.count;
+    memcpy(out, it->second.ackedIds, count * sizeof(PacketId_t));
+    acks.erase(it);
+    return count;
+}
@@ -0,0 +1,54 @@
+// lora_poll.hpp - Polling MAC: master-side poll order and piggybacked ACKs
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <vector>
+#include "lora_config.h"
+#include "packets/packet_bulk_ack.hpp"
+#include "packets/packet_poll.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ROLE
+// ═══════════════════════════════════════════════════════════════════════════
+enum class PollRole : uint8_t
+{
+    OFF,
+    MASTER,     // Опрашивает клиентов по очереди
+    SLAVE       // Передаёт только в ответ на опрос, пока его опрашивают
+};
+
+const char *pollRoleName(PollRole role);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCHEDULER (MASTER)
+// ═══════════════════════════════════════════════════════════════════════════
+// Round-robin по активным клиентам. Slave с флагом MORE опрашивается повторно,
+// но не больше LORA_POLL_MAX_BURST раз подряд. ACK на кадры slave копятся здесь
+// и уходят в его следующем опросе. Без блокировок: LoRaCore держит его под pollMutex.
+class LoRaPollScheduler
+{
+public:
+    void reset();
+
+    // Следующий опрашиваемый из active (по возрастанию адреса). false - опрашивать некого
+    // или новый обход начинать рано (waitMs - сколько ждать)
+    bool next(const std::vector<LoraAddress_t> &active, LoraAddress_t &out, uint32_t &waitMs);
+    // Ответ получен (more - у slave остались кадры) или не пришёл (answered == false)
+    void onReply(LoraAddress_t address, bool answered, bool more);
+
+    // false - для address уже LORA_POLL_MAX_ACKS подтверждений
+    bool addAck(LoraAddress_t address, PacketId_t packetId);
+    // Забрать подтверждения для опроса address. Возвращает их число
+    uint8_t takeAcks(LoraAddress_t address, PacketId_t *out);
+
+    // Длительность последнего полного обхода клиентов
+    uint32_t cycleMs() const { return lastCycleMs; }
+
+private:
+    std::map<LoraAddress_t, PacketBulkAck> acks;
+    LoraAddress_t current = 0;
+    uint8_t burst = 0;
+    bool repeat = false;
+    unsigned long cycleStartMs = 0;
+    uint32_t lastCycleMs = 0;
+};
@@ -0,0 +1,76 @@
+// lora_radio.hpp - Radio hardware abstraction
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RESULT CODES
+// ═══════════════════════════════════════════════════════════════════════════
+// 0 = успех, отрицательные значения - ошибка драйвера (для SX1262 это коды RadioLib)
+static constexpr int LORA_RADIO_OK          = 0;
+static constexpr int LORA_RADIO_ERR_UNKNOWN = -1;
+static constexpr int LORA_RADIO_ERR_TX_TIMEOUT = -5;  // = RADIOLIB_ERR_TX_TIMEOUT
+static constexpr int LORA_RADIO_ERR_CRC     = -7;   // = RADIOLIB_ERR_CRC_MISMATCH
+static constexpr int LORA_RADIO_ERR_CONFIG  = -20;  // Параметр профиля не поддерживается
+static constexpr int LORA_RADIO_ERR_DUTY_CYCLE = -2000; // LoRaCore: кадр не помещается в бюджет duty cycle
+
+// Итог CAD (scanChannel)
+static constexpr int LORA_RADIO_LORA_DETECTED = -701;  // = RADIOLIB_LORA_DETECTED
+static constexpr int LORA_RADIO_CHANNEL_FREE  = -702;  // = RADIOLIB_CHANNEL_FREE
+
+// IRQ DIO1: пакет принят или передача startTransmit() окончена. Вызывается из ISR - только уведомление задачи!
+typedef void (*LoRaRadioIrqHandler)(void *context);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RADIO INTERFACE
+// ═══════════════════════════════════════════════════════════════════════════
+// Тонкий слой между LoRaCore и трансивером. LoRaCore вызывает его только из задачи радио (radioTask).
+// Реализации:
+//   platform/esp32_sx1262 - Sx1262Radio (RadioLib, железо)
+//   platform/native       - LoopbackRadio (в памяти, для host сборки)
+class LoRaRadio
+{
+public:
+    virtual ~LoRaRadio() {}
+
+    // Инициализация железа (SPI, reset). true при успехе
+    virtual bool begin() = 0;
+
+    // Конфигурация модема. Частота в МГц, полоса в кГц
+    virtual int configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                              uint16_t preambleLen, int8_t txPower, uint8_t syncWord) = 0;
+    virtual int configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz) = 0;
+    virtual int setPreambleLength(uint16_t preambleLen) = 0;
+    virtual int setOutputPower(int8_t txPower) = 0;
+
+    virtual int standby() = 0;
+
+    // Блокирующая передача: возвращается после окончания кадра в эфире
+    virtual int transmit(const uint8_t *data, size_t len) = 0;
+
+    // Передача по IRQ: startTransmit() возвращается сразу, конец кадра - IRQ DIO1.
+    // После IRQ (или отказа от ожидания) - finishTransmit(): сброс IRQ, standby
+    virtual int startTransmit(const uint8_t *data, size_t len) = 0;
+    virtual int finishTransmit() = 0;
+
+    // Непрерывный приём / RX duty-cycle под преамбулу отправителя
+    virtual int startReceive() = 0;
+    virtual int startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols) = 0;
+
+    // Channel Activity Detection (только LoRa): LORA_RADIO_LORA_DETECTED / LORA_RADIO_CHANNEL_FREE.
+    // Блокирует на время CAD, после проверки радио в standby
+    virtual int scanChannel() = 0;
+
+    // Чтение принятого кадра (после IRQ)
+    virtual size_t getPacketLength() = 0;
+    virtual int readData(uint8_t *data, size_t len) = 0;
+    virtual float getRSSI() = 0;
+    virtual float getSNR() = 0;
+
+    virtual void setIrqHandler(LoRaRadioIrqHandler handler, void *context) = 0;
+    virtual void clearIrqHandler() = 0;
+};
+
+// Радио платформы по умолчанию (определяется в platform/<target>)
+LoRaRadio *createPlatformRadio();
@@ -0,0 +1,132 @@
+// lora_routing.cpp - Next-hop route table and relay duplicate filter
+#include "lora_routing.hpp"
+#include "packets/packet_relay.hpp"
+
+String LoRaRoute::toString() const
+{
+    char s[64];
+    snprintf(s, sizeof(s), "%u via %u, %u hop%s%s", destination, nextHop, hops, hops == 1 ? "" : "s",
+             isStatic ? ", static" : "");
+    return String(s);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ROUTE TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+bool LoRaRouteTable::learn(LoraAddress_t destination, LoraAddress_t nextHop, uint8_t hops, uint32_t nowMs)
+{
+    auto it = routes.find(destination);
+    if (it == routes.end()) {
+        if (hops == 0 || hops > LORA_RELAY_MAX_HOPS)
+            return false;
+        LoRaRoute route;
+        route.destination = destination;
+        route.nextHop = nextHop;
+        route.hops = hops;
+        route.updatedMs = nowMs;
+        routes[destination] = route;
+        return true;
+    }
+
+    LoRaRoute &route = it->second;
+    if (route.isStatic)
+        return false;
+    bool fresh = isFresh(route, nowMs);
+    if (route.nextHop == nextHop) {
+        // Тот же сосед сообщил новую длину: верим, даже если путь удлинился
+        if (hops == 0 || hops > LORA_RELAY_MAX_HOPS) {
+            routes.erase(it);
+            return true;
+        }
+        route.hops = hops;
+        route.updatedMs = nowMs;
+        return !fresh;
+    }
+    if (hops == 0 || hops > LORA_RELAY_MAX_HOPS || (fresh && hops >= route.hops))
+        return false;
+    route.nextHop = nextHop;
+    route.hops = hops;
+    route.updatedMs = nowMs;
+    return true;
+}
+
+void LoRaRouteTable::setStatic(LoraAddress_t destination, LoraAddress_t nextHop)
+{
+    LoRaRoute route;
+    route.destination = destination;
+    route.nextHop = nextHop;
+    route.hops = (nextHop == destination) ? 1 : 2;
+    route.isStatic = true;
+    routes[destination] = route;
+}
+
+bool LoRaRouteTable::remove(LoraAddress_t destination)
+{
+    return routes.erase(destination) > 0;
+}
+
+bool LoRaRouteTable::find(LoraAddress_t destination, uint32_t nowMs, LoRaRoute &out) const
+{
+    auto it = routes.find(destination);
+    if (it == routes.end() || !isFresh(it->second, nowMs))
+        return false;
+    out = it->second;
+    return true;
+}
+
+void LoRaRouteTable::expire(uint32_t nowMs)
+{
+    for (auto it = routes.begin(); it != routes.end();) {
+        if (!isFresh(it->second, nowMs)) {
+            it = routes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<LoRaRoute> LoRaRouteTable::list(uint32_t nowMs) const
+{
+    std::vector<LoRaRoute> result;
+    for (const auto &pair : routes) {
+        if (isFresh(pair.second, nowMs))
+            result.push_back(pair.second);
+    }
+    return result;
+}
+
+uint8_t LoRaRouteTable::serializeAdvert(uint8_t *buffer, uint32_t nowMs) const
+{
+    uint8_t count = 0;
+    for (const auto &pair : routes) {
+        const LoRaRoute &route = pair.second;
+        if (count >= PacketRouteAdvert::MAX_ENTRIES)
+            break;
+        if (!isFresh(route, nowMs) || route.hops >= LORA_RELAY_MAX_HOPS)
+            continue;
+        buffer[1 + count * PacketRouteAdvert::ENTRY_SIZE] = route.destination;
+        buffer[2 + count * PacketRouteAdvert::ENTRY_SIZE] = route.hops;
+        count++;
+    }
+    buffer[0] = count;
+    return 1 + count * PacketRouteAdvert::ENTRY_SIZE;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DUPLICATE FILTER
+// ═══════════════════════════════════════════════════════════════════════════
+bool LoRaRelayDuplicateFilter::check(LoraAddress_t origin, PacketId_t packetId, uint32_t nowMs)
+{
+    for (const Entry &entry : entries) {
+        if (entry.valid && entry.origin == origin && entry.packetId == packetId &&
+            nowMs - entry.ms < LORA_RELAY_DUP_WINDOW_MS)
+            return true;
+    }
+    Entry &slot = entries[next];
+    slot.origin = origin;
+    slot.packetId = packetId;
+    slot.valid = true;
+    slot.ms = nowMs;
+    next = (next + 1) % SIZE;
+    return false;
+}
@@ -0,0 +1,72 @@
+// lora_routing.hpp - Next-hop route table and relay duplicate filter
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <vector>
+#include "lora_config.h"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ROUTE TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+struct LoRaRoute
+{
+    LoraAddress_t destination = 0;
+    LoraAddress_t nextHop = 0;      // == destination - прямая связь
+    uint8_t hops = 0;               // Передач до destination
+    bool isStatic = false;          // setRoute(): не устаревает и не переучивается
+    uint32_t updatedMs = 0;
+
+    bool isDirect() const { return nextHop == destination; }
+    String toString() const;
+};
+
+// Дистанционно-векторная таблица: маршрут заменяется более коротким, а от того же
+// next hop - любым (в том числе длиннее). Устаревшие записи пропускаются при поиске
+// и удаляются expire(). Без блокировок: LoRaCore держит её под routesMutex.
+class LoRaRouteTable
+{
+public:
+    // true - появилось новое направление или сменился next hop
+    bool learn(LoraAddress_t destination, LoraAddress_t nextHop, uint8_t hops, uint32_t nowMs);
+    void setStatic(LoraAddress_t destination, LoraAddress_t nextHop);
+    bool remove(LoraAddress_t destination);
+    void clear() { routes.clear(); }
+
+    bool find(LoraAddress_t destination, uint32_t nowMs, LoRaRoute &out) const;
+    void expire(uint32_t nowMs);
+    std::vector<LoRaRoute> list(uint32_t nowMs) const;
+
+    // Payload PacketRouteAdvert: свежие маршруты короче LORA_RELAY_MAX_HOPS. Возвращает длину.
+    uint8_t serializeAdvert(uint8_t *buffer, uint32_t nowMs) const;
+
+private:
+    std::map<LoraAddress_t, LoRaRoute> routes;
+
+    static bool isFresh(const LoRaRoute &route, uint32_t nowMs) {
+        return route.isStatic || nowMs - route.updatedMs < LORA_ROUTE_TIMEOUT_MS;
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DUPLICATE FILTER
+// ═══════════════════════════════════════════════════════════════════════════
+// Кольцо последних пересланных (origin, packetId): один кадр, пришедший к ретранслятору
+// разными путями, уходит дальше один раз. Окно короче retry timeout - повтор origin проходит.
+class LoRaRelayDuplicateFilter
+{
+public:
+    // true - кадр уже пересылался в пределах окна; иначе запоминает его
+    bool check(LoraAddress_t origin, PacketId_t packetId, uint32_t nowMs);
+
+private:
+    struct Entry
+    {
+        LoraAddress_t origin = 0;
+        PacketId_t packetId = 0;
+        bool valid = false;
+        uint32_t ms = 0;
+    };
+    static constexpr uint8_t SIZE = 16;
+    Entry entries[SIZE];
+    uint8_t next = 0;
+};
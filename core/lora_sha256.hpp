@@ -0,0 +1,25 @@
+// lora_sha256.hpp - SHA-256 for end-to-end block transfer checks
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+static constexpr uint8_t LORA_SHA256_SIZE = 32;
+
+// Потоковый SHA-256 (FIPS 180-4). Переносимый код: одинаковый результат на ESP32 и host
+class LoRaSha256
+{
+public:
+    LoRaSha256() { reset(); }
+
+    void reset();
+    void update(const uint8_t *data, size_t len);
+    void finish(uint8_t out[LORA_SHA256_SIZE]);
+
+private:
+    void transform(const uint8_t block[64]);
+
+    uint32_t state[8];
+    uint64_t totalLen;
+    uint8_t buffer[64];
+    uint8_t bufferLen;
+};
@@ -0,0 +1,125 @@
+// lora_tdma.cpp - TDMA superframe timing and master-side slot scheduler
+#include "lora_tdma.hpp"
+#include <algorithm>
+#include "lora_helpers.hpp"
+
+const char *tdmaRoleName(TdmaRole role)
+{
+    switch (role) {
+    case TdmaRole::MASTER: return "master";
+    case TdmaRole::SLAVE:  return "slave";
+    default:               return "off";
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SUPERFRAME TIMING
+// ═══════════════════════════════════════════════════════════════════════════
+bool tdmaFindSlot(const LoRaTdmaLayout &layout, LoraAddress_t owner, LoRaTdmaWindow &out)
+{
+    uint32_t offsetUs = 0;
+    for (uint8_t i = 0; i < layout.slotCount; i++) {
+        offsetUs += layout.guardUs();
+        uint32_t lenUs = layout.slots[i].lenUnits * layout.unitUs();
+        if (layout.slots[i].owner == owner) {
+            out.offsetUs = offsetUs;
+            out.lenUs = lenUs;
+            return true;
+        }
+        offsetUs += lenUs;
+    }
+    return false;
+}
+
+uint32_t tdmaSuperframeUs(const LoRaTdmaLayout &layout)
+{
+    uint32_t units = layout.guardUnits;
+    for (uint8_t i = 0; i < layout.slotCount; i++) {
+        units += layout.guardUnits + layout.slots[i].lenUnits;
+    }
+    return units * layout.unitUs();
+}
+
+uint32_t tdmaFrameBudgetUs(uint8_t profileIndex, size_t frameBytes, uint32_t guardUs)
+{
+    return profileTimeOnAirUs(profileIndex, frameBytes) + guardUs;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCHEDULER (MASTER)
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaTdmaScheduler::reset()
+{
+    members.clear();
+    superframe = 0;
+}
+
+bool LoRaTdmaScheduler::onRequest(LoraAddress_t address, uint32_t airtimeMs)
+{
+    bool joined = members.find(address) == members.end();
+    Member &member = members[address];
+    member.demandMs = airtimeMs;
+    member.lastHeard = superframe;
+    return joined;
+}
+
+void LoRaTdmaScheduler::onHeard(LoraAddress_t address)
+{
+    auto it = members.find(address);
+    if (it != members.end()) {
+        it->second.lastHeard = superframe;
+    }
+}
+
+uint32_t LoRaTdmaScheduler::build(LoraAddress_t self, uint8_t profileIndex, uint32_t ownDemandMs,
+                                  LoRaTdmaLayout &out)
+{
+    superframe++;
+    for (auto it = members.begin(); it != members.end();) {
+        if (superframe - it->second.lastHeard > LORA_TDMA_MEMBER_TIMEOUT) {
+            it = members.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Слот slave - до LORA_TDMA_MAX_SLOT_FRAMES длинных кадров, слот master - столько же на каждого
+    // участника: команды и ACK для всех slave идут в нём
+    uint32_t minSlotMs = (profileTimeOnAirUs(profileIndex, LORA_TDMA_MIN_SLOT_BYTES) + 999) / 1000;
+    uint32_t maxFrameMs = (tdmaFrameBudgetUs(profileIndex, offsetof(LoRaPacket, payload) + LORA_BASE_MTU, LORA_TDMA_GUARD_MS * 1000) + 999) / 1000;
+    uint32_t maxDemandMs = LORA_TDMA_MAX_SLOT_FRAMES * maxFrameMs;
+    // Суперкадр растёт с числом участников, а вход - одна попытка за суперкадр: позиций запросов
+    // тоже больше, иначе последние slave ждут слот минутами
+    size_t contention = LORA_TDMA_CONTENTION_FRAMES + members.size() / LORA_TDMA_CONTENTION_PER_MEMBERS;
+    uint32_t requestMs = (contention *
+                          tdmaFrameBudgetUs(profileIndex, LORA_TDMA_REQUEST_FRAME_SIZE, LORA_TDMA_GUARD_MS * 1000) + 999) / 1000;
+
+    uint32_t slotMs[LORA_TDMA_MAX_SLOTS];
+    out.slotCount = 0;
+    size_t masterShare = std::max<size_t>(1, std::min<size_t>(members.size(), LORA_TDMA_MAX_SLOTS - 2));
+    slotMs[out.slotCount] = std::min<uint32_t>(ownDemandMs, maxDemandMs * masterShare) + minSlotMs;
+    out.slots[out.slotCount++].owner = self;
+    for (auto &pair : members) {
+        if (out.slotCount >= LORA_TDMA_MAX_SLOTS - 1)
+            break;
+        Member &member = pair.second;
+        slotMs[out.slotCount] = std::min(member.demandMs, maxDemandMs) + minSlotMs;
+        out.slots[out.slotCount++].owner = pair.first;
+        member.demandMs = 0;
+    }
+    slotMs[out.slotCount] = requestMs;
+    out.slots[out.slotCount++].owner = DEVICE_ID_BROADCAST;
+
+    // Единица - чтобы самый длинный слот уместился в байт
+    uint32_t longestMs = *std::max_element(slotMs, slotMs + out.slotCount);
+    uint32_t unitMs = std::min<uint32_t>(255, std::max<uint32_t>(1, (longestMs + 254) / 255));
+    auto toUnits = [unitMs](uint32_t ms) {
+        return (uint8_t)std::min<uint32_t>(255, std::max<uint32_t>(1, (ms + unitMs - 1) / unitMs));
+    };
+    out.unitMs = unitMs;
+    out.guardUnits = toUnits(LORA_TDMA_GUARD_MS);
+    for (uint8_t i = 0; i < out.slotCount; i++) {
+        out.slots[i].lenUnits = toUnits(slotMs[i]);
+    }
+    return superframe;
+}
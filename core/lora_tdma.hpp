@@ -0,0 +1,69 @@
+// lora_tdma.hpp - TDMA superframe timing and master-side slot scheduler
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include "lora_config.h"
+#include "packets/packet_tdma.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ROLE
+// ═══════════════════════════════════════════════════════════════════════════
+enum class TdmaRole : uint8_t
+{
+    OFF,
+    MASTER,     // Рассылает маяки и раздаёт слоты
+    SLAVE       // Передаёт в своём слоте, пока слышит маяки
+};
+
+const char *tdmaRoleName(TdmaRole role);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SUPERFRAME TIMING
+// ═══════════════════════════════════════════════════════════════════════════
+// Окно слота относительно конца маяка
+struct LoRaTdmaWindow
+{
+    uint32_t offsetUs = 0;
+    uint32_t lenUs = 0;
+};
+
+// false - у owner нет слота в этом суперкадре
+bool tdmaFindSlot(const LoRaTdmaLayout &layout, LoraAddress_t owner, LoRaTdmaWindow &out);
+
+// От конца маяка до начала следующего
+uint32_t tdmaSuperframeUs(const LoRaTdmaLayout &layout);
+
+// Кадр в слоте: время в эфире на профиле + guard до следующего кадра
+uint32_t tdmaFrameBudgetUs(uint8_t profileIndex, size_t frameBytes, uint32_t guardUs);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SCHEDULER (MASTER)
+// ═══════════════════════════════════════════════════════════════════════════
+// Слот slave = заявленное время очереди (не больше LORA_TDMA_MAX_SLOT_FRAMES кадров
+// максимальной длины) + минимальный слот для следующего запроса. Заявка расходуется
+// одним суперкадром. Без блокировок: LoRaCore держит его под tdmaMutex.
+class LoRaTdmaScheduler
+{
+public:
+    void reset();
+
+    // Запрос slave: вход в сеть или остаток очереди. true - новый участник
+    bool onRequest(LoraAddress_t address, uint32_t airtimeMs);
+    // Любой кадр от участника подтверждает, что он жив
+    void onHeard(LoraAddress_t address);
+
+    // Раскладка следующего суперкадра: слот master, слоты участников по адресам, слот конкуренции.
+    // Возвращает номер суперкадра для счётчика маяка.
+    uint32_t build(LoraAddress_t self, uint8_t profileIndex, uint32_t ownDemandMs, LoRaTdmaLayout &out);
+
+    size_t memberCount() const { return members.size(); }
+
+private:
+    struct Member
+    {
+        uint32_t demandMs = 0;
+        uint32_t lastHeard = 0;     // Суперкадр последнего кадра от участника
+    };
+    std::map<LoraAddress_t, Member> members;
+    uint32_t superframe = 0;
+};
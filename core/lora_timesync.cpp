@@ -0,0 +1,310 @@
+// lora_timesync.cpp - Network time: heartbeat time stamps, per-peer clock offset and drift
+#include "lora_timesync.hpp"
+#include "packets/packet_tdma.hpp"
+#include <algorithm>
+#include <math.h>
+
+static constexpr int32_t START_LATENCY_EMA = 4;     // Вес новой задержки запуска: 1/4
+
+String LoRaNetworkTime::toString() const
+{
+    if (!synced) {
+        return String("not synced");
+    }
+    char s[60];
+    snprintf(s, sizeof(s), "synced to %u, stratum %u, +-%lu us", reference, stratum, (unsigned long)errorUs);
+    return String(s);
+}
+
+String LoRaPeerClock::toString() const
+{
+    char s[110];
+    snprintf(s, sizeof(s), "offset=%ld us drift=%+.1f ppm +-%lu us (%u samples, stratum %u, %lu s ago)",
+             (long)offsetUs, driftPpm, (unsigned long)errorUs, samples, stratum, (unsigned long)(ageMs / 1000));
+    return String(s);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRAILER
+// ═══════════════════════════════════════════════════════════════════════════
+uint8_t timeTrailerBodyLen(const uint8_t *payload, uint8_t len)
+{
+    if (len == sizeof(uint32_t) + LORA_TIME_TRAILER_SIZE) {
+        return sizeof(uint32_t);
+    }
+    if (len < LORA_TDMA_BEACON_HEADER_SIZE + LORA_TIME_TRAILER_SIZE || len > MAX_LORA_PAYLOAD) {
+        return 0;
+    }
+    uint8_t bodyLen = len - LORA_TIME_TRAILER_SIZE;
+    uint32_t count;
+    LoRaTdmaLayout layout;
+    return PacketTdmaBeacon::deserialize(payload, bodyLen, count, layout) ? bodyLen : 0;
+}
+
+bool timeTrailerFits(const uint8_t *payload, uint8_t len)
+{
+    if (len + LORA_TIME_TRAILER_SIZE > LORA_BASE_MTU) {
+        return false;
+    }
+    uint32_t count;
+    LoRaTdmaLayout layout;
+    return len == sizeof(uint32_t) || PacketTdmaBeacon::deserialize(payload, len, count, layout);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// STAMPER
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaTimeStamper::stamp(LoRaTimeTrailer &trailer, PacketId_t packetId, uint32_t startUs, uint32_t airtimeUs)
+{
+    trailer.prevId = corrId;
+    trailer.prevCorrUs = corrUs;
+    predictedUs = startUs + airtimeUs;
+    stampedUs = predictedUs + startLatencyUs;
+    stampedId = packetId;
+    stamped = true;
+    trailer.stampUs = stampedUs;
+}
+
+void LoRaTimeStamper::onTxDone(uint32_t txDoneUs)
+{
+    if (!stamped) {
+        return;
+    }
+    stamped = false;
+    int32_t error = (int32_t)(txDoneUs - stampedUs);
+    corrId = stampedId;
+    corrUs = (error > INT16_MIN && error <= INT16_MAX) ? (int16_t)error : LORA_TIME_NO_CORR;
+
+    int32_t latency = (int32_t)(txDoneUs - predictedUs);
+    if (latency < INT16_MIN || latency > INT16_MAX) {
+        return;
+    }
+    startLatencyUs = latencyKnown ? startLatencyUs + (latency - startLatencyUs) / START_LATENCY_EMA : latency;
+    latencyKnown = true;
+}
+
+// Поправка предыдущей метки остаётся: её ещё никто не получил
+void LoRaTimeStamper::onTxFailed()
+{
+    stamped = false;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CLOCK TABLE
+// ═══════════════════════════════════════════════════════════════════════════
+static const uint8_t NEWEST_OFFSET = LORA_TIMESYNC_SAMPLES - 1;
+
+int32_t LoRaTimeSync::onTrailer(LoraAddress_t peerAddress, PacketId_t packetId, const LoRaTimeTrailer &trailer,
+                                uint32_t rxIrqUs)
+{
+    uint32_t rxUs = rxIrqUs - LORA_TIMESYNC_RX_DELAY_US;
+    auto it = peers.find(peerAddress);
+    if (it == peers.end()) {
+        if (peers.size() >= LORA_TIMESYNC_MAX_PEERS) {
+            // Вытесняется сосед с самой старой меткой
+            auto oldest = peers.begin();
+            for (auto p = peers.begin(); p != peers.end(); ++p) {
+                const Sample &a = p->second.samples[(p->second.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+                const Sample &b = oldest->second.samples[(oldest->second.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+                if ((uint32_t)(rxUs - a.localUs) > (uint32_t)(rxUs - b.localUs)) {
+                    oldest = p;
+                }
+            }
+            peers.erase(oldest);
+        }
+        it = peers.emplace(peerAddress, Peer()).first;
+    }
+    Peer &peer = it->second;
+    if (peer.count > 0 && !fresh(peer, rxUs)) {
+        peer = Peer();
+    }
+    peer.stratum = trailer.stratum;
+
+    // Поправка отправителя: его прошлый кадр ушёл в эфир не точно в предсказанный момент
+    if (trailer.prevCorrUs != LORA_TIME_NO_CORR) {
+        for (uint8_t i = 0; i < peer.count; i++) {
+            Sample &s = peer.samples[i];
+            if (s.packetId == trailer.prevId && !s.refined) {
+                s.offsetUs += trailer.prevCorrUs;
+                s.refined = true;
+                uint16_t corr = (uint16_t)abs(trailer.prevCorrUs);
+                peer.corrUs = peer.corrKnown ? (uint16_t)((3 * peer.corrUs + corr) / 4) : corr;
+                peer.corrKnown = true;
+                fit(peer);
+                break;
+            }
+        }
+    }
+
+    Sample sample;
+    sample.localUs = rxUs;
+    sample.offsetUs = trailer.stampUs - rxUs;
+    sample.packetId = packetId;
+
+    int32_t deviation = -1;
+    if (peer.count >= 3) {
+        deviation = abs((int32_t)(sample.offsetUs - predict(peer, rxUs)));
+        if (deviation > LORA_TIMESYNC_OUTLIER_US) {
+            // Одиночный выброс отбрасывается, серия - часы соседа перезапущены
+            if (++peer.rejected < LORA_TIMESYNC_MAX_REJECTS) {
+                return deviation;
+            }
+            uint8_t stratum = peer.stratum;
+            peer = Peer();
+            peer.stratum = stratum;
+        }
+    }
+    peer.samples[peer.head] = sample;
+    peer.head = (peer.head + 1) % LORA_TIMESYNC_SAMPLES;
+    if (peer.count < LORA_TIMESYNC_SAMPLES) {
+        peer.count++;
+    }
+    peer.rejected = 0;
+    fit(peer);
+    return deviation;
+}
+
+// Регрессия в координатах от последней выборки: разности по модулю 2^32 укладываются в int32
+void LoRaTimeSync::fit(Peer &peer)
+{
+    const Sample &newest = peer.samples[(peer.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+    peer.baseLocalUs = newest.localUs;
+    peer.baseOffsetUs = newest.offsetUs;
+    peer.skew = 0;
+    peer.skewErrorPpm = LORA_TIMESYNC_MAX_DRIFT_PPM;
+    peer.rmsUs = 0;
+    uint8_t n = peer.count;
+    if (n < 2) {
+        return;
+    }
+
+    double xs[LORA_TIMESYNC_SAMPLES], ys[LORA_TIMESYNC_SAMPLES];
+    double xMean = 0, yMean = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        xs[i] = (double)(int32_t)(peer.samples[i].localUs - newest.localUs);
+        ys[i] = (double)(int32_t)(peer.samples[i].offsetUs - newest.offsetUs);
+        xMean += xs[i];
+        yMean += ys[i];
+    }
+    xMean /= n;
+    yMean /= n;
+    double sxx = 0, sxy = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        sxx += (xs[i] - xMean) * (xs[i] - xMean);
+        sxy += (xs[i] - xMean) * (ys[i] - yMean);
+    }
+    if (sxx <= 0) {
+        return;
+    }
+    const double maxSkew = LORA_TIMESYNC_MAX_DRIFT_PPM * 1e-6;
+    double skew = sxy / sxx;
+    skew = skew > maxSkew ? maxSkew : (skew < -maxSkew ? -maxSkew : skew);
+    double intercept = yMean - skew * xMean;
+
+    peer.skew = skew;
+    peer.baseOffsetUs = newest.offsetUs + (int32_t)lround(intercept);
+    if (n > 2) {
+        double ssr = 0;
+        for (uint8_t i = 0; i < n; i++) {
+            double r = ys[i] - (intercept + skew * xs[i]);
+            ssr += r * r;
+        }
+        double rms = sqrt(ssr / (n - 2));
+        peer.rmsUs = (uint32_t)lround(rms);
+        // Стандартная ошибка наклона
+        peer.skewErrorPpm = (float)std::min<double>(rms / sqrt(sxx) * 1e6, LORA_TIMESYNC_MAX_DRIFT_PPM);
+    }
+}
+
+uint32_t LoRaTimeSync::predict(const Peer &peer, uint32_t localUs)
+{
+    int32_t dt = (int32_t)(localUs - peer.baseLocalUs);
+    return peer.baseOffsetUs + (int32_t)lround(peer.skew * dt);
+}
+
+// Разброс выборок вокруг прямой (2 sigma) + джиттер меток + неуточнённая последняя метка +
+// уход часов с последней метки
+uint32_t LoRaTimeSync::errorUs(const Peer &peer, uint32_t nowUs)
+{
+    const Sample &newest = peer.samples[(peer.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+    uint32_t ageUs = nowUs - newest.localUs;
+    float ppm = LORA_TIMESYNC_HOLDOVER_PPM + 2 * peer.skewErrorPpm;
+    return LORA_TIMESYNC_BASE_ERROR_US + 2 * peer.rmsUs + (newest.refined ? 0 : peer.corrUs) +
+           (uint32_t)(ageUs * 1e-6f * ppm);
+}
+
+bool LoRaTimeSync::fresh(const Peer &peer, uint32_t nowUs)
+{
+    const Sample &newest = peer.samples[(peer.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+    return peer.count > 0 && nowUs - newest.localUs < LORA_TIMESYNC_TIMEOUT_MS * 1000UL;
+}
+
+const LoRaTimeSync::Peer *LoRaTimeSync::reference(uint32_t nowUs, LoraAddress_t &address) const
+{
+    const Peer *best = nullptr;
+    uint32_t bestError = 0;
+    for (const auto &p : peers) {
+        if (p.second.stratum != 0 || !fresh(p.second, nowUs)) {
+            continue;
+        }
+        uint32_t error = errorUs(p.second, nowUs);
+        if (!best || error < bestError) {
+            best = &p.second;
+            bestError = error;
+            address = p.first;
+        }
+    }
+    return best;
+}
+
+bool LoRaTimeSync::peerClock(LoraAddress_t peerAddress, uint32_t nowUs, LoRaPeerClock &out) const
+{
+    auto it = peers.find(peerAddress);
+    if (it == peers.end() || !fresh(it->second, nowUs)) {
+        return false;
+    }
+    const Peer &peer = it->second;
+    const Sample &newest = peer.samples[(peer.head + NEWEST_OFFSET) % LORA_TIMESYNC_SAMPLES];
+    out.offsetUs = (int32_t)predict(peer, nowUs);
+    out.driftPpm = (float)(peer.skew * 1e6);
+    out.errorUs = errorUs(peer, nowUs);
+    out.samples = peer.count;
+    out.stratum = peer.stratum;
+    out.ageMs = (nowUs - newest.localUs) / 1000;
+    return true;
+}
+
+LoRaNetworkTime LoRaTimeSync::networkTime(bool root, uint32_t localUs) const
+{
+    LoRaNetworkTime t;
+    t.us = localUs;
+    if (root) {
+        t.synced = true;
+        t.stratum = 0;
+        return t;
+    }
+    LoraAddress_t address;
+    const Peer *ref = reference(localUs, address);
+    if (!ref) {
+        return t;
+    }
+    t.synced = true;
+    t.us = localUs + predict(*ref, localUs);
+    t.errorUs = errorUs(*ref, localUs);
+    t.reference = address;
+    t.stratum = 1;
+    return t;
+}
+
+bool LoRaTimeSync::toLocalUs(uint32_t networkUs, uint32_t nowUs, uint32_t &localUs) const
+{
+    LoraAddress_t address;
+    const Peer *ref = reference(nowUs, address);
+    if (!ref) {
+        return false;
+    }
+    // Второй шаг учитывает дрейф между сейчас и искомым моментом
+    localUs = networkUs - predict(*ref, nowUs);
+    localUs = networkUs - predict(*ref, localUs);
+    return true;
+}
@@ -0,0 +1,132 @@
+// lora_timesync.hpp - Network time: heartbeat time stamps, per-peer clock offset and drift
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include "lora_config.h"
+#include "packets/packet_heartbeat.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// NETWORK TIME
+// ═══════════════════════════════════════════════════════════════════════════
+// Сетевое время - micros() корня (по умолчанию DEVICE_ID_MASTER). Корень: synced, errorUs = 0.
+struct LoRaNetworkTime
+{
+    bool synced = false;
+    uint32_t us = 0;                            // Без синхронизации - свой micros()
+    uint32_t errorUs = 0;                       // Заявленная точность: |us - время корня| не больше
+    LoraAddress_t reference = DEVICE_ID_BROADCAST;  // Узел, по которому идёт время
+    uint8_t stratum = LORA_TIME_UNSYNCED;
+
+    // "synced to 1, stratum 1, +-120 us" / "not synced"
+    String toString() const;
+};
+
+// Часы соседа относительно своих: его micros() = свой micros() + offsetUs (по модулю 2^32)
+struct LoRaPeerClock
+{
+    int32_t offsetUs = 0;
+    float driftPpm = 0;                         // Его часы быстрее наших на driftPpm
+    uint32_t errorUs = 0;
+    uint8_t samples = 0;
+    uint8_t stratum = LORA_TIME_UNSYNCED;
+    uint32_t ageMs = 0;                         // С последней метки
+
+    // "offset=-1234567 us drift=+12.3 ppm +-80 us (8 samples, stratum 0, 3 s ago)"
+    String toString() const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRAILER
+// ═══════════════════════════════════════════════════════════════════════════
+// Метка - последние LORA_TIME_TRAILER_SIZE байт: обычный heartbeat [count:4] + метка,
+// маяк TDMA - раскладка + метка. Длины не пересекаются: heartbeat с меткой - 12 байт,
+// маяк - нечётной длины. Возвращает длину heartbeat без метки, 0 - метки нет.
+uint8_t timeTrailerBodyLen(const uint8_t *payload, uint8_t len);
+
+// В heartbeat длины len есть место для метки и это heartbeat, который узнает приёмник
+bool timeTrailerFits(const uint8_t *payload, uint8_t len);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// STAMPER (ОТПРАВИТЕЛЬ)
+// ═══════════════════════════════════════════════════════════════════════════
+// Только задача радио. Метка - ожидаемый IRQ TX done: начало передачи + время в эфире +
+// выученная задержка запуска передачи (SPI, переход в TX). После TX done ошибка предсказания
+// уходит в следующую метку как поправка, а её среднее - в задержку запуска.
+class LoRaTimeStamper
+{
+public:
+    // Перед startTransmit(): заполняет prevId, prevCorrUs, stampUs
+    void stamp(LoRaTimeTrailer &trailer, PacketId_t packetId, uint32_t startUs, uint32_t airtimeUs);
+    void onTxDone(uint32_t txDoneUs);
+    void onTxFailed();
+
+    int32_t getStartLatencyUs() const { return startLatencyUs; }
+
+private:
+    bool stamped = false;
+    PacketId_t stampedId = 0;
+    uint32_t stampedUs = 0;
+    uint32_t predictedUs = 0;                   // Без выученной задержки
+
+    PacketId_t corrId = 0;
+    int16_t corrUs = LORA_TIME_NO_CORR;
+    int32_t startLatencyUs = 0;
+    bool latencyKnown = false;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CLOCK TABLE (ПРИЁМНИК)
+// ═══════════════════════════════════════════════════════════════════════════
+// Выборка на метку: offset = stampUs - IRQ приёма. Поправка следующей метки уточняет выборку
+// prevId. Смещение и дрейф - линейная регрессия по последним LORA_TIMESYNC_SAMPLES выборкам.
+// Без блокировок: LoRaCore держит таблицу под timeSyncMutex.
+class LoRaTimeSync
+{
+public:
+    // Метка от peer. Возвращает |отклонение от прогноза| в мкс, -1 - прогноза ещё нет
+    int32_t onTrailer(LoraAddress_t peer, PacketId_t packetId, const LoRaTimeTrailer &trailer, uint32_t rxIrqUs);
+
+    bool peerClock(LoraAddress_t peer, uint32_t nowUs, LoRaPeerClock &out) const;
+
+    // root - этот узел корень. localUs - момент по своим часам
+    LoRaNetworkTime networkTime(bool root, uint32_t localUs) const;
+    // Момент сетевого времени по своим часам. false - нет синхронизации
+    bool toLocalUs(uint32_t networkUs, uint32_t nowUs, uint32_t &localUs) const;
+
+    void reset() { peers.clear(); }
+    size_t peerCount() const { return peers.size(); }
+
+private:
+    struct Sample
+    {
+        uint32_t localUs = 0;
+        uint32_t offsetUs = 0;                  // Его micros() - наш, по модулю 2^32
+        PacketId_t packetId = 0;
+        bool refined = false;                   // Поправка отправителя учтена
+    };
+    struct Peer
+    {
+        Sample samples[LORA_TIMESYNC_SAMPLES];
+        uint8_t count = 0;
+        uint8_t head = 0;                       // Следующая запись
+        uint8_t rejected = 0;                   // Выбросов подряд
+        uint8_t stratum = LORA_TIME_UNSYNCED;
+        // Прямая регрессии: offset(t) = baseOffsetUs + skew * (t - baseLocalUs)
+        uint32_t baseLocalUs = 0;
+        uint32_t baseOffsetUs = 0;
+        double skew = 0;
+        float skewErrorPpm = LORA_TIMESYNC_MAX_DRIFT_PPM;
+        uint32_t rmsUs = 0;                     // Разброс выборок вокруг прямой
+        uint16_t corrUs = LORA_TIMESYNC_START_ERROR_US; // Средняя |поправка|: ошибка ещё не уточнённой метки
+        bool corrKnown = false;
+    };
+
+    static void fit(Peer &peer);
+    static uint32_t predict(const Peer &peer, uint32_t localUs);
+    static uint32_t errorUs(const Peer &peer, uint32_t nowUs);
+    static bool fresh(const Peer &peer, uint32_t nowUs);
+    // Корень с наименьшей ошибкой, nullptr - нет
+    const Peer *reference(uint32_t nowUs, LoraAddress_t &address) const;
+
+    std::map<LoraAddress_t, Peer> peers;
+};
@@ -0,0 +1,185 @@
+// lora_trace.cpp - Per-packet lifecycle timestamps and per-stage latency histograms
+#include "lora_trace.hpp"
+
+static constexpr size_t TRACE_SLOTS = 256; // Все значения PacketId_t
+
+String LoRaPacketTrace::toString() const
+{
+    uint32_t retryDelayUs = retries ? txStartUs - firstTxEndUs : 0;
+    char ack[24];
+    if (dropped) {
+        snprintf(ack, sizeof(ack), "dropped");
+    } else if (ackRequired) {
+        snprintf(ack, sizeof(ack), "%lums", (unsigned long)((ackUs - txEndUs) / 1000));
+    } else {
+        snprintf(ack, sizeof(ack), "-");
+    }
+    uint32_t endUs = ackRequired && !dropped ? ackUs : txEndUs;
+
+    char s[200];
+    snprintf(s, sizeof(s),
+             "[TRACE] id=%u T=%c to=%u try=%u enq=%luus queue=%lums radio=%luus air=%luus retry=%lums ack=%s total=%lums",
+             packetId, packetType, receiverId, retries, (unsigned long)(acceptedUs - enqueueUs),
+             (unsigned long)((dequeueUs - queuedUs) / 1000), (unsigned long)(txStartUs - dequeueUs),
+             (unsigned long)(txEndUs - txStartUs), (unsigned long)(retryDelayUs / 1000), ack,
+             (unsigned long)((endUs - enqueueUs) / 1000));
+    return String(s);
+}
+
+void LoRaPacketTracer::setEnabled(bool enable, uint16_t sample)
+{
+    if (enable && traces.empty()) {
+        traces.resize(TRACE_SLOTS);
+        active.assign(TRACE_SLOTS, 0);
+        rx.resize(TRACE_SLOTS);
+    }
+    sampleEvery = sample;
+    enabled = enable;
+}
+
+LoRaPacketTrace *LoRaPacketTracer::find(PacketId_t id)
+{
+    if (!enabled || !active[id])
+        return nullptr;
+    return &traces[id];
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// OUTGOING
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaPacketTracer::begin(PacketId_t id, LoraAddress_t receiverId, uint8_t packetType, bool ackRequired)
+{
+    if (!enabled)
+        return;
+    LoRaPacketTrace &t = traces[id];
+    t = LoRaPacketTrace();
+    t.packetId = id;
+    t.receiverId = receiverId;
+    t.packetType = packetType;
+    t.ackRequired = ackRequired;
+    t.enqueueUs = micros();
+    active[id] = true;
+}
+
+void LoRaPacketTracer::cancel(PacketId_t id)
+{
+    if (enabled)
+        active[id] = false;
+}
+
+void LoRaPacketTracer::queued(PacketId_t id, bool retry)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t)
+        return;
+    uint32_t now = micros();
+    if (retry) {
+        t->retries++;
+    } else {
+        t->acceptedUs = now;
+        metrics.record(LORA_HIST_ENQUEUE_WAIT_US, now - t->enqueueUs);
+    }
+    // Уже выбран sendTask - время в очереди учтено как 0
+    if (++t->queuedCount > t->dequeuedCount)
+        t->queuedUs = now;
+}
+
+void LoRaPacketTracer::dequeued(PacketId_t id)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t)
+        return;
+    t->dequeueUs = micros();
+    if (++t->dequeuedCount > t->queuedCount)
+        t->queuedUs = t->dequeueUs;
+    metrics.record(LORA_HIST_QUEUE_WAIT_MS, (t->dequeueUs - t->queuedUs) / 1000);
+}
+
+void LoRaPacketTracer::txStart(PacketId_t id, uint32_t us)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t)
+        return;
+    t->txStartUs = us ? us : micros();
+    metrics.record(LORA_HIST_RADIO_WAIT_US, t->txStartUs - t->dequeueUs);
+}
+
+bool LoRaPacketTracer::txEnd(PacketId_t id, bool ok, LoRaPacketTrace &out, uint32_t us)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t)
+        return false;
+    t->txEndUs = us ? us : micros();
+    if (t->firstTxEndUs == 0)
+        t->firstTxEndUs = t->txEndUs;
+    // Без ACK жизнь кадра заканчивается передачей; ошибка TX с ACK уйдёт в повтор
+    if (t->ackRequired || !ok)
+        return false;
+    metrics.record(LORA_HIST_SEND_TOTAL_MS, (t->txEndUs - t->enqueueUs) / 1000);
+    return complete(*t, out);
+}
+
+bool LoRaPacketTracer::acked(PacketId_t id, LoRaPacketTrace &out, uint32_t us)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t || t->txEndUs == 0)
+        return false;
+    t->ackUs = us ? us : micros();
+    if (t->retries)
+        metrics.record(LORA_HIST_RETRY_DELAY_MS, (t->txStartUs - t->firstTxEndUs) / 1000);
+    metrics.record(LORA_HIST_ACK_WAIT_MS, (t->ackUs - t->txEndUs) / 1000);
+    metrics.record(LORA_HIST_SEND_TOTAL_MS, (t->ackUs - t->enqueueUs) / 1000);
+    return complete(*t, out);
+}
+
+bool LoRaPacketTracer::dropped(PacketId_t id, LoRaPacketTrace &out)
+{
+    LoRaPacketTrace *t = find(id);
+    if (!t)
+        return false;
+    t->dropped = true;
+    return complete(*t, out);
+}
+
+bool LoRaPacketTracer::complete(LoRaPacketTrace &trace, LoRaPacketTrace &out)
+{
+    active[trace.packetId] = false;
+    if (sampleEvery == 0 || ++completed % sampleEvery != 0)
+        return false;
+    out = trace;
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// INCOMING
+// ═══════════════════════════════════════════════════════════════════════════
+void LoRaPacketTracer::rxQueued(PacketId_t id, LoraAddress_t senderId, uint32_t irqUs)
+{
+    if (!enabled)
+        return;
+    RxStamp &stamp = rx[id];
+    stamp.senderId = senderId;
+    stamp.irqUs = irqUs;
+    stamp.valid = true;
+}
+
+void LoRaPacketTracer::rxDelivered(PacketId_t id, LoraAddress_t senderId)
+{
+    if (!enabled)
+        return;
+    RxStamp &stamp = rx[id];
+    if (!stamp.valid || stamp.senderId != senderId)
+        return;
+    stamp.valid = false;
+    metrics.record(LORA_HIST_RX_DELIVERY_US, micros() - stamp.irqUs);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TX DONE TIMES
+// ═══════════════════════════════════════════════════════════════════════════
+LoRaTxTimeTable::LoRaTxTimeTable()
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        times[i].store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,109 @@
+// lora_trace.hpp - Per-packet lifecycle timestamps and per-stage latency histograms
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "lora_config.h"
+#include "lora_metrics.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// PACKET TRACE
+// ═══════════════════════════════════════════════════════════════════════════
+// Метки micros() одного исходящего кадра. Повтор перезаписывает queued/dequeue/txStart/txEnd,
+// firstTxEndUs остаётся от первой передачи. 0 - этап не наступил.
+struct LoRaPacketTrace
+{
+    PacketId_t packetId = 0;
+    LoraAddress_t receiverId = 0;
+    uint8_t packetType = 0;
+    uint8_t retries = 0;
+    bool ackRequired = false;
+    bool dropped = false;           // Выброшен после max retries
+
+    uint32_t enqueueUs = 0;         // Вход в sendPacketBase()
+    uint32_t acceptedUs = 0;        // Первая постановка в outgoingQueue
+    uint32_t queuedUs = 0;          // Последняя постановка (первая или повтор)
+    uint32_t dequeueUs = 0;         // sendTask забрал кадр
+    uint32_t txStartUs = 0;         // Задача радио взяла кадр, startTransmit()
+    uint32_t txEndUs = 0;           // IRQ TX done
+    uint32_t firstTxEndUs = 0;
+    uint32_t ackUs = 0;             // IRQ приёма кадра с ACK
+
+    // Постановок и выборок: sendTask может забрать кадр раньше, чем поставивший отметит queued
+    uint8_t queuedCount = 0;
+    uint8_t dequeuedCount = 0;
+
+    // Строка для потока трассировки: "[TRACE] id=12 T=C to=2 try=0 enq=40us queue=35ms ..."
+    String toString() const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TRACER
+// ═══════════════════════════════════════════════════════════════════════════
+// Таблица по PacketId_t (256 записей): запись живёт от sendPacketBase() до ACK/drop.
+// Каждый этап пишет своя задача в своё время, блокировок нет. Через 256 пакетов
+// id повторяется - незавершённая запись старого пакета перезаписывается.
+// Вложенные в AGR пакеты отдельно не трассируются - только сам AGR кадр.
+class LoRaPacketTracer
+{
+public:
+    explicit LoRaPacketTracer(LoRaMetrics &metrics) : metrics(metrics) {}
+
+    // sampleEvery: каждый N-й завершённый кадр уходит в поток (0 - только гистограммы)
+    void setEnabled(bool enabled, uint16_t sampleEvery = 0);
+    bool isEnabled() const { return enabled; }
+    uint16_t getSampleEvery() const { return sampleEvery; }
+
+    // ── Исходящие ──
+    void begin(PacketId_t id, LoraAddress_t receiverId, uint8_t packetType, bool ackRequired);
+    void cancel(PacketId_t id);
+    void queued(PacketId_t id, bool retry = false);
+    void dequeued(PacketId_t id);
+    // us - метка из ISR или задачи радио; 0 - micros() в момент вызова
+    void txStart(PacketId_t id, uint32_t us = 0);
+    // true и out - кадр завершён и попал в выборку потока
+    bool txEnd(PacketId_t id, bool ok, LoRaPacketTrace &out, uint32_t us = 0);
+    bool acked(PacketId_t id, LoRaPacketTrace &out, uint32_t us = 0);
+    bool dropped(PacketId_t id, LoRaPacketTrace &out);
+
+    // ── Входящие: IRQ приёма -> receive() приложения ──
+    void rxQueued(PacketId_t id, LoraAddress_t senderId, uint32_t irqUs);
+    void rxDelivered(PacketId_t id, LoraAddress_t senderId);
+
+private:
+    struct RxStamp
+    {
+        LoraAddress_t senderId = 0;
+        bool valid = false;
+        uint32_t irqUs = 0;
+    };
+
+    LoRaMetrics &metrics;
+    volatile bool enabled = false;
+    uint16_t sampleEvery = 0;
+    uint32_t completed = 0;
+    std::vector<LoRaPacketTrace> traces;    // Выделяется при первом включении
+    std::vector<uint8_t> active;             // Не vector<bool>: биты одного байта пишут разные задачи
+    std::vector<RxStamp> rx;
+
+    LoRaPacketTrace *find(PacketId_t id);
+    bool complete(LoRaPacketTrace &trace, LoRaPacketTrace &out);
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TX DONE TIMES
+// ═══════════════════════════════════════════════════════════════════════════
+// Метка IRQ TX done последней передачи своего кадра по PacketId_t - всегда, без трассировки.
+// Пишет задача радио, читает receiveTask при ACK: атомарные значения, без мьютексов.
+class LoRaTxTimeTable
+{
+public:
+    LoRaTxTimeTable();
+
+    void set(PacketId_t id, uint32_t doneUs) { times[id].store(doneUs ? doneUs : 1, std::memory_order_relaxed); }
+    // 0 - кадр с этим ID не передавался
+    uint32_t get(PacketId_t id) const { return times[id].load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> times[256];
+};
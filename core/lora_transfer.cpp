@@ -0,0 +1,585 @@
+// lora_transfer.cpp - Block transfer: sliding window sender, bitmap receiver, data sources and sinks
+#include "lora_transfer.hpp"
+#include <algorithm>
+#include <string.h>
+
+const char *transferResultName(uint8_t result)
+{
+    switch (result) {
+    case LORA_XFER_OK:            return "ok";
+    case LORA_XFER_HASH_MISMATCH: return "hash mismatch";
+    case LORA_XFER_SINK_ERROR:    return "sink error";
+    case LORA_XFER_REJECTED:      return "rejected";
+    case LORA_XFER_CANCELLED:     return "cancelled";
+    case LORA_XFER_TIMEOUT:       return "timeout";
+    case LORA_XFER_SOURCE_ERROR:  return "source error";
+    default:                      return "?";
+    }
+}
+
+const char *transferStateName(TransferState state)
+{
+    switch (state) {
+    case TransferState::OFFERING:  return "offering";
+    case TransferState::SENDING:   return "sending";
+    case TransferState::STALLED:   return "stalled";
+    case TransferState::RECEIVING: return "receiving";
+    case TransferState::DONE:      return "done";
+    case TransferState::FAILED:    return "failed";
+    default:                       return "idle";
+    }
+}
+
+String LoRaTransferProgress::toString(bool outgoing, unsigned long nowMs) const
+{
+    if (state == TransferState::IDLE) {
+        return outgoing ? "out: idle" : "in: idle";
+    }
+    uint32_t ms = elapsedMs(nowMs);
+    uint32_t bytes = std::min<uint32_t>(size, blockCount ? (uint64_t)size * blocksDone / blockCount : 0);
+    char s[160];
+    snprintf(s, sizeof(s), "%s: %s %u, %s, %lu/%lu B (%u/%u blocks), %lu s, %lu B/s",
+             outgoing ? "out" : "in", outgoing ? "to" : "from", peer, transferStateName(state),
+             (unsigned long)bytes, (unsigned long)size, blocksDone, blockCount, (unsigned long)(ms / 1000),
+             (unsigned long)(ms ? (uint64_t)bytes * 1000 / ms : 0));
+    String info(s);
+    if (outgoing && framesSent > blocksDone) {
+        info += String(", resent ") + String(framesSent - blocksDone);
+    }
+    if (state == TransferState::FAILED) {
+        info += String(", ") + transferResultName(result);
+    }
+    return info;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// MEMORY SOURCE / SINK
+// ═══════════════════════════════════════════════════════════════════════════
+bool LoRaMemorySource::read(uint32_t offset, uint8_t *out, uint8_t len)
+{
+    if (offset > length || len > length - offset) {
+        return false;
+    }
+    memcpy(out, data + offset, len);
+    return true;
+}
+
+bool LoRaMemorySink::begin(const LoRaTransferOffer &offer)
+{
+    if (offer.size > maxSize) {
+        return false;
+    }
+    buffer.assign(offer.size, 0);
+    complete = false;
+    return true;
+}
+
+bool LoRaMemorySink::write(uint32_t offset, const uint8_t *data, uint8_t len)
+{
+    if (offset > buffer.size() || len > buffer.size() - offset) {
+        return false;
+    }
+    memcpy(buffer.data() + offset, data, len);
+    return true;
+}
+
+bool LoRaMemorySink::read(uint32_t offset, uint8_t *out, uint8_t len)
+{
+    if (offset > buffer.size() || len > buffer.size() - offset) {
+        return false;
+    }
+    memcpy(out, buffer.data() + offset, len);
+    return true;
+}
+
+bool LoRaMemorySink::finish(bool hashOk)
+{
+    complete = hashOk;
+    if (!hashOk) {
+        buffer.clear();
+    }
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SENDER
+// ═══════════════════════════════════════════════════════════════════════════
+bool LoRaTransferSender::start(LoraAddress_t peer, LoRaTransferSource &src, uint8_t kind, uint8_t id,
+                               unsigned long nowMs)
+{
+    uint32_t size = src.size();
+    uint32_t blocks = (size + LORA_XFER_BLOCK_SIZE - 1) / LORA_XFER_BLOCK_SIZE;
+    if (size == 0 || blocks > UINT16_MAX) {
+        return false;
+    }
+
+    // Хэш до первого кадра: получатель сверит его с принятым
+    LoRaSha256 sha;
+    uint8_t buffer[LORA_XFER_BLOCK_SIZE];
+    for (uint32_t offset = 0; offset < size; offset += LORA_XFER_BLOCK_SIZE) {
+        uint8_t len = (uint8_t)std::min<uint32_t>(LORA_XFER_BLOCK_SIZE, size - offset);
+        if (!src.read(offset, buffer, len)) {
+            return false;
+        }
+        sha.update(buffer, len);
+    }
+
+    source = &src;
+    offer = {};
+    offer.size = size;
+    offer.blockSize = LORA_XFER_BLOCK_SIZE;
+    offer.kind = kind;
+    sha.finish(offer.sha256);
+    transferId = id;
+    acked.assign((blocks + 7) / 8, 0);
+    sent.assign((blocks + 7) / 8, 0);
+    base = 0;
+    awaitingStatus = false;
+    abortPending = false;
+    lastHeardMs = nowMs;
+    lastOfferMs = 0;
+    pauseUntilMs = 0;
+
+    progress = LoRaTransferProgress();
+    progress.state = TransferState::OFFERING;
+    progress.peer = peer;
+    progress.kind = kind;
+    progress.size = size;
+    progress.blockCount = (uint16_t)blocks;
+    progress.startedMs = nowMs;
+    return true;
+}
+
+void LoRaTransferSender::cancel(uint8_t result, unsigned long nowMs)
+{
+    if (progress.state == TransferState::OFFERING || progress.state == TransferState::SENDING ||
+        progress.state == TransferState::STALLED) {
+        finish(result, nowMs);
+        abortPending = true;
+    }
+}
+
+void LoRaTransferSender::pause(unsigned long untilMs)
+{
+    pauseUntilMs = untilMs;
+    lastHeardMs = std::max(lastHeardMs, untilMs);
+}
+
+void LoRaTransferSender::finish(uint8_t result, unsigned long nowMs)
+{
+    progress.result = result;
+    progress.state = result == LORA_XFER_OK ? TransferState::DONE : TransferState::FAILED;
+    progress.finishedMs = nowMs ? nowMs : 1;
+    source = nullptr;
+}
+
+uint16_t LoRaTransferSender::windowEnd() const
+{
+    return (uint16_t)std::min<uint32_t>(progress.blockCount, (uint32_t)base + LORA_XFER_WINDOW_BLOCKS);
+}
+
+uint8_t LoRaTransferSender::buildData(uint16_t block, uint16_t count, bool round, uint8_t *payload)
+{
+    uint32_t offset = (uint32_t)block * offer.blockSize;
+    uint8_t len = (uint8_t)std::min<uint32_t>((uint32_t)count * offer.blockSize, offer.size - offset);
+    payload[0] = LORA_XFER_OP_DATA | (round ? LORA_XFER_FLAG_ROUND : 0);
+    payload[1] = transferId;
+    memcpy(payload + LORA_XFER_HEADER_SIZE, &block, sizeof(block));
+    if (!source || !source->read(offset, payload + LORA_XFER_DATA_HEADER_SIZE, len)) {
+        return 0;
+    }
+    for (uint16_t b = block; b < block + count; b++) {
+        sent[b >> 3] |= 1 << (b & 7);
+    }
+    progress.framesSent++;
+    return LORA_XFER_DATA_HEADER_SIZE + len;
+}
+
+uint8_t LoRaTransferSender::nextFrame(unsigned long nowMs, uint32_t frameMs, uint8_t *payload, uint8_t maxLen)
+{
+    if (abortPending) {
+        abortPending = false;
+        payload[0] = LORA_XFER_OP_ABORT;
+        payload[1] = transferId;
+        payload[2] = progress.result;
+        return LORA_XFER_HEADER_SIZE + 1;
+    }
+    if (!isActive()) {
+        return 0;
+    }
+    if ((long)(nowMs - lastHeardMs) > (long)LORA_XFER_ABORT_MS) {
+        cancel(LORA_XFER_TIMEOUT, nowMs);
+        return nextFrame(nowMs, frameMs, payload, maxLen);
+    }
+    if (progress.state == TransferState::SENDING && (long)(nowMs - lastHeardMs) > (long)LORA_XFER_STALL_MS) {
+        progress.state = TransferState::STALLED;
+        lastOfferMs = 0;
+    }
+
+    // Предложение (первое или проба после потери связи); ответ - отчёт получателя
+    if (progress.state == TransferState::OFFERING || progress.state == TransferState::STALLED) {
+        uint32_t interval = std::max<uint32_t>(LORA_XFER_OFFER_INTERVAL_MS, 4 * frameMs);
+        if (lastOfferMs && nowMs - lastOfferMs < interval) {
+            return 0;
+        }
+        lastOfferMs = nowMs;
+        payload[0] = LORA_XFER_OP_OFFER;
+        payload[1] = transferId;
+        memcpy(payload + LORA_XFER_HEADER_SIZE, &offer, sizeof(offer));
+        return LORA_XFER_HEADER_SIZE + sizeof(offer);
+    }
+
+    if ((long)(pauseUntilMs - nowMs) > 0) {
+        return 0;
+    }
+    uint16_t end = windowEnd();
+    if (awaitingStatus) {
+        // Запрос отчёта стоит в очереди за LORA_XFER_QUEUE_DEPTH кадрами, ответ - ещё кадр
+        uint32_t timeoutMs = frameMs * (LORA_XFER_QUEUE_DEPTH + 2) + LORA_XFER_STATUS_MARGIN_MS;
+        if (nowMs - awaitSinceMs < timeoutMs) {
+            return 0;
+        }
+        // Отчёт потерян: последний непринятый блок окна с повторным запросом
+        uint16_t probe = progress.blockCount - 1;
+        for (uint16_t b = end; b > base; b--) {
+            if (!isAcked(b - 1)) {
+                probe = b - 1;
+                break;
+            }
+        }
+        awaitSinceMs = nowMs;
+        uint8_t len = buildData(probe, 1, true, payload);
+        if (!len) {
+            cancel(LORA_XFER_SOURCE_ERROR, nowMs);
+            return nextFrame(nowMs, frameMs, payload, maxLen);
+        }
+        return len;
+    }
+
+    uint16_t block = end;
+    for (uint16_t b = base; b < end; b++) {
+        if (!isAcked(b) && !isSent(b)) {
+            block = b;
+            break;
+        }
+    }
+    if (block == end) {
+        // Всё подтверждено, DONE не пришёл: проба после таймаута
+        awaitingStatus = true;
+        awaitSinceMs = nowMs;
+        return 0;
+    }
+    // MTU больше одного блока: подряд идущие непосланные блоки - в один кадр
+    uint16_t count = 1;
+    uint16_t perFrame = std::max<uint16_t>(1, (maxLen - LORA_XFER_DATA_HEADER_SIZE) / offer.blockSize);
+    while (count < perFrame && block + count < end && !isAcked(block + count) && !isSent(block + count)) {
+        count++;
+    }
+    bool last = true;
+    for (uint16_t b = block + count; b < end; b++) {
+        if (!isAcked(b) && !isSent(b)) {
+            last = false;
+            break;
+        }
+    }
+    if (last) {
+        awaitingStatus = true;
+        awaitSinceMs = nowMs;
+    }
+    uint8_t len = buildData(block, count, last, payload);
+    if (!len) {
+        cancel(LORA_XFER_SOURCE_ERROR, nowMs);
+        return nextFrame(nowMs, frameMs, payload, maxLen);
+    }
+    return len;
+}
+
+void LoRaTransferSender::onFrame(const uint8_t *payload, uint8_t len, unsigned long nowMs)
+{
+    if (len < LORA_XFER_HEADER_SIZE + 1 || payload[1] != transferId || !isActive() || abortPending) {
+        return;
+    }
+    uint8_t op = payload[0] & LORA_XFER_OP_MASK;
+    if (op == LORA_XFER_OP_DONE || op == LORA_XFER_OP_ABORT) {
+        uint8_t result = payload[2];
+        if (op == LORA_XFER_OP_ABORT && result == LORA_XFER_OK) {
+            result = LORA_XFER_CANCELLED;
+        }
+        if (result == LORA_XFER_OK) {
+            progress.blocksDone = progress.blockCount;
+        }
+        finish(result, nowMs);
+        return;
+    }
+    if (op != LORA_XFER_OP_STATUS || len < LORA_XFER_STATUS_HEADER_SIZE) {
+        return;
+    }
+
+    uint16_t statusBase;
+    memcpy(&statusBase, payload + LORA_XFER_HEADER_SIZE, sizeof(statusBase));
+    statusBase = std::min(statusBase, progress.blockCount);
+    for (uint16_t b = base; b < statusBase; b++) {
+        acked[b >> 3] |= 1 << (b & 7);
+    }
+    const uint8_t *bitmap = payload + LORA_XFER_STATUS_HEADER_SIZE;
+    uint16_t bits = (len - LORA_XFER_STATUS_HEADER_SIZE) * 8;
+    for (uint16_t i = 0; i < bits && (uint32_t)statusBase + i < progress.blockCount; i++) {
+        if (bitmap[i >> 3] & (1 << (i & 7))) {
+            uint16_t b = statusBase + i;
+            acked[b >> 3] |= 1 << (b & 7);
+        }
+    }
+    while (base < progress.blockCount && isAcked(base)) {
+        base++;
+    }
+    uint16_t done = 0;
+    for (uint16_t b = 0; b < progress.blockCount; b++) {
+        done += isAcked(b);
+    }
+    progress.blocksDone = done;
+    lastHeardMs = std::max(lastHeardMs, nowMs);
+
+    // Ответ на запрос отчёта или возобновление: непринятые блоки окна - в новый раунд
+    bool round = (payload[0] & LORA_XFER_FLAG_ROUND) || progress.state != TransferState::SENDING;
+    progress.state = TransferState::SENDING;
+    if (round) {
+        awaitingStatus = false;
+        for (size_t i = 0; i < sent.size(); i++) {
+            sent[i] &= acked[i];
+        }
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RECEIVER
+// ═══════════════════════════════════════════════════════════════════════════
+uint8_t LoRaTransferReceiver::blockLen(uint16_t block) const
+{
+    uint32_t offset = (uint32_t)block * offer.blockSize;
+    return (uint8_t)std::min<uint32_t>(offer.blockSize, offer.size - offset);
+}
+
+uint8_t LoRaTransferReceiver::buildStatus(bool round, uint8_t *reply) const
+{
+    reply[0] = LORA_XFER_OP_STATUS | (round ? LORA_XFER_FLAG_ROUND : 0);
+    reply[1] = transferId;
+    memcpy(reply + LORA_XFER_HEADER_SIZE, &base, sizeof(base));
+
+    // Bitmap до последнего принятого блока после base
+    uint16_t last = base;
+    uint32_t limit = std::min<uint32_t>(progress.blockCount, (uint32_t)base + LORA_XFER_MAX_BITMAP * 8);
+    for (uint32_t b = base; b < limit; b++) {
+        if (isReceived((uint16_t)b)) {
+            last = (uint16_t)b + 1;
+        }
+    }
+    uint8_t bytes = (uint8_t)((last - base + 7) / 8);
+    uint8_t *bitmap = reply + LORA_XFER_STATUS_HEADER_SIZE;
+    memset(bitmap, 0, bytes);
+    for (uint16_t b = base; b < last; b++) {
+        if (isReceived(b)) {
+            bitmap[(b - base) >> 3] |= 1 << ((b - base) & 7);
+        }
+    }
+    return LORA_XFER_STATUS_HEADER_SIZE + bytes;
+}
+
+uint8_t LoRaTransferReceiver::buildResult(uint8_t op, uint8_t result, uint8_t *reply) const
+{
+    reply[0] = op;
+    reply[1] = transferId;
+    reply[2] = result;
+    return LORA_XFER_HEADER_SIZE + 1;
+}
+
+void LoRaTransferReceiver::finish(uint8_t result, unsigned long nowMs)
+{
+    progress.result = result;
+    progress.state = result == LORA_XFER_OK ? TransferState::DONE : TransferState::FAILED;
+    progress.finishedMs = nowMs ? nowMs : 1;
+    received.clear();
+    received.shrink_to_fit();
+    sink = nullptr;
+}
+
+bool LoRaTransferReceiver::expire(unsigned long nowMs)
+{
+    if (!isActive() || nowMs - lastHeardMs <= LORA_XFER_RESUME_MS) {
+        return false;
+    }
+    sink->finish(false);
+    finish(LORA_XFER_TIMEOUT, nowMs);
+    return true;
+}
+
+// Блоки, принятые раньше своей очереди, перечитываются из приёмника
+bool LoRaTransferReceiver::advanceHash()
+{
+    uint8_t buffer[LORA_XFER_BLOCK_SIZE];
+    while (hashed < progress.blockCount && isReceived(hashed)) {
+        uint8_t len = blockLen(hashed);
+        if (!sink->read((uint32_t)hashed * offer.blockSize, buffer, len)) {
+            return false;
+        }
+        hash.update(buffer, len);
+        hashed++;
+    }
+    return true;
+}
+
+uint8_t LoRaTransferReceiver::onFrame(LoraAddress_t sender, const uint8_t *payload, uint8_t len, unsigned long nowMs,
+                                      const SinkHandler &handler, uint8_t *reply)
+{
+    if (len < LORA_XFER_HEADER_SIZE) {
+        return 0;
+    }
+    uint8_t op = payload[0] & LORA_XFER_OP_MASK;
+    uint8_t id = payload[1];
+    if (op == LORA_XFER_OP_OFFER) {
+        return onOffer(sender, id, payload + LORA_XFER_HEADER_SIZE, len - LORA_XFER_HEADER_SIZE, nowMs, handler, reply);
+    }
+    if (sender != progress.peer || id != transferId) {
+        return 0;
+    }
+    if (progress.state != TransferState::RECEIVING) {
+        // Итог потерялся: повторить его на кадры завершённой передачи
+        bool recent = progress.finishedMs && nowMs - progress.finishedMs < LORA_XFER_RESUME_MS;
+        return op == LORA_XFER_OP_DATA && recent ? buildResult(LORA_XFER_OP_DONE, progress.result, reply) : 0;
+    }
+    lastHeardMs = nowMs;
+    if (op == LORA_XFER_OP_ABORT) {
+        sink->finish(false);
+        finish(len > LORA_XFER_HEADER_SIZE ? payload[2] : (uint8_t)LORA_XFER_CANCELLED, nowMs);
+        return 0;
+    }
+    if (op == LORA_XFER_OP_DATA) {
+        return onData(payload[0], payload + LORA_XFER_HEADER_SIZE, len - LORA_XFER_HEADER_SIZE, nowMs, reply);
+    }
+    return 0;
+}
+
+uint8_t LoRaTransferReceiver::onOffer(LoraAddress_t sender, uint8_t id, const uint8_t *body, uint8_t len,
+                                      unsigned long nowMs, const SinkHandler &handler, uint8_t *reply)
+{
+    LoRaTransferOffer incoming;
+    if (len < sizeof(incoming)) {
+        return 0;
+    }
+    memcpy(&incoming, body, sizeof(incoming));
+    bool same = sender == progress.peer && incoming.sameContent(offer);
+
+    // Возобновление: отправитель узнаёт, какие блоки уже есть
+    if (same && progress.state == TransferState::RECEIVING) {
+        transferId = id;
+        lastHeardMs = nowMs;
+        sinceStatus = 0;
+        return buildStatus(true, reply);
+    }
+    // Уже принято: DONE потерялся или то же содержимое предложено снова. После ошибки - приём заново
+    if (same && progress.state == TransferState::DONE && nowMs - progress.finishedMs < LORA_XFER_RESUME_MS) {
+        transferId = id;
+        return buildResult(LORA_XFER_OP_DONE, progress.result, reply);
+    }
+    if (progress.state == TransferState::RECEIVING) {
+        if (nowMs - lastHeardMs <= LORA_XFER_RESUME_MS) {
+            uint8_t busyReply[LORA_XFER_HEADER_SIZE + 1] = {LORA_XFER_OP_ABORT, id, LORA_XFER_REJECTED};
+            memcpy(reply, busyReply, sizeof(busyReply));
+            return sizeof(busyReply);
+        }
+        sink->finish(false);
+        finish(LORA_XFER_TIMEOUT, nowMs);
+    }
+
+    offer = incoming;
+    transferId = id;
+    progress = LoRaTransferProgress();
+    progress.peer = sender;
+    progress.kind = incoming.kind;
+    progress.size = incoming.size;
+    progress.blockCount = incoming.blockCount();
+    progress.startedMs = nowMs;
+
+    uint32_t blocks = incoming.blockSize ? (incoming.size + incoming.blockSize - 1) / incoming.blockSize : 0;
+    bool valid = incoming.size > 0 && incoming.blockSize > 0 && incoming.blockSize <= LORA_XFER_BLOCK_SIZE &&
+                 blocks <= UINT16_MAX;
+    LoRaTransferSink *target = valid && handler ? handler(sender, incoming) : nullptr;
+    if (!target || !target->begin(incoming)) {
+        finish(LORA_XFER_REJECTED, nowMs);
+        return buildResult(LORA_XFER_OP_ABORT, LORA_XFER_REJECTED, reply);
+    }
+
+    sink = target;
+    received.assign((blocks + 7) / 8, 0);
+    base = 0;
+    hashed = 0;
+    sinceStatus = 0;
+    hash.reset();
+    lastHeardMs = nowMs;
+    progress.state = TransferState::RECEIVING;
+    return buildStatus(true, reply);
+}
+
+uint8_t LoRaTransferReceiver::onData(uint8_t op, const uint8_t *body, uint8_t len, unsigned long nowMs, uint8_t *reply)
+{
+    uint16_t block;
+    if (len < sizeof(block)) {
+        return 0;
+    }
+    memcpy(&block, body, sizeof(block));
+    const uint8_t *data = body + sizeof(block);
+    uint8_t dataLen = len - sizeof(block);
+    // Кадр - один или несколько блоков подряд (MTU к узлу больше блока), целиком
+    uint16_t count = 0;
+    for (uint8_t covered = 0; covered < dataLen; count++) {
+        if (block + count >= progress.blockCount || blockLen(block + count) > dataLen - covered) {
+            return 0;
+        }
+        covered += blockLen(block + count);
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    for (uint16_t b = block; b < block + count; b++) {
+        uint8_t bLen = blockLen(b);
+        if (!isReceived(b)) {
+            if (!sink->write((uint32_t)b * offer.blockSize, data, bLen)) {
+                sink->finish(false);
+                finish(LORA_XFER_SINK_ERROR, nowMs);
+                return buildResult(LORA_XFER_OP_ABORT, LORA_XFER_SINK_ERROR, reply);
+            }
+            received[b >> 3] |= 1 << (b & 7);
+            progress.blocksDone++;
+            sinceStatus++;
+            // Блок по порядку хэшируется из кадра, без чтения приёмника
+            if (b == hashed) {
+                hash.update(data, bLen);
+                hashed++;
+            }
+            if (!advanceHash()) {
+                sink->finish(false);
+                finish(LORA_XFER_SINK_ERROR, nowMs);
+                return buildResult(LORA_XFER_OP_ABORT, LORA_XFER_SINK_ERROR, reply);
+            }
+        }
+        data += bLen;
+    }
+    while (base < progress.blockCount && isReceived(base)) {
+        base++;
+    }
+
+    if (progress.blocksDone == progress.blockCount) {
+        uint8_t digest[LORA_SHA256_SIZE];
+        hash.finish(digest);
+        bool hashOk = memcmp(digest, offer.sha256, LORA_SHA256_SIZE) == 0;
+        bool sinkOk = sink->finish(hashOk);
+        finish(!hashOk ? LORA_XFER_HASH_MISMATCH : !sinkOk ? LORA_XFER_SINK_ERROR : LORA_XFER_OK, nowMs);
+        return buildResult(LORA_XFER_OP_DONE, progress.result, reply);
+    }
+    bool round = op & LORA_XFER_FLAG_ROUND;
+    if (round || sinceStatus >= LORA_XFER_STATUS_EVERY) {
+        sinceStatus = 0;
+        return buildStatus(round, reply);
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+// lora_transfer.hpp - Block transfer: sliding window sender, bitmap receiver, data sources and sinks
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "lora_config.h"
+#include "lora_sha256.hpp"
+#include "packets/packet_transfer.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SOURCE / SINK
+// ═══════════════════════════════════════════════════════════════════════════
+// Данные передачи не обязаны помещаться в RAM: источник и приёмник читают и пишут
+// блоками по смещению. Оба принадлежат приложению и живут до завершения передачи.
+class LoRaTransferSource
+{
+public:
+    virtual ~LoRaTransferSource() {}
+    virtual uint32_t size() const = 0;
+    virtual bool read(uint32_t offset, uint8_t *out, uint8_t len) = 0;
+};
+
+class LoRaTransferSink
+{
+public:
+    virtual ~LoRaTransferSink() {}
+    // Новая передача. false - отказ (REJECTED)
+    virtual bool begin(const LoRaTransferOffer &offer) = 0;
+    // Блоки приходят в любом порядке, каждый один раз
+    virtual bool write(uint32_t offset, const uint8_t *data, uint8_t len) = 0;
+    // Чтение записанного: хэш блоков, принятых не по порядку
+    virtual bool read(uint32_t offset, uint8_t *out, uint8_t len) = 0;
+    // Конец передачи: hashOk - все блоки приняты и SHA-256 совпал, false - отмена.
+    // Возвращает false, если приёмник не смог завершить (SINK_ERROR)
+    virtual bool finish(bool hashOk) = 0;
+};
+
+// Источник в памяти: конфиги и небольшие файлы
+class LoRaMemorySource : public LoRaTransferSource
+{
+public:
+    LoRaMemorySource(const uint8_t *data, uint32_t size) : data(data), length(size) {}
+    uint32_t size() const override { return length; }
+    bool read(uint32_t offset, uint8_t *out, uint8_t len) override;
+
+private:
+    const uint8_t *data;
+    uint32_t length;
+};
+
+// Приёмник в памяти до maxSize байт. data() валидны после finish(true)
+class LoRaMemorySink : public LoRaTransferSink
+{
+public:
+    explicit LoRaMemorySink(uint32_t maxSize) : maxSize(maxSize) {}
+    bool begin(const LoRaTransferOffer &offer) override;
+    bool write(uint32_t offset, const uint8_t *data, uint8_t len) override;
+    bool read(uint32_t offset, uint8_t *out, uint8_t len) override;
+    bool finish(bool hashOk) override;
+
+    const std::vector<uint8_t> &data() const { return buffer; }
+    bool isComplete() const { return complete; }
+
+private:
+    uint32_t maxSize;
+    std::vector<uint8_t> buffer;
+    bool complete = false;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// STATE
+// ═══════════════════════════════════════════════════════════════════════════
+enum class TransferState : uint8_t
+{
+    IDLE,
+    OFFERING,       // Отправитель ждёт первый отчёт получателя
+    SENDING,
+    STALLED,        // Нет отчётов дольше LORA_XFER_STALL_MS: пробы OFFER до возобновления
+    RECEIVING,
+    DONE,
+    FAILED
+};
+
+const char *transferStateName(TransferState state);
+
+// Прогресс для getTransferInfo() и callback
+struct LoRaTransferProgress
+{
+    TransferState state = TransferState::IDLE;
+    LoraAddress_t peer = DEVICE_ID_BROADCAST;
+    uint8_t kind = LORA_XFER_KIND_FILE;
+    uint8_t result = LORA_XFER_OK;
+    uint32_t size = 0;
+    uint16_t blockCount = 0;
+    uint16_t blocksDone = 0;        // Подтверждено (отправитель) или принято (получатель)
+    uint32_t framesSent = 0;        // Кадров DATA, включая повторы (отправитель)
+    unsigned long startedMs = 0;
+    unsigned long finishedMs = 0;   // 0 - идёт
+
+    uint32_t elapsedMs(unsigned long nowMs) const { return (finishedMs ? finishedMs : nowMs) - startedMs; }
+    String toString(bool outgoing, unsigned long nowMs) const;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SENDER
+// ═══════════════════════════════════════════════════════════════════════════
+// Selective repeat: блоки окна [base, base + LORA_XFER_WINDOW_BLOCKS) уходят по разу за раунд,
+// последний в раунде просит отчёт. Отчёт-ответ (ROUND) возвращает в раунд все непринятые
+// блоки окна; промежуточные отчёты только сдвигают окно. Без блокировок: LoRaCore держит
+// его под transferMutex.
+class LoRaTransferSender
+{
+public:
+    // Читает источник целиком ради SHA-256. false - источник пуст или не читается
+    bool start(LoraAddress_t peer, LoRaTransferSource &source, uint8_t kind, uint8_t transferId, unsigned long nowMs);
+    // Завершить с result; получатель узнает о нём кадром ABORT
+    void cancel(uint8_t result, unsigned long nowMs);
+
+    // Следующий кадр в payload (MAX_LORA_PAYLOAD). Возвращает длину, 0 - сейчас слать нечего.
+    // maxLen - MTU к получателю: DATA несёт столько блоков подряд, сколько в него помещается.
+    // frameMs - эфир кадра длиной maxLen на текущем профиле
+    uint8_t nextFrame(unsigned long nowMs, uint32_t frameMs, uint8_t *payload, uint8_t maxLen);
+    // STATUS, DONE или ABORT от получателя
+    void onFrame(const uint8_t *payload, uint8_t len, unsigned long nowMs);
+    // Не слать DATA до untilMs (смена профиля); время паузы не считается потерей связи
+    void pause(unsigned long untilMs);
+
+    bool isActive() const { return progress.state == TransferState::OFFERING || progress.state == TransferState::SENDING ||
+                                   progress.state == TransferState::STALLED || abortPending; }
+    const LoRaTransferProgress &getProgress() const { return progress; }
+
+private:
+    bool isAcked(uint16_t block) const { return acked[block >> 3] & (1 << (block & 7)); }
+    bool isSent(uint16_t block) const { return sent[block >> 3] & (1 << (block & 7)); }
+    uint16_t windowEnd() const;
+    uint8_t buildData(uint16_t block, uint16_t count, bool round, uint8_t *payload);
+    void finish(uint8_t result, unsigned long nowMs);
+
+    LoRaTransferSource *source = nullptr;
+    LoRaTransferOffer offer = {};
+    uint8_t transferId = 0;
+    std::vector<uint8_t> acked;
+    std::vector<uint8_t> sent;      // Отправлен в текущем раунде
+    uint16_t base = 0;              // Первый неподтверждённый блок
+    bool awaitingStatus = false;    // Раунд закрыт запросом отчёта
+    bool abortPending = false;
+    unsigned long awaitSinceMs = 0;
+    unsigned long lastHeardMs = 0;
+    unsigned long lastOfferMs = 0;
+    unsigned long pauseUntilMs = 0;
+    LoRaTransferProgress progress;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RECEIVER
+// ═══════════════════════════════════════════════════════════════════════════
+// Один приём за раз. Bitmap принятых блоков в RAM (1 бит на блок), данные - сразу в приёмник.
+// SHA-256 считается по порядку: блоки, пришедшие раньше своей очереди, перечитываются из
+// приёмника. Незавершённый приём хранится LORA_XFER_RESUME_MS: OFFER с тем же содержимым
+// продолжает его с первого непринятого блока.
+class LoRaTransferReceiver
+{
+public:
+    using SinkHandler = std::function<LoRaTransferSink *(LoraAddress_t, const LoRaTransferOffer &)>;
+
+    // Кадр от отправителя. Ответ - в reply (MAX_LORA_PAYLOAD), возвращает его длину или 0
+    uint8_t onFrame(LoraAddress_t sender, const uint8_t *payload, uint8_t len, unsigned long nowMs,
+                    const SinkHandler &handler, uint8_t *reply);
+    // Сбросить приём без кадров дольше LORA_XFER_RESUME_MS. true - сброшен
+    bool expire(unsigned long nowMs);
+    // Кадров от отправителя нет дольше LORA_XFER_STALL_MS
+    bool isStalled(unsigned long nowMs) const {
+        return progress.state == TransferState::RECEIVING && nowMs - lastHeardMs > LORA_XFER_STALL_MS;
+    }
+
+    bool isActive() const { return progress.state == TransferState::RECEIVING; }
+    const LoRaTransferProgress &getProgress() const { return progress; }
+
+private:
+    bool isReceived(uint16_t block) const { return received[block >> 3] & (1 << (block & 7)); }
+    uint8_t blockLen(uint16_t block) const;
+    uint8_t onOffer(LoraAddress_t sender, uint8_t id, const uint8_t *body, uint8_t len, unsigned long nowMs,
+                    const SinkHandler &handler, uint8_t *reply);
+    uint8_t onData(uint8_t op, const uint8_t *body, uint8_t len, unsigned long nowMs, uint8_t *reply);
+    bool advanceHash();
+    uint8_t buildStatus(bool round, uint8_t *reply) const;
+    uint8_t buildResult(uint8_t op, uint8_t result, uint8_t *reply) const;
+    void finish(uint8_t result, unsigned long nowMs);
+
+    LoRaTransferSink *sink = nullptr;
+    LoRaTransferOffer offer = {};
+    uint8_t transferId = 0;
+    std::vector<uint8_t> received;
+    uint16_t base = 0;              // Первый непринятый блок
+    uint16_t hashed = 0;            // Блоков в хэше (по порядку)
+    uint16_t sinceStatus = 0;       // Новых блоков после последнего отчёта
+    LoRaSha256 hash;
+    unsigned long lastHeardMs = 0;
+    LoRaTransferProgress progress;
+};
@@ -0,0 +1,72 @@
+// lora_txclass.cpp - Strict-priority TX traffic classes
+#include "lora_txclass.hpp"
+#include "lora_packets.hpp"
+
+const char *txClassName(TxClass cls)
+{
+    switch (cls) {
+    case TxClass::CONTROL:  return "control";
+    case TxClass::REALTIME: return "realtime";
+    case TxClass::RETRY:    return "retry";
+    case TxClass::NORMAL:   return "normal";
+    case TxClass::BULK:     return "bulk";
+    default:                return "?";
+    }
+}
+
+UBaseType_t txClassQueueSize(TxClass cls)
+{
+    switch (cls) {
+    case TxClass::CONTROL:  return LORA_TXQ_CONTROL_SIZE;
+    case TxClass::REALTIME: return LORA_TXQ_REALTIME_SIZE;
+    case TxClass::RETRY:    return LORA_TXQ_RETRY_SIZE;
+    case TxClass::BULK:     return LORA_TXQ_BULK_SIZE;
+    default:                return LORA_OUTGOING_QUEUE_SIZE;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CLASSIFICATION
+// ═══════════════════════════════════════════════════════════════════════════
+TxClass txClassOf(const LoRaPacket &pkt)
+{
+    uint8_t type = pkt.packetType;
+    LoRaRelayHeader hdr;
+    if (readRelayHeader(pkt, hdr)) {
+        type = hdr.innerType;
+    }
+    switch (type) {
+    case CMD_ACK:
+    case CMD_BULK_ACK:
+    case CMD_REQUEST_ASA:
+    case CMD_RESPONCE_ASA:
+    case CMD_ROUTE_ADV:
+    case CMD_LINK_REPORT:
+    case CMD_LOW_POWER:
+        return TxClass::CONTROL;
+    default:
+        break;
+    }
+    if (pkt.isHighPriority()) {
+        return TxClass::REALTIME;
+    }
+    return type == CMD_TRANSFER ? TxClass::BULK : TxClass::NORMAL;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// QUEUED COPIES
+// ═══════════════════════════════════════════════════════════════════════════
+LoRaTxQueuedTable::LoRaTxQueuedTable()
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        copies[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Не ниже нуля: ID кадра с ACK может совпасть с ID кадра send(), выбранным приложением
+void LoRaTxQueuedTable::remove(PacketId_t packetId)
+{
+    uint8_t current = copies[packetId].load(std::memory_order_relaxed);
+    while (current > 0 && !copies[packetId].compare_exchange_weak(current, current - 1, std::memory_order_relaxed)) {
+    }
+}
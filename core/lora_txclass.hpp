@@ -0,0 +1,51 @@
+// lora_txclass.hpp - Strict-priority TX traffic classes
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "lora_config.h"
+#include "packets/lora_packet.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CLASSES
+// ═══════════════════════════════════════════════════════════════════════════
+// У каждого класса своя FIFO очередь передачи с лимитом LORA_TXQ_*_SIZE. sendTask берёт кадр
+// из первого непустого класса: ACK и ASA не ждут секунд bulk-трафика, повторы - свежих данных.
+enum class TxClass : uint8_t
+{
+    CONTROL = 0,    // ACK, BULK ACK, ASA, анонс маршрутов
+    REALTIME,       // highPriority: команды реального времени, отчёты передачи
+    RETRY,          // Повторы resendTask
+    NORMAL,         // Данные приложения, AGR (outgoingQueue)
+    BULK,           // DATA блочной передачи
+    COUNT
+};
+
+static constexpr uint8_t TX_CLASS_COUNT = (uint8_t)TxClass::COUNT;
+
+const char *txClassName(TxClass cls);
+UBaseType_t txClassQueueSize(TxClass cls);
+
+// Класс по типу и флагу highPriority; кадр CMD_RELAY - по типу вложенного пакета.
+// Повтор отличить по содержимому нельзя: RETRY назначает resendTask
+TxClass txClassOf(const LoRaPacket &pkt);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// QUEUED COPIES
+// ═══════════════════════════════════════════════════════════════════════════
+// Копий своего кадра с ACK в очередях передачи и macBacklog по PacketId_t. resendTask не повторяет
+// кадр, который ещё не ушёл: повтор в RETRY обогнал бы оригинал и ушёл в эфир дважды.
+// Пишется из задач приложения, resendTask и sendTask без блокировок.
+class LoRaTxQueuedTable
+{
+public:
+    LoRaTxQueuedTable();
+
+    // Учитывается до постановки в очередь: sendTask может передать кадр раньше, чем вернётся xQueueSend
+    void add(PacketId_t packetId) { copies[packetId].fetch_add(1, std::memory_order_relaxed); }
+    // Кадр передан, снят по сроку, заменён или не поставлен
+    void remove(PacketId_t packetId);
+    bool queued(PacketId_t packetId) const { return copies[packetId].load(std::memory_order_relaxed) > 0; }
+
+private:
+    std::atomic<uint8_t> copies[256];
+};
@@ -0,0 +1,158 @@
+// lora_txpower.cpp - Per-peer transmit power control from link reports of the peer
+#include "lora_txpower.hpp"
+#include <algorithm>
+#include <math.h>
+
+float loraDemodFloorDb(uint8_t sf)
+{
+    sf = std::min<uint8_t>(std::max<uint8_t>(sf, 5), 12);
+    return -2.5f * (sf - 4);
+}
+
+float loraSensitivityDbm(uint8_t sf, float bwKHz)
+{
+    return -174.0f + 10.0f * log10f(bwKHz * 1000.0f) + LORA_TPC_NOISE_FIGURE_DB + loraDemodFloorDb(sf);
+}
+
+// Вытесняется запись с самым старым временем
+template <typename Entry>
+static void makeRoom(std::map<LoraAddress_t, Entry> &entries, uint32_t Entry::*atMs, uint32_t nowMs)
+{
+    if (entries.size() < LORA_TPC_MAX_PEERS) {
+        return;
+    }
+    auto oldest = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (nowMs - it->second.*atMs > nowMs - oldest->second.*atMs) {
+            oldest = it;
+        }
+    }
+    entries.erase(oldest);
+}
+
+// RSSI - мощность сигнала и шума: на полную мощность поднимается только сигнал (доля по SNR)
+static float fullPowerRssi(float rssi, float snr, float offsetDb)
+{
+    float signalShare = 1.0f / (1.0f + powf(10.0f, -snr / 10.0f));
+    return rssi + 10.0f * log10f(signalShare * powf(10.0f, offsetDb / 10.0f) + 1.0f - signalShare);
+}
+
+LoRaTxPowerControl::LoRaTxPowerControl()
+{
+    std::fill(sentPower, sentPower + 256, (int8_t)LORA_TX_POWER);
+}
+
+int8_t LoRaTxPowerControl::powerFor(LoraAddress_t peer, uint32_t nowMs)
+{
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        return LORA_TX_POWER;
+    }
+    if (nowMs - it->second.reportMs > LORA_TPC_REPORT_TIMEOUT_MS) {
+        peers.erase(it);
+        return LORA_TX_POWER;
+    }
+    return it->second.powerDbm;
+}
+
+void LoRaTxPowerControl::onReport(LoraAddress_t peer, PacketId_t packetId, float snr, float rssi, uint8_t sf,
+                                  float bwKHz, uint32_t nowMs)
+{
+    auto it = peers.find(peer);
+    if (it == peers.end()) {
+        makeRoom(peers, &Peer::reportMs, nowMs);
+        it = peers.emplace(peer, Peer()).first;
+    }
+    Peer &p = it->second;
+    float offset = LORA_TX_POWER - sentPower[packetId];
+    float fullSnr = p.fullSnr.update(snr + offset);
+    float fullRssi = p.fullRssi.update(fullPowerRssi(rssi, snr, offset));
+    float margin = fullSnr - loraDemodFloorDb(sf);
+    if (snr >= LORA_TPC_SNR_SATURATION_DB) {
+        // Сильный сигнал: SNR SX1262 упирается в потолок, RSSI над чувствительностью точнее
+        margin = std::max(margin, fullRssi - loraSensitivityDbm(sf, bwKHz));
+    }
+    // Запас сверх целевого - столько дБ можно снять с полной мощности
+    int target = LORA_TX_POWER - (int)floorf(margin - LORA_TPC_TARGET_MARGIN_DB);
+    target = std::min(std::max(target, LORA_TPC_MIN_DBM), LORA_TX_POWER);
+    if (target < p.powerDbm) {
+        p.powerDbm = (int8_t)std::max(target, p.powerDbm - LORA_TPC_STEP_DOWN_DB);
+    } else {
+        p.powerDbm = (int8_t)target;
+    }
+    p.marginDb = margin;
+    p.reportMs = nowMs;
+    p.losses = 0;
+}
+
+void LoRaTxPowerControl::onAck(LoraAddress_t peer)
+{
+    auto it = peers.find(peer);
+    if (it != peers.end()) {
+        it->second.losses = 0;
+    }
+}
+
+void LoRaTxPowerControl::onLoss(LoraAddress_t peer)
+{
+    auto it = peers.find(peer);
+    if (it == peers.end() || ++it->second.losses < LORA_TPC_LOSS_LIMIT) {
+        return;
+    }
+    it->second.powerDbm = (int8_t)std::min(it->second.powerDbm + LORA_TPC_STEP_UP_DB, LORA_TX_POWER);
+    it->second.losses = 0;
+}
+
+bool LoRaTxPowerControl::fullPowerLink(LoraAddress_t peer, uint32_t nowMs, float &rssi, float &snr) const
+{
+    auto it = peers.find(peer);
+    if (it == peers.end() || nowMs - it->second.reportMs > LORA_TPC_REPORT_TIMEOUT_MS) {
+        return false;
+    }
+    rssi = it->second.fullRssi.get();
+    snr = it->second.fullSnr.get();
+    return true;
+}
+
+bool LoRaTxPowerControl::reportDue(LoraAddress_t peer, float snr, uint32_t nowMs)
+{
+    auto it = reports.find(peer);
+    bool first = it == reports.end();
+    if (first) {
+        makeRoom(reports, &Report::sentMs, nowMs);
+        it = reports.emplace(peer, Report()).first;
+    }
+    Report &r = it->second;
+    float avgSnr = r.snr.update(snr);
+    uint32_t elapsed = nowMs - r.sentMs;
+    if (!first && elapsed < LORA_TPC_REPORT_INTERVAL_MS &&
+        (elapsed < LORA_TPC_REPORT_MIN_MS || fabsf(avgSnr - r.sentSnr) < LORA_TPC_REPORT_DELTA_DB)) {
+        return false;
+    }
+    r.sentMs = nowMs;
+    r.sentSnr = avgSnr;
+    return true;
+}
+
+String LoRaTxPowerControl::toString(uint32_t nowMs)
+{
+    if (peers.empty()) {
+        return "  no reports: all peers at " + String(LORA_TX_POWER) + " dBm";
+    }
+    String info;
+    char s[100];
+    for (const auto &entry : peers) {
+        const Peer &p = entry.second;
+        snprintf(s, sizeof(s), "  Peer %u: %d dBm, margin at %d dBm %.1f dB, report %lu s ago, losses %u", entry.first,
+                 p.powerDbm, LORA_TX_POWER, p.marginDb, (unsigned long)((nowMs - p.reportMs) / 1000), p.losses);
+        info += info.length() ? "\n" : "";
+        info += s;
+    }
+    return info;
+}
+
+void LoRaTxPowerControl::reset()
+{
+    peers.clear();
+    reports.clear();
+}
@@ -0,0 +1,74 @@
+// lora_txpower.hpp - Per-peer transmit power control from link reports of the peer
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include "lora_config.h"
+#include "lora_helpers.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LINK BUDGET
+// ═══════════════════════════════════════════════════════════════════════════
+// Порог демодуляции SX1262: SNR, ниже которого кадр не принимается (SF5 -2.5 ... SF12 -20 дБ)
+float loraDemodFloorDb(uint8_t sf);
+// Чувствительность приёмника, дБм: шум полосы + LORA_TPC_NOISE_FIGURE_DB + порог демодуляции
+float loraSensitivityDbm(uint8_t sf, float bwKHz);
+
+// ═══════════════════════════════════════════════════════════════════════════
+// POWER CONTROL
+// ═══════════════════════════════════════════════════════════════════════════
+// Передатчик: мощность к каждому узлу по его отчётам о наших кадрах. Отчёт приводится к полной
+// мощности (мощность кадра известна по его ID) и сглаживается. Запас - SNR над порогом
+// демодуляции текущего SF (при насыщении SNR - и RSSI над чувствительностью). Мощность
+// снижается не больше чем на LORA_TPC_STEP_DOWN_DB за отчёт, пока запас больше
+// LORA_TPC_TARGET_MARGIN_DB; растёт сразу до нужной по отчёту и на LORA_TPC_STEP_UP_DB после
+// LORA_TPC_LOSS_LIMIT повторов подряд. Узел без свежих отчётов - LORA_TX_POWER.
+// Приёмник: отчёт - раз в LORA_TPC_REPORT_INTERVAL_MS или при изменении сглаженного SNR кадров
+// узла (замирания одного кадра - не повод для отчёта).
+// Без блокировок: LoRaCore держит таблицу под txPowerMutex.
+class LoRaTxPowerControl
+{
+public:
+    LoRaTxPowerControl();
+
+    int8_t powerFor(LoraAddress_t peer, uint32_t nowMs);
+    // Мощность кадра packetId: по ней отчёт о кадре переводится в запас
+    void onSent(PacketId_t packetId, int8_t powerDbm) { sentPower[packetId] = powerDbm; }
+    // Отчёт узла peer о нашем кадре packetId. sf, bwKHz - текущий профиль
+    void onReport(LoraAddress_t peer, PacketId_t packetId, float snr, float rssi, uint8_t sf, float bwKHz,
+                  uint32_t nowMs);
+    void onAck(LoraAddress_t peer);
+    void onLoss(LoraAddress_t peer);
+    // Линия к узлу на полной мощности по его свежим отчётам: RSSI/SNR наших кадров + снижение
+    // мощности кадра, сглаженные. false - свежих отчётов нет
+    bool fullPowerLink(LoraAddress_t peer, uint32_t nowMs, float &rssi, float &snr) const;
+
+    // Приёмник: кадр peer принят с SNR snr - пора ли отчитаться о нём. true - отчёт считается отправленным
+    bool reportDue(LoraAddress_t peer, float snr, uint32_t nowMs);
+
+    // "Peer 2: 4 dBm, margin 12.5 dB, 3 s ago" по узлам
+    String toString(uint32_t nowMs);
+    // Смена профиля: запас по старому SF недействителен, все узлы - LORA_TX_POWER, отчёты заново
+    void reset();
+
+private:
+    struct Peer
+    {
+        int8_t powerDbm = LORA_TX_POWER;
+        float marginDb = 0;                     // Запас на полной мощности
+        RssiFilter fullRssi;                    // Отчёты, приведённые к LORA_TX_POWER
+        RssiFilter fullSnr;
+        uint32_t reportMs = 0;
+        uint8_t losses = 0;                     // Повторов подряд
+    };
+
+    struct Report
+    {
+        uint32_t sentMs = 0;
+        float sentSnr = 0;                      // Сглаженный SNR при последнем отчёте
+        RssiFilter snr;
+    };
+
+    int8_t sentPower[256];
+    std::map<LoraAddress_t, Peer> peers;        // Кому передаём
+    std::map<LoraAddress_t, Report> reports;    // Кому отчитываемся
+};
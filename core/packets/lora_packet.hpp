@@ -64,7 +64,7 @@ struct LoRaPacket
     void setBroadcastFlag(bool v)     { v ? flags |=  LORA_PKT_FLAG_BROADCAST     : flags &= ~LORA_PKT_FLAG_BROADCAST; }
 
 };
-static_assert(sizeof(LoRaPacket) <= 150, "LoRaPacket too large!");
+static_assert(sizeof(LoRaPacket) <= 255, "LoRaPacket larger than SX1262 FIFO!");
 #pragma pack(pop)
 
 
@@ -92,6 +92,17 @@ inline String LoRaPacketToStr(const LoRaPacket &pkt)
 }
 
 
+// Кадр, вычитанный из радио сразу после IRQ (стадия drain): разбор и диспетчеризация - позже.
+// Он же - элемент incomingQueue: receive(LoRaRxFrame &) отдаёт приложению метки приёма
+struct LoRaRxFrame {
+    LoRaPacket pkt = {};
+    int16_t len = 0;        // getPacketLength(); вне 1..sizeof(LoRaPacket) - кадр не читался
+    int16_t crcState = 0;   // Результат readData()
+    float rssi = 0;
+    float snr = 0;
+    uint32_t irqUs = 0;     // micros() в ISR DIO1: конец кадра в эфире, без задержки задач
+};
+
 // Pending send tracking structure
 struct PendingSend {
     LoRaPacket pkt = {}; // Initialize to zero
@@ -16,19 +16,22 @@
 class PacketAggregated : public PacketBase
 {
 public:
-    static constexpr uint8_t MAX_SUB_PACKETS = 5;
+    // Подпакетов в AGR: один на 16 байт MTU кадра (LORA_BASE_MTU - 5), не больше MAX_SUB_PACKETS
+    static constexpr uint8_t MAX_SUB_PACKETS = MAX_LORA_PAYLOAD / 16;
+    static uint8_t maxSubPackets(uint8_t capacity) { return capacity / 16; }
     
     PacketAggregated() {
         packetType = CMD_AGR;
         payloadLen = 0;
     }
     
-    // Add a sub-packet: returns true if added, false if no space
-    bool addSubPacket(uint8_t pktType, const uint8_t* pktPayload, uint8_t pktPayloadLen) {
+    // Add a sub-packet: returns true if added, false if no space. capacity - MTU кадра (getMtu())
+    bool addSubPacket(uint8_t pktType, const uint8_t* pktPayload, uint8_t pktPayloadLen,
+                      uint8_t capacity = MAX_LORA_PAYLOAD) {
         // Check if we have space: type(1) + len(1) + payload
         uint8_t requiredSpace = 1 + 1 + pktPayloadLen;
         
-        if (payloadLen + requiredSpace > MAX_LORA_PAYLOAD) {
+        if (payloadLen + requiredSpace > capacity) {
             return false; // Not enough space
         }
         
@@ -104,14 +107,14 @@ public:
     }
     
     // Calculate how much space is left
-    uint8_t getAvailableSpace() const {
-        return MAX_LORA_PAYLOAD - payloadLen;
+    uint8_t getAvailableSpace(uint8_t capacity = MAX_LORA_PAYLOAD) const {
+        return payloadLen < capacity ? capacity - payloadLen : 0;
     }
     
     // Check if we can fit a packet of given size
-    bool canFit(uint8_t pktPayloadLen) const {
+    bool canFit(uint8_t pktPayloadLen, uint8_t capacity = MAX_LORA_PAYLOAD) const {
         uint8_t required = 1 + 1 + pktPayloadLen; // type + len + payload
-        return (payloadLen + required) <= MAX_LORA_PAYLOAD;
+        return (payloadLen + required) <= capacity;
     }
 };
 
@@ -5,12 +5,14 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// Helper function to parse ASA request
-inline bool parseAsaRequest(const uint8_t *buf, size_t len, uint8_t &profileIndex)
+// Helper function to parse ASA request/response: [profile:1][mtu:1].
+// Прошивки без MTU профиля шлют только [profile:1] - для них LORA_BASE_MTU
+inline bool parseAsaRequest(const uint8_t *buf, size_t len, uint8_t &profileIndex, uint8_t &mtu)
 {
-    if (len != sizeof(uint8_t))
+    if (len != sizeof(uint8_t) && len != 2 * sizeof(uint8_t))
         return false;
-    profileIndex = *buf;
+    profileIndex = buf[0];
+    mtu = len > 1 ? buf[1] : LORA_BASE_MTU;
     return true;
 }
 
@@ -22,12 +24,14 @@ inline bool parseAsaRequest(const uint8_t *buf, size_t len, uint8_t &profileInde
 // ASA Exchange packet (for ASA requests and confirmations)
 struct PacketAsaExchange : public PacketBase {
     uint8_t profileIndex;
+    uint8_t mtu;                // Запрос - MTU профиля у запросившего, ответ - согласованный
 
     PacketAsaExchange(CommandType type = CMD_REQUEST_ASA) {
         packetType = type;
         packetId = 0;
-        payloadLen = sizeof(profileIndex);
+        payloadLen = sizeof(profileIndex) + sizeof(mtu);
         profileIndex = 0;
+        mtu = LORA_BASE_MTU;
         ackRequired = false;     // ACK не должен требовать ACK
         highPriority = true;     // ACK должен лететь немедленно
         service = true;          // служебный пакет
@@ -35,7 +39,6 @@ struct PacketAsaExchange : public PacketBase {
 
     void setProfile(uint8_t index) {
         profileIndex = index;
-        payloadLen = sizeof(profileIndex);
     }
 
     uint8_t getProfile() const {
@@ -22,6 +22,7 @@ public:
     bool compressed = false;      // payload сжат?
     bool aggregated = false;      // AGR packet?
     bool broadcast = false;       // broadcast пакет (0xFF адрес получателя)?
+    uint32_t ttlMs = 0;           // срок жизни: позже не передаётся и не повторяется (0 = без срока)
 };
 
 // Free function for converting PacketBase to string (safer than member function)
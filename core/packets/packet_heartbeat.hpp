@@ -27,4 +27,23 @@ public:
     }
 };
 
+// ═══════════════════════════════════════════════════════════════════════════
+// TIME STAMP
+// ═══════════════════════════════════════════════════════════════════════════
+// Метка времени в конце своего heartbeat (и маяка TDMA), добавляет LoRaCore (lora_timesync.hpp).
+// stampUs пишет задача радио перед startTransmit(): micros() отправителя в момент TX done этого
+// кадра, предсказанный по времени в эфире. prevCorrUs - ошибка предсказания предыдущего кадра
+// с меткой (prevId), известная только после его IRQ TX done.
+struct LoRaTimeTrailer
+{
+    uint8_t stratum;        // 0 - корень сетевого времени, 1 - синхронизирован с ним
+    PacketId_t prevId;
+    int16_t prevCorrUs;     // LORA_TIME_NO_CORR - предыдущий кадр без метки или не передан
+    uint32_t stampUs;
+};
+
 #pragma pack(pop)
+
+static constexpr uint8_t LORA_TIME_TRAILER_SIZE = sizeof(LoRaTimeTrailer);
+static constexpr uint8_t LORA_TIME_UNSYNCED = 0xFF;
+static constexpr int16_t LORA_TIME_NO_CORR = INT16_MIN;
@@ -0,0 +1,60 @@
+// packet_link_report.hpp - Link report: SNR/RSSI of the sender's frame as measured by the receiver
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include "lora_packet.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LINK REPORT
+// ═══════════════════════════════════════════════════════════════════════════
+// Приёмник -> отправитель: [packetId:1][snr:1, 0.25 дБ][rssi:1, дБм]. packetId - кадр
+// отправителя, по которому сделан замер: отправитель знает, с какой мощностью его передал.
+// Только напрямую и без ACK: потерянный отчёт заменит следующий.
+#pragma pack(push, 1)
+
+struct LoRaLinkReport
+{
+    PacketId_t packetId;
+    int8_t snrQuarterDb;
+    int8_t rssiDbm;
+
+    float snr() const { return snrQuarterDb / 4.0f; }
+};
+
+#pragma pack(pop)
+
+class PacketLinkReport : public PacketBase
+{
+public:
+    PacketLinkReport() {
+        packetType      = CMD_LINK_REPORT;
+        payloadLen      = sizeof(LoRaLinkReport);
+        ackRequired     = false;
+        service         = true;
+        noRetry         = true;
+    }
+
+    static LoRaLinkReport make(PacketId_t packetId, float snr, float rssi) {
+        LoRaLinkReport report;
+        report.packetId = packetId;
+        report.snrQuarterDb = toInt8(snr * 4.0f);
+        report.rssiDbm = toInt8(rssi);
+        return report;
+    }
+
+    static bool parse(const uint8_t *buffer, uint8_t len, LoRaLinkReport &report) {
+        if (len != sizeof(LoRaLinkReport))
+            return false;
+        memcpy(&report, buffer, sizeof(report));
+        return true;
+    }
+
+private:
+    static int8_t toInt8(float value) {
+        long v = lroundf(value);
+        return (int8_t)(v < INT8_MIN ? INT8_MIN : v > INT8_MAX ? INT8_MAX : v);
+    }
+};
@@ -0,0 +1,32 @@
+// packet_low_power.hpp - Low-power RX notice: the sender listens in duty-cycle RX or continuously again
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include <stdint.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LOW-POWER NOTICE
+// ═══════════════════════════════════════════════════════════════════════════
+// Узел -> адресат по умолчанию: [enabled:1]. 1 - узел слушает в duty-cycle RX, кадры к нему
+// нужны с длинной преамбулой; 0 - снова непрерывный приём. С ACK и повторами: пропущенное
+// объявление - пропущенные команды. Только напрямую: преамбулу слышит сосед, а не адресат relay.
+class PacketLowPower : public PacketBase
+{
+public:
+    uint8_t enabled;
+
+    PacketLowPower() : enabled(0) {
+        packetType      = CMD_LOW_POWER;
+        payloadLen      = sizeof(enabled);
+        ackRequired     = true;
+        highPriority    = true;         // ACK сразу: узел слушает только окно после своей передачи
+        service         = true;
+    }
+
+    static bool parse(const uint8_t *buffer, uint8_t len, bool &enabled) {
+        if (len != sizeof(uint8_t) || buffer[0] > 1)
+            return false;
+        enabled = buffer[0] == 1;
+        return true;
+    }
+};
@@ -0,0 +1,25 @@
+// packet_metrics.hpp - Metrics snapshot page packet
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+
+// ═══════════════════════════════════════════════════════════════════════════
+// METRICS PACKET
+// ═══════════════════════════════════════════════════════════════════════════
+// Ответ на PacketRequestInfo с requestType = INFO_REQUEST_METRICS.
+// Payload - одна страница LoRaMetricsSnapshot::serializePage(), разбор - forEachMetricRecord().
+#pragma pack(push, 1)
+
+class PacketMetrics : public PacketBase
+{
+public:
+    PacketMetrics() {
+        packetType = CMD_METRICS;
+        payloadLen = 0;
+        ackRequired = false;     // Снимок устаревает быстрее, чем доходит повтор
+        noRetry = true;
+        service = true;          // служебный пакет
+    }
+};
+
+#pragma pack(pop)
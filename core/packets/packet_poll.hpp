@@ -0,0 +1,56 @@
+// packet_poll.hpp - Polling MAC: master poll and slave reply with piggybacked ACKs
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include "lora_packet.hpp"
+#include <stdint.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// POLL / REPLY
+// ═══════════════════════════════════════════════════════════════════════════
+// Один формат в обе стороны: [flags:1][ackCount:1][ackIds:ackCount][подпакеты AGR...]
+// Master -> slave: опрос, ackIds - подтверждения кадров этого slave, подпакетов нет.
+// Slave -> master: ответ, ackIds - подтверждения кадров master, подпакеты - очередь
+// slave в формате PacketAggregated. Пустой ответ - slave нечего передать.
+static constexpr uint8_t LORA_POLL_HEADER_SIZE = 2;
+static constexpr uint8_t LORA_POLL_MAX_ACKS = 10;
+static constexpr uint8_t LORA_POLL_FLAG_MORE = 0x01;   // Ответ: в очереди slave остались кадры
+
+class PacketPoll : public PacketBase
+{
+public:
+    PacketPoll() {
+        packetType      = CMD_POLL;
+        payloadLen      = LORA_POLL_HEADER_SIZE;
+        ackRequired     = false;        // Ответ на опрос - и есть подтверждение
+        service         = true;
+        noRetry         = true;
+    }
+
+    // Заголовок в buffer (MAX_LORA_PAYLOAD байт). Возвращает длину; подпакеты дописываются следом
+    static uint8_t writeHeader(uint8_t *buffer, uint8_t flags, const PacketId_t *acks, uint8_t ackCount) {
+        if (ackCount > LORA_POLL_MAX_ACKS)
+            ackCount = LORA_POLL_MAX_ACKS;
+        buffer[0] = flags;
+        buffer[1] = ackCount;
+        memcpy(buffer + LORA_POLL_HEADER_SIZE, acks, ackCount * sizeof(PacketId_t));
+        return LORA_POLL_HEADER_SIZE + ackCount * sizeof(PacketId_t);
+    }
+
+    // false - повреждённый кадр. data указывает на подпакеты AGR (dataLen может быть 0)
+    static bool parse(const uint8_t *buffer, uint8_t len, uint8_t &flags, const PacketId_t *&acks,
+                      uint8_t &ackCount, const uint8_t *&data, uint8_t &dataLen) {
+        if (len < LORA_POLL_HEADER_SIZE || len > MAX_LORA_PAYLOAD)
+            return false;
+        ackCount = buffer[1];
+        uint8_t headerLen = LORA_POLL_HEADER_SIZE + ackCount * sizeof(PacketId_t);
+        if (ackCount > LORA_POLL_MAX_ACKS || headerLen > len)
+            return false;
+        flags = buffer[0];
+        acks = reinterpret_cast<const PacketId_t *>(buffer + LORA_POLL_HEADER_SIZE);
+        data = buffer + headerLen;
+        dataLen = len - headerLen;
+        return true;
+    }
+};
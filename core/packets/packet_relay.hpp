@@ -0,0 +1,115 @@
+// packet_relay.hpp - Relayed frame and route advertisement packets
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include "lora_packet.hpp"
+#include <stdint.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RELAY FRAME
+// ═══════════════════════════════════════════════════════════════════════════
+// Базовый заголовок не меняется: кадр CMD_RELAY идёт от текущего узла к следующему
+// (senderId -> receiverId), а исходный пакет лежит в payload:
+// [origin:1][destination:1][hopsLeft:1][innerType:1][innerFlags:1][inner payload...]
+// packetId кадра - id исходного пакета, ACK идёт end-to-end от destination к origin.
+#pragma pack(push, 1)
+
+struct LoRaRelayHeader
+{
+    LoraAddress_t origin;
+    LoraAddress_t destination;
+    uint8_t hopsLeft;       // Сколько ещё передач разрешено, включая текущую
+    uint8_t innerType;
+    uint8_t innerFlags;
+};
+
+#pragma pack(pop)
+
+static constexpr uint8_t LORA_RELAY_HEADER_SIZE = sizeof(LoRaRelayHeader);
+// MTU согласуется только с соседом: кадр через relay - в LORA_BASE_MTU на каждом участке
+static constexpr uint8_t LORA_RELAY_MAX_INNER_PAYLOAD = LORA_BASE_MTU - LORA_RELAY_HEADER_SIZE;
+
+// Упаковать пакет для передачи через nextHop. Флаги кадра - флаги исходного пакета, но ACK
+// и повторы только end-to-end: ретранслятор кадр не подтверждает и не повторяет.
+inline bool wrapRelayFrame(const LoRaPacket &inner, LoraAddress_t origin, LoraAddress_t destination,
+                           uint8_t hopsLeft, LoraAddress_t nextHop, LoRaPacket &out)
+{
+    if (inner.payloadLen > LORA_RELAY_MAX_INNER_PAYLOAD)
+        return false;
+    LoRaRelayHeader hdr = {origin, destination, hopsLeft, inner.packetType, inner.flags};
+    LoRaPacket frame = {};
+    frame.senderId = inner.senderId;
+    frame.receiverId = nextHop;
+    frame.packetType = CMD_RELAY;
+    frame.packetId = inner.packetId;
+    frame.flags = inner.flags;
+    frame.payloadLen = LORA_RELAY_HEADER_SIZE + inner.payloadLen;
+    memcpy(frame.payload, &hdr, LORA_RELAY_HEADER_SIZE);
+    memcpy(frame.payload + LORA_RELAY_HEADER_SIZE, inner.payload, inner.payloadLen);
+    out = frame;
+    return true;
+}
+
+inline bool readRelayHeader(const LoRaPacket &frame, LoRaRelayHeader &hdr)
+{
+    if (frame.packetType != CMD_RELAY || frame.payloadLen < LORA_RELAY_HEADER_SIZE ||
+        frame.payloadLen > MAX_LORA_PAYLOAD)
+        return false;
+    memcpy(&hdr, frame.payload, LORA_RELAY_HEADER_SIZE);
+    return true;
+}
+
+// Восстановить исходный пакет на destination: senderId = origin, receiverId = destination
+inline bool unwrapRelayFrame(const LoRaPacket &frame, LoRaPacket &inner)
+{
+    LoRaRelayHeader hdr;
+    if (!readRelayHeader(frame, hdr))
+        return false;
+    LoRaPacket pkt = {};
+    pkt.senderId = hdr.origin;
+    pkt.receiverId = hdr.destination;
+    pkt.packetType = hdr.innerType;
+    pkt.packetId = frame.packetId;
+    pkt.flags = hdr.innerFlags;
+    pkt.payloadLen = frame.payloadLen - LORA_RELAY_HEADER_SIZE;
+    memcpy(pkt.payload, frame.payload + LORA_RELAY_HEADER_SIZE, pkt.payloadLen);
+    inner = pkt;
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// ROUTE ADVERTISEMENT
+// ═══════════════════════════════════════════════════════════════════════════
+// Broadcast ретранслятора: [count:1] + count * [destination:1][hops:1].
+// Получатель учит destination через отправителя с hops + 1.
+#pragma pack(push, 1)
+
+class PacketRouteAdvert : public PacketBase
+{
+public:
+    static constexpr uint8_t ENTRY_SIZE = 2;
+    static constexpr uint8_t MAX_ENTRIES = (LORA_BASE_MTU - 1) / ENTRY_SIZE;   // Анонс - broadcast
+
+    PacketRouteAdvert() {
+        packetType      = CMD_ROUTE_ADV;
+        payloadLen      = 1;
+        ackRequired     = false;
+        service         = true;         // Служебный пакет
+        noRetry         = true;
+        broadcast       = true;
+    }
+
+    // Разбор: callback(LoraAddress_t destination, uint8_t hops)
+    template <typename Callback>
+    static bool deserialize(const uint8_t *buffer, uint8_t len, Callback callback) {
+        if (len < 1 || buffer[0] > MAX_ENTRIES || len != 1 + buffer[0] * ENTRY_SIZE)
+            return false;
+        for (uint8_t i = 0; i < buffer[0]; i++) {
+            callback(buffer[1 + i * ENTRY_SIZE], buffer[2 + i * ENTRY_SIZE]);
+        }
+        return true;
+    }
+};
+
+#pragma pack(pop)
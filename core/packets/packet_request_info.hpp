@@ -7,6 +7,13 @@
 // ═══════════════════════════════════════════════════════════════════════════
 // REQUEST INFO PACKET
 // ═══════════════════════════════════════════════════════════════════════════
+// Значения requestType
+enum InfoRequestType : uint8_t
+{
+    INFO_REQUEST_APP = 0,           // Обрабатывает приложение
+    INFO_REQUEST_METRICS = 'M',     // LoRaCore отвечает страницами CMD_METRICS сам
+};
+
 #pragma pack(push, 1)
 
 // Request info packet
@@ -0,0 +1,103 @@
+// packet_tdma.hpp - TDMA beacon (superframe layout) and slot request packets
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include "packet_heartbeat.hpp"
+#include "lora_packet.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SUPERFRAME LAYOUT
+// ═══════════════════════════════════════════════════════════════════════════
+// Слоты идут подряд от конца маяка, перед каждым - guard. Длины в единицах unitMs:
+// единица выбирается master так, чтобы самый длинный слот профиля уместился в байт.
+// owner == DEVICE_ID_BROADCAST - слот конкуренции для узлов без своего слота.
+#pragma pack(push, 1)
+
+struct LoRaTdmaSlot
+{
+    LoraAddress_t owner;
+    uint8_t lenUnits;
+};
+
+#pragma pack(pop)
+
+static constexpr uint8_t LORA_TDMA_BEACON_HEADER_SIZE = sizeof(uint32_t) + 3;
+// Маяк - broadcast: не длиннее LORA_BASE_MTU
+static constexpr uint8_t LORA_TDMA_MAX_SLOTS = (LORA_BASE_MTU - LORA_TDMA_BEACON_HEADER_SIZE) / sizeof(LoRaTdmaSlot);
+
+struct LoRaTdmaLayout
+{
+    uint8_t unitMs = 1;
+    uint8_t guardUnits = 1;
+    uint8_t slotCount = 0;
+    LoRaTdmaSlot slots[LORA_TDMA_MAX_SLOTS];
+
+    uint32_t unitUs() const { return unitMs * 1000UL; }
+    uint32_t guardUs() const { return guardUnits * unitUs(); }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// BEACON
+// ═══════════════════════════════════════════════════════════════════════════
+// Heartbeat master с раскладкой суперкадра:
+// [count:4][unitMs:1][guardUnits:1][slotCount:1] + slotCount * [owner:1][lenUnits:1].
+// count - номер суперкадра; узел без TDMA видит обычный heartbeat (первые 4 байта).
+class PacketTdmaBeacon : public PacketHeartbeat
+{
+public:
+    // Payload маяка в buffer (LORA_BASE_MTU байт). Возвращает длину.
+    uint8_t serialize(const LoRaTdmaLayout &layout, uint8_t *buffer) const {
+        uint8_t slotCount = layout.slotCount > LORA_TDMA_MAX_SLOTS ? LORA_TDMA_MAX_SLOTS : layout.slotCount;
+        memcpy(buffer, &count, sizeof(count));
+        buffer[4] = layout.unitMs;
+        buffer[5] = layout.guardUnits;
+        buffer[6] = slotCount;
+        memcpy(buffer + LORA_TDMA_BEACON_HEADER_SIZE, layout.slots, slotCount * sizeof(LoRaTdmaSlot));
+        return LORA_TDMA_BEACON_HEADER_SIZE + slotCount * sizeof(LoRaTdmaSlot);
+    }
+
+    // false - обычный heartbeat или повреждённая раскладка
+    static bool deserialize(const uint8_t *buffer, uint8_t len, uint32_t &count, LoRaTdmaLayout &layout) {
+        if (len < LORA_TDMA_BEACON_HEADER_SIZE || len > MAX_LORA_PAYLOAD)
+            return false;
+        uint8_t slotCount = buffer[6];
+        if (buffer[4] == 0 || slotCount > LORA_TDMA_MAX_SLOTS ||
+            len != LORA_TDMA_BEACON_HEADER_SIZE + slotCount * sizeof(LoRaTdmaSlot))
+            return false;
+        memcpy(&count, buffer, sizeof(count));
+        layout.unitMs = buffer[4];
+        layout.guardUnits = buffer[5];
+        layout.slotCount = slotCount;
+        memcpy(layout.slots, buffer + LORA_TDMA_BEACON_HEADER_SIZE, slotCount * sizeof(LoRaTdmaSlot));
+        return true;
+    }
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SLOT REQUEST
+// ═══════════════════════════════════════════════════════════════════════════
+// Slave -> master: вход в сеть (в слоте конкуренции) и очередь, не уместившаяся в слот.
+// airtimeMs - время в эфире очереди узла с guard между кадрами; 0 - только keepalive.
+#pragma pack(push, 1)
+
+class PacketTdmaRequest : public PacketBase
+{
+public:
+    uint8_t frames;
+    uint16_t airtimeMs;
+
+    PacketTdmaRequest() : frames(0), airtimeMs(0) {
+        packetType      = CMD_TDMA_REQUEST;
+        payloadLen      = sizeof(frames) + sizeof(airtimeMs);
+        ackRequired     = false;        // Следующий маяк - и есть ответ
+        service         = true;         // Служебный пакет
+        noRetry         = true;
+    }
+};
+
+#pragma pack(pop)
+
+static constexpr uint8_t LORA_TDMA_REQUEST_FRAME_SIZE = offsetof(LoRaPacket, payload) + 3;
@@ -0,0 +1,87 @@
+// packet_transfer.hpp - Block transfer: offer, data blocks, receiver status and result
+#pragma once
+#include "packet_base.hpp"
+#include "packet_types.hpp"
+#include "lora_packet.hpp"
+#include "lora_sha256.hpp"
+#include <stdint.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// FRAMES
+// ═══════════════════════════════════════════════════════════════════════════
+// Все кадры передачи - CMD_TRANSFER: [op:1][transferId:1][тело]. transferId выбирает
+// отправитель; при возобновлении он новый, получатель узнаёт передачу по размеру и хэшу.
+//   OFFER  отправитель -> получатель: [size:4][blockSize:1][kind:1][sha256:32]
+//   DATA   отправитель -> получатель: [block:2][данные блока]; флаг ROUND в op - последний блок
+//          раунда, прислать отчёт
+//   STATUS получатель -> отправитель: [base:2][bitmap...]; все блоки до base приняты,
+//          бит i bitmap (младший бит первым) - принят блок base + i; флаг ROUND - ответ на запрос
+//   DONE   получатель -> отправитель: [result:1] после проверки хэша
+//   ABORT  любая сторона: [result:1]
+enum LoRaTransferOp : uint8_t
+{
+    LORA_XFER_OP_OFFER  = 1,
+    LORA_XFER_OP_DATA   = 2,
+    LORA_XFER_OP_STATUS = 3,
+    LORA_XFER_OP_DONE   = 4,
+    LORA_XFER_OP_ABORT  = 5,
+};
+
+static constexpr uint8_t LORA_XFER_OP_MASK = 0x7F;
+static constexpr uint8_t LORA_XFER_FLAG_ROUND = 0x80;
+
+// Что передаётся: получатель выбирает по нему приёмник данных
+enum LoRaTransferKind : uint8_t
+{
+    LORA_XFER_KIND_FILE     = 0,        // Конфиг, файл - на усмотрение приложения
+    LORA_XFER_KIND_FIRMWARE = 1,        // Образ прошивки для OTA
+};
+
+enum LoRaTransferResult : uint8_t
+{
+    LORA_XFER_OK = 0,
+    LORA_XFER_HASH_MISMATCH,            // Все блоки приняты, SHA-256 не совпал
+    LORA_XFER_SINK_ERROR,               // Приёмник данных не смог записать или завершить
+    LORA_XFER_REJECTED,                 // Получатель занят или не принимает такой kind
+    LORA_XFER_CANCELLED,                // abortTransfer()
+    LORA_XFER_TIMEOUT,                  // Нет связи дольше LORA_XFER_ABORT_MS
+    LORA_XFER_SOURCE_ERROR,             // Источник не смог прочитать блок
+};
+
+const char *transferResultName(uint8_t result);
+
+static constexpr uint8_t LORA_XFER_HEADER_SIZE = 2;
+static constexpr uint8_t LORA_XFER_DATA_HEADER_SIZE = LORA_XFER_HEADER_SIZE + sizeof(uint16_t);
+static constexpr uint8_t LORA_XFER_STATUS_HEADER_SIZE = LORA_XFER_HEADER_SIZE + sizeof(uint16_t);
+static constexpr uint8_t LORA_XFER_MAX_BITMAP = LORA_BASE_MTU - LORA_XFER_STATUS_HEADER_SIZE;
+
+#pragma pack(push, 1)
+
+struct LoRaTransferOffer
+{
+    uint32_t size;
+    uint8_t blockSize;
+    uint8_t kind;
+    uint8_t sha256[LORA_SHA256_SIZE];
+
+    uint16_t blockCount() const { return blockSize ? (uint16_t)((size + blockSize - 1) / blockSize) : 0; }
+    bool sameContent(const LoRaTransferOffer &other) const {
+        return size == other.size && blockSize == other.blockSize && kind == other.kind &&
+               memcmp(sha256, other.sha256, LORA_SHA256_SIZE) == 0;
+    }
+};
+
+#pragma pack(pop)
+
+class PacketTransfer : public PacketBase
+{
+public:
+    PacketTransfer() {
+        packetType      = CMD_TRANSFER;
+        payloadLen      = 0;
+        ackRequired     = false;        // Подтверждение - отчёт STATUS с bitmap
+        service         = true;
+        noRetry         = true;         // Потерянные блоки повторяет сама передача
+    }
+};
@@ -32,12 +32,20 @@ enum CommandType : uint8_t
     CMD_PONG                = 60,       // 'O'
     CMD_PING                = 62,       // 'P'
 
+    CMD_LOW_POWER           = 'E',      // Low-power RX notice: send to the sender with a long preamble
     CMD_CONFIG              = 'F',      // Config packet
     CMD_INFO_ENGINE         = 'I',      // Engine info packet
+    CMD_TDMA_REQUEST        = 'L',      // TDMA slot request / join
+    CMD_METRICS             = 'M',      // Metrics snapshot page
     CMD_NAV                 = 'N',      // Navigation packet
+    CMD_LINK_REPORT         = 'Q',      // Link report: SNR/RSSI of the sender's frame (TX power control)
     CMD_RSSI_REPORT         = 'R',      // RSSI report packet
     CMD_STATUS              = 'S',      // Status packet
     CMD_TELEMETRY_FRAGMENT  = 'T',      // Telemetry fragment packet
+    CMD_POLL                = 'U',      // Polling MAC: poll / reply with piggybacked ACKs
+    CMD_ROUTE_ADV           = 'V',      // Route advertisement (relay)
+    CMD_RELAY               = 'X',      // Relayed frame, inner packet in payload
+    CMD_TRANSFER            = 'Z',      // Block transfer: offer / data / status / result
     CMD_REQUEST_INFO        = 'i',      // Request info packet
     CMD_COMMAND_RESPONSE    = 'r',      // Command response packet
 
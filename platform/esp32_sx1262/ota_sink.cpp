@@ -0,0 +1,67 @@
+// ota_sink.cpp - Block transfer sink writing firmware straight into the inactive OTA partition
+#include "ota_sink.hpp"
+
+void LLog(const char *s);
+void LLog(const String &s);
+
+bool LoRaOtaSink::begin(const LoRaTransferOffer &offer)
+{
+    if (offer.kind != LORA_XFER_KIND_FIRMWARE) {
+        return false;
+    }
+    if (handle) {
+        esp_ota_abort(handle);
+        handle = 0;
+    }
+    ready = false;
+    partition = esp_ota_get_next_update_partition(nullptr);
+    if (!partition || offer.size > partition->size) {
+        LLog("OTA: no partition for " + String(offer.size) + " B");
+        return false;
+    }
+    // Размер известен: стирается только нужная часть раздела
+    esp_err_t err = esp_ota_begin(partition, offer.size, &handle);
+    if (err != ESP_OK) {
+        LLog("OTA: begin failed: " + String(esp_err_to_name(err)));
+        handle = 0;
+        return false;
+    }
+    LLog("OTA: receiving " + String(offer.size) + " B into " + String(partition->label));
+    return true;
+}
+
+// Блоки приходят не по порядку: запись по смещению
+bool LoRaOtaSink::write(uint32_t offset, const uint8_t *data, uint8_t len)
+{
+    return handle && esp_ota_write_with_offset(handle, data, len, offset) == ESP_OK;
+}
+
+bool LoRaOtaSink::read(uint32_t offset, uint8_t *out, uint8_t len)
+{
+    return partition && esp_partition_read(partition, offset, out, len) == ESP_OK;
+}
+
+bool LoRaOtaSink::finish(bool hashOk)
+{
+    if (!handle) {
+        return false;
+    }
+    if (!hashOk) {
+        esp_ota_abort(handle);
+        handle = 0;
+        return true;
+    }
+    // esp_ota_end проверяет образ (заголовок, контрольная сумма приложения)
+    esp_err_t err = esp_ota_end(handle);
+    handle = 0;
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(partition);
+    }
+    if (err != ESP_OK) {
+        LLog("OTA: image rejected: " + String(esp_err_to_name(err)));
+        return false;
+    }
+    ready = true;
+    LLog("OTA: image ready in " + String(partition->label) + ", reboot to apply");
+    return true;
+}
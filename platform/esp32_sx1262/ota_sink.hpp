@@ -0,0 +1,23 @@
+// ota_sink.hpp - Block transfer sink writing firmware straight into the inactive OTA partition
+#pragma once
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include "lora_transfer.hpp"
+
+// Приёмник LORA_XFER_KIND_FIRMWARE: блоки пишутся в следующий OTA раздел по смещению,
+// образ целиком в RAM не держится. После finish(true) раздел - загрузочный, нужна перезагрузка
+class LoRaOtaSink : public LoRaTransferSink
+{
+public:
+    bool begin(const LoRaTransferOffer &offer) override;
+    bool write(uint32_t offset, const uint8_t *data, uint8_t len) override;
+    bool read(uint32_t offset, uint8_t *out, uint8_t len) override;
+    bool finish(bool hashOk) override;
+
+    bool isReadyToBoot() const { return ready; }
+
+private:
+    const esp_partition_t *partition = nullptr;
+    esp_ota_handle_t handle = 0;
+    bool ready = false;
+};
@@ -0,0 +1,119 @@
+#include "sx1262_radio.hpp"
+
+void LLog(const char *s);
+void LLog(const String &s);
+
+Sx1262Radio *Sx1262Radio::instance = nullptr;
+
+LoRaRadio *createPlatformRadio()
+{
+    return new Sx1262Radio();
+}
+
+void Sx1262Radio::onDio1()
+{
+    if (instance && instance->irqHandler) {
+        instance->irqHandler(instance->irqContext);
+    }
+}
+
+bool Sx1262Radio::begin()
+{
+    LLog("Sx1262Radio: Инициализация SPI для LoRa...");
+    SPI.begin(pinSck, pinMiso, pinMosi, pinSs);
+    digitalWrite(pinRst, LOW); // Software reset of LoRa module
+    delay(5);
+    digitalWrite(pinRst, HIGH);
+    delay(2);
+
+    pinMode(pinBusy, INPUT);
+    LLog("Sx1262Radio: BUSY state before init: " + String(digitalRead(pinBusy)));
+    return true;
+}
+
+int Sx1262Radio::configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                               uint16_t preambleLen, int8_t txPower, uint8_t syncWord)
+{
+    int result;
+    if ((result = radio.setModem(RADIOLIB_MODEM_LORA)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setFrequency(freqMHz)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setSpreadingFactor(sf)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setCodingRate(cr)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setBandwidth(bwKHz)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setPreambleLength(preambleLen)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setCRC(true)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = radio.setOutputPower(txPower)) != RADIOLIB_ERR_NONE) return result;
+    return radio.setSyncWord(syncWord);
+}
+
+int Sx1262Radio::configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz)
+{
+    int result = radio.setModem(RADIOLIB_MODEM_FSK);
+    if (result != RADIOLIB_ERR_NONE) {
+        LLog("Sx1262Radio: GFSK setModem error: " + String(result));
+        return result;
+    }
+    result = radio.setFrequency(freqMHz);
+    if (result != RADIOLIB_ERR_NONE) {
+        LLog("Sx1262Radio: GFSK setFrequency error: " + String(result));
+        return result;
+    }
+
+    result = radio.setBitRate(bitrate / 1000.0f);
+    if (result == RADIOLIB_ERR_NONE) {
+        LLog("Sx1262Radio: GFSK setBitRate успешно, используем классический подход");
+
+        result = radio.setFrequencyDeviation(deviation / 1000.0f);
+        if (result != RADIOLIB_ERR_NONE) {
+            LLog("Sx1262Radio: GFSK setFrequencyDeviation error: " + String(result));
+            return result;
+        }
+
+        result = radio.setRxBandwidth(rxBwKHz);
+        if (result != RADIOLIB_ERR_NONE) {
+            LLog("Sx1262Radio: GFSK setRxBandwidth error: " + String(result) +
+                 " (trying to set " + String(rxBwKHz, 1) + "kHz)");
+            return result;
+        }
+    } else {
+        LLog("Sx1262Radio: setBitRate не поддерживается, пробуем beginFSK...");
+
+        if (bitrate < 4800) {
+            LLog("Sx1262Radio: GFSK bitrate " + String(bitrate) + " below SX1262 minimum (4800)");
+            return LORA_RADIO_ERR_CONFIG;
+        }
+
+        result = radio.beginFSK(bitrate / 1000.0f, deviation / 1000.0f, rxBwKHz, 32, 10.0f, false);
+        if (result != RADIOLIB_ERR_NONE) {
+            LLog("Sx1262Radio: GFSK beginFSK error: " + String(result) +
+                 " (bitrate=" + String(bitrate / 1000.0f, 1) + "kbps" +
+                 ", dev=" + String(deviation / 1000.0f, 1) + "kHz" +
+                 ", rxBw=" + String(rxBwKHz, 1) + "kHz)");
+            return result;
+        }
+    }
+
+    result = radio.setCRC(true);
+    if (result != RADIOLIB_ERR_NONE) {
+        LLog("Sx1262Radio: GFSK setCRC error: " + String(result));
+    }
+    return result;
+}
+
+void Sx1262Radio::setIrqHandler(LoRaRadioIrqHandler handler, void *context)
+{
+    irqHandler = handler;
+    irqContext = context;
+    instance = this;
+    radio.setDio1Action(onDio1);
+}
+
+void Sx1262Radio::clearIrqHandler()
+{
+    radio.clearDio1Action();
+    irqHandler = nullptr;
+    irqContext = nullptr;
+    if (instance == this) {
+        instance = nullptr;
+    }
+}
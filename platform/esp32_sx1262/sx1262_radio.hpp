@@ -0,0 +1,63 @@
+// sx1262_radio.hpp - SX1262 (RadioLib) implementation of LoRaRadio
+#pragma once
+#include <Arduino.h>
+#include <RadioLib.h>
+#include <SPI.h>
+#include "lora_radio.hpp"
+
+class Sx1262Radio : public LoRaRadio
+{
+private:
+    uint8_t pinSck, pinMiso, pinMosi, pinSs, pinRst, pinDio1, pinBusy;
+    Module *_module;
+    SX1262 radio;
+    LoRaRadioIrqHandler irqHandler = nullptr;
+    void *irqContext = nullptr;
+
+    // RadioLib setDio1Action() не принимает контекст - один SX1262 на плату
+    static Sx1262Radio *instance;
+    static void onDio1();
+
+public:
+    Sx1262Radio(uint8_t sck = LORA_SCK, uint8_t miso = LORA_MISO, uint8_t mosi = LORA_MOSI,
+                uint8_t ss = LORA_SS, uint8_t rst = LORA_RST, uint8_t dio1 = LORA_DIO1, uint8_t busy = LORA_BUSY)
+        : pinSck(sck), pinMiso(miso), pinMosi(mosi), pinSs(ss), pinRst(rst), pinDio1(dio1), pinBusy(busy),
+          _module(new Module(ss, dio1, rst, busy)),
+          radio(_module)
+    {}
+
+    ~Sx1262Radio() override
+    {
+        clearIrqHandler();
+        delete _module;
+    }
+
+    bool begin() override;
+
+    int configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                      uint16_t preambleLen, int8_t txPower, uint8_t syncWord) override;
+    int configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz) override;
+    int setPreambleLength(uint16_t preambleLen) override { return radio.setPreambleLength(preambleLen); }
+    int setOutputPower(int8_t txPower) override { return radio.setOutputPower(txPower); }
+
+    int standby() override { return radio.standby(); }
+    int transmit(const uint8_t *data, size_t len) override { return radio.transmit(const_cast<uint8_t *>(data), len); }
+    int startTransmit(const uint8_t *data, size_t len) override { return radio.startTransmit(const_cast<uint8_t *>(data), len); }
+    int finishTransmit() override { return radio.finishTransmit(); }
+
+    int startReceive() override { return radio.startReceive(); }
+    int startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols) override {
+        return radio.startReceiveDutyCycleAuto(senderPreambleLen, minSymbols);
+    }
+    int scanChannel() override { return radio.scanChannel(); }
+
+    size_t getPacketLength() override { return radio.getPacketLength(); }
+    int readData(uint8_t *data, size_t len) override { return radio.readData(data, len); }
+    float getRSSI() override { return radio.getRSSI(); }
+    float getSNR() override { return radio.getSNR(); }
+
+    void setIrqHandler(LoRaRadioIrqHandler handler, void *context) override;
+    void clearIrqHandler() override;
+
+    SX1262 &getDriver() { return radio; }
+};
@@ -0,0 +1,74 @@
+// Arduino.h - Minimal Arduino core for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <algorithm>
+#include "WString.h"
+#include "host_random.hpp"
+#include "host_rtos.hpp"
+
+using std::max;
+using std::min;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TIME (часы ядра host_rtos: реальные или симулированные)
+// ═══════════════════════════════════════════════════════════════════════════
+inline unsigned long millis() { return (unsigned long)(host::nowUs() / 1000ULL); }
+inline unsigned long micros() { return (unsigned long)host::nowUs(); }
+inline void delay(unsigned long ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+inline void delayMicroseconds(unsigned int us) { host::delayUs(us); }
+inline void yield() { taskYIELD(); }
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RANDOM (host::random(), сид задаёт randomSeed() или симулятор)
+// ═══════════════════════════════════════════════════════════════════════════
+inline void randomSeed(unsigned long seed) { host::seedRandom(seed); }
+inline long random(long maxVal) { return maxVal > 0 ? (long)(host::random32() % (uint32_t)maxVal) : 0; }
+inline long random(long minVal, long maxVal) { return maxVal > minVal ? minVal + random(maxVal - minVal) : minVal; }
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SERIAL (stdout / stdin)
+// ═══════════════════════════════════════════════════════════════════════════
+class HostSerial
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+
+    // false - вывод подавляется (симуляция многих узлов в одном процессе)
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c);
+    template <typename T>
+    size_t print(T value) { return print(String(value)); }
+
+    size_t println() { return write("\n"); }
+    size_t println(const String &s) { return print(s) + println(); }
+    size_t println(const char *s) { return print(s) + println(); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+
+    // Неблокирующий ввод: stdin читается, только если в нём есть данные
+    int available();
+    int read();
+    String readStringUntil(char terminator);
+
+    operator bool() const { return true; }
+
+private:
+    size_t write(const char *s);
+
+    bool _enabled = true;
+};
+
+extern HostSerial Serial;
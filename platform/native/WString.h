@@ -0,0 +1,147 @@
+// WString.h - Arduino String for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <type_traits>
+
+// Подмножество Arduino String, которое используют core/ и apps/.
+// Семантика как у Arduino: String(char) - символ, String(uint8_t) - число,
+// float/double печатаются с 2 знаками по умолчанию.
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) : _s(cstr ? cstr : "") {}
+    String(const char *cstr, size_t length) : _s(cstr ? std::string(cstr, length) : std::string()) {}
+    String(const std::string &s) : _s(s) {}
+    String(const String &other) = default;
+    String(String &&other) = default;
+
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(signed char value, unsigned char base = 10);
+    explicit String(short value, unsigned char base = 10);
+    explicit String(unsigned short value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &other) = default;
+    String &operator=(String &&other) = default;
+    String &operator=(const char *cstr)
+    {
+        _s = cstr ? cstr : "";
+        return *this;
+    }
+
+    // Доступ
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return _s[index]; }
+    const std::string &str() const { return _s; }
+    void reserve(unsigned int size) { _s.reserve(size); }
+
+    // Конкатенация
+    String &concat(const String &other)
+    {
+        _s += other._s;
+        return *this;
+    }
+    String &operator+=(const String &other) { return concat(other); }
+    String &operator+=(const char *cstr)
+    {
+        if (cstr)
+            _s += cstr;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        _s += c;
+        return *this;
+    }
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+    String &operator+=(T value) { return concat(String(value)); }
+
+    // Сравнение
+    bool equals(const String &other) const { return _s == other._s; }
+    bool equalsIgnoreCase(const String &other) const;
+    bool operator==(const String &other) const { return _s == other._s; }
+    bool operator==(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+    bool operator!=(const String &other) const { return _s != other._s; }
+    bool operator!=(const char *cstr) const { return !(*this == cstr); }
+    bool operator<(const String &other) const { return _s < other._s; }
+    bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    // Поиск
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int indexOf(const String &s, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    // Изменение
+    void replace(const String &find, const String &replacement);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // Преобразование
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    std::string _s;
+};
+
+inline String operator+(const String &lhs, const String &rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const String &lhs, const char *rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const char *lhs, const String &rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const String &lhs, char rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+inline String operator+(const String &lhs, T rhs)
+{
+    String result(lhs);
+    result += String(rhs);
+    return result;
+}
+
+inline bool operator==(const char *lhs, const String &rhs) { return rhs == lhs; }
+inline bool operator!=(const char *lhs, const String &rhs) { return rhs != lhs; }
@@ -0,0 +1,238 @@
+// host_arduino.cpp - String and Serial for host (native) builds
+#include "Arduino.h"
+#include <ctype.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+HostSerial Serial;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// STRING
+// ═══════════════════════════════════════════════════════════════════════════
+static std::string formatUnsigned(unsigned long long value, unsigned char base)
+{
+    if (base < 2 || base > 36)
+        base = 10;
+    if (value == 0)
+        return "0";
+    std::string out;
+    while (value > 0)
+    {
+        unsigned digit = (unsigned)(value % base);
+        out.insert(out.begin(), (char)(digit < 10 ? '0' + digit : 'a' + digit - 10));
+        value /= base;
+    }
+    return out;
+}
+
+static std::string formatSigned(long long value, unsigned char base)
+{
+    // Как в Arduino: знак только для десятичной системы
+    if (base == 10 && value < 0)
+        return "-" + formatUnsigned((unsigned long long)(-(value + 1)) + 1, base);
+    return formatUnsigned((unsigned long long)value, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimalPlaces)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    return buf;
+}
+
+String::String(unsigned char value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(signed char value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(short value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned short value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _s(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _s(formatFloat(value, decimalPlaces)) {}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+    if (_s.size() != other._s.size())
+        return false;
+    for (size_t i = 0; i < _s.size(); i++)
+    {
+        if (tolower((unsigned char)_s[i]) != tolower((unsigned char)other._s[i]))
+            return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const
+{
+    if (offset > _s.size())
+        return false;
+    return _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    if (suffix._s.size() > _s.size())
+        return false;
+    return _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const
+{
+    size_t pos = _s.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &s, unsigned int fromIndex) const
+{
+    size_t pos = _s.find(s._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const
+{
+    size_t pos = _s.rfind(c);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+    return substring(beginIndex, (unsigned int)_s.size());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    // Arduino меняет границы местами, если begin > end
+    if (beginIndex > endIndex)
+        std::swap(beginIndex, endIndex);
+    if (beginIndex >= _s.size())
+        return String();
+    if (endIndex > _s.size())
+        endIndex = (unsigned int)_s.size();
+    return String(_s.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(const String &find, const String &replacement)
+{
+    if (find._s.empty())
+        return;
+    size_t pos = 0;
+    while ((pos = _s.find(find._s, pos)) != std::string::npos)
+    {
+        _s.replace(pos, find._s.size(), replacement._s);
+        pos += replacement._s.size();
+    }
+}
+
+void String::remove(unsigned int index)
+{
+    if (index < _s.size())
+        _s.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < _s.size())
+        _s.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+    for (char &c : _s)
+        c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+    for (char &c : _s)
+        c = (char)toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    while (begin < _s.size() && isspace((unsigned char)_s[begin]))
+        begin++;
+    size_t end = _s.size();
+    while (end > begin && isspace((unsigned char)_s[end - 1]))
+        end--;
+    _s = _s.substr(begin, end - begin);
+}
+
+long String::toInt() const
+{
+    return strtol(_s.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const
+{
+    return (float)toDouble();
+}
+
+double String::toDouble() const
+{
+    return strtod(_s.c_str(), nullptr);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SERIAL
+// ═══════════════════════════════════════════════════════════════════════════
+size_t HostSerial::write(const char *s)
+{
+    if (!_enabled || !s)
+        return 0;
+    size_t len = strlen(s);
+    fwrite(s, 1, len, stdout);
+    return len;
+}
+
+size_t HostSerial::print(char c)
+{
+    char buf[2] = {c, 0};
+    return write(buf);
+}
+
+size_t HostSerial::printf(const char *format, ...)
+{
+    if (!_enabled)
+        return 0;
+    va_list args;
+    va_start(args, format);
+    int n = vfprintf(stdout, format, args);
+    va_end(args);
+    return n > 0 ? (size_t)n : 0;
+}
+
+void HostSerial::flush()
+{
+    fflush(stdout);
+}
+
+int HostSerial::available()
+{
+    struct pollfd pfd;
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
+
+int HostSerial::read()
+{
+    if (!available())
+        return -1;
+    unsigned char c;
+    return ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+
+String HostSerial::readStringUntil(char terminator)
+{
+    String result;
+    int c;
+    while ((c = read()) >= 0 && c != terminator)
+        result += (char)c;
+    return result;
+}
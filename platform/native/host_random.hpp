@@ -0,0 +1,57 @@
+// host_random.hpp - Seeded deterministic RNG for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// splitmix64: быстрый, одинаковый на любом компиляторе/stdlib (в отличие от std::*_distribution)
+class HostRandom
+{
+public:
+    explicit HostRandom(uint64_t seed = 1) : state(seed) {}
+
+    void seed(uint64_t value) { state = value; }
+
+    uint64_t next64()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t next32() { return (uint32_t)(next64() >> 32); }
+
+    // [0, 1)
+    double uniform() { return (double)(next64() >> 11) * (1.0 / 9007199254740992.0); }
+
+    bool chance(double probability) { return probability > 0.0 && uniform() < probability; }
+
+    // Нормальное распределение (Box-Muller)
+    double gaussian(double mean, double sigma)
+    {
+        if (sigma <= 0.0)
+            return mean;
+        double u1 = uniform();
+        double u2 = uniform();
+        if (u1 < 1e-300)
+            u1 = 1e-300;
+        return mean + sigma * sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+    }
+
+private:
+    uint64_t state;
+};
+
+namespace host {
+
+// Общий RNG процесса: lc_random32(), Arduino random(). Сид задаёт симулятор
+inline HostRandom &random()
+{
+    static HostRandom rng(1);
+    return rng;
+}
+
+inline void seedRandom(uint64_t seed) { random().seed(seed); }
+inline uint32_t random32() { return random().next32(); }
+
+} // namespace host
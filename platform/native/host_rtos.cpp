@@ -0,0 +1,879 @@
+// host_rtos.cpp - Serialized task kernel with real-time or simulated clock
+#include "host_rtos.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+// Стек задачи ниже точки входа размечается байтом STACK_FILL: uxTaskGetStackHighWaterMark()
+// ищет нижний изменённый. Поток хоста больше, размечается столько
+static constexpr size_t STACK_PAINT_BYTES = 64 * 1024;
+static constexpr size_t STACK_RED_ZONE = 256;
+static constexpr uint8_t STACK_FILL = 0xA5;
+
+struct HostTask
+{
+    enum class State : uint8_t { READY, RUNNING, BLOCKED, DELETED };
+
+    std::string name;
+    UBaseType_t priority = 0;
+    TaskFunction_t fn = nullptr;
+    void *param = nullptr;
+
+    State state = State::READY;
+    std::condition_variable cv;
+
+    // Ожидание
+    uint64_t wakeAtUs = NO_DEADLINE;
+    bool timedOut = false;
+    std::vector<HostTask *> *waitList = nullptr;
+    bool waitingNotify = false;
+
+    // Notification
+    uint32_t notifyValue = 0;
+    bool notifyPending = false;
+
+    uint64_t readySeq = 0;
+
+    // Стек: глубина из xTaskCreate, кадр точки входа и нижний размеченный байт
+    uint32_t stackDepth = 0;
+    uintptr_t stackTop = 0;
+    uintptr_t stackLow = 0;
+};
+
+struct HostQueue
+{
+    UBaseType_t itemSize = 0;
+    UBaseType_t capacity = 0;
+    UBaseType_t count = 0;
+    std::deque<std::vector<uint8_t>> items; // Пусто для семафоров
+    std::vector<HostTask *> rxWaiters;
+    std::vector<HostTask *> txWaiters;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// KERNEL STATE
+// ═══════════════════════════════════════════════════════════════════════════
+namespace {
+
+struct TimerEvent
+{
+    std::function<void()> callback;
+};
+
+struct Kernel
+{
+    std::mutex m;
+    std::condition_variable idleCv;
+
+    HostTask *current = nullptr;            // Единственная исполняемая задача
+    std::vector<HostTask *> ready;
+    std::vector<HostTask *> all;            // В порядке создания
+    std::multimap<uint64_t, TimerEvent> timers;
+
+    host::ClockMode mode = host::ClockMode::REALTIME;
+    double timeScale = 1.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t simNowUs = 0;
+    uint64_t readySeq = 0;
+
+    uint64_t now() const
+    {
+        if (mode == host::ClockMode::SIMULATED)
+            return simNowUs;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        return (uint64_t)(us * timeScale);
+    }
+
+    std::chrono::steady_clock::time_point realTimeOf(uint64_t virtualUs) const
+    {
+        return start + std::chrono::microseconds((int64_t)((double)virtualUs / timeScale));
+    }
+};
+
+// Ядро не разрушается: detached потоки задач могут ждать на его cv до выхода процесса
+Kernel &kernel()
+{
+    static Kernel *k = new Kernel();
+    return *k;
+}
+
+thread_local HostTask *tlsSelf = nullptr;
+
+typedef std::unique_lock<std::mutex> Lock;
+
+void removeFromWaitList(HostTask *t)
+{
+    if (!t->waitList)
+        return;
+    std::vector<HostTask *> &list = *t->waitList;
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        if (list[i] == t)
+        {
+            list.erase(list.begin() + i);
+            break;
+        }
+    }
+    t->waitList = nullptr;
+}
+
+void makeReady(Kernel &k, HostTask *t)
+{
+    removeFromWaitList(t);
+    t->waitingNotify = false;
+    t->wakeAtUs = NO_DEADLINE;
+    t->state = HostTask::State::READY;
+    t->readySeq = ++k.readySeq;
+    k.ready.push_back(t);
+}
+
+// Лучшая готовая задача: выше приоритет, затем раньше стала готовой
+size_t bestReadyIndex(const Kernel &k)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < k.ready.size(); i++)
+    {
+        const HostTask *a = k.ready[i];
+        const HostTask *b = k.ready[best];
+        if (a->priority > b->priority || (a->priority == b->priority && a->readySeq < b->readySeq))
+            best = i;
+    }
+    return best;
+}
+
+uint64_t nextEventUs(const Kernel &k)
+{
+    uint64_t next = NO_DEADLINE;
+    if (!k.timers.empty())
+        next = k.timers.begin()->first;
+    for (const HostTask *t : k.all)
+    {
+        if (t->state == HostTask::State::BLOCKED && t->wakeAtUs < next)
+            next = t->wakeAtUs;
+    }
+    return next;
+}
+
+// Передать CPU следующей готовой задаче. Если готовых нет - продвинуть время
+// (ждать в реальном времени или прыгнуть в симуляции), выполнить события и таймауты.
+void dispatch(Kernel &k, Lock &lock)
+{
+    for (;;)
+    {
+        if (!k.ready.empty())
+        {
+            size_t idx = bestReadyIndex(k);
+            HostTask *next = k.ready[idx];
+            k.ready.erase(k.ready.begin() + idx);
+            next->state = HostTask::State::RUNNING;
+            k.current = next;
+            next->cv.notify_one();
+            return;
+        }
+
+        k.current = nullptr;
+        uint64_t next = nextEventUs(k);
+        if (next == NO_DEADLINE)
+        {
+            if (k.mode == host::ClockMode::SIMULATED)
+            {
+                fprintf(stderr, "host_rtos: deadlock - all tasks blocked without timeout\n");
+                abort();
+            }
+            k.idleCv.wait(lock);
+            continue;
+        }
+
+        if (k.mode == host::ClockMode::SIMULATED)
+        {
+            if (next > k.simNowUs)
+                k.simNowUs = next;
+        }
+        else if (k.now() < next)
+        {
+            k.idleCv.wait_until(lock, k.realTimeOf(next));
+            continue;
+        }
+
+        uint64_t now = k.now();
+
+        // События "прерываний" - без lock, чтобы callback мог вызывать *FromISR
+        while (!k.timers.empty() && k.timers.begin()->first <= now)
+        {
+            auto it = k.timers.begin();
+            std::function<void()> callback = std::move(it->second.callback);
+            k.timers.erase(it);
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+
+        for (HostTask *t : k.all)
+        {
+            if (t->state == HostTask::State::BLOCKED && t->wakeAtUs <= now)
+            {
+                t->timedOut = true;
+                makeReady(k, t);
+            }
+        }
+    }
+}
+
+void waitUntilCurrent(Kernel &k, Lock &lock, HostTask *self)
+{
+    self->cv.wait(lock, [&] { return k.current == self; });
+}
+
+// Текущая задача вызывающего потока. Чужой поток (main) регистрируется как задача
+HostTask *selfLocked(Kernel &k, Lock &lock)
+{
+    if (tlsSelf)
+        return tlsSelf;
+
+    HostTask *t = new HostTask();
+    t->name = k.all.empty() ? "main" : "host";
+    t->priority = 1;
+    tlsSelf = t;
+    k.all.push_back(t);
+
+    if (!k.current && k.ready.empty() && k.all.size() == 1)
+    {
+        t->state = HostTask::State::RUNNING;
+        k.current = t;
+        return t;
+    }
+
+    makeReady(k, t);
+    k.idleCv.notify_all();
+    waitUntilCurrent(k, lock, t);
+    return t;
+}
+
+// Вызывающая задача заблокирована (или удалена) - отдать CPU и дождаться своей очереди
+void block(Kernel &k, Lock &lock, HostTask *self, uint64_t deadlineUs)
+{
+    self->state = HostTask::State::BLOCKED;
+    self->wakeAtUs = deadlineUs;
+    self->timedOut = false;
+    dispatch(k, lock);
+    waitUntilCurrent(k, lock, self);
+}
+
+bool higherPriorityReady(const Kernel &k, UBaseType_t priority)
+{
+    for (const HostTask *t : k.ready)
+    {
+        if (t->priority > priority)
+            return true;
+    }
+    return false;
+}
+
+void yieldLocked(Kernel &k, Lock &lock, HostTask *self)
+{
+    makeReady(k, self);
+    dispatch(k, lock);
+    waitUntilCurrent(k, lock, self);
+}
+
+// Вытеснение: проснулась задача с более высоким приоритетом
+void maybePreempt(Kernel &k, Lock &lock)
+{
+    HostTask *self = tlsSelf;
+    if (self && k.current == self && higherPriorityReady(k, self->priority))
+        yieldLocked(k, lock, self);
+}
+
+// Пробуждение для *FromISR: true если проснувшаяся задача важнее текущей
+BaseType_t wokeHigherPriority(const Kernel &k, const HostTask *woken)
+{
+    if (!woken)
+        return pdFALSE;
+    if (!k.current || woken->priority > k.current->priority)
+        return pdTRUE;
+    return pdFALSE;
+}
+
+HostTask *wakeOne(Kernel &k, std::vector<HostTask *> &waiters)
+{
+    if (waiters.empty())
+        return nullptr;
+    size_t best = 0;
+    for (size_t i = 1; i < waiters.size(); i++)
+    {
+        if (waiters[i]->priority > waiters[best]->priority)
+            best = i;
+    }
+    HostTask *t = waiters[best];
+    makeReady(k, t);
+    return t;
+}
+
+uint64_t deadlineFor(const Kernel &k, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+        return NO_DEADLINE;
+    return k.now() + (uint64_t)ticks * (1000000ULL / configTICK_RATE_HZ);
+}
+
+// Разметка ниже своего кадра: память потока, в которую задача ещё не заходила
+__attribute__((noinline)) void paintStack(HostTask *t)
+{
+    uint8_t marker = 0;
+    volatile uint8_t *low = (volatile uint8_t *)((uintptr_t)&marker - STACK_RED_ZONE - STACK_PAINT_BYTES);
+    for (size_t i = 0; i < STACK_PAINT_BYTES; i++)
+        low[i] = STACK_FILL;
+    t->stackLow = (uintptr_t)low;
+}
+
+void taskEntry(HostTask *t)
+{
+    tlsSelf = t;
+    t->stackTop = (uintptr_t)__builtin_frame_address(0);
+    paintStack(t);
+    Kernel &k = kernel();
+    {
+        Lock lock(k.m);
+        waitUntilCurrent(k, lock, t);
+    }
+    t->fn(t->param);
+    vTaskDelete(nullptr); // Задача FreeRTOS не должна возвращаться
+}
+
+// ─── Queue core ───────────────────────────────────────────────────────────
+bool queuePut(HostQueue *q, const void *item, bool front)
+{
+    if (q->count >= q->capacity)
+        return false;
+    if (q->itemSize > 0)
+    {
+        const uint8_t *src = (const uint8_t *)item;
+        std::vector<uint8_t> data(src, src + q->itemSize);
+        if (front)
+            q->items.push_front(std::move(data));
+        else
+            q->items.push_back(std::move(data));
+    }
+    q->count++;
+    return true;
+}
+
+bool queueGet(HostQueue *q, void *buffer, bool remove)
+{
+    if (q->count == 0)
+        return false;
+    if (q->itemSize > 0)
+    {
+        if (buffer)
+            memcpy(buffer, q->items.front().data(), q->itemSize);
+        if (remove)
+            q->items.pop_front();
+    }
+    if (remove)
+        q->count--;
+    return true;
+}
+
+BaseType_t queueSend(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+    uint64_t deadline = deadlineFor(k, ticks);
+    self->timedOut = false;
+
+    for (;;)
+    {
+        if (queuePut(q, item, front))
+        {
+            wakeOne(k, q->rxWaiters);
+            maybePreempt(k, lock);
+            return pdTRUE;
+        }
+        if (ticks == 0 || self->timedOut)
+            return errQUEUE_FULL;
+        self->waitList = &q->txWaiters;
+        q->txWaiters.push_back(self);
+        block(k, lock, self, deadline);
+    }
+}
+
+BaseType_t queueReceive(QueueHandle_t q, void *buffer, TickType_t ticks, bool remove)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+    uint64_t deadline = deadlineFor(k, ticks);
+    self->timedOut = false;
+
+    for (;;)
+    {
+        if (queueGet(q, buffer, remove))
+        {
+            if (remove)
+                wakeOne(k, q->txWaiters);
+            else
+                wakeOne(k, q->rxWaiters); // Peek не забирает элемент - пусть следующий тоже увидит
+            maybePreempt(k, lock);
+            return pdTRUE;
+        }
+        if (ticks == 0 || self->timedOut)
+            return errQUEUE_EMPTY;
+        self->waitList = &q->rxWaiters;
+        q->rxWaiters.push_back(self);
+        block(k, lock, self, deadline);
+    }
+}
+
+BaseType_t queueSendFromISR(QueueHandle_t q, const void *item, bool front, BaseType_t *woken)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    if (!queuePut(q, item, front))
+        return errQUEUE_FULL;
+    HostTask *t = wakeOne(k, q->rxWaiters);
+    if (woken && wokeHigherPriority(k, t))
+        *woken = pdTRUE;
+    return pdTRUE;
+}
+
+QueueHandle_t queueCreate(UBaseType_t capacity, UBaseType_t itemSize, UBaseType_t initialCount)
+{
+    HostQueue *q = new HostQueue();
+    q->capacity = capacity;
+    q->itemSize = itemSize;
+    q->count = initialCount;
+    return q;
+}
+
+// ─── Notification core ────────────────────────────────────────────────────
+bool applyNotify(HostTask *t, uint32_t value, eNotifyAction action)
+{
+    switch (action)
+    {
+    case eSetBits:
+        t->notifyValue |= value;
+        break;
+    case eIncrement:
+        t->notifyValue++;
+        break;
+    case eSetValueWithOverwrite:
+        t->notifyValue = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (t->notifyPending)
+            return false;
+        t->notifyValue = value;
+        break;
+    case eNoAction:
+        break;
+    }
+    t->notifyPending = true;
+    return true;
+}
+
+HostTask *notifyLocked(Kernel &k, TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *result)
+{
+    if (!task || task->state == HostTask::State::DELETED)
+    {
+        *result = pdFAIL;
+        return nullptr;
+    }
+    *result = applyNotify(task, value, action) ? pdPASS : pdFAIL;
+    if (task->state == HostTask::State::BLOCKED && task->waitingNotify)
+    {
+        makeReady(k, task);
+        return task;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// ═══════════════════════════════════════════════════════════════════════════
+// HOST CLOCK
+// ═══════════════════════════════════════════════════════════════════════════
+namespace host {
+
+void setClockMode(ClockMode mode, double timeScale)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    // До первой задачи часы начинаются с нуля (симуляция воспроизводима),
+    // потом время не прыгает назад при переключении
+    uint64_t now = k.all.empty() ? 0 : k.now();
+    k.mode = mode;
+    k.timeScale = timeScale > 0.0 ? timeScale : 1.0;
+    k.simNowUs = now;
+    k.start = std::chrono::steady_clock::now() -
+              std::chrono::microseconds((int64_t)((double)now / k.timeScale));
+}
+
+ClockMode getClockMode()
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    return k.mode;
+}
+
+uint64_t nowUs()
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    return k.now();
+}
+
+void delayUs(uint64_t us)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+    if (us == 0)
+    {
+        yieldLocked(k, lock, self);
+        return;
+    }
+    block(k, lock, self, k.now() + us);
+}
+
+void scheduleAt(uint64_t atUs, std::function<void()> callback)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    k.timers.emplace(atUs, TimerEvent{std::move(callback)});
+    k.idleCv.notify_all();
+}
+
+} // namespace host
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TASKS
+// ═══════════════════════════════════════════════════════════════════════════
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+    (void)coreId;
+
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    selfLocked(k, lock);
+
+    HostTask *t = new HostTask();
+    t->name = name ? name : "";
+    t->priority = priority;
+    t->fn = fn;
+    t->param = param;
+    t->stackDepth = stackDepth;
+    k.all.push_back(t);
+    if (createdTask)
+        *createdTask = t;
+
+    std::thread(taskEntry, t).detach();
+    makeReady(k, t);
+    maybePreempt(k, lock);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                       UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, param, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+    HostTask *target = task ? task : self;
+
+    removeFromWaitList(target);
+    for (size_t i = 0; i < k.ready.size(); i++)
+    {
+        if (k.ready[i] == target)
+        {
+            k.ready.erase(k.ready.begin() + i);
+            break;
+        }
+    }
+    target->state = HostTask::State::DELETED;
+
+    if (target == self)
+    {
+        // Поток остаётся спящим навсегда - стек задачи не освобождается, как и дескриптор
+        dispatch(k, lock);
+        self->cv.wait(lock, [] { return false; });
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host::delayUs((uint64_t)ticks * (1000000ULL / configTICK_RATE_HZ));
+}
+
+void taskYIELD()
+{
+    host::delayUs(0);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(host::nowUs() / (1000000ULL / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    return selfLocked(k, lock);
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    if (!task)
+        task = xTaskGetCurrentTaskHandle();
+    return task->name.c_str();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    if (!task)
+        task = xTaskGetCurrentTaskHandle();
+    return task->priority;
+}
+
+// Наибольшая глубина стека задачи от точки входа, байт
+static size_t stackUsed(const HostTask *task)
+{
+    if (!task->stackLow)
+        return 0;
+    const volatile uint8_t *p = (const volatile uint8_t *)task->stackLow;
+    size_t untouched = 0;
+    while (untouched < STACK_PAINT_BYTES && p[untouched] == STACK_FILL)
+        untouched++;
+    return task->stackTop - (task->stackLow + untouched);
+}
+
+// Байт стека, в которые задача не заходила, из заданных в xTaskCreate (как в ESP-IDF)
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    if (!task)
+        task = xTaskGetCurrentTaskHandle();
+    size_t used = stackUsed(task);
+    return used < task->stackDepth ? task->stackDepth - used : 0;
+}
+
+std::vector<host::TaskStack> host::taskStacks()
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    std::vector<TaskStack> out;
+    for (HostTask *t : k.all)
+    {
+        if (t->stackLow && t->state != HostTask::State::DELETED)
+            out.push_back({t->name, t->stackDepth, (uint32_t)stackUsed(t)});
+    }
+    return out;
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return 0;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TASK NOTIFICATIONS
+// ═══════════════════════════════════════════════════════════════════════════
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+
+    if (self->notifyValue == 0 && ticksToWait != 0)
+    {
+        self->waitingNotify = true;
+        block(k, lock, self, deadlineFor(k, ticksToWait));
+    }
+
+    uint32_t value = self->notifyValue;
+    if (value > 0)
+        self->notifyValue = clearCountOnExit ? 0 : value - 1;
+    self->notifyPending = false;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+    xTaskNotifyFromISR(task, 0, eIncrement, higherPriorityTaskWoken);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    selfLocked(k, lock);
+    BaseType_t result;
+    notifyLocked(k, task, value, action, &result);
+    maybePreempt(k, lock);
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                              BaseType_t *higherPriorityTaskWoken)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    BaseType_t result;
+    HostTask *woken = notifyLocked(k, task, value, action, &result);
+    if (higherPriorityTaskWoken && wokeHigherPriority(k, woken))
+        *higherPriorityTaskWoken = pdTRUE;
+    return result;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit,
+                           uint32_t *notificationValue, TickType_t ticksToWait)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    HostTask *self = selfLocked(k, lock);
+
+    if (!self->notifyPending)
+    {
+        self->notifyValue &= ~bitsToClearOnEntry;
+        if (ticksToWait != 0)
+        {
+            self->waitingNotify = true;
+            block(k, lock, self, deadlineFor(k, ticksToWait));
+        }
+    }
+
+    if (notificationValue)
+        *notificationValue = self->notifyValue;
+    if (!self->notifyPending)
+        return pdFALSE;
+    self->notifyValue &= ~bitsToClearOnExit;
+    self->notifyPending = false;
+    return pdTRUE;
+}
+
+void vPortYieldFromISR(BaseType_t higherPriorityTaskWoken)
+{
+    if (!higherPriorityTaskWoken)
+        return;
+    // Из события ядра (current == nullptr) переключение сделает сам диспетчер
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    maybePreempt(k, lock);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// QUEUES AND SEMAPHORES
+// ═══════════════════════════════════════════════════════════════════════════
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    return queueCreate(length, itemSize, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    return queueReceive(queue, buffer, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    return queueReceive(queue, buffer, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+    return queueSendFromISR(queue, item, false, higherPriorityTaskWoken);
+}
+
+BaseType_t xQueueSendToFrontFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+    return queueSendFromISR(queue, item, true, higherPriorityTaskWoken);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *buffer, BaseType_t *higherPriorityTaskWoken)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    if (!queueGet(queue, buffer, true))
+        return pdFALSE;
+    HostTask *t = wakeOne(k, queue->txWaiters);
+    if (higherPriorityTaskWoken && wokeHigherPriority(k, t))
+        *higherPriorityTaskWoken = pdTRUE;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    queue->items.clear();
+    queue->count = 0;
+    while (wakeOne(k, queue->txWaiters))
+    {
+    }
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    Kernel &k = kernel();
+    Lock lock(k.m);
+    return queue->capacity - queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return queueCreate(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return queueCreate(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    return queueCreate(maxCount, 0, initialCount);
+}
@@ -0,0 +1,160 @@
+// host_rtos.hpp - FreeRTOS API on std::thread for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// HOST KERNEL
+// ═══════════════════════════════════════════════════════════════════════════
+// Задачи - это std::thread, но одновременно исполняется только одна (как одно ядро):
+// задача отдаёт CPU только в блокирующих вызовах (очередь, семафор, notify, vTaskDelay)
+// или при пробуждении более приоритетной задачи. Выбор следующей задачи детерминирован:
+// приоритет, затем порядок готовности.
+//
+// Часы:
+//   REALTIME  - millis() идёт по steady_clock (с масштабом timeScale)
+//   SIMULATED - виртуальное время стоит, пока кто-то исполняется, и прыгает к ближайшему
+//               таймауту/событию, когда все задачи заблокированы. Часы симуляции проходят
+//               за доли секунды, результат воспроизводим.
+//
+// Поток, впервые вызвавший API (обычно main), становится задачей "main" с приоритетом 1.
+
+namespace host {
+
+enum class ClockMode : uint8_t {
+    REALTIME,
+    SIMULATED
+};
+
+// Вызывать до создания задач
+void setClockMode(ClockMode mode, double timeScale = 1.0);
+ClockMode getClockMode();
+
+// Текущее время ядра в микросекундах
+uint64_t nowUs();
+
+// Блокировать текущую задачу на us микросекунд
+void delayUs(uint64_t us);
+
+// Событие в контексте "прерывания": callback вызывается, когда время дойдёт до atUs.
+// Внутри callback допустимы только *FromISR функции и scheduleAt().
+void scheduleAt(uint64_t atUs, std::function<void()> callback);
+
+// Стек задач, созданных xTaskCreate, байт: глубина и наибольшая занятая часть.
+// Поток хоста больше глубины: задача, вышедшая за неё, не падает - used > depth
+struct TaskStack
+{
+    std::string name;
+    uint32_t depth;
+    uint32_t used;
+};
+std::vector<TaskStack> taskStacks();
+
+} // namespace host
+
+// ═══════════════════════════════════════════════════════════════════════════
+// FREERTOS TYPES AND CONSTANTS
+// ═══════════════════════════════════════════════════════════════════════════
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+struct HostTask;
+struct HostQueue;
+typedef HostTask *TaskHandle_t;
+typedef HostQueue *QueueHandle_t;
+typedef HostQueue *SemaphoreHandle_t;
+
+#define pdFALSE             ((BaseType_t)0)
+#define pdTRUE              ((BaseType_t)1)
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define errQUEUE_FULL       ((BaseType_t)0)
+#define errQUEUE_EMPTY      ((BaseType_t)0)
+
+#define configTICK_RATE_HZ  1000
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) \
+    ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+enum eNotifyAction {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+};
+
+// Задачи сериализованы, поэтому критические секции на хосте пустые
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+
+// ═══════════════════════════════════════════════════════════════════════════
+// TASKS
+// ═══════════════════════════════════════════════════════════════════════════
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                       UBaseType_t priority, TaskHandle_t *createdTask);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void taskYIELD();
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+
+// Task notifications
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                              BaseType_t *higherPriorityTaskWoken);
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit,
+                           uint32_t *notificationValue, TickType_t ticksToWait);
+
+void vPortYieldFromISR(BaseType_t higherPriorityTaskWoken);
+#define portYIELD_FROM_ISR(x)   vPortYieldFromISR(x)
+
+// ═══════════════════════════════════════════════════════════════════════════
+// QUEUES AND SEMAPHORES (семафор = очередь с элементом нулевого размера, как в FreeRTOS)
+// ═══════════════════════════════════════════════════════════════════════════
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *buffer, TickType_t ticksToWait);
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xQueueSendToFrontFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *buffer, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSend(q, item, ticks)                  xQueueSendToBack(q, item, ticks)
+#define xQueueSendFromISR(q, item, woken)           xQueueSendToBackFromISR(q, item, woken)
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+
+#define vSemaphoreDelete(sem)                       vQueueDelete(sem)
+#define xSemaphoreTake(sem, ticks)                  xQueueReceive(sem, nullptr, ticks)
+#define xSemaphoreGive(sem)                         xQueueSendToBack(sem, nullptr, 0)
+#define xSemaphoreTakeFromISR(sem, woken)           xQueueReceiveFromISR(sem, nullptr, woken)
+#define xSemaphoreGiveFromISR(sem, woken)           xQueueSendToBackFromISR(sem, nullptr, woken)
+#define uxSemaphoreGetCount(sem)                    uxQueueMessagesWaiting(sem)
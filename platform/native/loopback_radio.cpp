@@ -0,0 +1,240 @@
+#include "loopback_radio.hpp"
+#include <algorithm>
+#include <string.h>
+
+LoRaRadio *createPlatformRadio()
+{
+    return new LoopbackRadio();
+}
+
+LoopbackRadio::~LoopbackRadio()
+{
+    std::vector<LoopbackRadio *> linked;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        linked = peers;
+    }
+    for (auto *peer : linked) {
+        disconnect(*peer);
+    }
+}
+
+void LoopbackRadio::connect(LoopbackRadio &peer)
+{
+    if (&peer == this) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (std::find(peers.begin(), peers.end(), &peer) == peers.end()) peers.push_back(&peer);
+    }
+    std::lock_guard<std::mutex> lock(peer.mtx);
+    if (std::find(peer.peers.begin(), peer.peers.end(), this) == peer.peers.end()) peer.peers.push_back(this);
+}
+
+void LoopbackRadio::disconnect(LoopbackRadio &peer)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        peers.erase(std::remove(peers.begin(), peers.end(), &peer), peers.end());
+    }
+    std::lock_guard<std::mutex> lock(peer.mtx);
+    peer.peers.erase(std::remove(peer.peers.begin(), peer.peers.end(), this), peer.peers.end());
+}
+
+void LoopbackRadio::setLinkQuality(float rssi, float snr)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    linkRssi = rssi;
+    linkSnr = snr;
+}
+
+int LoopbackRadio::configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                                 uint16_t preambleLen, int8_t txPower, uint8_t syncWord)
+{
+    if (sf < 5 || sf > 12 || cr < 5 || cr > 8 || bwKHz <= 0) return LORA_RADIO_ERR_CONFIG;
+    std::lock_guard<std::mutex> lock(mtx);
+    mod.lora = true;
+    mod.freqMHz = freqMHz;
+    mod.sf = sf;
+    mod.cr = cr;
+    mod.bwKHz = bwKHz;
+    mod.bitrate = 0;
+    mod.preambleLen = preambleLen;
+    mod.txPower = txPower;
+    mod.syncWord = syncWord;
+    state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz)
+{
+    if (bitrate < 4800) return LORA_RADIO_ERR_CONFIG;
+    std::lock_guard<std::mutex> lock(mtx);
+    mod.lora = false;
+    mod.freqMHz = freqMHz;
+    mod.sf = 0;
+    mod.cr = 0;
+    mod.bwKHz = rxBwKHz;
+    mod.bitrate = bitrate;
+    mod.deviation = deviation;
+    state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::setPreambleLength(uint16_t len)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    mod.preambleLen = len;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::setOutputPower(int8_t txPower)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    mod.txPower = txPower;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::standby()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::transmit(const uint8_t *data, size_t len)
+{
+    if (!data || len == 0 || len > MAX_FRAME_LEN) return LORA_RADIO_ERR_UNKNOWN;
+
+    Modulation tx;
+    std::vector<LoopbackRadio *> targets;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tx = mod;
+        targets = peers;
+        state = State::STANDBY;
+        txCount++;
+    }
+    for (auto *peer : targets) {
+        peer->deliver(tx, data, len);
+    }
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::startTransmit(const uint8_t *data, size_t len)
+{
+    int result = transmit(data, len);
+    if (result != LORA_RADIO_OK) return result;
+
+    LoRaRadioIrqHandler handler = nullptr;
+    void *context = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        handler = irqHandler;
+        context = irqContext;
+    }
+    if (handler) {
+        handler(context);
+    }
+    return LORA_RADIO_OK;
+}
+
+bool LoopbackRadio::canHear(const Modulation &tx) const
+{
+    if (state == State::STANDBY) return false;
+    if (tx.lora != mod.lora || tx.freqMHz != mod.freqMHz) return false;
+    if (mod.lora) {
+        if (tx.sf != mod.sf || tx.bwKHz != mod.bwKHz || tx.syncWord != mod.syncWord) return false;
+        // Duty-cycle приёмник спит: нужна преамбула, перекрывающая период сна
+        if (state == State::RX_DUTY_CYCLE && tx.preambleLen < dutyCyclePreambleLen) return false;
+        return true;
+    }
+    return tx.bitrate == mod.bitrate && tx.deviation == mod.deviation;
+}
+
+void LoopbackRadio::deliver(const Modulation &tx, const uint8_t *data, size_t len)
+{
+    LoRaRadioIrqHandler handler = nullptr;
+    void *context = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!canHear(tx)) {
+            missedCount++;
+            return;
+        }
+        memcpy(rxBuf, data, len);
+        rxLen = len;
+        rxCount++;
+        handler = irqHandler;
+        context = irqContext;
+    }
+    if (handler) {
+        handler(context);
+    }
+}
+
+int LoopbackRadio::startReceive()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    state = State::RX;
+    return LORA_RADIO_OK;
+}
+
+int LoopbackRadio::scanChannel()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    state = State::STANDBY;
+    return LORA_RADIO_CHANNEL_FREE;
+}
+
+int LoopbackRadio::startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    // Как RadioLib: если преамбула короче двух окон детекции - обычный непрерывный приём
+    if (2 * minSymbols > senderPreambleLen) {
+        state = State::RX;
+    } else {
+        state = State::RX_DUTY_CYCLE;
+        dutyCyclePreambleLen = senderPreambleLen;
+    }
+    return LORA_RADIO_OK;
+}
+
+size_t LoopbackRadio::getPacketLength()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return rxLen;
+}
+
+int LoopbackRadio::readData(uint8_t *data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!data) return LORA_RADIO_ERR_UNKNOWN;
+    memcpy(data, rxBuf, std::min(len, rxLen));
+    return LORA_RADIO_OK;
+}
+
+float LoopbackRadio::getRSSI()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return linkRssi;
+}
+
+float LoopbackRadio::getSNR()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return linkSnr;
+}
+
+void LoopbackRadio::setIrqHandler(LoRaRadioIrqHandler handler, void *context)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    irqHandler = handler;
+    irqContext = context;
+}
+
+void LoopbackRadio::clearIrqHandler()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    irqHandler = nullptr;
+    irqContext = nullptr;
+}
@@ -0,0 +1,95 @@
+// loopback_radio.hpp - In-memory LoRaRadio for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+#include "lora_radio.hpp"
+
+// Радио без железа: transmit() мгновенно кладёт кадр в RX буфер связанных радио
+// и вызывает их IRQ. Кадр принимается, только если модуляция совпадает
+// (LoRa SF/BW или GFSK bitrate, частота) и приёмник слушает.
+// Duty-cycle приёмник слышит только кадры с достаточно длинной преамбулой.
+class LoopbackRadio : public LoRaRadio
+{
+public:
+    static constexpr size_t MAX_FRAME_LEN = 255;
+
+    LoopbackRadio() {}
+    ~LoopbackRadio() override;
+
+    // Двусторонняя связь между радио
+    void connect(LoopbackRadio &peer);
+    void disconnect(LoopbackRadio &peer);
+
+    // RSSI/SNR, с которыми это радио "принимает" кадры
+    void setLinkQuality(float rssi, float snr);
+
+    uint32_t getTxCount() const { return txCount; }
+    uint32_t getRxCount() const { return rxCount; }
+    uint32_t getMissedCount() const { return missedCount; }
+
+    bool begin() override { return true; }
+
+    int configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                      uint16_t preambleLen, int8_t txPower, uint8_t syncWord) override;
+    int configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz) override;
+    int setPreambleLength(uint16_t len) override;
+    int setOutputPower(int8_t txPower) override;
+
+    int standby() override;
+    int transmit(const uint8_t *data, size_t len) override;
+    // Кадр доставляется мгновенно: IRQ TX done - сразу из startTransmit()
+    int startTransmit(const uint8_t *data, size_t len) override;
+    int finishTransmit() override { return standby(); }
+
+    int startReceive() override;
+    int startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols) override;
+    // Кадр доставляется мгновенно - эфир всегда свободен
+    int scanChannel() override;
+
+    size_t getPacketLength() override;
+    int readData(uint8_t *data, size_t len) override;
+    float getRSSI() override;
+    float getSNR() override;
+
+    void setIrqHandler(LoRaRadioIrqHandler handler, void *context) override;
+    void clearIrqHandler() override;
+
+private:
+    enum class State : uint8_t { STANDBY, RX, RX_DUTY_CYCLE };
+
+    struct Modulation {
+        bool lora = true;
+        float freqMHz = 0;
+        uint8_t sf = 0;
+        uint8_t cr = 0;
+        float bwKHz = 0;
+        uint32_t bitrate = 0;
+        uint32_t deviation = 0;
+        uint16_t preambleLen = LORA_PREAMBLE_LEN;
+        int8_t txPower = LORA_TX_POWER;
+        uint8_t syncWord = LORA_SYNC_WORD;
+    };
+
+    bool canHear(const Modulation &tx) const;
+    void deliver(const Modulation &tx, const uint8_t *data, size_t len);
+
+    mutable std::mutex mtx;
+    std::vector<LoopbackRadio *> peers;
+    Modulation mod;
+    State state = State::STANDBY;
+    uint16_t dutyCyclePreambleLen = 0;
+
+    uint8_t rxBuf[MAX_FRAME_LEN] = {};
+    size_t rxLen = 0;
+    float linkRssi = -60.0f;
+    float linkSnr = 10.0f;
+
+    LoRaRadioIrqHandler irqHandler = nullptr;
+    void *irqContext = nullptr;
+
+    uint32_t txCount = 0;
+    uint32_t rxCount = 0;
+    uint32_t missedCount = 0;
+};
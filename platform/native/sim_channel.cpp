@@ -0,0 +1,421 @@
+// sim_channel.cpp - Discrete-event shared LoRa channel
+#include "sim_channel.hpp"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <Arduino.h>
+#include "lora_helpers.hpp"
+
+// Порог демодуляции SX1262 (SNR, дБ) для SF5..SF12
+static float loraRequiredSnrDb(uint8_t sf)
+{
+    static const float table[] = {-2.5f, -5.0f, -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f};
+    if (sf < 5) sf = 5;
+    if (sf > 12) sf = 12;
+    return table[sf - 5];
+}
+
+static double dbmToMw(float dbm) { return pow(10.0, dbm / 10.0); }
+static float mwToDbm(double mw) { return (float)(10.0 * log10(mw)); }
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CHANNEL
+// ═══════════════════════════════════════════════════════════════════════════
+SimChannel::SimChannel(const SimChannelConfig &cfg)
+    : config(cfg), rng(cfg.seed)
+{
+}
+
+std::pair<int, int> SimChannel::linkKey(const SimRadio &a, const SimRadio &b)
+{
+    return std::make_pair(std::min(a.index, b.index), std::max(a.index, b.index));
+}
+
+void SimChannel::setLinkLoss(const SimRadio &a, const SimRadio &b, float lossDb)
+{
+    linkLoss[linkKey(a, b)] = lossDb;
+}
+
+void SimChannel::setLinkLossRate(const SimRadio &a, const SimRadio &b, float rate)
+{
+    linkLossRates[linkKey(a, b)] = rate;
+}
+
+float SimChannel::pathLossDb(const SimRadio &a, const SimRadio &b) const
+{
+    auto it = linkLoss.find(linkKey(a, b));
+    if (it != linkLoss.end())
+        return it->second;
+
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    float distance = std::max(1.0f, sqrtf(dx * dx + dy * dy));
+    return config.referenceLossDb + 10.0f * config.pathLossExponent * log10f(distance);
+}
+
+float SimChannel::linkLossRate(const SimRadio &a, const SimRadio &b) const
+{
+    auto it = linkLossRates.find(linkKey(a, b));
+    return it != linkLossRates.end() ? it->second : config.packetLossRate;
+}
+
+float SimChannel::noiseFloorDbm(const SimRadio &radio) const
+{
+    // kTB + NF. GFSK - по полосе приёмника
+    float bwHz = radio.mod.lora ? radio.mod.bwKHz * 1000.0f : radio.mod.rxBwKHz * 1000.0f;
+    if (bwHz <= 0)
+        bwHz = 2.0f * radio.mod.bitrate;
+    return -174.0f + 10.0f * log10f(std::max(bwHz, 1.0f)) + config.noiseFigureDb;
+}
+
+float SimChannel::requiredSnrDb(const SimRadio &radio) const
+{
+    return radio.mod.lora ? loraRequiredSnrDb(radio.mod.sf) : config.fskRequiredSnrDb;
+}
+
+void SimChannel::attach(SimRadio *radio)
+{
+    radio->index = (int)radios.size();
+    radios.push_back(radio);
+}
+
+void SimChannel::detach(SimRadio *radio)
+{
+    if (radio->index >= 0 && radio->index < (int)radios.size())
+        radios[radio->index] = nullptr;
+}
+
+SimChannel::Transmission *SimChannel::findTransmission(uint32_t txId)
+{
+    for (auto &t : transmissions) {
+        if (t.id == txId)
+            return &t;
+    }
+    return nullptr;
+}
+
+// Кадры мешают друг другу только на одном канале с одинаковой модуляцией
+bool SimChannel::interferes(const Transmission &a, const Transmission &b) const
+{
+    if (a.startUs >= b.endUs || b.startUs >= a.endUs)
+        return false;
+    return SimRadio::sameChannel(a.mod, b.mod);
+}
+
+uint32_t SimChannel::beginTransmission(SimRadio *sender, const uint8_t *data, size_t len)
+{
+    const SimRadio::Modulation &m = sender->mod;
+    uint32_t toaUs = m.lora ? loraTimeOnAirUs(m.sf, m.bwKHz, m.cr, m.preambleLen, len)
+                            : fskTimeOnAirUs(m.bitrate, len);
+
+    Transmission t;
+    t.id = nextTxId++;
+    t.sender = sender;
+    t.mod = m;
+    t.startUs = host::nowUs();
+    t.endUs = t.startUs + toaUs;
+    t.active = true;
+    t.data.assign(data, data + len);
+    t.powerDbm.assign(radios.size(), -200.0f);
+
+    stats.transmissions++;
+    stats.airtimeUs += toaUs;
+    if (frameObserver)
+        frameObserver(*sender, data, len, toaUs);
+
+    for (SimRadio *rx : radios) {
+        if (!rx || rx == sender)
+            continue;
+
+        float shadowing = (float)rng.gaussian(0.0, config.shadowingSigmaDb);
+        float power = m.txPower - pathLossDb(*sender, *rx) + shadowing;
+        t.powerDbm[rx->index] = power;
+
+        // Приёмник захватывает первый слышимый кадр, остальные - помеха
+        if (!rx->isListening() || rx->lockedTxId != 0 || !rx->canHear(m))
+            continue;
+        if (power - noiseFloorDbm(*rx) < requiredSnrDb(*rx)) {
+            stats.belowSensitivity++;
+            continue;
+        }
+        rx->lockedTxId = t.id;
+    }
+
+    uint32_t txId = t.id;
+    transmissions.push_back(std::move(t));
+    host::scheduleAt(host::nowUs() + toaUs, [this, txId] { endTransmission(txId); });
+    return toaUs;
+}
+
+bool SimChannel::channelActive(const SimRadio &radio) const
+{
+    for (const auto &t : transmissions) {
+        if (!t.active || t.sender == &radio || radio.index >= (int)t.powerDbm.size())
+            continue;
+        if (SimRadio::sameChannel(t.mod, radio.mod) &&
+            t.powerDbm[radio.index] - noiseFloorDbm(radio) >= requiredSnrDb(radio))
+            return true;
+    }
+    return false;
+}
+
+void SimChannel::endTransmission(uint32_t txId)
+{
+    Transmission *t = findTransmission(txId);
+    if (!t)
+        return;
+    t->active = false;
+    t->sender->state = SimRadio::State::STANDBY; // SX1262 после TX_DONE уходит в standby
+    if (t->sender->txDoneIrq) {
+        t->sender->txDoneIrq = false;
+        if (t->sender->irqHandler)
+            t->sender->irqHandler(t->sender->irqContext);
+    }
+
+    for (SimRadio *rx : radios) {
+        if (!rx || rx->lockedTxId != txId)
+            continue;
+        rx->lockedTxId = 0;
+
+        float signal = t->powerDbm[rx->index];
+        double noiseMw = dbmToMw(noiseFloorDbm(*rx));
+        double interferenceMw = 0.0;
+        for (const auto &other : transmissions) {
+            if (other.id != txId && other.sender != rx && rx->index < (int)other.powerDbm.size() &&
+                interferes(*t, other))
+                interferenceMw += dbmToMw(other.powerDbm[rx->index]);
+        }
+
+        if (interferenceMw > 0.0) {
+            if (signal - mwToDbm(interferenceMw) < config.captureThresholdDb) {
+                stats.collisions++;
+                continue;
+            }
+            stats.captured++;
+        }
+
+        if (rng.chance(linkLossRate(*t->sender, *rx))) {
+            stats.randomDrops++;
+            continue;
+        }
+
+        float snr = signal - mwToDbm(noiseMw + interferenceMw);
+        float rssi = mwToDbm(dbmToMw(signal) + noiseMw);
+        stats.delivered++;
+        rx->deliver(t->data.data(), t->data.size(), rssi, snr);
+    }
+
+    pruneHistory();
+}
+
+// Завершённые кадры нужны, пока пересекаются с кадрами в эфире
+void SimChannel::pruneHistory()
+{
+    uint64_t oldestActive = UINT64_MAX;
+    for (const auto &t : transmissions) {
+        if (t.active)
+            oldestActive = std::min(oldestActive, t.startUs);
+    }
+    transmissions.erase(std::remove_if(transmissions.begin(), transmissions.end(),
+                                       [oldestActive](const Transmission &t) {
+                                           return !t.active && t.endUs <= oldestActive;
+                                       }),
+                        transmissions.end());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// RADIO
+// ═══════════════════════════════════════════════════════════════════════════
+SimRadio::SimRadio(SimChannel &ch, float xMeters, float yMeters)
+    : channel(ch), x(xMeters), y(yMeters)
+{
+    channel.attach(this);
+}
+
+SimRadio::~SimRadio()
+{
+    channel.detach(this);
+}
+
+void SimRadio::setPosition(float xMeters, float yMeters)
+{
+    x = xMeters;
+    y = yMeters;
+}
+
+int SimRadio::configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                            uint16_t preambleLen, int8_t txPower, uint8_t syncWord)
+{
+    if (sf < 5 || sf > 12 || cr < 5 || cr > 8 || bwKHz <= 0) return LORA_RADIO_ERR_CONFIG;
+    abortReception();
+    mod.lora = true;
+    mod.freqMHz = freqMHz;
+    mod.sf = sf;
+    mod.cr = cr;
+    mod.bwKHz = bwKHz;
+    mod.preambleLen = preambleLen;
+    mod.txPower = txPower;
+    mod.syncWord = syncWord;
+    state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz)
+{
+    if (bitrate < 4800) return LORA_RADIO_ERR_CONFIG;
+    abortReception();
+    mod.lora = false;
+    mod.freqMHz = freqMHz;
+    mod.bitrate = bitrate;
+    mod.deviation = deviation;
+    mod.rxBwKHz = rxBwKHz;
+    state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::setPreambleLength(uint16_t len)
+{
+    mod.preambleLen = len;
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::setOutputPower(int8_t txPower)
+{
+    mod.txPower = txPower;
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::standby()
+{
+    abortReception();
+    if (state != State::TX)
+        state = State::STANDBY;
+    return LORA_RADIO_OK;
+}
+
+uint32_t SimRadio::beginTx(const uint8_t *data, size_t len)
+{
+    abortReception(); // Half-duplex
+    // Буфер SX1262 общий для TX и RX (RadioLib: base address 0): непрочитанный кадр затирается
+    if (rxUnread) {
+        channel.stats.overwritten++;
+        rxUnread = false;
+    }
+    state = State::TX;
+    txCount++;
+
+    uint32_t toaUs = channel.beginTransmission(this, data, len);
+    txAirtimeUs += toaUs;
+    return toaUs;
+}
+
+int SimRadio::transmit(const uint8_t *data, size_t len)
+{
+    if (!data || len == 0 || len > MAX_FRAME_LEN) return LORA_RADIO_ERR_UNKNOWN;
+
+    uint32_t toaUs = beginTx(data, len);
+    // Блокирующая передача, как RadioLib transmit(): задача спит до конца кадра
+    host::delayUs(toaUs);
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::startTransmit(const uint8_t *data, size_t len)
+{
+    if (!data || len == 0 || len > MAX_FRAME_LEN) return LORA_RADIO_ERR_UNKNOWN;
+
+    txDoneIrq = true;
+    beginTx(data, len);
+    return LORA_RADIO_OK;
+}
+
+bool SimRadio::sameChannel(const Modulation &a, const Modulation &b)
+{
+    if (a.lora != b.lora || a.freqMHz != b.freqMHz) return false;
+    if (a.lora) return a.sf == b.sf && a.bwKHz == b.bwKHz;
+    return a.bitrate == b.bitrate;
+}
+
+bool SimRadio::canHear(const Modulation &tx) const
+{
+    if (!sameChannel(tx, mod)) return false;
+    if (mod.lora) {
+        if (tx.syncWord != mod.syncWord) return false;
+        // Duty-cycle приёмник спит: нужна преамбула, перекрывающая период сна
+        if (state == State::RX_DUTY_CYCLE && tx.preambleLen < dutyCyclePreambleLen) return false;
+        return true;
+    }
+    return tx.deviation == mod.deviation;
+}
+
+void SimRadio::abortReception()
+{
+    if (lockedTxId != 0) {
+        channel.stats.aborted++;
+        lockedTxId = 0;
+    }
+}
+
+void SimRadio::deliver(const uint8_t *data, size_t len, float rssi, float snr)
+{
+    if (rxUnread)
+        channel.stats.overwritten++;
+    memcpy(rxBuf, data, len);
+    rxLen = len;
+    rxRssi = rssi;
+    rxSnr = snr;
+    rxUnread = true;
+    rxCount++;
+    if (irqHandler)
+        irqHandler(irqContext);
+}
+
+int SimRadio::startReceive()
+{
+    abortReception();
+    state = State::RX;
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols)
+{
+    abortReception();
+    // Как RadioLib: если преамбула короче двух окон детекции - обычный непрерывный приём
+    if (2 * minSymbols > senderPreambleLen) {
+        state = State::RX;
+    } else {
+        state = State::RX_DUTY_CYCLE;
+        dutyCyclePreambleLen = senderPreambleLen;
+    }
+    return LORA_RADIO_OK;
+}
+
+int SimRadio::scanChannel()
+{
+    if (!mod.lora) return LORA_RADIO_ERR_CONFIG;
+
+    abortReception();
+    state = State::STANDBY;
+    uint32_t symbolUs = (uint32_t)((float)(1UL << mod.sf) * 1000.0f / mod.bwKHz);
+    host::delayUs(2 * symbolUs);
+    return channel.channelActive(*this) ? LORA_RADIO_LORA_DETECTED : LORA_RADIO_CHANNEL_FREE;
+}
+
+int SimRadio::readData(uint8_t *data, size_t len)
+{
+    if (!data) return LORA_RADIO_ERR_UNKNOWN;
+    memcpy(data, rxBuf, std::min(len, rxLen));
+    rxUnread = false;
+    return LORA_RADIO_OK;
+}
+
+void SimRadio::setIrqHandler(LoRaRadioIrqHandler handler, void *context)
+{
+    irqHandler = handler;
+    irqContext = context;
+}
+
+void SimRadio::clearIrqHandler()
+{
+    irqHandler = nullptr;
+    irqContext = nullptr;
+}
@@ -0,0 +1,220 @@
+// sim_channel.hpp - Discrete-event shared LoRa channel for host (native) builds
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+#include "lora_radio.hpp"
+#include "host_random.hpp"
+
+class SimChannel;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// CHANNEL MODEL
+// ═══════════════════════════════════════════════════════════════════════════
+// Общий эфир для N SimRadio. Работает на часах host_rtos (SIMULATED - часы симуляции
+// проходят за секунды). Модель:
+//   - Время в эфире по формуле SX1262 для текущей модуляции отправителя
+//   - Кадр слышат только приёмники в RX с той же частотой, SF/BW (LoRa) или bitrate (GFSK)
+//     и sync word. Разные SF/BW считаются ортогональными и не мешают друг другу
+//   - Half-duplex: передающее радио не принимает, TX/standby/перенастройка рвут приём
+//   - Log-distance path loss (+ shadowing на кадр) -> RSSI, SNR относительно шума полосы
+//   - Порог демодуляции по SF (SX1262), для GFSK - fskRequiredSnrDb
+//   - Приёмник захватывает первый слышимый кадр. Кадр выживает при пересечении,
+//     если он сильнее суммы помех на captureThresholdDb (capture effect)
+//   - Случайные потери с seeded RNG
+struct SimChannelConfig
+{
+    uint64_t seed = 1;
+    float pathLossExponent = 2.7f;      // Пригород/над водой 2.5..3
+    float referenceLossDb = 31.2f;      // Потери на 1 м (FSPL, 868 МГц)
+    float shadowingSigmaDb = 0.0f;      // Замирания: отклонение на каждый кадр
+    float noiseFigureDb = 6.0f;         // Шум-фактор приёмника SX1262
+    float captureThresholdDb = 6.0f;    // Запас мощности для захвата при коллизии
+    float fskRequiredSnrDb = 10.0f;     // SNR для приёма GFSK
+    float packetLossRate = 0.0f;        // Случайные потери на кадр и приёмник (0..1)
+};
+
+struct SimChannelStats
+{
+    uint32_t transmissions = 0;
+    uint32_t delivered = 0;             // Кадров доставлено в RX буфер (на приёмник)
+    uint32_t collisions = 0;            // Потеряно из-за пересечения без захвата
+    uint32_t captured = 0;              // Пересечение, но кадр выжил
+    uint32_t belowSensitivity = 0;      // Слишком слабый сигнал
+    uint32_t aborted = 0;               // Приём прерван (TX, standby, перенастройка)
+    uint32_t randomDrops = 0;
+    uint32_t overwritten = 0;           // Непрочитанный кадр затёрт новым кадром или своей передачей
+    uint64_t airtimeUs = 0;             // Суммарное время в эфире всех кадров
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SIMULATED RADIO
+// ═══════════════════════════════════════════════════════════════════════════
+// LoRaRadio поверх SimChannel. transmit() блокирует задачу на время в эфире,
+// приём завершается событием ядра в контексте "прерывания" (IRQ -> LoRaCore::onReceive).
+class SimRadio : public LoRaRadio
+{
+public:
+    static constexpr size_t MAX_FRAME_LEN = 255;
+
+    SimRadio(SimChannel &channel, float xMeters = 0.0f, float yMeters = 0.0f);
+    ~SimRadio() override;
+
+    void setPosition(float xMeters, float yMeters);
+    float getX() const { return x; }
+    float getY() const { return y; }
+    int getIndex() const { return index; }
+
+    uint32_t getTxCount() const { return txCount; }
+    uint32_t getRxCount() const { return rxCount; }
+    uint64_t getTxAirtimeUs() const { return txAirtimeUs; }
+    int8_t getTxPower() const { return mod.txPower; }
+
+    bool begin() override { return true; }
+
+    int configureLoRa(float freqMHz, uint8_t sf, uint8_t cr, float bwKHz,
+                      uint16_t preambleLen, int8_t txPower, uint8_t syncWord) override;
+    int configureFSK(float freqMHz, uint32_t bitrate, uint32_t deviation, float rxBwKHz) override;
+    int setPreambleLength(uint16_t len) override;
+    int setOutputPower(int8_t txPower) override;
+
+    int standby() override;
+    int transmit(const uint8_t *data, size_t len) override;
+    // Конец кадра - событие ядра: IRQ TX done в контексте "прерывания"
+    int startTransmit(const uint8_t *data, size_t len) override;
+    int finishTransmit() override { return standby(); }
+
+    int startReceive() override;
+    int startReceiveDutyCycle(uint16_t senderPreambleLen, uint16_t minSymbols) override;
+    // CAD: 2 символа на текущем SF/BW, затем есть ли в эфире слышимый кадр того же канала
+    int scanChannel() override;
+
+    size_t getPacketLength() override { return rxLen; }
+    int readData(uint8_t *data, size_t len) override;
+    float getRSSI() override { return rxRssi; }
+    float getSNR() override { return rxSnr; }
+
+    void setIrqHandler(LoRaRadioIrqHandler handler, void *context) override;
+    void clearIrqHandler() override;
+
+private:
+    friend class SimChannel;
+
+    enum class State : uint8_t { STANDBY, RX, RX_DUTY_CYCLE, TX };
+
+    struct Modulation {
+        bool lora = true;
+        float freqMHz = LORA_FREQUENCY;
+        uint8_t sf = LORA_SF;
+        uint8_t cr = LORA_CODING_RATE;
+        float bwKHz = LORA_BANDWIDTH;
+        uint32_t bitrate = 0;
+        uint32_t deviation = 0;
+        float rxBwKHz = 0;
+        uint16_t preambleLen = LORA_PREAMBLE_LEN;
+        int8_t txPower = LORA_TX_POWER;
+        uint8_t syncWord = LORA_SYNC_WORD;
+    };
+
+    bool isListening() const { return state == State::RX || state == State::RX_DUTY_CYCLE; }
+    static bool sameChannel(const Modulation &a, const Modulation &b);
+    bool canHear(const Modulation &tx) const;
+    void abortReception();
+    void deliver(const uint8_t *data, size_t len, float rssi, float snr);
+    uint32_t beginTx(const uint8_t *data, size_t len);
+
+    SimChannel &channel;
+    int index = -1;
+    float x;
+    float y;
+
+    Modulation mod;
+    State state = State::STANDBY;
+    uint16_t dutyCyclePreambleLen = 0;
+
+    uint32_t lockedTxId = 0;            // Кадр, который сейчас принимаем
+    bool txDoneIrq = false;             // Кадр startTransmit(): IRQ по окончании
+
+    uint8_t rxBuf[MAX_FRAME_LEN] = {};
+    size_t rxLen = 0;
+    bool rxUnread = false;
+    float rxRssi = 0;
+    float rxSnr = 0;
+
+    uint32_t txCount = 0;
+    uint32_t rxCount = 0;
+    uint64_t txAirtimeUs = 0;
+
+    LoRaRadioIrqHandler irqHandler = nullptr;
+    void *irqContext = nullptr;
+};
+
+// Наблюдатель эфира: каждый кадр в момент начала передачи (статистика, трассировка)
+typedef std::function<void(const SimRadio &sender, const uint8_t *data, size_t len, uint32_t airtimeUs)> SimFrameObserver;
+
+class SimChannel
+{
+public:
+    explicit SimChannel(const SimChannelConfig &config = SimChannelConfig());
+
+    const SimChannelConfig &getConfig() const { return config; }
+    const SimChannelStats &getStats() const { return stats; }
+    HostRandom &getRandom() { return rng; }
+
+    // Фиксированные потери между двумя радио (вместо расстояния), симметрично
+    void setLinkLoss(const SimRadio &a, const SimRadio &b, float lossDb);
+    // Случайные потери на конкретной линии (вместо packetLossRate)
+    void setLinkLossRate(const SimRadio &a, const SimRadio &b, float rate);
+
+    // Затухание на линии (без shadowing)
+    float pathLossDb(const SimRadio &a, const SimRadio &b) const;
+
+    void setFrameObserver(SimFrameObserver observer) { frameObserver = observer; }
+
+private:
+    friend class SimRadio;
+
+    struct Transmission
+    {
+        uint32_t id;
+        SimRadio *sender;
+        SimRadio::Modulation mod;
+        uint64_t startUs;
+        uint64_t endUs;
+        bool active;
+        std::vector<uint8_t> data;
+        std::vector<float> powerDbm;    // Мощность у каждого радио (индекс = SimRadio::index)
+    };
+
+    void attach(SimRadio *radio);
+    void detach(SimRadio *radio);
+
+    // Начать кадр: возвращает время в эфире (мкс). Конец кадра - событие ядра
+    uint32_t beginTransmission(SimRadio *sender, const uint8_t *data, size_t len);
+    // Идёт чужой кадр на канале радио с мощностью выше порога демодуляции (CAD)
+    bool channelActive(const SimRadio &radio) const;
+    void endTransmission(uint32_t txId);
+
+    Transmission *findTransmission(uint32_t txId);
+    bool interferes(const Transmission &a, const Transmission &b) const;
+    float noiseFloorDbm(const SimRadio &radio) const;
+    float requiredSnrDb(const SimRadio &radio) const;
+    float linkLossRate(const SimRadio &a, const SimRadio &b) const;
+    void pruneHistory();
+
+    static std::pair<int, int> linkKey(const SimRadio &a, const SimRadio &b);
+
+    SimChannelConfig config;
+    SimChannelStats stats;
+    HostRandom rng;
+
+    std::vector<SimRadio *> radios;     // Индекс = SimRadio::index (nullptr после detach)
+    std::vector<Transmission> transmissions;
+    std::map<std::pair<int, int>, float> linkLoss;
+    std::map<std::pair<int, int>, float> linkLossRates;
+    uint32_t nextTxId = 1;
+    SimFrameObserver frameObserver;
+};
@@ -0,0 +1,95 @@
+// test_airtime.cpp - LoRaAirtimeWindow / LoRaAirtimeLedger: sliding window, wait at bucket boundaries
+#include <unity.h>
+#include "lora_airtime.hpp"
+#include "lora_packets.hpp"
+
+static constexpr uint32_t BUCKET_MS = LORA_DUTY_CYCLE_WINDOW_MS / LORA_DUTY_CYCLE_BUCKETS;
+static constexpr uint32_t BUDGET_US = 36000000;     // 1% часа
+
+void setUp() {}
+void tearDown() {}
+
+void test_window_fits_exactly()
+{
+    LoRaAirtimeWindow window;
+    window.add(0, BUDGET_US - 1000);
+    TEST_ASSERT_EQUAL_UINT32(0, window.waitMs(0, 1000, BUDGET_US));
+    TEST_ASSERT_GREATER_THAN(0, window.waitMs(0, 1001, BUDGET_US));
+    // Кадр больше бюджета не поместится никогда
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, window.waitMs(0, BUDGET_US + 1, BUDGET_US));
+}
+
+// Эфир в корзине уходит из суммы через окно после конца корзины: ожидание не больше
+// фактического на одну корзину и не скачет на её границе
+void test_window_wait_across_bucket_boundaries()
+{
+    LoRaAirtimeWindow window;
+    window.add(0, BUDGET_US);
+    uint32_t releaseMs = LORA_DUTY_CYCLE_WINDOW_MS + BUCKET_MS;
+    TEST_ASSERT_EQUAL_UINT32(releaseMs, window.waitMs(0, 1, BUDGET_US));
+
+    const uint32_t checks[] = {1, BUCKET_MS / 2, BUCKET_MS - 1, BUCKET_MS, BUCKET_MS + 1, 30 * BUCKET_MS,
+                               LORA_DUTY_CYCLE_WINDOW_MS, releaseMs - 1};
+    for (uint32_t now : checks) {
+        TEST_ASSERT_EQUAL_UINT32(releaseMs - now, window.waitMs(now, 1, BUDGET_US));
+        TEST_ASSERT_EQUAL_UINT32(BUDGET_US, window.used(now));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, window.waitMs(releaseMs, 1, BUDGET_US));
+    TEST_ASSERT_EQUAL_UINT32(0, window.used(releaseMs));
+}
+
+// Ждать - до ухода старых корзин, которых хватает на кадр, а не всего окна
+void test_window_wait_for_oldest_buckets()
+{
+    LoRaAirtimeWindow window;
+    window.add(0, BUDGET_US / 4);
+    window.add(10 * BUCKET_MS + 5, BUDGET_US / 4);
+    window.add(20 * BUCKET_MS, BUDGET_US / 2);
+    uint32_t now = 30 * BUCKET_MS;
+
+    // Корзина 0 уходит в 61 корзину от начала, корзина 10 - в 71
+    uint32_t firstMs = LORA_DUTY_CYCLE_WINDOW_MS + BUCKET_MS;
+    TEST_ASSERT_EQUAL_UINT32(firstMs - now, window.waitMs(now, BUDGET_US / 4, BUDGET_US));
+    TEST_ASSERT_EQUAL_UINT32(firstMs + 10 * BUCKET_MS - now, window.waitMs(now, BUDGET_US / 4 + 1, BUDGET_US));
+}
+
+// Пропуск больше окна очищает все корзины
+void test_window_long_gap()
+{
+    LoRaAirtimeWindow window;
+    window.add(0, 1000);
+    window.add(5 * BUCKET_MS, 2000);
+    TEST_ASSERT_EQUAL_UINT32(3000, window.used(5 * BUCKET_MS));
+    TEST_ASSERT_EQUAL_UINT32(0, window.used(10 * LORA_DUTY_CYCLE_WINDOW_MS));
+    window.add(10 * LORA_DUTY_CYCLE_WINDOW_MS, 500);
+    TEST_ASSERT_EQUAL_UINT32(500, window.used(10 * LORA_DUTY_CYCLE_WINDOW_MS + 1));
+}
+
+void test_ledger_sub_bands()
+{
+    TEST_ASSERT_EQUAL_UINT32(100, loraSubBandFor(868.1f)->dutyBp);
+    TEST_ASSERT_EQUAL_UINT32(1000, loraSubBandFor(869.525f)->dutyBp);
+    // Между поддиапазонами - общий 0.1%, вне 863-870 МГц - без ограничения
+    TEST_ASSERT_EQUAL_UINT32(10, loraSubBandFor(868.65f)->dutyBp);
+    TEST_ASSERT_TRUE(loraSubBandFor(915.0f) == nullptr);
+
+    LoRaAirtimeLedger ledger;
+    uint32_t budgetUs = loraSubBandFor(868.1f)->budgetUs();
+    ledger.record(0, 868.1f, 2, CMD_TELEMETRY_FRAGMENT, budgetUs);
+    TEST_ASSERT_GREATER_THAN(0, ledger.waitMs(0, 868.1f, 1));
+    // Другой поддиапазон - свой бюджет
+    TEST_ASSERT_EQUAL_UINT32(0, ledger.waitMs(0, 869.525f, 1));
+    ledger.record(0, 915.0f, 2, CMD_TELEMETRY_FRAGMENT, 100 * budgetUs);
+    TEST_ASSERT_EQUAL_UINT32(0, ledger.waitMs(0, 915.0f, budgetUs));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_fits_exactly);
+    RUN_TEST(test_window_wait_across_bucket_boundaries);
+    RUN_TEST(test_window_wait_for_oldest_buckets);
+    RUN_TEST(test_window_long_gap);
+    RUN_TEST(test_ledger_sub_bands);
+    return UNITY_END();
+}
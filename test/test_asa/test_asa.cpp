@@ -0,0 +1,69 @@
+// test_asa.cpp - ASA exchange payload: [profile] from older firmware, [profile][mtu], profile MTU table
+#include <unity.h>
+#include "lora_packets.hpp"
+#include "lora_helpers.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Прошивка без MTU профиля шлёт только [profile]: MTU - LORA_BASE_MTU
+void test_asa_parse_one_byte()
+{
+    const uint8_t buf[] = {7};
+    uint8_t profile = 0xFF;
+    uint8_t mtu = 0;
+    TEST_ASSERT_TRUE(parseAsaRequest(buf, sizeof(buf), profile, mtu));
+    TEST_ASSERT_EQUAL_UINT8(7, profile);
+    TEST_ASSERT_EQUAL_UINT8(LORA_BASE_MTU, mtu);
+}
+
+void test_asa_parse_two_bytes()
+{
+    const uint8_t buf[] = {8, 249};
+    uint8_t profile = 0;
+    uint8_t mtu = 0;
+    TEST_ASSERT_TRUE(parseAsaRequest(buf, sizeof(buf), profile, mtu));
+    TEST_ASSERT_EQUAL_UINT8(8, profile);
+    TEST_ASSERT_EQUAL_UINT8(249, mtu);
+}
+
+void test_asa_parse_rejects_other_lengths()
+{
+    const uint8_t buf[] = {4, 108, 0};
+    uint8_t profile = 0x55;
+    uint8_t mtu = 0x55;
+    TEST_ASSERT_FALSE(parseAsaRequest(buf, 0, profile, mtu));
+    TEST_ASSERT_FALSE(parseAsaRequest(buf, sizeof(buf), profile, mtu));
+    TEST_ASSERT_EQUAL_UINT8(0x55, profile);
+    TEST_ASSERT_EQUAL_UINT8(0x55, mtu);
+}
+
+void test_asa_packet_defaults()
+{
+    PacketAsaExchange pkt(CMD_RESPONCE_ASA);
+    TEST_ASSERT_EQUAL_UINT8(CMD_RESPONCE_ASA, pkt.packetType);
+    TEST_ASSERT_EQUAL_UINT8(2, pkt.payloadLen);
+    TEST_ASSERT_EQUAL_UINT8(LORA_BASE_MTU, pkt.mtu);
+    TEST_ASSERT_FALSE(pkt.ackRequired);
+}
+
+// MTU профиля - от LORA_BASE_MTU до MAX_LORA_PAYLOAD, неизвестный профиль - базовый
+void test_asa_profile_mtu_bounds()
+{
+    for (uint8_t i = 0; i < LORA_PROFILE_COUNT; i++) {
+        TEST_ASSERT_TRUE(profileMtu(i) >= LORA_BASE_MTU);
+        TEST_ASSERT_TRUE(profileMtu(i) <= MAX_LORA_PAYLOAD);
+    }
+    TEST_ASSERT_EQUAL_UINT8(LORA_BASE_MTU, profileMtu(LORA_PROFILE_COUNT));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_asa_parse_one_byte);
+    RUN_TEST(test_asa_parse_two_bytes);
+    RUN_TEST(test_asa_parse_rejects_other_lengths);
+    RUN_TEST(test_asa_packet_defaults);
+    RUN_TEST(test_asa_profile_mtu_bounds);
+    return UNITY_END();
+}
@@ -0,0 +1,72 @@
+// test_coalesce.cpp - LoRaCoalesceTable: one channel per (destination, key), eviction of the stalest channel
+#include <unity.h>
+#include "lora_coalesce.hpp"
+#include "lora_packets.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Новый образец канала заменяет ID прежнего; каналы различаются и получателем, и ключом
+void test_coalesce_channel_per_destination_and_key()
+{
+    LoRaCoalesceTable table;
+    PacketId_t id = 0;
+    TEST_ASSERT_FALSE(table.find(2, 1, id));
+
+    table.set(2, 1, 10, 100);
+    table.set(2, 2, 11, 100);
+    table.set(3, 1, 12, 100);
+    table.set(2, 1, 13, 200);
+    TEST_ASSERT_EQUAL_size_t(3, table.size());
+
+    TEST_ASSERT_TRUE(table.find(2, 1, id));
+    TEST_ASSERT_EQUAL_UINT8(13, id);
+    TEST_ASSERT_TRUE(table.find(2, 2, id));
+    TEST_ASSERT_EQUAL_UINT8(11, id);
+    TEST_ASSERT_TRUE(table.find(3, 1, id));
+    TEST_ASSERT_EQUAL_UINT8(12, id);
+}
+
+// Полная таблица: новый канал вытесняет тот, что обновлялся давнее всех
+void test_coalesce_evicts_stalest()
+{
+    LoRaCoalesceTable table;
+    for (uint8_t key = 0; key < LORA_COALESCE_MAX; key++) {
+        table.set(2, key, key, 1000 + key);
+    }
+    table.set(2, 0, 100, 5000);     // Канал 0 свежий, давнее всех теперь канал 1
+    table.set(4, 0, 200, 5001);
+    TEST_ASSERT_EQUAL_size_t(LORA_COALESCE_MAX, table.size());
+
+    PacketId_t id = 0;
+    TEST_ASSERT_FALSE(table.find(2, 1, id));
+    TEST_ASSERT_TRUE(table.find(2, 0, id));
+    TEST_ASSERT_EQUAL_UINT8(100, id);
+    TEST_ASSERT_TRUE(table.find(4, 0, id));
+    TEST_ASSERT_EQUAL_UINT8(200, id);
+    TEST_ASSERT_TRUE(table.find(2, LORA_COALESCE_MAX - 1, id));
+}
+
+// clear() освобождает все каналы
+void test_coalesce_clear()
+{
+    LoRaCoalesceTable table;
+    table.set(2, 1, 10, 0);
+    table.set(3, 1, 11, 0);
+    table.clear();
+    TEST_ASSERT_EQUAL_size_t(0, table.size());
+    PacketId_t id = 0;
+    TEST_ASSERT_FALSE(table.find(2, 1, id));
+    table.set(3, 1, 12, 0);
+    TEST_ASSERT_TRUE(table.find(3, 1, id));
+    TEST_ASSERT_EQUAL_UINT8(12, id);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_coalesce_channel_per_destination_and_key);
+    RUN_TEST(test_coalesce_evicts_stalest);
+    RUN_TEST(test_coalesce_clear);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+// test_completion.cpp - LoRaCompletionTracker: results by frame event, AGR binding, deadlines, capacity
+#include <unity.h>
+#include "lora_completion.hpp"
+#include "lora_packets.hpp"
+
+// Итоги по порядку: "handle:result " для каждого
+static String takeResults(LoRaCompletionTracker &tracker)
+{
+    std::vector<LoRaSendCompletion> out;
+    tracker.take(out);
+    String s;
+    for (const auto &completion : out) {
+        s += String(completion.handle) + ":" + sendResultName(completion.result) + " ";
+    }
+    return s;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Кадр с ACK: передача и ошибка передачи - не итог (будут повторы), итог - ACK
+void test_completion_ack_frame_waits_for_ack()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t h = tracker.add(2, nullptr, 100, 0);
+    tracker.bind(h, 10, true);
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(10, SendEvent::TRANSMITTED, 150));
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(10, SendEvent::TX_FAILED, 160));
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(11, SendEvent::ACKED, 170));
+    TEST_ASSERT_FALSE(tracker.hasCompleted());
+
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.onEvent(10, SendEvent::ACKED, 400));
+    std::vector<LoRaSendCompletion> out;
+    tracker.take(out);
+    TEST_ASSERT_EQUAL_size_t(1, out.size());
+    TEST_ASSERT_TRUE(out[0].result == SendResult::DELIVERED);
+    TEST_ASSERT_EQUAL_UINT32(300, out[0].elapsedMs);
+    TEST_ASSERT_EQUAL_UINT8(2, out[0].receiver);
+    TEST_ASSERT_EQUAL_size_t(0, tracker.activeCount());
+}
+
+// Кадр без ACK: итог - передача в эфир или её ошибка; ACK и max retries к нему не относятся
+void test_completion_no_ack_frame()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t a = tracker.add(2, nullptr, 0, 0);
+    SendHandle_t b = tracker.add(2, nullptr, 0, 0);
+    tracker.bind(a, 10, false);
+    tracker.bind(b, 11, false);
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(10, SendEvent::ACKED, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(10, SendEvent::DROPPED, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.onEvent(10, SendEvent::TRANSMITTED, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.onEvent(11, SendEvent::TX_FAILED, 0));
+    TEST_ASSERT_EQUAL_STRING((String(a) + ":sent " + String(b) + ":dropped ").c_str(), takeResults(tracker).c_str());
+}
+
+// Сообщения, слитые в один AGR, завершаются одним событием его ID
+void test_completion_agr_binding()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t a = tracker.add(2, nullptr, 0, 0);
+    SendHandle_t b = tracker.add(2, nullptr, 0, 0);
+    SendHandle_t c = tracker.add(3, nullptr, 0, 0);
+    tracker.bind(a, 10, true);
+    tracker.bind(b, 11, true);
+    tracker.bind(c, 12, true);
+    tracker.bind(a, 20, true);      // Слияние: оба едут в AGR 20
+    tracker.bind(b, 20, true);
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.onEvent(10, SendEvent::ACKED, 0));
+    TEST_ASSERT_EQUAL_UINT8(2, tracker.onEvent(20, SendEvent::DROPPED, 0));
+    TEST_ASSERT_EQUAL_size_t(1, tracker.activeCount());
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.onEvent(12, SendEvent::CANCELLED, 0));
+    TEST_ASSERT_EQUAL_STRING((String(a) + ":dropped " + String(b) + ":dropped " + String(c) + ":cancelled ").c_str(),
+                             takeResults(tracker).c_str());
+}
+
+// Срок: истёкшие записи - EXPIRED, ID кадров с ACK отдаются, чтобы снять их с pending
+void test_completion_deadline()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t withAck = tracker.add(2, nullptr, 1000, 500);
+    SendHandle_t noAck = tracker.add(2, nullptr, 1000, 500);
+    SendHandle_t unbound = tracker.add(2, nullptr, 1000, 500);
+    SendHandle_t forever = tracker.add(2, nullptr, 1000, 0);
+    tracker.bind(withAck, 10, true);
+    tracker.bind(noAck, 11, false);
+    tracker.bind(forever, 12, true);
+
+    std::vector<PacketId_t> expiredAck;
+    tracker.expire(1499, expiredAck);
+    TEST_ASSERT_EQUAL_size_t(4, tracker.activeCount());
+    tracker.expire(1501, expiredAck);
+    TEST_ASSERT_EQUAL_size_t(1, tracker.activeCount());
+    TEST_ASSERT_EQUAL_size_t(1, expiredAck.size());
+    TEST_ASSERT_EQUAL_UINT8(10, expiredAck[0]);
+    TEST_ASSERT_EQUAL_STRING((String(withAck) + ":expired " + String(noAck) + ":expired " + String(unbound) + ":expired ").c_str(),
+                             takeResults(tracker).c_str());
+
+    // EXPIRED от очереди (ttlMs кадра) завершает и запись, ждущую ACK
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.onEvent(12, SendEvent::EXPIRED, 0));
+    TEST_ASSERT_EQUAL_STRING((String(forever) + ":expired ").c_str(), takeResults(tracker).c_str());
+}
+
+// Не больше LORA_SEND_TRACK_MAX записей; handle не повторяется и не бывает 0
+void test_completion_capacity_and_handles()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t last = 0;
+    for (uint32_t i = 0; i < LORA_SEND_TRACK_MAX; i++) {
+        SendHandle_t h = tracker.add(2, nullptr, 0, 0);
+        TEST_ASSERT_TRUE(h > last);
+        last = h;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, tracker.add(2, nullptr, 0, 0));
+
+    tracker.complete(last, SendResult::QUEUE_FULL, 0);
+    SendHandle_t next = tracker.add(2, nullptr, 0, 0);
+    TEST_ASSERT_EQUAL_UINT32(last + 1, next);
+}
+
+// Callback переходит в итог и вызывается задачей завершений уже вне трекера
+void test_completion_callback_moves_to_result()
+{
+    LoRaCompletionTracker tracker;
+    SendHandle_t seen = 0;
+    SendResult seenResult = SendResult::SENT;
+    SendHandle_t h = tracker.add(2, [&](SendHandle_t handle, SendResult result) {
+        seen = handle;
+        seenResult = result;
+    }, 0, 0);
+    tracker.complete(h, SendResult::TOO_LARGE, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, seen);
+
+    std::vector<LoRaSendCompletion> out;
+    tracker.take(out);
+    TEST_ASSERT_EQUAL_size_t(1, out.size());
+    TEST_ASSERT_TRUE((bool)out[0].callback);
+    out[0].callback(out[0].handle, out[0].result);
+    TEST_ASSERT_EQUAL_UINT32(h, seen);
+    TEST_ASSERT_TRUE(seenResult == SendResult::TOO_LARGE);
+    TEST_ASSERT_FALSE(tracker.hasCompleted());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_completion_ack_frame_waits_for_ack);
+    RUN_TEST(test_completion_no_ack_frame);
+    RUN_TEST(test_completion_agr_binding);
+    RUN_TEST(test_completion_deadline);
+    RUN_TEST(test_completion_capacity_and_handles);
+    RUN_TEST(test_completion_callback_moves_to_result);
+    return UNITY_END();
+}
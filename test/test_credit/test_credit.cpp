@@ -0,0 +1,89 @@
+// test_credit.cpp - LoRaCreditLedger: per-peer window, queue limit, byte credit, clamped dequeue
+#include <unity.h>
+#include "lora_credit.hpp"
+#include "lora_packets.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Окно - кадров за LORA_CREDIT_WINDOW_MS эфира, в пределах MIN..MAX
+void test_credit_window_for_profile()
+{
+    TEST_ASSERT_EQUAL_UINT16(LORA_CREDIT_MAX_FRAMES, LoRaCreditLedger::windowFor(0));
+    TEST_ASSERT_EQUAL_UINT16(LORA_CREDIT_MAX_FRAMES, LoRaCreditLedger::windowFor(1));
+    TEST_ASSERT_EQUAL_UINT16(LORA_CREDIT_WINDOW_MS / 200, LoRaCreditLedger::windowFor(200));
+    TEST_ASSERT_EQUAL_UINT16(LORA_CREDIT_MIN_FRAMES, LoRaCreditLedger::windowFor(LORA_CREDIT_WINDOW_MS * 10));
+}
+
+// Кредит - окно минус своя очередь к узлу; очереди других узлов на него не влияют
+void test_credit_per_peer()
+{
+    LoRaCreditLedger ledger;
+    for (uint8_t i = 0; i < 3; i++) {
+        ledger.onQueued(2, 20);
+    }
+    ledger.onQueued(3, 50);
+
+    LoRaSendCredit c = ledger.credit(2, 10, 100, 200, 80);
+    TEST_ASSERT_EQUAL_UINT16(7, c.frames);
+    TEST_ASSERT_EQUAL_UINT16(7 * 80, c.bytes);          // Не больше кадров кредита в MTU
+    TEST_ASSERT_EQUAL_UINT16(3, c.queuedFrames);
+    TEST_ASSERT_EQUAL_UINT16(10, c.windowFrames);
+    TEST_ASSERT_EQUAL_UINT32(200, c.frameMs);
+    TEST_ASSERT_EQUAL_UINT16(10, ledger.credit(4, 10, 100, 200, 80).frames);
+
+    // MTU к узлу уменьшился: байт в окне меньше, чем кадров кредита в новом MTU
+    c = ledger.credit(2, 10, 100, 200, 10);
+    TEST_ASSERT_EQUAL_UINT16(7, c.frames);
+    TEST_ASSERT_EQUAL_UINT16(10 * 10 - 3 * 20, c.bytes);
+
+    ledger.onDequeued(2, 20);
+    TEST_ASSERT_EQUAL_UINT16(2, ledger.queuedFrames(2));
+    TEST_ASSERT_EQUAL_UINT16(8, ledger.credit(2, 10, 100, 200, 80).frames);
+}
+
+// Общая outgoingQueue почти полна: кредит не больше свободного места, байты - по кадрам
+void test_credit_limited_by_queue()
+{
+    LoRaCreditLedger ledger;
+    LoRaSendCredit c = ledger.credit(2, 10, 3, 200, 80);
+    TEST_ASSERT_EQUAL_UINT16(3, c.frames);
+    TEST_ASSERT_EQUAL_UINT16(3 * 80, c.bytes);
+    TEST_ASSERT_EQUAL_UINT16(0, ledger.credit(2, 10, 0, 200, 80).frames);
+}
+
+// Очередь к узлу дольше окна (профиль стал медленнее) - кредит 0, а не переполнение
+void test_credit_exhausted()
+{
+    LoRaCreditLedger ledger;
+    for (uint8_t i = 0; i < 5; i++) {
+        ledger.onQueued(2, 80);
+    }
+    LoRaSendCredit c = ledger.credit(2, LORA_CREDIT_MIN_FRAMES, 100, 1500, 80);
+    TEST_ASSERT_EQUAL_UINT16(0, c.frames);
+    TEST_ASSERT_EQUAL_UINT16(0, c.bytes);
+}
+
+// Кадр, поставленный в обход учёта, не уводит счётчики ниже нуля
+void test_credit_dequeue_clamped()
+{
+    LoRaCreditLedger ledger;
+    ledger.onQueued(2, 10);
+    ledger.onDequeued(2, 30);
+    ledger.onDequeued(2, 30);
+    TEST_ASSERT_EQUAL_UINT16(0, ledger.queuedFrames(2));
+    LoRaSendCredit c = ledger.credit(2, 4, 100, 200, 80);
+    TEST_ASSERT_EQUAL_UINT16(4, c.frames);
+    TEST_ASSERT_EQUAL_UINT16(4 * 80, c.bytes);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_credit_window_for_profile);
+    RUN_TEST(test_credit_per_peer);
+    RUN_TEST(test_credit_limited_by_queue);
+    RUN_TEST(test_credit_exhausted);
+    RUN_TEST(test_credit_dequeue_clamped);
+    return UNITY_END();
+}
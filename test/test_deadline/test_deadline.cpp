@@ -0,0 +1,82 @@
+// test_deadline.cpp - LoRaDeadlineTable: expiry, EDF order, active window, millis() wrap
+#include <unity.h>
+#include "lora_deadline.hpp"
+#include "lora_packets.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Срок наступает в nowMs + ttlMs (с точностью до | 1); кадр без срока не истекает
+void test_deadline_expiry()
+{
+    LoRaDeadlineTable table;
+    table.set(1, 500, 1000);
+    table.set(2, 0, 1000);
+    TEST_ASSERT_FALSE(table.expired(1, 1499));
+    TEST_ASSERT_TRUE(table.expired(1, 1501));
+    TEST_ASSERT_FALSE(table.expired(2, 1000000));
+    TEST_ASSERT_EQUAL_UINT32(0, table.deadline(2));
+
+    // Повторная постановка ID перезаписывает срок, clear() снимает его
+    table.set(1, 0, 2000);
+    TEST_ASSERT_FALSE(table.expired(1, 3000));
+    table.set(3, 100, 0);
+    TEST_ASSERT_TRUE(table.deadline(3) != 0);
+    table.clear(3);
+    TEST_ASSERT_FALSE(table.expired(3, 1000));
+}
+
+// EDF: меньший срок раньше, кадр со сроком раньше кадра без срока
+void test_deadline_edf_order()
+{
+    LoRaDeadlineTable table;
+    table.set(1, 300, 1000);
+    table.set(2, 100, 1000);
+    table.set(3, 0, 1000);
+    TEST_ASSERT_TRUE(table.earlier(2, 1));
+    TEST_ASSERT_FALSE(table.earlier(1, 2));
+    TEST_ASSERT_TRUE(table.earlier(1, 3));
+    TEST_ASSERT_FALSE(table.earlier(3, 1));
+    TEST_ASSERT_FALSE(table.earlier(3, 4));
+    TEST_ASSERT_FALSE(table.earlier(1, 1));
+}
+
+// active() - пока не наступил самый поздний из выставленных сроков
+void test_deadline_active_window()
+{
+    LoRaDeadlineTable table;
+    TEST_ASSERT_FALSE(table.active(0));
+    table.set(1, 1000, 0);
+    table.set(2, 200, 0);
+    TEST_ASSERT_TRUE(table.active(500));
+    TEST_ASSERT_TRUE(table.active(999));
+    TEST_ASSERT_FALSE(table.active(1001));
+    table.set(3, 100, 5000);
+    TEST_ASSERT_TRUE(table.active(5050));
+}
+
+// Сроки сравниваются по разности: переход millis() через 2^32 не ломает порядок и истечение
+void test_deadline_millis_wrap()
+{
+    LoRaDeadlineTable table;
+    unsigned long nearWrap = 0xFFFFFF00UL;
+    table.set(1, 0x200, nearWrap);      // Срок после переполнения
+    table.set(2, 0x80, nearWrap);       // До него
+    TEST_ASSERT_TRUE(table.earlier(2, 1));
+    TEST_ASSERT_FALSE(table.expired(1, nearWrap + 0x10));
+    TEST_ASSERT_TRUE(table.expired(2, 0xFFFFFF81UL));
+    TEST_ASSERT_FALSE(table.expired(1, 0xFFUL));
+    TEST_ASSERT_TRUE(table.expired(1, 0x101UL));
+    TEST_ASSERT_TRUE(table.active(0x10UL));
+    TEST_ASSERT_FALSE(table.active(0x101UL));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_deadline_expiry);
+    RUN_TEST(test_deadline_edf_order);
+    RUN_TEST(test_deadline_active_window);
+    RUN_TEST(test_deadline_millis_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// test_fair.cpp - LoRaFairScheduler: airtime DRR between peers, class order inside a peer
+#include <unity.h>
+#include "lora_fair.hpp"
+#include "lora_packets.hpp"
+
+static LoRaPacket frame(LoraAddress_t peer, PacketId_t id)
+{
+    LoRaPacket pkt;
+    pkt.senderId = DEVICE_ID_MASTER;
+    pkt.receiverId = peer;
+    pkt.packetType = CMD_COMMAND_STRING;
+    pkt.packetId = id;
+    return pkt;
+}
+
+// Порядок узлов в следующих count кадрах
+static String popPeers(LoRaFairScheduler &fair, size_t count)
+{
+    String order;
+    LoRaPacket pkt;
+    while (count-- && fair.pop(pkt)) {
+        order += String(pkt.getReceiverId());
+    }
+    return order;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Короткие кадры узла 1 и длинные узла 2: за обход каждому - квант эфира, а не кадр
+void test_fair_equal_airtime_per_round()
+{
+    LoRaFairScheduler fair;
+    fair.setQuantumUs(400);
+    for (uint8_t i = 0; i < 8; i++) {
+        fair.push(frame(1, i), TxClass::NORMAL, 100);
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        fair.push(frame(2, 100 + i), TxClass::NORMAL, 400);
+    }
+    TEST_ASSERT_EQUAL_STRING("1111211112", popPeers(fair, 10).c_str());
+    TEST_ASSERT_TRUE(fair.empty());
+}
+
+// Кадр дороже кванта копит дефицит несколько обходов, остальные узлы за это время идут
+void test_fair_frame_larger_than_quantum()
+{
+    LoRaFairScheduler fair;
+    fair.setQuantumUs(100);
+    fair.push(frame(1, 1), TxClass::NORMAL, 350);
+    for (uint8_t i = 0; i < 5; i++) {
+        fair.push(frame(2, 10 + i), TxClass::NORMAL, 100);
+    }
+    TEST_ASSERT_EQUAL_STRING("222122", popPeers(fair, 6).c_str());
+}
+
+// Опустевший узел выходит из обхода без остатка: вернувшись, начинает с одного кванта
+void test_fair_empty_peer_drops_deficit()
+{
+    LoRaFairScheduler fair;
+    fair.setQuantumUs(1000);
+    fair.push(frame(1, 1), TxClass::NORMAL, 100);
+    fair.push(frame(2, 2), TxClass::NORMAL, 1000);
+    fair.push(frame(2, 3), TxClass::NORMAL, 1000);
+    TEST_ASSERT_EQUAL_STRING("12", popPeers(fair, 2).c_str());
+    TEST_ASSERT_EQUAL_size_t(1, fair.peerCount());
+
+    // С остатком 900 мкс кадр 1900 мкс ушёл бы раньше второго кадра узла 2
+    fair.push(frame(1, 4), TxClass::NORMAL, 1900);
+    TEST_ASSERT_EQUAL_STRING("21", popPeers(fair, 2).c_str());
+    TEST_ASSERT_TRUE(fair.empty());
+}
+
+// Внутри узла - по классу (повторы раньше данных), внутри класса - FIFO
+void test_fair_class_order_inside_peer()
+{
+    LoRaFairScheduler fair;
+    fair.setQuantumUs(1000);
+    fair.push(frame(1, 1), TxClass::NORMAL, 10);
+    fair.push(frame(1, 2), TxClass::RETRY, 10);
+    fair.push(frame(1, 3), TxClass::NORMAL, 10);
+    fair.push(frame(1, 4), TxClass::CONTROL, 10);
+    fair.push(frame(1, 5), TxClass::CONTROL, 10);
+    TEST_ASSERT_EQUAL_size_t(1, fair.classSize(TxClass::RETRY));
+    TEST_ASSERT_EQUAL_size_t(5, fair.peerSize(1));
+
+    const PacketId_t expected[] = {4, 5, 2, 1, 3};
+    LoRaPacket pkt;
+    for (PacketId_t id : expected) {
+        TEST_ASSERT_TRUE(fair.pop(pkt));
+        TEST_ASSERT_EQUAL_UINT8(id, pkt.packetId);
+    }
+    TEST_ASSERT_FALSE(fair.pop(pkt));
+    TEST_ASSERT_EQUAL_size_t(0, fair.classSize(TxClass::RETRY));
+    TEST_ASSERT_EQUAL_size_t(0, fair.peerSize(1));
+}
+
+// После LORA_RETRY_BURST повторов подряд - кадр данных; без данных повторы идут дальше
+void test_fair_retry_burst_yields_to_data()
+{
+    LoRaFairScheduler fair;
+    fair.setQuantumUs(1000);
+    for (PacketId_t id = 1; id <= 4; id++) {
+        fair.push(frame(1, id), TxClass::RETRY, 10);
+    }
+    fair.push(frame(1, 10), TxClass::NORMAL, 10);
+    fair.push(frame(1, 11), TxClass::NORMAL, 10);
+
+    String order;
+    LoRaPacket pkt;
+    while (fair.pop(pkt)) {
+        order += String(pkt.packetId) + " ";
+    }
+    String expected;
+    PacketId_t retry = 1, data = 10;
+    while (retry <= 4) {
+        for (uint8_t i = 0; i < LORA_RETRY_BURST && retry <= 4; i++) {
+            expected += String(retry++) + " ";
+        }
+        if (data <= 11) {
+            expected += String(data++) + " ";
+        }
+    }
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), order.c_str());
+    TEST_ASSERT_EQUAL_size_t(0, fair.classSize(TxClass::RETRY));
+    TEST_ASSERT_TRUE(fair.empty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fair_equal_airtime_per_round);
+    RUN_TEST(test_fair_frame_larger_than_quantum);
+    RUN_TEST(test_fair_empty_peer_drops_deficit);
+    RUN_TEST(test_fair_class_order_inside_peer);
+    RUN_TEST(test_fair_retry_burst_yields_to_data);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+// test_poll.cpp - LoRaPollScheduler: round-robin order, MORE bursts, cycle pacing, piggybacked ACKs
+#include <unity.h>
+#include "lora_poll.hpp"
+#include "lora_packets.hpp"
+
+// Очередь опросов: адреса next(), пока он разрешает опрос, не больше count
+static String pollOrder(LoRaPollScheduler &poll, const std::vector<LoraAddress_t> &active, size_t count)
+{
+    String order;
+    LoraAddress_t address;
+    uint32_t waitMs;
+    while (count-- && poll.next(active, address, waitMs)) {
+        order += String(address);
+        poll.onReply(address, true, false);
+    }
+    return order;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Обход по возрастанию адреса; обход, начатый с первого адреса, повторяется
+// не раньше чем через LORA_POLL_MIN_CYCLE_MS
+void test_poll_round_robin_and_min_cycle()
+{
+    LoRaPollScheduler poll;
+    std::vector<LoraAddress_t> active = {7, 3, 5};
+    TEST_ASSERT_EQUAL_STRING("357357", pollOrder(poll, active, 10).c_str());
+
+    LoraAddress_t address;
+    uint32_t waitMs = 0;
+    TEST_ASSERT_FALSE(poll.next(active, address, waitMs));
+    TEST_ASSERT_TRUE(waitMs > 0 && waitMs <= LORA_POLL_MIN_CYCLE_MS);
+
+    host::delayUs(waitMs * 1000ULL);
+    TEST_ASSERT_EQUAL_STRING("357", pollOrder(poll, active, 3).c_str());
+    TEST_ASSERT_EQUAL_UINT32(LORA_POLL_MIN_CYCLE_MS, poll.cycleMs());
+}
+
+// Slave с MORE опрашивается подряд, но не больше LORA_POLL_MAX_BURST раз
+void test_poll_more_burst_is_bounded()
+{
+    LoRaPollScheduler poll;
+    std::vector<LoraAddress_t> active = {3, 5};
+    LoraAddress_t address;
+    uint32_t waitMs;
+    String order;
+    for (uint8_t i = 0; i < LORA_POLL_MAX_BURST + 1; i++) {
+        TEST_ASSERT_TRUE(poll.next(active, address, waitMs));
+        order += String(address);
+        poll.onReply(address, true, address == 3);
+    }
+    String expected;
+    for (uint8_t i = 0; i < LORA_POLL_MAX_BURST; i++) {
+        expected += "3";
+    }
+    expected += "5";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), order.c_str());
+}
+
+// Без ответа повторного опроса нет, даже если прошлый ответ ставил MORE
+void test_poll_no_repeat_without_answer()
+{
+    LoRaPollScheduler poll;
+    std::vector<LoraAddress_t> active = {3, 5};
+    LoraAddress_t address;
+    uint32_t waitMs;
+    TEST_ASSERT_TRUE(poll.next(active, address, waitMs));
+    poll.onReply(3, true, true);
+    TEST_ASSERT_TRUE(poll.next(active, address, waitMs));
+    TEST_ASSERT_EQUAL_UINT8(3, address);
+    poll.onReply(3, false, true);
+    TEST_ASSERT_TRUE(poll.next(active, address, waitMs));
+    TEST_ASSERT_EQUAL_UINT8(5, address);
+}
+
+// Клиент, выпавший из active, пропускается; пустой список - опрашивать некого
+void test_poll_skips_inactive()
+{
+    LoRaPollScheduler poll;
+    LoraAddress_t address;
+    uint32_t waitMs;
+    TEST_ASSERT_FALSE(poll.next({}, address, waitMs));
+    TEST_ASSERT_EQUAL_UINT32(0, waitMs);
+
+    TEST_ASSERT_TRUE(poll.next({3, 5, 7}, address, waitMs));
+    poll.onReply(3, true, true);
+    TEST_ASSERT_TRUE(poll.next({5, 7}, address, waitMs));
+    TEST_ASSERT_EQUAL_UINT8(5, address);
+}
+
+// ACK копятся по адресу до LORA_POLL_MAX_ACKS и забираются один раз
+void test_poll_acks_per_slave()
+{
+    LoRaPollScheduler poll;
+    for (PacketId_t id = 0; id < LORA_POLL_MAX_ACKS; id++) {
+        TEST_ASSERT_TRUE(poll.addAck(3, id));
+    }
+    TEST_ASSERT_FALSE(poll.addAck(3, 100));
+    TEST_ASSERT_TRUE(poll.addAck(5, 50));
+
+    PacketId_t ids[LORA_POLL_MAX_ACKS];
+    TEST_ASSERT_EQUAL_UINT8(LORA_POLL_MAX_ACKS, poll.takeAcks(3, ids));
+    TEST_ASSERT_EQUAL_UINT8(LORA_POLL_MAX_ACKS - 1, ids[LORA_POLL_MAX_ACKS - 1]);
+    TEST_ASSERT_EQUAL_UINT8(0, poll.takeAcks(3, ids));
+    TEST_ASSERT_EQUAL_UINT8(1, poll.takeAcks(5, ids));
+    TEST_ASSERT_EQUAL_UINT8(50, ids[0]);
+}
+
+// Заголовок опроса: ACK и подпакеты разбираются обратно, лишние ACK отсекаются
+void test_poll_header_roundtrip()
+{
+    PacketId_t acks[LORA_POLL_MAX_ACKS + 2];
+    for (uint8_t i = 0; i < sizeof(acks); i++) {
+        acks[i] = 10 + i;
+    }
+    uint8_t buf[MAX_LORA_PAYLOAD];
+    uint8_t len = PacketPoll::writeHeader(buf, LORA_POLL_FLAG_MORE, acks, 3);
+    buf[len++] = 0xAA;      // Подпакет
+
+    uint8_t flags, ackCount, dataLen;
+    const PacketId_t *parsed;
+    const uint8_t *data;
+    TEST_ASSERT_TRUE(PacketPoll::parse(buf, len, flags, parsed, ackCount, data, dataLen));
+    TEST_ASSERT_EQUAL_UINT8(LORA_POLL_FLAG_MORE, flags);
+    TEST_ASSERT_EQUAL_UINT8(3, ackCount);
+    TEST_ASSERT_EQUAL_UINT8(12, parsed[2]);
+    TEST_ASSERT_EQUAL_UINT8(1, dataLen);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, data[0]);
+
+    len = PacketPoll::writeHeader(buf, 0, acks, sizeof(acks));
+    TEST_ASSERT_EQUAL_UINT8(LORA_POLL_HEADER_SIZE + LORA_POLL_MAX_ACKS, len);
+    TEST_ASSERT_FALSE(PacketPoll::parse(buf, LORA_POLL_HEADER_SIZE + 1, flags, parsed, ackCount, data, dataLen));
+}
+
+int main()
+{
+    // Пауза между обходами - по millis(): время симуляции идёт только в delayUs
+    host::setClockMode(host::ClockMode::SIMULATED);
+    host::delayUs(1000000);     // millis() == 0 - обход ещё не начинался
+    UNITY_BEGIN();
+    RUN_TEST(test_poll_round_robin_and_min_cycle);
+    RUN_TEST(test_poll_more_burst_is_bounded);
+    RUN_TEST(test_poll_no_repeat_without_answer);
+    RUN_TEST(test_poll_skips_inactive);
+    RUN_TEST(test_poll_acks_per_slave);
+    RUN_TEST(test_poll_header_roundtrip);
+    return UNITY_END();
+}
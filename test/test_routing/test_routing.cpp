@@ -0,0 +1,151 @@
+// test_routing.cpp - LoRaRouteTable: learning, expiry, advert; LoRaRelayDuplicateFilter window
+#include <unity.h>
+#include "lora_routing.hpp"
+#include "lora_packets.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Новое направление учится с любой допустимой длиной, hops = 0 и длиннее предела - нет
+void test_route_learn_new_destination()
+{
+    LoRaRouteTable table;
+    TEST_ASSERT_FALSE(table.learn(5, 2, 0, 0));
+    TEST_ASSERT_FALSE(table.learn(5, 2, LORA_RELAY_MAX_HOPS + 1, 0));
+    TEST_ASSERT_TRUE(table.learn(5, 2, 2, 0));
+
+    LoRaRoute route;
+    TEST_ASSERT_TRUE(table.find(5, 10, route));
+    TEST_ASSERT_EQUAL_UINT8(2, route.nextHop);
+    TEST_ASSERT_EQUAL_UINT8(2, route.hops);
+    TEST_ASSERT_FALSE(route.isDirect());
+    TEST_ASSERT_FALSE(table.find(6, 10, route));
+}
+
+// Другой сосед заменяет свежий маршрут только более коротким путём
+void test_route_shorter_path_replaces()
+{
+    LoRaRouteTable table;
+    table.learn(5, 2, 2, 0);
+    TEST_ASSERT_FALSE(table.learn(5, 3, 2, 100));
+    TEST_ASSERT_FALSE(table.learn(5, 3, 3, 100));
+    TEST_ASSERT_TRUE(table.learn(5, 5, 1, 100));
+
+    LoRaRoute route;
+    TEST_ASSERT_TRUE(table.find(5, 100, route));
+    TEST_ASSERT_TRUE(route.isDirect());
+    TEST_ASSERT_EQUAL_UINT8(1, route.hops);
+}
+
+// Тот же next hop сообщает новую длину: верим и длинному пути, hops = 0 - маршрута больше нет
+void test_route_same_next_hop_updates()
+{
+    LoRaRouteTable table;
+    table.learn(5, 2, 2, 0);
+    TEST_ASSERT_FALSE(table.learn(5, 2, 3, 100));     // Направление и сосед прежние
+
+    LoRaRoute route;
+    TEST_ASSERT_TRUE(table.find(5, 100, route));
+    TEST_ASSERT_EQUAL_UINT8(3, route.hops);
+
+    TEST_ASSERT_TRUE(table.learn(5, 2, 0, 200));
+    TEST_ASSERT_FALSE(table.find(5, 200, route));
+}
+
+// Устаревший маршрут не находится и заменяется любым, expire() его удаляет
+void test_route_expires()
+{
+    LoRaRouteTable table;
+    table.learn(5, 2, 1, 0);
+    table.learn(6, 2, 2, LORA_ROUTE_TIMEOUT_MS / 2);
+
+    LoRaRoute route;
+    TEST_ASSERT_TRUE(table.find(5, LORA_ROUTE_TIMEOUT_MS - 1, route));
+    TEST_ASSERT_FALSE(table.find(5, LORA_ROUTE_TIMEOUT_MS, route));
+    TEST_ASSERT_EQUAL_size_t(1, table.list(LORA_ROUTE_TIMEOUT_MS).size());
+
+    // Устаревший путь в 1 передачу уступает пути длиннее
+    TEST_ASSERT_TRUE(table.learn(5, 3, 3, LORA_ROUTE_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(table.find(5, LORA_ROUTE_TIMEOUT_MS, route));
+    TEST_ASSERT_EQUAL_UINT8(3, route.nextHop);
+
+    table.expire(LORA_ROUTE_TIMEOUT_MS * 2);
+    TEST_ASSERT_EQUAL_size_t(0, table.list(0).size());
+}
+
+// Статический маршрут не устаревает и не переучивается
+void test_route_static()
+{
+    LoRaRouteTable table;
+    table.setStatic(5, 2);
+    TEST_ASSERT_FALSE(table.learn(5, 5, 1, 0));
+
+    LoRaRoute route;
+    TEST_ASSERT_TRUE(table.find(5, LORA_ROUTE_TIMEOUT_MS * 10, route));
+    TEST_ASSERT_TRUE(route.isStatic);
+    TEST_ASSERT_EQUAL_UINT8(2, route.nextHop);
+    TEST_ASSERT_EQUAL_UINT8(2, route.hops);
+
+    TEST_ASSERT_TRUE(table.remove(5));
+    TEST_ASSERT_FALSE(table.remove(5));
+    TEST_ASSERT_FALSE(table.find(5, 0, route));
+}
+
+// Анонс - свежие маршруты короче предела, разбор отдаёт те же пары
+void test_route_advert_roundtrip()
+{
+    LoRaRouteTable table;
+    table.learn(5, 5, 1, LORA_ROUTE_TIMEOUT_MS);
+    table.learn(6, 5, LORA_RELAY_MAX_HOPS, LORA_ROUTE_TIMEOUT_MS);   // Дальше не уйдёт
+    table.learn(7, 5, 2, 0);                                         // Устарел
+    table.learn(8, 5, 2, LORA_ROUTE_TIMEOUT_MS);
+
+    uint8_t buf[LORA_BASE_MTU];
+    uint8_t len = table.serializeAdvert(buf, LORA_ROUTE_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL_UINT8(1 + 2 * PacketRouteAdvert::ENTRY_SIZE, len);
+
+    String entries;
+    TEST_ASSERT_TRUE(PacketRouteAdvert::deserialize(buf, len, [&](LoraAddress_t destination, uint8_t hops) {
+        entries += String(destination) + ":" + String(hops) + " ";
+    }));
+    TEST_ASSERT_EQUAL_STRING("5:1 8:2 ", entries.c_str());
+
+    buf[0] = 3;     // Число записей не сходится с длиной
+    TEST_ASSERT_FALSE(PacketRouteAdvert::deserialize(buf, len, [](LoraAddress_t, uint8_t) {}));
+}
+
+// Дубль подавляется в окне, после окна (повтор origin) проходит
+void test_relay_duplicate_window()
+{
+    LoRaRelayDuplicateFilter filter;
+    TEST_ASSERT_FALSE(filter.check(5, 10, 0));
+    TEST_ASSERT_TRUE(filter.check(5, 10, LORA_RELAY_DUP_WINDOW_MS - 1));
+    TEST_ASSERT_FALSE(filter.check(6, 10, 1));      // Другой origin
+    TEST_ASSERT_FALSE(filter.check(5, 11, 1));      // Другой id
+    TEST_ASSERT_FALSE(filter.check(5, 10, LORA_RELAY_DUP_WINDOW_MS));
+}
+
+// Кольцо помнит последние записи: старейшая вытесняется
+void test_relay_duplicate_ring_evicts_oldest()
+{
+    LoRaRelayDuplicateFilter filter;
+    for (PacketId_t id = 0; id < 17; id++) {
+        TEST_ASSERT_FALSE(filter.check(5, id, 0));
+    }
+    TEST_ASSERT_TRUE(filter.check(5, 16, 0));
+    TEST_ASSERT_FALSE(filter.check(5, 0, 0));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_route_learn_new_destination);
+    RUN_TEST(test_route_shorter_path_replaces);
+    RUN_TEST(test_route_same_next_hop_updates);
+    RUN_TEST(test_route_expires);
+    RUN_TEST(test_route_static);
+    RUN_TEST(test_route_advert_roundtrip);
+    RUN_TEST(test_relay_duplicate_window);
+    RUN_TEST(test_relay_duplicate_ring_evicts_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,141 @@
+// test_tdma.cpp - TDMA beacon layout round trip, slot windows, master slot scheduler
+#include <unity.h>
+#include "lora_tdma.hpp"
+#include "lora_packets.hpp"
+
+static LoRaTdmaLayout layout3()
+{
+    LoRaTdmaLayout layout;
+    layout.unitMs = 4;
+    layout.guardUnits = 5;
+    layout.slotCount = 3;
+    layout.slots[0] = {DEVICE_ID_MASTER, 10};
+    layout.slots[1] = {7, 20};
+    layout.slots[2] = {DEVICE_ID_BROADCAST, 30};
+    return layout;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Раскладка и номер суперкадра переживают serialize/deserialize без изменений
+void test_tdma_beacon_roundtrip()
+{
+    PacketTdmaBeacon beacon;
+    beacon.count = 0x12345678;
+    uint8_t buf[LORA_BASE_MTU];
+    uint8_t len = beacon.serialize(layout3(), buf);
+    TEST_ASSERT_EQUAL_UINT8(LORA_TDMA_BEACON_HEADER_SIZE + 3 * sizeof(LoRaTdmaSlot), len);
+
+    uint32_t count = 0;
+    LoRaTdmaLayout layout;
+    TEST_ASSERT_TRUE(PacketTdmaBeacon::deserialize(buf, len, count, layout));
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, count);
+    TEST_ASSERT_EQUAL_UINT8(4, layout.unitMs);
+    TEST_ASSERT_EQUAL_UINT8(5, layout.guardUnits);
+    TEST_ASSERT_EQUAL_UINT8(3, layout.slotCount);
+    TEST_ASSERT_EQUAL_UINT8(7, layout.slots[1].owner);
+    TEST_ASSERT_EQUAL_UINT8(20, layout.slots[1].lenUnits);
+    TEST_ASSERT_EQUAL_UINT8(DEVICE_ID_BROADCAST, layout.slots[2].owner);
+}
+
+// Обычный heartbeat, неверная длина, нулевая единица и лишние слоты - не маяк
+void test_tdma_beacon_rejects_malformed()
+{
+    PacketTdmaBeacon beacon;
+    uint8_t buf[LORA_BASE_MTU];
+    uint8_t len = beacon.serialize(layout3(), buf);
+    uint32_t count;
+    LoRaTdmaLayout layout;
+
+    TEST_ASSERT_FALSE(PacketTdmaBeacon::deserialize(buf, sizeof(uint32_t), count, layout));
+    TEST_ASSERT_FALSE(PacketTdmaBeacon::deserialize(buf, len - 1, count, layout));
+    buf[6] = LORA_TDMA_MAX_SLOTS + 1;
+    TEST_ASSERT_FALSE(PacketTdmaBeacon::deserialize(buf, len, count, layout));
+    buf[6] = 3;
+    buf[4] = 0;
+    TEST_ASSERT_FALSE(PacketTdmaBeacon::deserialize(buf, len, count, layout));
+}
+
+// Полная раскладка укладывается в LORA_BASE_MTU: маяк - broadcast
+void test_tdma_beacon_full_layout_fits_mtu()
+{
+    LoRaTdmaLayout big;
+    big.slotCount = LORA_TDMA_MAX_SLOTS;
+    for (uint8_t i = 0; i < LORA_TDMA_MAX_SLOTS; i++) {
+        big.slots[i] = {(LoraAddress_t)(i + 1), 1};
+    }
+    PacketTdmaBeacon beacon;
+    uint8_t buf[LORA_BASE_MTU];
+    uint8_t len = beacon.serialize(big, buf);
+    TEST_ASSERT_TRUE(len <= LORA_BASE_MTU);
+
+    uint32_t count;
+    LoRaTdmaLayout layout;
+    TEST_ASSERT_TRUE(PacketTdmaBeacon::deserialize(buf, len, count, layout));
+    TEST_ASSERT_EQUAL_UINT8(LORA_TDMA_MAX_SLOTS, layout.slotCount);
+}
+
+// Окно слота - от конца маяка, перед каждым слотом guard
+void test_tdma_slot_windows()
+{
+    LoRaTdmaLayout layout = layout3();
+    LoRaTdmaWindow window;
+    TEST_ASSERT_TRUE(tdmaFindSlot(layout, 7, window));
+    TEST_ASSERT_EQUAL_UINT32((5 + 10 + 5) * 4000, window.offsetUs);
+    TEST_ASSERT_EQUAL_UINT32(20 * 4000, window.lenUs);
+    TEST_ASSERT_FALSE(tdmaFindSlot(layout, 9, window));
+    // Guard перед каждым слотом и перед следующим маяком
+    TEST_ASSERT_EQUAL_UINT32((4 * 5 + 10 + 20 + 30) * 4000, tdmaSuperframeUs(layout));
+}
+
+// Master первым, участники по адресам, слот конкуренции последним; заявка - на один суперкадр
+void test_tdma_scheduler_layout()
+{
+    LoRaTdmaScheduler scheduler;
+    TEST_ASSERT_TRUE(scheduler.onRequest(9, 0));
+    TEST_ASSERT_TRUE(scheduler.onRequest(3, 2000));
+    TEST_ASSERT_FALSE(scheduler.onRequest(9, 0));
+
+    LoRaTdmaLayout layout;
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.build(DEVICE_ID_MASTER, 0, 0, layout));
+    TEST_ASSERT_EQUAL_UINT8(4, layout.slotCount);
+    TEST_ASSERT_EQUAL_UINT8(DEVICE_ID_MASTER, layout.slots[0].owner);
+    TEST_ASSERT_EQUAL_UINT8(3, layout.slots[1].owner);
+    TEST_ASSERT_EQUAL_UINT8(9, layout.slots[2].owner);
+    TEST_ASSERT_EQUAL_UINT8(DEVICE_ID_BROADCAST, layout.slots[3].owner);
+    TEST_ASSERT_TRUE(layout.slots[1].lenUnits > layout.slots[2].lenUnits);
+
+    LoRaTdmaLayout next;
+    scheduler.build(DEVICE_ID_MASTER, 0, 0, next);
+    TEST_ASSERT_TRUE(next.slots[1].lenUnits * next.unitMs < layout.slots[1].lenUnits * layout.unitMs);
+}
+
+// Участник без кадров LORA_TDMA_MEMBER_TIMEOUT суперкадров теряет слот, onHeard его держит
+void test_tdma_scheduler_member_timeout()
+{
+    LoRaTdmaScheduler scheduler;
+    scheduler.onRequest(3, 0);
+    scheduler.onRequest(4, 0);
+    LoRaTdmaLayout layout;
+    for (uint32_t i = 0; i <= LORA_TDMA_MEMBER_TIMEOUT; i++) {
+        scheduler.onHeard(4);
+        scheduler.build(DEVICE_ID_MASTER, 0, 0, layout);
+    }
+    TEST_ASSERT_EQUAL_size_t(1, scheduler.memberCount());
+    LoRaTdmaWindow window;
+    TEST_ASSERT_FALSE(tdmaFindSlot(layout, 3, window));
+    TEST_ASSERT_TRUE(tdmaFindSlot(layout, 4, window));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tdma_beacon_roundtrip);
+    RUN_TEST(test_tdma_beacon_rejects_malformed);
+    RUN_TEST(test_tdma_beacon_full_layout_fits_mtu);
+    RUN_TEST(test_tdma_slot_windows);
+    RUN_TEST(test_tdma_scheduler_layout);
+    RUN_TEST(test_tdma_scheduler_member_timeout);
+    return UNITY_END();
+}
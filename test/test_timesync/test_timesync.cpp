@@ -0,0 +1,227 @@
+// test_timesync.cpp - Time trailer parsing, peer clock offset and drift, outliers, stamper corrections
+#include <unity.h>
+#include "lora_timesync.hpp"
+#include "lora_packets.hpp"
+
+static constexpr LoraAddress_t ROOT = DEVICE_ID_MASTER;
+static constexpr uint32_t START_US = 1000000;
+static constexpr uint32_t OFFSET_US = 123456789;
+static constexpr uint32_t STEP_US = 1000000;
+
+// Часы соседа: смещение OFFSET_US и уход driftPpm от START_US
+static uint32_t peerUs(uint32_t localUs, float driftPpm)
+{
+    return localUs + OFFSET_US + (uint32_t)lround((localUs - START_US) * driftPpm * 1e-6);
+}
+
+static LoRaTimeTrailer trailerAt(uint32_t stampUs, uint8_t stratum = 0)
+{
+    LoRaTimeTrailer trailer = {};
+    trailer.stratum = stratum;
+    trailer.prevCorrUs = LORA_TIME_NO_CORR;
+    trailer.stampUs = stampUs;
+    return trailer;
+}
+
+// count меток раз в STEP_US, возвращает время последней
+static uint32_t feed(LoRaTimeSync &sync, uint8_t count, float driftPpm)
+{
+    uint32_t localUs = START_US;
+    for (uint8_t i = 0; i < count; i++) {
+        localUs = START_US + i * STEP_US;
+        sync.onTrailer(ROOT, i, trailerAt(peerUs(localUs, driftPpm)), localUs);
+    }
+    return localUs;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Метка - хвост heartbeat или маяка TDMA; без неё длина тела 0
+void test_trailer_body_len()
+{
+    uint8_t buf[LORA_BASE_MTU] = {};
+    TEST_ASSERT_EQUAL_UINT8(sizeof(uint32_t), timeTrailerBodyLen(buf, sizeof(uint32_t) + LORA_TIME_TRAILER_SIZE));
+    TEST_ASSERT_EQUAL_UINT8(0, timeTrailerBodyLen(buf, sizeof(uint32_t)));
+
+    LoRaTdmaLayout layout;
+    layout.slotCount = 2;
+    layout.slots[0] = {ROOT, 10};
+    layout.slots[1] = {DEVICE_ID_BROADCAST, 5};
+    PacketTdmaBeacon beacon;
+    uint8_t beaconLen = beacon.serialize(layout, buf);
+    TEST_ASSERT_EQUAL_UINT8(0, timeTrailerBodyLen(buf, beaconLen));
+    TEST_ASSERT_EQUAL_UINT8(beaconLen, timeTrailerBodyLen(buf, beaconLen + LORA_TIME_TRAILER_SIZE));
+    TEST_ASSERT_EQUAL_UINT8(0, timeTrailerBodyLen(buf, beaconLen + LORA_TIME_TRAILER_SIZE + 1));
+}
+
+// Метку можно дописать к heartbeat и маяку, если хватает MTU; к чужому payload - нет
+void test_trailer_fits()
+{
+    uint8_t buf[LORA_BASE_MTU] = {};
+    TEST_ASSERT_TRUE(timeTrailerFits(buf, sizeof(uint32_t)));
+    TEST_ASSERT_FALSE(timeTrailerFits(buf, sizeof(uint32_t) + 1));
+
+    LoRaTdmaLayout layout;
+    layout.slotCount = 1;
+    layout.slots[0] = {ROOT, 10};
+    PacketTdmaBeacon beacon;
+    TEST_ASSERT_TRUE(timeTrailerFits(buf, beacon.serialize(layout, buf)));
+
+    // Полный маяк: метка - только если осталось место до LORA_BASE_MTU
+    layout.slotCount = LORA_TDMA_MAX_SLOTS;
+    for (uint8_t i = 0; i < LORA_TDMA_MAX_SLOTS; i++) {
+        layout.slots[i] = {(LoraAddress_t)(i + 1), 1};
+    }
+    uint8_t fullLen = beacon.serialize(layout, buf);
+    TEST_ASSERT_TRUE((fullLen + LORA_TIME_TRAILER_SIZE <= LORA_BASE_MTU) == timeTrailerFits(buf, fullLen));
+}
+
+// Регрессия по меткам: смещение и дрейф соседа, сетевое время узла stratum 1
+void test_peer_offset_and_drift()
+{
+    LoRaTimeSync sync;
+    uint32_t lastUs = feed(sync, LORA_TIMESYNC_SAMPLES, 20);
+
+    LoRaPeerClock clock;
+    TEST_ASSERT_TRUE(sync.peerClock(ROOT, lastUs, clock));
+    TEST_ASSERT_EQUAL_UINT8(LORA_TIMESYNC_SAMPLES, clock.samples);
+    TEST_ASSERT_EQUAL_UINT8(0, clock.stratum);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 20, clock.driftPpm);
+    TEST_ASSERT_INT32_WITHIN(2, (int32_t)(peerUs(lastUs, 20) - lastUs), clock.offsetUs);
+
+    // Через 10 с без меток прогноз учитывает дрейф, ошибка растёт
+    uint32_t laterUs = lastUs + 10 * STEP_US;
+    LoRaNetworkTime t = sync.networkTime(false, laterUs);
+    TEST_ASSERT_TRUE(t.synced);
+    TEST_ASSERT_EQUAL_UINT8(1, t.stratum);
+    TEST_ASSERT_EQUAL_UINT8(ROOT, t.reference);
+    TEST_ASSERT_INT32_WITHIN(5, peerUs(laterUs, 20), t.us);
+    TEST_ASSERT_TRUE(t.errorUs > clock.errorUs);
+
+    uint32_t localUs = 0;
+    TEST_ASSERT_TRUE(sync.toLocalUs(t.us, laterUs, localUs));
+    TEST_ASSERT_INT32_WITHIN(2, laterUs, localUs);
+}
+
+// Корень - сам себе время; без корня среди соседей синхронизации нет
+void test_network_time_root_and_unsynced()
+{
+    LoRaTimeSync sync;
+    LoRaNetworkTime root = sync.networkTime(true, 777);
+    TEST_ASSERT_TRUE(root.synced);
+    TEST_ASSERT_EQUAL_UINT8(0, root.stratum);
+    TEST_ASSERT_EQUAL_UINT32(777, root.us);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint32_t localUs = START_US + i * STEP_US;
+        sync.onTrailer(5, i, trailerAt(peerUs(localUs, 0), 1), localUs);
+    }
+    TEST_ASSERT_FALSE(sync.networkTime(false, START_US + 4 * STEP_US).synced);
+    uint32_t localUs;
+    TEST_ASSERT_FALSE(sync.toLocalUs(0, START_US, localUs));
+}
+
+// Поправка отправителя в следующей метке уточняет уже принятую выборку: без поправок
+// смещение ушло бы на ошибку меток
+void test_sender_correction_refines_sample()
+{
+    LoRaTimeSync corrected;
+    LoRaTimeSync raw;
+    uint32_t lastUs = START_US;
+    for (uint8_t i = 0; i < LORA_TIMESYNC_SAMPLES; i++) {
+        lastUs = START_US + i * STEP_US;
+        // Метки предсказали TX done на 300 мкс раньше, чем он случился; последняя - точно
+        bool last = i == LORA_TIMESYNC_SAMPLES - 1;
+        LoRaTimeTrailer trailer = trailerAt(peerUs(lastUs, 0) - (last ? 0 : 300));
+        raw.onTrailer(ROOT, i, trailer, lastUs);
+        if (i > 0) {
+            trailer.prevId = i - 1;
+            trailer.prevCorrUs = 300;
+        }
+        corrected.onTrailer(ROOT, i, trailer, lastUs);
+    }
+    LoRaPeerClock clock;
+    TEST_ASSERT_TRUE(corrected.peerClock(ROOT, lastUs, clock));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 0, clock.driftPpm);
+    TEST_ASSERT_INT32_WITHIN(2, (int32_t)OFFSET_US, clock.offsetUs);
+
+    TEST_ASSERT_TRUE(raw.peerClock(ROOT, lastUs, clock));
+    TEST_ASSERT_TRUE(abs(clock.offsetUs - (int32_t)OFFSET_US) > 100);
+}
+
+// Одиночный выброс отбрасывается, LORA_TIMESYNC_MAX_REJECTS подряд - часы соседа заново
+void test_outliers()
+{
+    LoRaTimeSync sync;
+    uint32_t lastUs = feed(sync, 4, 0);
+
+    uint32_t jumpUs = lastUs + STEP_US;
+    int32_t deviation = sync.onTrailer(ROOT, 10, trailerAt(peerUs(jumpUs, 0) + 10000), jumpUs);
+    TEST_ASSERT_INT32_WITHIN(5, 10000, deviation);
+    LoRaPeerClock clock;
+    TEST_ASSERT_TRUE(sync.peerClock(ROOT, jumpUs, clock));
+    TEST_ASSERT_EQUAL_UINT8(4, clock.samples);
+    TEST_ASSERT_INT32_WITHIN(2, (int32_t)OFFSET_US, clock.offsetUs);
+
+    for (uint8_t i = 1; i < LORA_TIMESYNC_MAX_REJECTS; i++) {
+        jumpUs += STEP_US;
+        sync.onTrailer(ROOT, 10 + i, trailerAt(peerUs(jumpUs, 0) + 10000), jumpUs);
+    }
+    TEST_ASSERT_TRUE(sync.peerClock(ROOT, jumpUs, clock));
+    TEST_ASSERT_EQUAL_UINT8(1, clock.samples);
+    TEST_ASSERT_INT32_WITHIN(2, (int32_t)OFFSET_US + 10000, clock.offsetUs);
+}
+
+// Без меток дольше LORA_TIMESYNC_TIMEOUT_MS часы соседа не отдаются
+void test_peer_clock_timeout()
+{
+    LoRaTimeSync sync;
+    uint32_t lastUs = feed(sync, 3, 0);
+    LoRaPeerClock clock;
+    TEST_ASSERT_TRUE(sync.peerClock(ROOT, lastUs + LORA_TIMESYNC_TIMEOUT_MS * 1000UL - 1, clock));
+    TEST_ASSERT_FALSE(sync.peerClock(ROOT, lastUs + LORA_TIMESYNC_TIMEOUT_MS * 1000UL, clock));
+    TEST_ASSERT_FALSE(sync.peerClock(9, lastUs, clock));
+}
+
+// Отправитель: ошибка предсказания TX done уходит поправкой в следующую метку, её среднее -
+// в задержку запуска
+void test_stamper_corrections()
+{
+    LoRaTimeStamper stamper;
+    LoRaTimeTrailer trailer;
+    stamper.stamp(trailer, 1, 1000, 5000);
+    TEST_ASSERT_EQUAL_UINT32(6000, trailer.stampUs);
+    TEST_ASSERT_EQUAL_INT32(LORA_TIME_NO_CORR, trailer.prevCorrUs);
+    stamper.onTxDone(6400);
+    TEST_ASSERT_EQUAL_INT32(400, stamper.getStartLatencyUs());
+
+    stamper.stamp(trailer, 2, 10000, 5000);
+    TEST_ASSERT_EQUAL_UINT8(1, trailer.prevId);
+    TEST_ASSERT_EQUAL_INT32(400, trailer.prevCorrUs);
+    TEST_ASSERT_EQUAL_UINT32(15400, trailer.stampUs);
+
+    // Неудачная передача: поправка кадра 1 ещё не доставлена и остаётся
+    stamper.onTxFailed();
+    stamper.stamp(trailer, 3, 20000, 5000);
+    TEST_ASSERT_EQUAL_UINT8(1, trailer.prevId);
+    TEST_ASSERT_EQUAL_INT32(400, trailer.prevCorrUs);
+    stamper.onTxDone(25400 + 100);
+    stamper.stamp(trailer, 4, 30000, 5000);
+    TEST_ASSERT_EQUAL_UINT8(3, trailer.prevId);
+    TEST_ASSERT_EQUAL_INT32(100, trailer.prevCorrUs);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_trailer_body_len);
+    RUN_TEST(test_trailer_fits);
+    RUN_TEST(test_peer_offset_and_drift);
+    RUN_TEST(test_network_time_root_and_unsynced);
+    RUN_TEST(test_sender_correction_refines_sample);
+    RUN_TEST(test_outliers);
+    RUN_TEST(test_peer_clock_timeout);
+    RUN_TEST(test_stamper_corrections);
+    return UNITY_END();
+}
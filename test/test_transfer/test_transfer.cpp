@@ -0,0 +1,248 @@
+// test_transfer.cpp - Block transfer: SHA-256 vectors, sender/receiver state machine over a lossy link
+#include <unity.h>
+#include <functional>
+#include "lora_transfer.hpp"
+#include "lora_packets.hpp"
+
+static constexpr LoraAddress_t SENDER = 1;
+static constexpr uint32_t FRAME_MS = 100;
+static constexpr uint32_t DATA_SIZE = 1000;     // 14 блоков, последний короткий
+
+static uint8_t source[DATA_SIZE];
+
+// Кадр отправителя n: false - потерян; кадр можно испортить
+using LinkFilter = std::function<bool(uint32_t n, uint8_t *frame, uint8_t len)>;
+
+// Обмен без эфира: кадр отправителя - получателю, ответ - сразу отправителю. Время идёт по
+// FRAME_MS за шаг, пока отправитель активен, но не дольше maxFrames кадров
+static void pump(LoRaTransferSender &tx, LoRaTransferReceiver &rx, LoRaTransferSink *sink, unsigned long &nowMs,
+                 uint8_t maxLen, const LinkFilter &link = nullptr, uint32_t maxFrames = 1000)
+{
+    auto handler = [sink](LoraAddress_t, const LoRaTransferOffer &) { return sink; };
+    uint8_t frame[MAX_LORA_PAYLOAD];
+    uint8_t reply[MAX_LORA_PAYLOAD];
+    uint32_t frames = 0;
+    for (uint32_t step = 0; step < 100000 && tx.isActive() && frames < maxFrames; step++) {
+        nowMs += FRAME_MS;
+        uint8_t len = tx.nextFrame(nowMs, FRAME_MS, frame, maxLen);
+        if (!len) {
+            continue;
+        }
+        uint32_t n = frames++;
+        if (link && !link(n, frame, len)) {
+            continue;
+        }
+        uint8_t replyLen = rx.onFrame(SENDER, frame, len, nowMs, handler, reply);
+        if (replyLen) {
+            tx.onFrame(reply, replyLen, nowMs);
+        }
+    }
+}
+
+static String hex(const uint8_t *data, size_t len)
+{
+    String s;
+    char byte[3];
+    for (size_t i = 0; i < len; i++) {
+        snprintf(byte, sizeof(byte), "%02x", data[i]);
+        s += byte;
+    }
+    return s;
+}
+
+static String sha256(const char *text)
+{
+    LoRaSha256 sha;
+    sha.update(reinterpret_cast<const uint8_t *>(text), strlen(text));
+    uint8_t digest[LORA_SHA256_SIZE];
+    sha.finish(digest);
+    return hex(digest, sizeof(digest));
+}
+
+void setUp()
+{
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        source[i] = (uint8_t)(i * 7 + i / 256);
+    }
+}
+
+void tearDown() {}
+
+// Векторы FIPS 180-4: пустое сообщение, один блок, сообщение на два блока
+void test_sha256_vectors()
+{
+    TEST_ASSERT_EQUAL_STRING("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", sha256("").c_str());
+    TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha256("abc").c_str());
+    TEST_ASSERT_EQUAL_STRING("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+                             sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq").c_str());
+}
+
+// Хэш не зависит от того, какими кусками пришли данные
+void test_sha256_streaming()
+{
+    uint8_t whole[LORA_SHA256_SIZE];
+    uint8_t parts[LORA_SHA256_SIZE];
+    LoRaSha256 sha;
+    sha.update(source, DATA_SIZE);
+    sha.finish(whole);
+
+    sha.reset();
+    for (uint32_t offset = 0; offset < DATA_SIZE; offset += 63) {
+        sha.update(source + offset, std::min<uint32_t>(63, DATA_SIZE - offset));
+    }
+    sha.finish(parts);
+    TEST_ASSERT_EQUAL_MEMORY(whole, parts, LORA_SHA256_SIZE);
+}
+
+// OFFERING -> SENDING по первому отчёту -> DONE; каждый блок ушёл один раз
+void test_transfer_lossless()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaMemorySink sink(DATA_SIZE);
+    LoRaTransferSender tx;
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    TEST_ASSERT_TRUE(tx.start(2, src, LORA_XFER_KIND_FILE, 1, nowMs));
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::OFFERING);
+
+    pump(tx, rx, &sink, nowMs, LORA_BASE_MTU, nullptr, 1);
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::SENDING);
+    TEST_ASSERT_TRUE(rx.isActive());
+
+    pump(tx, rx, &sink, nowMs, LORA_BASE_MTU);
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::DONE);
+    TEST_ASSERT_TRUE(rx.getProgress().state == TransferState::DONE);
+    TEST_ASSERT_TRUE(sink.isComplete());
+    TEST_ASSERT_EQUAL_MEMORY(source, sink.data().data(), DATA_SIZE);
+    uint16_t blocks = (DATA_SIZE + LORA_XFER_BLOCK_SIZE - 1) / LORA_XFER_BLOCK_SIZE;
+    TEST_ASSERT_EQUAL_UINT32(blocks, tx.getProgress().framesSent);
+    TEST_ASSERT_EQUAL_UINT16(blocks, tx.getProgress().blocksDone);
+}
+
+// MTU больше блока: несколько блоков подряд в одном кадре DATA
+void test_transfer_multi_block_frames()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaMemorySink sink(DATA_SIZE);
+    LoRaTransferSender tx;
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    tx.start(2, src, LORA_XFER_KIND_FILE, 1, nowMs);
+    pump(tx, rx, &sink, nowMs, MAX_LORA_PAYLOAD);
+    TEST_ASSERT_TRUE(sink.isComplete());
+    TEST_ASSERT_EQUAL_MEMORY(source, sink.data().data(), DATA_SIZE);
+    TEST_ASSERT_EQUAL_UINT32((tx.getProgress().blockCount + 2) / 3, tx.getProgress().framesSent);
+}
+
+// Потери кадров (в том числе запросов отчёта): блоки повторяются, данные и хэш сходятся
+void test_transfer_lossy_link()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaMemorySink sink(DATA_SIZE);
+    LoRaTransferSender tx;
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    tx.start(2, src, LORA_XFER_KIND_FILE, 1, nowMs);
+    pump(tx, rx, &sink, nowMs, LORA_BASE_MTU, [](uint32_t n, uint8_t *, uint8_t) { return n % 3 != 2; });
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::DONE);
+    TEST_ASSERT_TRUE(sink.isComplete());
+    TEST_ASSERT_EQUAL_MEMORY(source, sink.data().data(), DATA_SIZE);
+    TEST_ASSERT_TRUE(tx.getProgress().framesSent > tx.getProgress().blockCount);
+}
+
+// Блок, испорченный в пути: все блоки приняты, SHA-256 не сошёлся - HASH_MISMATCH у обоих
+void test_transfer_hash_mismatch()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaMemorySink sink(DATA_SIZE);
+    LoRaTransferSender tx;
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    tx.start(2, src, LORA_XFER_KIND_FILE, 1, nowMs);
+    pump(tx, rx, &sink, nowMs, LORA_BASE_MTU, [](uint32_t n, uint8_t *frame, uint8_t len) {
+        if (n == 3 && len > LORA_XFER_DATA_HEADER_SIZE) {
+            frame[LORA_XFER_DATA_HEADER_SIZE] ^= 0xFF;
+        }
+        return true;
+    });
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::FAILED);
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_HASH_MISMATCH, tx.getProgress().result);
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_HASH_MISMATCH, rx.getProgress().result);
+    TEST_ASSERT_FALSE(sink.isComplete());
+}
+
+// Получатель без приёмника отказывает: отправитель FAILED с REJECTED
+void test_transfer_rejected()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaTransferSender tx;
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    tx.start(2, src, LORA_XFER_KIND_FIRMWARE, 1, nowMs);
+    pump(tx, rx, nullptr, nowMs, LORA_BASE_MTU);
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::FAILED);
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_REJECTED, tx.getProgress().result);
+    TEST_ASSERT_FALSE(rx.isActive());
+}
+
+// Новая передача того же содержимого продолжает прерванный приём с первого непринятого блока
+void test_transfer_resume()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaMemorySink sink(DATA_SIZE);
+    LoRaTransferReceiver rx;
+    unsigned long nowMs = 1000;
+    {
+        LoRaTransferSender first;
+        first.start(2, src, LORA_XFER_KIND_FILE, 1, nowMs);
+        pump(first, rx, &sink, nowMs, LORA_BASE_MTU, nullptr, 8);
+        TEST_ASSERT_TRUE(first.isActive());
+    }
+    TEST_ASSERT_TRUE(rx.isActive());
+    uint16_t received = rx.getProgress().blocksDone;
+    TEST_ASSERT_TRUE(received > 0);
+
+    LoRaTransferSender second;
+    second.start(2, src, LORA_XFER_KIND_FILE, 2, nowMs);
+    pump(second, rx, &sink, nowMs, LORA_BASE_MTU);
+    TEST_ASSERT_TRUE(second.getProgress().state == TransferState::DONE);
+    TEST_ASSERT_TRUE(sink.isComplete());
+    TEST_ASSERT_EQUAL_MEMORY(source, sink.data().data(), DATA_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(second.getProgress().blockCount - received, second.getProgress().framesSent);
+}
+
+// Получатель молчит: после LORA_XFER_ABORT_MS отправитель сдаётся и шлёт ABORT
+void test_transfer_sender_timeout()
+{
+    LoRaMemorySource src(source, DATA_SIZE);
+    LoRaTransferSender tx;
+    unsigned long nowMs = 1000;
+    tx.start(2, src, LORA_XFER_KIND_FILE, 7, nowMs);
+    uint8_t frame[MAX_LORA_PAYLOAD];
+    TEST_ASSERT_TRUE(tx.nextFrame(nowMs, FRAME_MS, frame, LORA_BASE_MTU) > 0);
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_OP_OFFER, frame[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, tx.nextFrame(nowMs + 1, FRAME_MS, frame, LORA_BASE_MTU));
+
+    nowMs += LORA_XFER_ABORT_MS + 1;
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_HEADER_SIZE + 1, tx.nextFrame(nowMs, FRAME_MS, frame, LORA_BASE_MTU));
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_OP_ABORT, frame[0]);
+    TEST_ASSERT_EQUAL_UINT8(7, frame[1]);
+    TEST_ASSERT_EQUAL_UINT8(LORA_XFER_TIMEOUT, frame[2]);
+    TEST_ASSERT_TRUE(tx.getProgress().state == TransferState::FAILED);
+    TEST_ASSERT_FALSE(tx.isActive());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sha256_vectors);
+    RUN_TEST(test_sha256_streaming);
+    RUN_TEST(test_transfer_lossless);
+    RUN_TEST(test_transfer_multi_block_frames);
+    RUN_TEST(test_transfer_lossy_link);
+    RUN_TEST(test_transfer_hash_mismatch);
+    RUN_TEST(test_transfer_rejected);
+    RUN_TEST(test_transfer_resume);
+    RUN_TEST(test_transfer_sender_timeout);
+    return UNITY_END();
+}
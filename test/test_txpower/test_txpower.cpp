@@ -0,0 +1,130 @@
+// test_txpower.cpp - LoRaTxPowerControl: power steps from link reports, losses, report pacing
+#include <unity.h>
+#include "lora_txpower.hpp"
+
+static constexpr LoraAddress_t PEER = 2;
+static constexpr uint8_t SF = 12;
+static constexpr float BW_KHZ = 125.0f;
+
+// Отчёт о кадре id, переданном на powerDbm: SNR на полной мощности fullSnr, RSSI -120 дБм
+static int8_t report(LoRaTxPowerControl &tpc, PacketId_t id, int8_t powerDbm, float fullSnr, uint32_t nowMs)
+{
+    tpc.onSent(id, powerDbm);
+    float offset = LORA_TX_POWER - powerDbm;
+    tpc.onReport(PEER, id, fullSnr - offset, -120.0f - offset, SF, BW_KHZ, nowMs);
+    return tpc.powerFor(PEER, nowMs);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_txpower_demod_floor()
+{
+    TEST_ASSERT_EQUAL_INT(-20, (int)loraDemodFloorDb(12));
+    TEST_ASSERT_EQUAL_INT(-75, (int)(loraDemodFloorDb(7) * 10));
+    TEST_ASSERT_EQUAL_INT(-25, (int)(loraDemodFloorDb(4) * 10));
+}
+
+void test_txpower_unknown_peer_full_power()
+{
+    LoRaTxPowerControl tpc;
+    TEST_ASSERT_EQUAL_INT8(LORA_TX_POWER, tpc.powerFor(PEER, 0));
+}
+
+// SNR 6 дБ на SF12 - запас 26 дБ: цель на 16 дБ ниже полной, не больше LORA_TPC_STEP_DOWN_DB за отчёт
+void test_txpower_steps_down_per_report()
+{
+    LoRaTxPowerControl tpc;
+    int8_t power = LORA_TX_POWER;
+    const int8_t expected[] = {18, 14, 10, 6, 6};
+    for (uint8_t i = 0; i < sizeof(expected); i++) {
+        power = report(tpc, i, power, 6.0f, i * 1000);
+        TEST_ASSERT_EQUAL_INT8(expected[i], power);
+    }
+}
+
+// Рост - сразу до мощности по отчёту, без шага
+void test_txpower_rises_at_once()
+{
+    LoRaTxPowerControl tpc;
+    int8_t power = LORA_TX_POWER;
+    for (uint8_t i = 0; i < 4; i++) {
+        power = report(tpc, i, power, 6.0f, i * 1000);
+    }
+    TEST_ASSERT_EQUAL_INT8(6, power);
+    // Сглаженный SNR: 0.3 * -1 + 0.7 * 6 = 3.9, запас 23.9 дБ - цель 22 - 13
+    TEST_ASSERT_EQUAL_INT8(9, report(tpc, 10, power, -1.0f, 5000));
+}
+
+// Запас 67 дБ: снижение по шагам до LORA_TPC_MIN_DBM, не ниже
+void test_txpower_clamped_to_min()
+{
+    LoRaTxPowerControl tpc;
+    int8_t power = LORA_TX_POWER;
+    for (uint8_t i = 0; i < 20; i++) {
+        power = report(tpc, i, power, 47.0f, i * 1000);
+    }
+    TEST_ASSERT_EQUAL_INT8(LORA_TPC_MIN_DBM, power);
+}
+
+// LORA_TPC_LOSS_LIMIT повторов подряд - шаг вверх; ACK между ними сбрасывает счёт
+void test_txpower_losses_step_up()
+{
+    LoRaTxPowerControl tpc;
+    int8_t power = LORA_TX_POWER;
+    for (uint8_t i = 0; i < 4; i++) {
+        power = report(tpc, i, power, 6.0f, i * 1000);
+    }
+    tpc.onLoss(PEER);
+    tpc.onAck(PEER);
+    tpc.onLoss(PEER);
+    TEST_ASSERT_EQUAL_INT8(power, tpc.powerFor(PEER, 4000));
+    tpc.onLoss(PEER);
+    TEST_ASSERT_EQUAL_INT8(power + LORA_TPC_STEP_UP_DB, tpc.powerFor(PEER, 4000));
+    for (uint8_t i = 0; i < 2 * LORA_TPC_LOSS_LIMIT * LORA_TX_POWER; i++) {
+        tpc.onLoss(PEER);
+    }
+    TEST_ASSERT_EQUAL_INT8(LORA_TX_POWER, tpc.powerFor(PEER, 4000));
+}
+
+void test_txpower_report_timeout()
+{
+    LoRaTxPowerControl tpc;
+    report(tpc, 1, LORA_TX_POWER, 6.0f, 1000);
+    TEST_ASSERT_EQUAL_INT8(18, tpc.powerFor(PEER, 1000 + LORA_TPC_REPORT_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL_INT8(LORA_TX_POWER, tpc.powerFor(PEER, 1001 + LORA_TPC_REPORT_TIMEOUT_MS));
+}
+
+// Приёмник: первый кадр - отчёт, дальше - по интервалу или при изменении сглаженного SNR
+void test_txpower_report_pacing()
+{
+    LoRaTxPowerControl tpc;
+    TEST_ASSERT_TRUE(tpc.reportDue(PEER, 0.0f, 0));
+    TEST_ASSERT_FALSE(tpc.reportDue(PEER, 0.0f, 1000));
+    // Сглаженный SNR 6 дБ, но раньше LORA_TPC_REPORT_MIN_MS
+    TEST_ASSERT_FALSE(tpc.reportDue(PEER, 20.0f, LORA_TPC_REPORT_MIN_MS - 1));
+    // Один кадр на 9 дБ лучше сдвигает сглаженный SNR меньше LORA_TPC_REPORT_DELTA_DB, второй - уже нет
+    LoRaTxPowerControl fading;
+    fading.reportDue(PEER, 0.0f, 0);
+    TEST_ASSERT_FALSE(fading.reportDue(PEER, 9.0f, LORA_TPC_REPORT_MIN_MS));
+    TEST_ASSERT_TRUE(fading.reportDue(PEER, 9.0f, LORA_TPC_REPORT_MIN_MS + 1));
+    // Без изменений - раз в LORA_TPC_REPORT_INTERVAL_MS
+    LoRaTxPowerControl steady;
+    steady.reportDue(PEER, 0.0f, 0);
+    TEST_ASSERT_FALSE(steady.reportDue(PEER, 0.0f, LORA_TPC_REPORT_INTERVAL_MS - 1));
+    TEST_ASSERT_TRUE(steady.reportDue(PEER, 0.0f, LORA_TPC_REPORT_INTERVAL_MS));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_txpower_demod_floor);
+    RUN_TEST(test_txpower_unknown_peer_full_power);
+    RUN_TEST(test_txpower_steps_down_per_report);
+    RUN_TEST(test_txpower_rises_at_once);
+    RUN_TEST(test_txpower_clamped_to_min);
+    RUN_TEST(test_txpower_losses_step_up);
+    RUN_TEST(test_txpower_report_timeout);
+    RUN_TEST(test_txpower_report_pacing);
+    return UNITY_END();
+}